@@ -0,0 +1,106 @@
+// -*- C++ -*-
+/*! \file
+ *  \brief Batched evaluation over multi1d<LatticeColorMatrix>
+ *
+ *  Times u[mu] = u[mu] * s[mu] + c * shift(s[mu], FORWARD, mu) for all
+ *  directions, once as Nd evaluations and once with evaluate_batch, which
+ *  launches a single kernel. Both must give the same field, on all sites
+ *  and on the even checkerboard.
+ */
+
+#include "qdp.h"
+
+#include <iomanip>
+#include <sstream>
+
+using namespace QDP;
+
+
+//! Best time in seconds of iter runs of f
+template<class F>
+double best(F f, int iter)
+{
+  f();   // build the kernel
+  CudaDeviceSynchronize();
+
+  double t = 1e30;
+  for (int i = 0; i < iter; ++i) {
+    StopWatch swatch;
+    swatch.start();
+    f();
+    CudaDeviceSynchronize();
+    swatch.stop();
+    t = std::min(t, swatch.getTimeInSeconds());
+  }
+  return t;
+}
+
+
+int main(int argc, char *argv[])
+{
+  // Put the machine into a known state
+  QDP_initialize(&argc, &argv);
+
+  // Setup the layout
+  const int foo[] = {8,8,8,16};
+  multi1d<int> nrow(Nd);
+  nrow = foo;  // Use only Nd elements
+  Layout::setLattSize(nrow);
+  Layout::create();
+
+  const int iter = 20;
+  const Real c = 0.25;
+
+  multi1d<LatticeColorMatrix> u0(Nd), s(Nd), u(Nd), v(Nd);
+  for(int mu=0; mu < Nd; ++mu) {
+    gaussian(u0[mu]);
+    gaussian(s[mu]);
+  }
+
+  auto f = [&](int mu) { return u[mu] * s[mu] + c * shift(s[mu], FORWARD, mu); };
+
+  QDPIO::cout << "u[mu] = u[mu] * s[mu] + c * shift(s[mu], FORWARD, mu) on " << Layout::vol() << " sites" << std::endl;
+  QDPIO::cout << "subset      Nd kernels   1 kernel   [ms]" << std::endl;
+
+  int failed = 0;
+
+  const Subset* subsets[] = { &all, &rb[0] };
+  const char*   names[]   = { "all", "even" };
+  for(int i=0; i < 2; ++i)
+  {
+    const Subset& sub = *subsets[i];
+
+    u = u0;
+    double t_single = best([&]{ for(int mu=0; mu < Nd; ++mu) u[mu][sub] = f(mu); }, iter);
+    u = u0;
+    double t_batch  = best([&]{ evaluate_batch(u, OpAssign(), f, sub); }, iter);
+
+    // One step from the same start
+    u = u0;
+    v = u0;
+    for(int mu=0; mu < Nd; ++mu)
+      v[mu][sub] = f(mu);
+    evaluate_batch(u, OpAssign(), f, sub);
+
+    Double diff = zero;
+    for(int mu=0; mu < Nd; ++mu)
+      diff += norm2(u[mu] - v[mu]);
+    bool ok = toDouble(diff) == 0.0;
+    failed += !ok;
+
+    std::ostringstream row;
+    row << std::left << std::setw(10) << names[i] << std::right
+	<< std::fixed << std::setprecision(3)
+	<< std::setw(12) << t_single * 1e3
+	<< std::setw(11) << t_batch * 1e3
+	<< (ok ? "" : "  MISMATCH");
+    QDPIO::cout << row.str() << std::endl;
+  }
+
+  QDPIO::cout << "Summary: " << failed << " failures" << std::endl;
+
+  // Time to bolt
+  QDP_finalize();
+
+  exit(failed ? 1 : 0);
+}
@@ -0,0 +1,117 @@
+// -*- C++ -*-
+/*! \file
+ *  \brief Checkerboard fields with half-volume storage
+ *
+ *  Packs the even and odd sites of a LatticeFermion into LatticeFermionCB
+ *  fields and unpacks them again, which must give back the field. Then
+ *  checks and times the axpy y = a*x + y and norm2 on a checkerboard, once
+ *  with full fields under rb[cb] and once on the half-volume fields, and
+ *  prints the device bytes per vector of both.
+ */
+
+#include "qdp.h"
+
+#include <iomanip>
+#include <sstream>
+
+using namespace QDP;
+
+
+//! Best time in seconds of iter runs of f
+template<class F>
+double best(F f, int iter)
+{
+  f();   // build the kernel
+  CudaDeviceSynchronize();
+
+  double t = 1e30;
+  for (int i = 0; i < iter; ++i) {
+    StopWatch swatch;
+    swatch.start();
+    f();
+    CudaDeviceSynchronize();
+    swatch.stop();
+    t = std::min(t, swatch.getTimeInSeconds());
+  }
+  return t;
+}
+
+
+int main(int argc, char *argv[])
+{
+  // Put the machine into a known state
+  QDP_initialize(&argc, &argv);
+
+  // Setup the layout
+  const int foo[] = {16,16,16,32};
+  multi1d<int> nrow(Nd);
+  nrow = foo;  // Use only Nd elements
+  Layout::setLattSize(nrow);
+  Layout::create();
+
+  const int  iter = 20;
+  const Real a    = 0.5;
+
+  int failed = 0;
+
+  // Round trip through both checkerboards
+  LatticeFermion psi, back;
+  gaussian(psi);
+  back = zero;
+
+  LatticeFermionCB even(0), odd(1);
+  pack(even, psi);
+  pack(odd, psi);
+  unpack(back, even);
+  unpack(back, odd);
+
+  bool ok = toDouble(norm2(back - psi)) == 0.0;
+  failed += !ok;
+  QDPIO::cout << "pack/unpack round trip" << (ok ? "" : "  MISMATCH") << std::endl;
+
+  QDPIO::cout << "y = a*x + y and norm2 on " << LatticeFermionCB::sites() << " sites per node" << std::endl;
+  QDPIO::cout << "cb    full [ms]    half [ms]   bytes full / half" << std::endl;
+
+  for(int cb = 0; cb < 2; ++cb)
+  {
+    LatticeFermion   x, y, y0;
+    LatticeFermionCB xh(cb), yh(cb);
+    gaussian(x);
+    gaussian(y0);
+    y = y0;
+    pack(xh, x);
+    pack(yh, y0);
+
+    // One step from the same start
+    y[rb[cb]] = a * x + y;
+    yh = a * xh + yh;
+
+    LatticeFermion yb = zero;
+    unpack(yb, yh);
+    double n_full = toDouble(norm2(y, rb[cb]));
+    double n_half = toDouble(norm2(yh));
+
+    bool ok = toDouble(norm2(yb - y, rb[cb])) == 0.0 && fabs(n_full - n_half) <= 1e-12 * n_full;
+    failed += !ok;
+
+    double t_full = best([&]{ y[rb[cb]] = a * x + y; norm2(y, rb[cb]); }, iter);
+    double t_half = best([&]{ yh = a * xh + yh; norm2(yh); }, iter);
+
+    std::ostringstream row;
+    row << std::setw(2) << cb
+	<< std::fixed << std::setprecision(3)
+	<< std::setw(13) << t_full * 1e3
+	<< std::setw(13) << t_half * 1e3
+	<< std::setw(12) << Layout::sitesOnNode() * sizeof(LatticeFermion::SubType_t)
+	<< " / " << LatticeFermionCB::sites() * sizeof(LatticeFermion::SubType_t)
+	<< (ok ? "" : "  MISMATCH");
+    QDPIO::cout << row.str() << std::endl;
+  }
+
+  QDPIO::cout << "Summary: " << failed << " failures" << std::endl;
+
+  // Time to bolt
+  QDP_finalize();
+
+  exit(failed ? 1 : 0);
+}
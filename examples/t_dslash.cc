@@ -0,0 +1,132 @@
+// -*- C++ -*-
+/*! \file
+ *  \brief Wilson hopping term: check and throughput of wilsonDslash
+ *
+ *  Compares wilsonDslash with the hopping term written with full spinor
+ *  shifts and Gamma matrices, for both signs and checkerboards, and
+ *  prints the flops and memory bandwidth of both. The bandwidth counts
+ *  8 links, 8 neighbour spinors and the result per site. Run on several
+ *  nodes to include the halo exchange, e.g.
+ *
+ *      mpirun -np 2 ./t_dslash -geom 1 1 1 2
+ */
+
+#include "qdp.h"
+#include "examples.h"
+
+#include <iomanip>
+#include <sstream>
+
+using namespace QDP;
+
+
+//! Best time in seconds of iter runs of f
+template<class F>
+double best(F f, int iter)
+{
+  f();   // build the kernel
+  CudaDeviceSynchronize();
+
+  double t = 1e30;
+  for (int i = 0; i < iter; ++i) {
+    StopWatch swatch;
+    swatch.start();
+    f();
+    CudaDeviceSynchronize();
+    swatch.stop();
+    t = std::min(t, swatch.getTimeInSeconds());
+  }
+  return t;
+}
+
+
+//! The hopping term with full spinors, term by term
+void dslashNaive(LatticeFermion& chi, const multi1d<LatticeColorMatrix>& u, const LatticeFermion& psi,
+		 int isign, int cb)
+{
+  chi[rb[cb]] = zero;
+  for(int mu=0; mu < Nd; ++mu)
+  {
+    LatticeFermion fwd, bwd;
+    fwd[rb[cb]] = u[mu] * shift(psi, FORWARD, mu);
+    bwd[rb[cb]] = shift(adj(u[mu]) * psi, BACKWARD, mu);
+
+    if (isign > 0)
+      chi[rb[cb]] += fwd - Gamma(1 << mu) * fwd + bwd + Gamma(1 << mu) * bwd;
+    else
+      chi[rb[cb]] += fwd + Gamma(1 << mu) * fwd + bwd - Gamma(1 << mu) * bwd;
+  }
+}
+
+
+int main(int argc, char *argv[])
+{
+  // Put the machine into a known state
+  QDP_initialize(&argc, &argv);
+
+  // Setup the layout
+  const int foo[] = {16,16,16,32};
+  multi1d<int> nrow(Nd);
+  nrow = foo;  // Use only Nd elements
+  Layout::setLattSize(nrow);
+  Layout::create();
+
+  const int    iter  = 10;
+  const double sites = (double)Layout::vol() / 2;
+  const double flops = 1320.0 * sites;
+  const double bytes = (8.0 * sizeof(ColorMatrix) + 9.0 * sizeof(Fermion)) * sites;
+
+  multi1d<LatticeColorMatrix> u(Nd);
+  for(int mu=0; mu < Nd; ++mu) {
+    gaussian(u[mu]);
+    reunit(u[mu]);
+  }
+
+  LatticeFermion psi, chi, ref;
+  gaussian(psi);
+  chi = zero;
+  ref = zero;
+
+  int failed = 0;
+
+  // Same result for both signs and checkerboards
+  for(int isign = -1; isign <= 1; isign += 2)
+    for(int cb = 0; cb < 2; ++cb)
+    {
+      wilsonDslash(chi, u, psi, isign, cb);
+      dslashNaive(ref, u, psi, isign, cb);
+
+      double rel = toDouble(norm2(chi - ref, rb[cb])) / toDouble(norm2(ref, rb[cb]));
+      bool ok = rel < 1e-10;
+      failed += !ok;
+      std::ostringstream row;
+      row << "isign = " << std::setw(2) << isign << "  cb = " << cb
+	  << "  |chi - ref|^2 / |ref|^2 = " << rel << (ok ? "" : "  MISMATCH");
+      QDPIO::cout << row.str() << std::endl;
+    }
+
+  double t_fused = best([&]{ wilsonDslash(chi, u, psi, +1, 0); }, iter);
+  double t_naive = best([&]{ dslashNaive(ref, u, psi, +1, 0); }, iter);
+
+  QDPIO::cout << "Wilson hopping term on " << sites << " sites" << std::endl;
+  QDPIO::cout << "version        GFlop/s      GB/s" << std::endl;
+
+  const char* names[] = { "naive", "projected" };
+  const double times[] = { t_naive, t_fused };
+  for(int i=0; i < 2; ++i)
+  {
+    std::ostringstream row;
+    row << std::left << std::setw(12) << names[i] << std::right
+	<< std::fixed << std::setprecision(1)
+	<< std::setw(11) << flops / times[i] * 1e-9
+	<< std::setw(10) << bytes / times[i] * 1e-9;
+    QDPIO::cout << row.str() << std::endl;
+  }
+
+  QDPIO::cout << "Summary: " << failed << " failures" << std::endl;
+
+  // Time to bolt
+  QDP_finalize();
+
+  exit(failed ? 1 : 0);
+}
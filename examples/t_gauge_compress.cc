@@ -0,0 +1,114 @@
+// -*- C++ -*-
+/*! \file
+ *  \brief Check and time the 12 and 8 real compressed gauge fields
+ *
+ *  Besides random links, the unit gauge and diagonal links are packed and
+ *  rebuilt in a kernel: there the 8-real form has a1 = a2 = 0 and must
+ *  take its block diagonal branch.
+ */
+
+#include "qdp.h"
+#include "examples.h"
+
+#include <cmath>
+#include <limits>
+
+using namespace QDP;
+
+
+template<class U>
+double time_mult(LatticeFermion& chi, const U& u, const LatticeFermion& psi, int iter)
+{
+  chi = u * psi;   // build the kernel outside the timing
+
+  StopWatch swatch;
+  swatch.start();
+  for (int i = 0; i < iter; ++i)
+    chi = u * psi;
+  swatch.stop();
+
+  return swatch.getTimeInMicroseconds() / iter;
+}
+
+
+//! Whether u survives packing to 12 and 8 reals and rebuilding in a kernel
+bool roundTrip(const std::string& name, const LatticeColorMatrix& u)
+{
+  LatticeColorMatrixRecon12 u12(u);
+  LatticeColorMatrixRecon8  u8(u);
+
+  LatticeColorMatrix v;
+  v = u12;  double d12 = toDouble( norm2( u - v ) );
+  v = u8;   double d8  = toDouble( norm2( u - v ) );
+
+  // Rounding of the working precision on every site, NaN fails as well
+  double tol = 100.0 * Layout::vol() * std::pow( (double)std::numeric_limits<REAL>::epsilon() , 2 );
+  bool ok = d12 <= tol && d8 <= tol;
+  QDPIO::cout << name << ": |u - recon12|^2 = " << d12 << "  |u - recon8|^2 = " << d8
+	      << (ok ? "" : "  FAILED") << endl;
+  return ok;
+}
+
+
+int main(int argc, char *argv[])
+{
+  // Put the machine into a known state
+  QDP_initialize(&argc, &argv);
+
+  // Setup the layout
+  const int foo[] = {8,8,8,16};
+  multi1d<int> nrow(Nd);
+  nrow = foo;  // Use only Nd elements
+  Layout::setLattSize(nrow);
+  Layout::create();
+
+  LatticeColorMatrix u;
+  LatticeFermion psi, chi, chi12, chi8;
+  gaussian(u);
+  reunit(u);
+  gaussian(psi);
+
+  LatticeColorMatrixRecon12 u12(u);
+  LatticeColorMatrixRecon8  u8(u);
+
+  // Reconstructed matrices against the original
+  LatticeColorMatrix v;
+  v = u12;  QDPIO::cout << "|u - recon12|^2 = " << norm2( u - v ) << endl;
+  v = u8;   QDPIO::cout << "|u - recon8|^2  = " << norm2( u - v ) << endl;
+
+  // In expressions
+  chi = u * psi;
+  chi12 = u12 * psi;
+  chi8  = u8 * psi;
+  QDPIO::cout << "|u psi - recon12 psi|^2 = " << norm2( chi - chi12 ) << endl;
+  QDPIO::cout << "|u psi - recon8 psi|^2  = " << norm2( chi - chi8 ) << endl;
+  QDPIO::cout << "|adj(u) psi - adj(recon8) psi|^2 = " << norm2( adj(u) * psi - adj(u8) * psi ) << endl;
+
+  int failed = 0;
+
+  LatticeColorMatrix unit = 1.0;
+  failed += !roundTrip("unit gauge", unit);
+
+  LatticeReal alpha, beta;
+  random(alpha);
+  random(beta);
+  alpha *= Real(2*M_PI);
+  beta  *= Real(2*M_PI);
+  LatticeColorMatrix diag = zero;
+  pokeColor( diag , cmplx( cos(alpha) , sin(alpha) ) , 0 , 0 );
+  pokeColor( diag , cmplx( cos(beta) , sin(beta) ) , 1 , 1 );
+  pokeColor( diag , cmplx( cos(alpha + beta) , -sin(alpha + beta) ) , 2 , 2 );
+  failed += !roundTrip("diagonal links", diag);
+
+  const int iter = 100;
+  QDPIO::cout << "u * psi:         " << time_mult( chi , u   , psi , iter ) << " us" << endl;
+  QDPIO::cout << "recon12 * psi:   " << time_mult( chi , u12 , psi , iter ) << " us" << endl;
+  QDPIO::cout << "recon8 * psi:    " << time_mult( chi , u8  , psi , iter ) << " us" << endl;
+
+  QDPIO::cout << "Summary: " << failed << " failures" << endl;
+
+  // Time to bolt
+  QDP_finalize();
+
+  exit(failed ? 1 : 0);
+}
@@ -0,0 +1,119 @@
+// -*- C++ -*-
+/*! \file
+ *  \brief Throughput of the fused Gaussian fill
+ *
+ *  Times gaussian() on a LatticeFermion, which makes both uniforms in
+ *  registers and writes only the destination, against the three pass
+ *  version it replaces: random() into two temporaries followed by the
+ *  Box-Muller kernel. Both generators are timed. The two versions must
+ *  give the same numbers bit for bit and leave the same generator state,
+ *  e.g.
+ *
+ *      ./t_gaussian -rng philox
+ */
+
+#include "qdp.h"
+
+#include <iomanip>
+#include <sstream>
+
+using namespace QDP;
+
+
+//! Best time in seconds of iter runs of f
+template<class F>
+double best(F f, int iter)
+{
+  f();   // build the kernel
+  CudaDeviceSynchronize();
+
+  double t = 1e30;
+  for (int i = 0; i < iter; ++i) {
+    StopWatch swatch;
+    swatch.start();
+    f();
+    CudaDeviceSynchronize();
+    swatch.stop();
+    t = std::min(t, swatch.getTimeInSeconds());
+  }
+  return t;
+}
+
+
+//! The three pass Gaussian fill: two uniform fields, then Box-Muller
+void gaussianUnfused(LatticeFermion& d)
+{
+  static CUfunction function;
+
+  LatticeFermion r1, r2;
+  random(r1);
+  random(r2);
+
+  if (function == NULL)
+    function = function_gaussian_build( d , r1 , r2 );
+
+  function_gaussian_exec( function, d, r1, r2, all );
+}
+
+
+int main(int argc, char *argv[])
+{
+  // Put the machine into a known state
+  QDP_initialize(&argc, &argv);
+
+  // Setup the layout
+  const int foo[] = {16,16,16,32};
+  multi1d<int> nrow(Nd);
+  nrow = foo;  // Use only Nd elements
+  Layout::setLattSize(nrow);
+  Layout::create();
+
+  const int    iter    = 10;
+  const double numbers = (double)Layout::vol() * sizeof(Fermion) / sizeof(Real);
+
+  LatticeFermion a, b;
+
+  QDPIO::cout << "Gaussian numbers of a LatticeFermion on " << Layout::vol() << " sites" << std::endl;
+  QDPIO::cout << "generator   3 passes     fused   [G numbers/s]" << std::endl;
+
+  int failed = 0;
+
+  const RNG::Generator gens[] = { RNG::Generator::lcg, RNG::Generator::philox };
+  for(RNG::Generator g : gens)
+  {
+    RNG::setGenerator(g);
+    double t_unfused = best([&]{ gaussianUnfused(a); }, iter);
+    double t_fused   = best([&]{ gaussian(b); }, iter);
+
+    // Same start, same numbers, same seed and Philox call count afterwards
+    Seed start, after_unfused, after_fused;
+    RNG::savern(start);
+    uint64_t calls_start = RNG::philoxCalls();
+    gaussianUnfused(a);
+    RNG::savern(after_unfused);
+    uint64_t calls_unfused = RNG::philoxCalls();
+    RNG::setrn(start);
+    RNG::setPhiloxCalls(calls_start);
+    gaussian(b);
+    RNG::savern(after_fused);
+
+    bool ok = toDouble(norm2(a - b)) == 0.0 && !toBool(after_unfused != after_fused)
+      && calls_unfused == RNG::philoxCalls();
+    failed += !ok;
+
+    std::ostringstream row;
+    row << std::left << std::setw(10) << (g == RNG::Generator::lcg ? "lcg" : "philox") << std::right
+	<< std::fixed << std::setprecision(2)
+	<< std::setw(10) << numbers / t_unfused * 1e-9
+	<< std::setw(10) << numbers / t_fused * 1e-9
+	<< (ok ? "" : "  MISMATCH");
+    QDPIO::cout << row.str() << std::endl;
+  }
+
+  QDPIO::cout << "Summary: " << failed << " failures" << std::endl;
+
+  // Time to bolt
+  QDP_finalize();
+
+  exit(failed ? 1 : 0);
+}
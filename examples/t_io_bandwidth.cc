@@ -0,0 +1,104 @@
+// -*- C++ -*-
+/*! \file
+ *  \brief Disk bandwidth of BinaryFileWriter and BinaryFileReader
+ *
+ *  Writes a gauge field to a local file and reads it back with one
+ *  chunk (every transfer synchronous), double and triple buffering and
+ *  triple buffering with direct I/O, and prints the bandwidth including
+ *  the final flush. The checksums of the writer and the reader and the
+ *  field read back are compared. The file goes to the current directory
+ *  or to the one given as the last argument; -iochunk sets the chunk size.
+ *
+ *      ./t_io_bandwidth -iochunk 16 /scratch/me
+ */
+
+#include "qdp.h"
+
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+using namespace QDP;
+
+
+int main(int argc, char *argv[])
+{
+  // Put the machine into a known state
+  QDP_initialize(&argc, &argv);
+
+  // Setup the layout
+  const int foo[] = {16,16,16,32};
+  multi1d<int> nrow(Nd);
+  nrow = foo;  // Use only Nd elements
+  Layout::setLattSize(nrow);
+  Layout::create();
+
+  std::string dir = argc > 1 && argv[argc-1][0] != '-' ? argv[argc-1] : ".";
+  std::string file = dir + "/t_io_bandwidth.dat";
+
+  multi1d<LatticeColorMatrix> u(Nd);
+  for(int mu=0; mu < Nd; ++mu)
+    gaussian(u[mu]);
+
+  const double bytes = (double)Nd * Layout::vol() * sizeof(ColorMatrix);
+  const AsyncIOOptions base = asyncIOGetOptions();
+
+  struct Setting { const char* name; int buffers; bool direct; };
+  const Setting settings[] = { { "synchronous", 1, false }, { "double", 2, false },
+			       { "triple", 3, false }, { "triple, direct", 3, true } };
+
+  QDPIO::cout << "Gauge field of " << bytes / (1 << 20) << " MB to " << file
+	      << " in chunks of " << (base.chunk >> 20) << " MB" << std::endl;
+  QDPIO::cout << "buffering            write      read   [GB/s]" << std::endl;
+
+  int failed = 0;
+  for(const Setting& s : settings)
+  {
+    AsyncIOOptions opt = base;
+    opt.buffers = s.buffers;
+    opt.direct = s.direct;
+    asyncIOSetOptions(opt);
+
+    StopWatch t_write, t_read;
+
+    t_write.start();
+    BinaryFileWriter bin(file);
+    write(bin, u);
+    bin.flush();
+    QDPUtil::n_uint32_t written = bin.getChecksum();
+    bin.close();
+    t_write.stop();
+
+    multi1d<LatticeColorMatrix> v(Nd);
+    t_read.start();
+    BinaryFileReader bout(file);
+    read(bout, v);
+    QDPUtil::n_uint32_t got = bout.getChecksum();
+    bout.close();
+    t_read.stop();
+
+    Double diff = zero;
+    for(int mu=0; mu < Nd; ++mu)
+      diff += norm2(v[mu] - u[mu]);
+    bool ok = written == got && toDouble(diff) == 0.0;
+    failed += !ok;
+
+    std::ostringstream row;
+    row << std::left << std::setw(16) << s.name << std::right << std::fixed << std::setprecision(2)
+	<< std::setw(10) << bytes / t_write.getTimeInSeconds() * 1e-9
+	<< std::setw(10) << bytes / t_read.getTimeInSeconds() * 1e-9
+	<< (ok ? "" : "  MISMATCH");
+    QDPIO::cout << row.str() << std::endl;
+  }
+  asyncIOSetOptions(base);
+
+  if (Layout::primaryNode())
+    remove(file.c_str());
+
+  QDPIO::cout << "Summary: " << failed << " failures" << std::endl;
+
+  // Time to bolt
+  QDP_finalize();
+
+  exit(failed ? 1 : 0);
+}
@@ -0,0 +1,84 @@
+// -*- C++ -*-
+/*! \file
+ *  \brief Build a batch of kernels concurrently and check them against the serial path
+ */
+
+#include "qdp.h"
+
+using namespace QDP;
+
+
+template<class T, class T1, class RHS>
+jit_builder_t make_builder(OLattice<T>& dest, const QDPExpr<RHS,OLattice<T1> >& rhs)
+{
+  return [&dest,rhs]() { return function_build(dest, OpAssign(), rhs); };
+}
+
+
+int main(int argc, char *argv[])
+{
+  // Put the machine into a known state
+  QDP_initialize(&argc, &argv);
+
+  // Setup the layout
+  const int foo[] = {8,8,8,8};
+  multi1d<int> nrow(Nd);
+  nrow = foo;  // Use only Nd elements
+  Layout::setLattSize(nrow);
+  Layout::create();
+
+  LatticeColorMatrix u, v;
+  LatticeFermion psi;
+  gaussian(u);
+  gaussian(v);
+  gaussian(psi);
+
+  multi1d<LatticeColorMatrix> cm(4);
+  multi1d<LatticeFermion>     fe(4);
+
+  std::vector<jit_builder_t> builders;
+  builders.push_back( make_builder( cm[0] , u * v ) );
+  builders.push_back( make_builder( cm[1] , adj(u) * v ) );
+  builders.push_back( make_builder( cm[2] , u * adj(v) + v ) );
+  builders.push_back( make_builder( cm[3] , adj(u) * adj(v) - u ) );
+  builders.push_back( make_builder( fe[0] , u * psi ) );
+  builders.push_back( make_builder( fe[1] , adj(u) * psi ) );
+  builders.push_back( make_builder( fe[2] , u * v * psi ) );
+  builders.push_back( make_builder( fe[3] , psi + u * psi ) );
+
+  StopWatch swatch;
+  swatch.start();
+  std::vector<CUfunction> functions = jit_build_concurrent( builders );
+  swatch.stop();
+
+  QDPIO::cout << "Built " << functions.size() << " kernels with "
+	      << jit_get_build_threads() << " threads in "
+	      << swatch.getTimeInSeconds() << " secs" << endl;
+
+  function_exec( functions[0] , cm[0] , OpAssign() , u * v , all );
+  function_exec( functions[1] , cm[1] , OpAssign() , adj(u) * v , all );
+  function_exec( functions[2] , cm[2] , OpAssign() , u * adj(v) + v , all );
+  function_exec( functions[3] , cm[3] , OpAssign() , adj(u) * adj(v) - u , all );
+  function_exec( functions[4] , fe[0] , OpAssign() , u * psi , all );
+  function_exec( functions[5] , fe[1] , OpAssign() , adj(u) * psi , all );
+  function_exec( functions[6] , fe[2] , OpAssign() , u * v * psi , all );
+  function_exec( functions[7] , fe[3] , OpAssign() , psi + u * psi , all );
+
+  // Same expressions through the serial evaluate() path
+  LatticeColorMatrix cm_ref;
+  LatticeFermion     fe_ref;
+
+  cm_ref = u * v;                QDPIO::cout << "diff 0 = " << norm2( cm[0] - cm_ref ) << endl;
+  cm_ref = adj(u) * v;           QDPIO::cout << "diff 1 = " << norm2( cm[1] - cm_ref ) << endl;
+  cm_ref = u * adj(v) + v;       QDPIO::cout << "diff 2 = " << norm2( cm[2] - cm_ref ) << endl;
+  cm_ref = adj(u) * adj(v) - u;  QDPIO::cout << "diff 3 = " << norm2( cm[3] - cm_ref ) << endl;
+  fe_ref = u * psi;              QDPIO::cout << "diff 4 = " << norm2( fe[0] - fe_ref ) << endl;
+  fe_ref = adj(u) * psi;         QDPIO::cout << "diff 5 = " << norm2( fe[1] - fe_ref ) << endl;
+  fe_ref = u * v * psi;          QDPIO::cout << "diff 6 = " << norm2( fe[2] - fe_ref ) << endl;
+  fe_ref = psi + u * psi;        QDPIO::cout << "diff 7 = " << norm2( fe[3] - fe_ref ) << endl;
+
+  // Time to bolt
+  QDP_finalize();
+
+  exit(0);
+}
@@ -0,0 +1,109 @@
+// -*- C++ -*-
+/*! \file
+ *  \brief Shift bandwidth of the site orderings
+ *
+ *  Times nearest neighbour shifts of a LatticeColorMatrix in every
+ *  direction and a hopping term sum_mu U_mu(x) psi(x+mu) + U_mu(x-mu)^dag
+ *  psi(x-mu), and prints one row for the layout in use. The layout is
+ *  fixed by create(), so compare layouts with one run each, e.g.
+ *
+ *      for l in lexico cb2 cb3d tiled tiled:2 morton; do ./t_layout_shift -layout $l; done
+ *
+ *  The shifted coordinates are checked too, so a row also says whether
+ *  the layout's tables are consistent.
+ */
+
+#include "qdp.h"
+
+#include <iomanip>
+#include <sstream>
+
+using namespace QDP;
+
+
+//! Best bandwidth in GB/s of iter runs of f, which moves bytes per run
+template<class F>
+double bandwidth(F f, double bytes, int iter)
+{
+  f();   // build the kernel
+  CudaDeviceSynchronize();
+
+  double best = 1e30;
+  for (int i = 0; i < iter; ++i) {
+    StopWatch swatch;
+    swatch.start();
+    f();
+    CudaDeviceSynchronize();
+    swatch.stop();
+    best = std::min(best, swatch.getTimeInSeconds());
+  }
+  return bytes / best * 1e-9;
+}
+
+
+int main(int argc, char *argv[])
+{
+  // Put the machine into a known state
+  QDP_initialize(&argc, &argv);
+
+  // Setup the layout
+  const int foo[] = {16,16,16,16};
+  multi1d<int> nrow(Nd);
+  nrow = foo;  // Use only Nd elements
+  Layout::setLattSize(nrow);
+  Layout::create();
+
+  const int    iter   = 10;
+  const double sites  = Layout::sitesOnNode();
+  const double matrix = sites * sizeof(LatticeColorMatrix::Subtype_t);
+  const double fermi  = sites * sizeof(LatticeFermion::Subtype_t);
+
+  // The shifts must move the coordinates
+  int failed = 0;
+  for(int mu=0; mu < Nd; ++mu) {
+    LatticeInteger x = Layout::latticeCoordinate(mu);
+    LatticeInteger fwd = shift(x, FORWARD, mu);
+    LatticeInteger bwd = shift(x, BACKWARD, mu);
+    failed += toInt(sum(LatticeInteger(where(fwd == (x + 1) % nrow[mu], 0, 1)))) != 0;
+    failed += toInt(sum(LatticeInteger(where(bwd == (x + nrow[mu] - 1) % nrow[mu], 0, 1)))) != 0;
+  }
+
+  multi1d<LatticeColorMatrix> u(Nd);
+  for(int mu=0; mu < Nd; ++mu)
+    gaussian(u[mu]);
+  LatticeColorMatrix a, b;
+  LatticeFermion psi, chi;
+  gaussian(b);
+  gaussian(psi);
+
+  std::ostringstream row;
+  row << std::setw(10) << Layout::policy().name() << std::fixed << std::setprecision(2);
+
+  double total = 0;
+  for(int mu=0; mu < Nd; ++mu) {
+    double fwd = bandwidth([&]{ a = shift(b, FORWARD, mu);  }, 2 * matrix, iter);
+    double bwd = bandwidth([&]{ a = shift(b, BACKWARD, mu); }, 2 * matrix, iter);
+    row << std::setw(8) << fwd << std::setw(8) << bwd;
+    total += fwd + bwd;
+  }
+  row << std::setw(9) << total / (2 * Nd);
+
+  // Per site: Nd matrices twice, 2 Nd neighbours and the result
+  double hop = bandwidth([&]{
+      chi = u[0] * shift(psi, FORWARD, 0) + shift(adj(u[0]) * psi, BACKWARD, 0);
+      for(int mu=1; mu < Nd; ++mu)
+	chi += u[mu] * shift(psi, FORWARD, mu) + shift(adj(u[mu]) * psi, BACKWARD, mu);
+    }, 2 * Nd * matrix + 2 * Nd * fermi + Nd * fermi, iter);
+  row << std::setw(9) << hop << (failed ? "  WRONG SHIFTS" : "");
+
+  QDPIO::cout << "Shift bandwidth [GB/s] on " << Layout::sitesOnNode() << " sites per node" << std::endl;
+  QDPIO::cout << "    layout   0 fwd   0 bwd   1 fwd   1 bwd   2 fwd   2 bwd   3 fwd   3 bwd     mean  hopping" << std::endl;
+  QDPIO::cout << row.str() << std::endl;
+
+  QDPIO::cout << "Summary: " << failed << " failures" << std::endl;
+
+  // Time to bolt
+  QDP_finalize();
+
+  exit(failed ? 1 : 0);
+}
@@ -0,0 +1,99 @@
+// -*- C++ -*-
+/*! \file
+ *  \brief Map construction time, offset maps against the generic path
+ *
+ *  Builds maps for a few displacements twice, once as OffsetMapFunc
+ *  (integer arithmetic on the host worker threads) and once through a
+ *  MapFunc that computes the same coordinates but does not declare the
+ *  offset, checks that both give the same tables and prints the times.
+ *  Both must end up sharing one set of tables: the generic map finds it
+ *  by content, a second OffsetMapFunc by its displacement.
+ */
+
+#include "qdp.h"
+
+using namespace QDP;
+
+
+//! The displacement as an opaque MapFunc, i.e. the generic path
+class GenericOffsetFunc : public MapFunc
+{
+public:
+  GenericOffsetFunc(const OffsetMapFunc& f_) : f(f_) {}
+  multi1d<int> operator()(const multi1d<int>& x, int sign) const { return f(x, sign); }
+private:
+  const OffsetMapFunc& f;
+};
+
+
+bool same(const multi1d<int>& a, const multi1d<int>& b)
+{
+  if (a.size() != b.size())
+    return false;
+  for(int i=0; i < a.size(); ++i)
+    if (a[i] != b[i])
+      return false;
+  return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+  // Put the machine into a known state
+  QDP_initialize(&argc, &argv);
+
+  // Setup the layout
+  const int foo[] = {16,16,16,32};
+  multi1d<int> nrow(Nd);
+  nrow = foo;  // Use only Nd elements
+  Layout::setLattSize(nrow);
+  Layout::create();
+
+  QDPIO::cout << "Map construction on " << Layout::sitesOnNode() << " sites per node, "
+	      << hostThreadsGetCount() << " host workers" << std::endl;
+
+  int failed = 0;
+  const int disps[][4] = { {3,0,0,0}, {0,-1,0,0}, {1,1,0,0}, {0,0,5,-7} };
+
+  for(const int* d : disps)
+  {
+    multi1d<int> disp(Nd);
+    for(int mu=0; mu < Nd; ++mu)
+      disp[mu] = d[mu];
+
+    OffsetMapFunc offset(disp);
+    GenericOffsetFunc generic(offset);
+
+    StopWatch t_offset, t_generic;
+
+    t_offset.start();
+    Map m_offset(offset);
+    t_offset.stop();
+
+    t_generic.start();
+    Map m_generic(generic);
+    t_generic.stop();
+
+    Map m_again(offset);
+
+    bool ok = same(m_offset.goffset(), m_generic.goffset())
+      && m_offset.hasOffnode() == m_generic.hasOffnode()
+      && m_generic.getGoffsetsId() == m_offset.getGoffsetsId()
+      && m_again.getGoffsetsId() == m_offset.getGoffsetsId();
+    if (m_offset.hasOffnode())
+      ok = ok && same(m_offset.soffset(), m_generic.soffset()) && same(m_offset.roffset(), m_generic.roffset());
+
+    QDPIO::cout << "disp " << d[0] << " " << d[1] << " " << d[2] << " " << d[3]
+		<< ":  offset " << t_offset.getTimeInSeconds() << " s"
+		<< "  generic " << t_generic.getTimeInSeconds() << " s"
+		<< (ok ? "" : "  TABLES DIFFER") << std::endl;
+    failed += !ok;
+  }
+
+  QDPIO::cout << "Summary: " << failed << " failures" << std::endl;
+
+  // Time to bolt
+  QDP_finalize();
+
+  exit(failed ? 1 : 0);
+}
@@ -0,0 +1,177 @@
+// -*- C++ -*-
+/*! \file
+ *  \brief Maps whose sites come from several nodes
+ *
+ *  A reflection, a transpose of the first two directions and a twisted
+ *  shift are applied to a field holding each site's lexicographic index,
+ *  and the result is compared with the index of the source site. Run on
+ *  several local ranks with a processor grid that splits the first two
+ *  directions, e.g.
+ *
+ *      mpirun -np 4 ./t_map_multi -geom 2 2 1 1
+ *
+ *  so that every node receives from and sends to more than one node.
+ *
+ *  Last, a field is shifted once around the lattice in every direction,
+ *  each shift reading the result of the one before, which must give it
+ *  back. With -gpudirect the faces go from and to device memory, so this
+ *  checks that a gather has finished before its face is sent and that a
+ *  receive buffer is read before it is filled again, e.g.
+ *
+ *      mpirun -np 2 ./t_map_multi -geom 1 1 1 2 -gpudirect
+ */
+
+#include "qdp.h"
+
+using namespace QDP;
+
+
+//! x -> -x in direction dir
+class ReflectFunc : public MapFunc
+{
+public:
+  ReflectFunc(int dir_) : dir(dir_) {}
+  multi1d<int> operator()(const multi1d<int>& x, int sign) const
+  {
+    multi1d<int> y = x;
+    y[dir] = (Layout::lattSize()[dir] - x[dir]) % Layout::lattSize()[dir];
+    return y;
+  }
+private:
+  int dir;
+};
+
+//! Swap directions 0 and 1, which must have the same extent
+class TransposeFunc : public MapFunc
+{
+public:
+  multi1d<int> operator()(const multi1d<int>& x, int sign) const
+  {
+    multi1d<int> y = x;
+    y[0] = x[1];
+    y[1] = x[0];
+    return y;
+  }
+};
+
+//! Shift by one in direction 0; sites crossing the boundary also move by 'twist' in direction 1
+class TwistFunc : public MapFunc
+{
+public:
+  TwistFunc(int twist_) : twist(twist_) {}
+  multi1d<int> operator()(const multi1d<int>& x, int sign) const
+  {
+    const multi1d<int>& L = Layout::lattSize();
+    multi1d<int> y = x;
+    if (sign > 0) {
+      y[0] = (x[0] + 1) % L[0];
+      if (x[0] == L[0] - 1)
+	y[1] = (x[1] + twist) % L[1];
+    } else {
+      y[0] = (x[0] + L[0] - 1) % L[0];
+      if (x[0] == 0)
+	y[1] = (x[1] + L[1] - twist) % L[1];
+    }
+    return y;
+  }
+private:
+  int twist;
+};
+
+
+//! Lexicographic index of the site coordinates c
+LatticeReal siteIndex(const multi1d<LatticeInteger>& c)
+{
+  LatticeReal idx = zero;
+  int stride = 1;
+  for(int mu=0; mu < Nd; ++mu) {
+    idx += Real(stride) * LatticeReal(c[mu]);
+    stride *= Layout::lattSize()[mu];
+  }
+  return idx;
+}
+
+
+//! Whether func moves the site at src to every site x
+bool test(const std::string& name, const MapFunc& func,
+	  const multi1d<LatticeInteger>& x, const multi1d<LatticeInteger>& src)
+{
+  Map map(func);
+
+  LatticeReal got = map(siteIndex(x));
+  Double diff = norm2(got - siteIndex(src));
+
+  bool ok = toDouble(diff) == 0.0;
+  QDPIO::cout << name << ": " << (ok ? "ok" : "FAILED") << std::endl;
+  return ok;
+}
+
+
+//! Whether nearest neighbour shifts once around the lattice give back the field
+bool testChained(const multi1d<LatticeInteger>& x)
+{
+  LatticeReal start = siteIndex(x);
+  LatticeReal y = start;
+
+  for(int mu=0; mu < Nd; ++mu) {
+    for(int k=0; k < Layout::lattSize()[mu]; ++k)
+      y = shift(y, FORWARD, mu);
+    for(int k=0; k < Layout::lattSize()[mu]; ++k)
+      y = shift(shift(y, BACKWARD, mu), FORWARD, mu);
+  }
+
+  bool ok = toDouble(norm2(y - start)) == 0.0;
+  QDPIO::cout << "chained shifts" << (DeviceParams::Instance().getGPUDirect() ? " (gpudirect)" : "")
+	      << ": " << (ok ? "ok" : "FAILED") << std::endl;
+  return ok;
+}
+
+
+int main(int argc, char *argv[])
+{
+  // Put the machine into a known state
+  QDP_initialize(&argc, &argv);
+
+  // Setup the layout
+  const int foo[] = {8,8,4,4};
+  multi1d<int> nrow(Nd);
+  nrow = foo;  // Use only Nd elements
+  Layout::setLattSize(nrow);
+  Layout::create();
+
+  QDPIO::cout << "Maps on " << Layout::numNodes() << " nodes" << std::endl;
+
+  const multi1d<int>& L = Layout::lattSize();
+  multi1d<LatticeInteger> x(Nd);
+  for(int mu=0; mu < Nd; ++mu)
+    x[mu] = Layout::latticeCoordinate(mu);
+
+  int failed = 0;
+
+  // The expected source coordinates of every site
+  multi1d<LatticeInteger> src(Nd);
+
+  src = x;
+  src[0] = where( x[0] == 0 , LatticeInteger(zero) , LatticeInteger(L[0] - x[0]) );
+  failed += !test("reflection", ReflectFunc(0), x, src);
+
+  src = x;
+  src[0] = x[1];
+  src[1] = x[0];
+  failed += !test("transpose", TransposeFunc(), x, src);
+
+  const int twist = 3;
+  src = x;
+  src[0] = where( x[0] == L[0] - 1 , LatticeInteger(zero) , LatticeInteger(x[0] + 1) );
+  src[1] = where( x[0] == L[0] - 1 , LatticeInteger((x[1] + twist) % L[1]) , LatticeInteger(x[1]) );
+  failed += !test("twisted shift", TwistFunc(twist), x, src);
+
+  failed += !testChained(x);
+
+  QDPIO::cout << "Summary: " << failed << " failures" << std::endl;
+
+  // Time to bolt
+  QDP_finalize();
+
+  exit(failed ? 1 : 0);
+}
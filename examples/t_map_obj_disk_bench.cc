@@ -0,0 +1,132 @@
+// -*- C++ -*-
+/*! \file
+ *  \brief Insert and get throughput of MapObjectDisk
+ *
+ *  Writes N records of a few sizes, then reads them back in random order,
+ *  once with a sync after every record and reads through the file stream
+ *  (the old behaviour) and once with group commit and mapped reads.
+ *
+ *  Usage: t_map_obj_disk_bench [-records N] [-file name]
+ */
+
+#include "qdp.h"
+#include "qdp_map_obj_disk.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+using namespace QDP;
+
+
+struct Rate {
+  double insert;   // seconds
+  double get;
+};
+
+
+Rate bench(const std::string& file, int nrec, int nelem, bool fast)
+{
+  multi1d<double> val(nelem);
+  for (int i = 0; i < nelem; ++i)
+    val[i] = i;
+
+  Rate r;
+  StopWatch swatch;
+
+  if (Layout::primaryNode())
+    std::remove(file.c_str());
+
+  {
+    MapObjectDisk<int, multi1d<double> > db;
+    if (fast)
+      db.setFlushPolicy(0, 64*1024*1024);
+    else {
+      db.setFlushPolicy(1, 0);
+      db.setMappedReads(false);
+    }
+    db.open(file, std::ios_base::in | std::ios_base::out | std::ios_base::trunc);
+
+    swatch.reset();
+    swatch.start();
+    for (int k = 0; k < nrec; ++k) {
+      val[0] = k;
+      db.insert(k, val);
+    }
+    db.flush();
+    swatch.stop();
+    r.insert = swatch.getTimeInSeconds();
+  }
+
+  {
+    MapObjectDisk<int, multi1d<double> > db;
+    db.setMappedReads(fast);
+    db.open(file, std::ios_base::in);
+
+    std::vector<int> order(nrec);
+    for (int k = 0; k < nrec; ++k)
+      order[k] = k;
+    std::shuffle(order.begin(), order.end(), std::mt19937(17));
+
+    multi1d<double> out;
+    swatch.reset();
+    swatch.start();
+    for (int k: order) {
+      db.get(k, out);
+      if (out.size() != nelem || out[0] != k)
+	QDP_error_exit("t_map_obj_disk_bench: wrong value for key %d", k);
+    }
+    swatch.stop();
+    r.get = swatch.getTimeInSeconds();
+  }
+
+  if (Layout::primaryNode())
+    std::remove(file.c_str());
+
+  return r;
+}
+
+
+int main(int argc, char *argv[])
+{
+  QDP_initialize(&argc, &argv);
+
+  int nrec = 20000;
+  std::string file = "t_map_obj_disk_bench.mod";
+  for (int i = 1; i < argc; ++i) {
+    if (std::string(argv[i]) == "-records" && i+1 < argc)
+      nrec = atoi(argv[++i]);
+    else if (std::string(argv[i]) == "-file" && i+1 < argc)
+      file = argv[++i];
+  }
+
+  const int foo[] = {4,4,4,4};
+  multi1d<int> nrow(Nd);
+  nrow = foo;  // Use only Nd elements
+  Layout::setLattSize(nrow);
+  Layout::create();
+
+  // 64 bytes (a correlator entry), 4 KiB, 256 KiB (a perambulator block)
+  const int sizes[] = {8, 512, 32768};
+
+  QDPIO::cout << "MapObjectDisk, " << nrec << " records per size" << std::endl;
+  QDPIO::cout << "   bytes  mode            insert rec/s    MB/s      get rec/s    MB/s" << std::endl;
+
+  for (int nelem: sizes) {
+    // Keep the large case to a few hundred MB
+    int n = std::min(nrec, (int)(256.0*1024*1024 / (nelem*sizeof(double))));
+    double mb = (double)n * nelem * sizeof(double) / 1.0e6;
+
+    for (int fast = 0; fast < 2; ++fast) {
+      Rate r = bench(file, n, nelem, fast);
+      char line[256];
+      snprintf(line, sizeof(line), "%8lu  %-14s %12.0f %7.1f %14.0f %7.1f",
+	       (unsigned long)(nelem*sizeof(double)), fast ? "group+mmap" : "per-record",
+	       n / r.insert, mb / r.insert, n / r.get, mb / r.get);
+      QDPIO::cout << line << std::endl;
+    }
+  }
+
+  QDP_finalize();
+  exit(0);
+}
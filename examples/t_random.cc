@@ -0,0 +1,124 @@
+// -*- C++ -*-
+/*! \file
+ *  \brief Throughput of the lattice random number generators
+ *
+ *  Times random() and gaussian() on a LatticeColorMatrix with the linear
+ *  congruential generator and with Philox, and prints the random numbers
+ *  made per second. For Philox the kernel is also checked against the
+ *  host generator at a few sites, and setrn with the saved call count
+ *  must reproduce the field.
+ *  The values do not depend on the layout or the number of nodes, e.g.
+ *
+ *      ./t_random -layout cb2; ./t_random -layout morton
+ */
+
+#include "qdp.h"
+
+#include <iomanip>
+#include <sstream>
+
+using namespace QDP;
+
+
+//! Best time in seconds of iter runs of f
+template<class F>
+double best(F f, int iter)
+{
+  f();   // build the kernel
+  CudaDeviceSynchronize();
+
+  double t = 1e30;
+  for (int i = 0; i < iter; ++i) {
+    StopWatch swatch;
+    swatch.start();
+    f();
+    CudaDeviceSynchronize();
+    swatch.stop();
+    t = std::min(t, swatch.getTimeInSeconds());
+  }
+  return t;
+}
+
+
+int main(int argc, char *argv[])
+{
+  // Put the machine into a known state
+  QDP_initialize(&argc, &argv);
+
+  // Setup the layout
+  const int foo[] = {16,16,16,32};
+  multi1d<int> nrow(Nd);
+  nrow = foo;  // Use only Nd elements
+  Layout::setLattSize(nrow);
+  Layout::create();
+
+  const int    iter    = 10;
+  const double numbers = (double)Layout::vol() * sizeof(ColorMatrix) / sizeof(Real);
+
+  LatticeColorMatrix u, v;
+
+  QDPIO::cout << "Random numbers of a LatticeColorMatrix on " << Layout::vol() << " sites" << std::endl;
+  QDPIO::cout << "generator    random   gaussian   [G numbers/s]" << std::endl;
+
+  const RNG::Generator gens[] = { RNG::Generator::lcg, RNG::Generator::philox };
+  for(RNG::Generator g : gens)
+  {
+    RNG::setGenerator(g);
+    double t_random   = best([&]{ random(u); }, iter);
+    double t_gaussian = best([&]{ gaussian(u); }, iter);
+
+    std::ostringstream row;
+    row << std::left << std::setw(10) << (g == RNG::Generator::lcg ? "lcg" : "philox") << std::right
+	<< std::fixed << std::setprecision(2)
+	<< std::setw(9) << numbers / t_random * 1e-9
+	<< std::setw(11) << numbers / t_gaussian * 1e-9;
+    QDPIO::cout << row.str() << std::endl;
+  }
+
+  // The kernel gives what the host stream of the site's lexicographic index gives
+  int failed = 0;
+
+  Seed seed;
+  RNG::savern(seed);
+  uint64_t calls = RNG::philoxCalls();
+  uint32_t key[2];
+  RNG::philoxKey(key);
+  random(u);
+
+  const int probes = 16;
+  for(int p = 0; p < probes; ++p)
+  {
+    multi1d<int> x(Nd);
+    uint64_t lex = 0;
+    for(int m = Nd-1; m >= 0; --m) {
+      x[m] = (p * 7919 + m * 104729 + p * p * 31) % nrow[m];
+      if (p == probes - 1)
+	x[m] = nrow[m] - 1;
+      lex = lex * nrow[m] + x[m];
+    }
+    if (p == 0) {
+      x = 0;
+      lex = 0;
+    }
+
+    ColorMatrix want;
+    Philox::Stream stream(key, lex, calls);
+    fill_random(want.elem(), stream, stream, stream);
+
+    ColorMatrix got = peekSite(u, x);
+    failed += toDouble(norm2(got - want)) != 0.0;
+  }
+
+  // setrn and the call count restart the same sequence
+  RNG::setrn(seed);
+  RNG::setPhiloxCalls(calls);
+  random(v);
+  failed += toDouble(norm2(v - u)) != 0.0;
+
+  QDPIO::cout << "Summary: " << failed << " failures" << std::endl;
+
+  // Time to bolt
+  QDP_finalize();
+
+  exit(failed ? 1 : 0);
+}
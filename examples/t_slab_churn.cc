@@ -0,0 +1,69 @@
+// -*- C++ -*-
+/*! \file
+ *  \brief OScalar allocation churn with and without the slab allocator
+ *
+ *  Creates and destroys small scalars in a loop the way solver code does
+ *  with its temporaries, times the loop with the slab allocator enabled
+ *  and disabled, and prints the per size-class counters.
+ */
+
+#include "qdp.h"
+
+using namespace QDP;
+
+
+double churn(int iter)
+{
+  StopWatch swatch;
+  swatch.start();
+  for (int i = 0; i < iter; ++i) {
+    Real          r   = Real(i);
+    Complex       c   = cmplx(r, Real(1));
+    DComplex      dc  = cmplx(Double(i), Double(2));
+    ColorMatrix   m   = Real(1);
+    DColorMatrix  dm  = Double(1);
+    Complex       tmp = c * c + c;
+    // Keep them alive in overlapping lifetimes
+    {
+      Real     s = r * r;
+      DComplex t = dc + dc;
+    }
+  }
+  swatch.stop();
+  return swatch.getTimeInMicroseconds() / iter;
+}
+
+
+int main(int argc, char *argv[])
+{
+  // Put the machine into a known state
+  QDP_initialize(&argc, &argv);
+
+  // Setup the layout
+  const int foo[] = {4,4,4,4};
+  multi1d<int> nrow(Nd);
+  nrow = foo;  // Use only Nd elements
+  Layout::setLattSize(nrow);
+  Layout::create();
+
+  const int iter = 100000;
+
+  QDPSlabAllocator::Instance().setEnabled(false);
+  churn(100);
+  double t_pool = churn(iter);
+
+  QDPSlabAllocator::Instance().setEnabled(true);
+  churn(100);
+  double t_slab = churn(iter);
+
+  QDPIO::cout << "pool allocator: " << t_pool << " us per iteration" << std::endl;
+  QDPIO::cout << "slab allocator: " << t_slab << " us per iteration" << std::endl;
+  QDPIO::cout << "speedup:        " << t_pool / t_slab << std::endl;
+
+  QDPSlabAllocator::Instance().printInfo();
+
+  // Time to bolt
+  QDP_finalize();
+
+  exit(0);
+}
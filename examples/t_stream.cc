@@ -0,0 +1,93 @@
+// -*- C++ -*-
+/*! \file
+ *  \brief STREAM copy, scale, add and triad through evaluate()
+ *
+ *  Runs the four STREAM kernels as lattice expressions on LatticeFermion
+ *  and prints the bandwidth for 1, 2, 4, ... host workers up to the
+ *  configured count (-hostthreads, one per CPU by default). With the PTX
+ *  emulator this shows how the host fallback scales and whether the
+ *  fields stay local to the workers' NUMA nodes (-hostpin on|off); on a
+ *  GPU the worker count does not matter and every row is the same.
+ *
+ *  The fields are made anew for every row, so their pages are placed by
+ *  the workers of that row.
+ */
+
+#include "qdp.h"
+
+#include <iomanip>
+#include <sstream>
+
+using namespace QDP;
+
+
+//! Best bandwidth in GB/s of iter runs of f, which moves bytes per run
+template<class F>
+double bandwidth(F f, double bytes, int iter)
+{
+  f();   // build the kernel and place the pages
+  CudaDeviceSynchronize();
+
+  double best = 1e30;
+  for (int i = 0; i < iter; ++i) {
+    StopWatch swatch;
+    swatch.start();
+    f();
+    CudaDeviceSynchronize();
+    swatch.stop();
+    best = std::min(best, swatch.getTimeInSeconds());
+  }
+  return bytes / best * 1e-9;
+}
+
+
+int main(int argc, char *argv[])
+{
+  // Put the machine into a known state
+  QDP_initialize(&argc, &argv);
+
+  // Setup the layout
+  const int foo[] = {8,8,8,16};
+  multi1d<int> nrow(Nd);
+  nrow = foo;  // Use only Nd elements
+  Layout::setLattSize(nrow);
+  Layout::create();
+
+  const int    iter  = 10;
+  const double field = (double)Layout::sitesOnNode() * sizeof(LatticeFermion::Subtype_t);
+  const Real   s     = 3.0;
+  const int    maxw  = hostThreadsGetCount();
+
+  QDPIO::cout << "STREAM on LatticeFermion, " << Layout::sitesOnNode() << " sites, "
+	      << hostNumaNodes() << " NUMA node(s), pinning "
+	      << (hostThreadsPinned() ? "on" : "off") << std::endl;
+  QDPIO::cout << "workers       copy      scale        add      triad   [GB/s]" << std::endl;
+
+  for (int w = 1; ; w = std::min(2 * w, maxw)) {
+    hostThreadsSetCount(w);
+    {
+      LatticeFermion a, b, c;
+      gaussian(b);
+      gaussian(c);
+
+      double copy  = bandwidth([&]{ a = b;         }, 2 * field, iter);
+      double scale = bandwidth([&]{ a = s * b;     }, 2 * field, iter);
+      double add   = bandwidth([&]{ a = b + c;     }, 3 * field, iter);
+      double triad = bandwidth([&]{ a = b + s * c; }, 3 * field, iter);
+
+      std::ostringstream row;
+      row << std::setw(7) << w << std::fixed << std::setprecision(2)
+	  << std::setw(11) << copy << std::setw(11) << scale
+	  << std::setw(11) << add << std::setw(11) << triad;
+      QDPIO::cout << row.str() << std::endl;
+    }
+    if (w == maxw)
+      break;
+  }
+  hostThreadsSetCount(maxw);
+
+  // Time to bolt
+  QDP_finalize();
+
+  exit(0);
+}
@@ -0,0 +1,85 @@
+// -*- C++ -*-
+/*! \file
+ *  \brief Shared memory tiling of shifted fields on a 4D stencil
+ *
+ *  Runs the same nearest neighbour expression with tiling off, on and
+ *  autotuned, checks the results agree and prints the time per call.
+ *  psi is shifted 8 times and staged once per block with its halo, the
+ *  backward links once per direction. Tiling needs a blocked layout, the
+ *  test picks tiled:4 unless one is given with -layout.
+ */
+
+#include "qdp.h"
+
+using namespace QDP;
+
+
+void stencil(LatticeFermion& chi, const multi1d<LatticeColorMatrix>& u, const LatticeFermion& psi)
+{
+  chi = u[0] * shift(psi, FORWARD, 0) + adj(shift(u[0], BACKWARD, 0)) * shift(psi, BACKWARD, 0)
+      + u[1] * shift(psi, FORWARD, 1) + adj(shift(u[1], BACKWARD, 1)) * shift(psi, BACKWARD, 1)
+      + u[2] * shift(psi, FORWARD, 2) + adj(shift(u[2], BACKWARD, 2)) * shift(psi, BACKWARD, 2)
+      + u[3] * shift(psi, FORWARD, 3) + adj(shift(u[3], BACKWARD, 3)) * shift(psi, BACKWARD, 3);
+}
+
+
+double time_stencil(LatticeFermion& chi, const multi1d<LatticeColorMatrix>& u, const LatticeFermion& psi, int iter)
+{
+  // Warm up, this also runs the block size search
+  for (int i = 0; i < 20; ++i)
+    stencil(chi, u, psi);
+
+  StopWatch swatch;
+  swatch.start();
+  for (int i = 0; i < iter; ++i)
+    stencil(chi, u, psi);
+  swatch.stop();
+
+  return swatch.getTimeInMicroseconds() / iter;
+}
+
+
+int main(int argc, char *argv[])
+{
+  // Put the machine into a known state
+  QDP_initialize(&argc, &argv);
+
+  // Setup the layout
+  const int foo[] = {16,16,16,16};
+  multi1d<int> nrow(Nd);
+  nrow = foo;  // Use only Nd elements
+  Layout::setLattSize(nrow);
+  if (!Layout::policy().blocked())
+    Layout::setPolicy(layoutPolicyMake("tiled:4"));
+  Layout::create();
+
+  multi1d<LatticeColorMatrix> u(Nd);
+  LatticeFermion psi, chi_plain, chi_tiled, chi_auto;
+  for (int mu = 0; mu < Nd; ++mu)
+    gaussian(u[mu]);
+  gaussian(psi);
+
+  const int iter = 100;
+
+  jit_set_tiling(JitTiling::off);
+  double t_plain = time_stencil(chi_plain, u, psi, iter);
+
+  jit_set_tiling(JitTiling::on);
+  double t_tiled = time_stencil(chi_tiled, u, psi, iter);
+
+  jit_set_tiling(JitTiling::autotune);
+  double t_auto = time_stencil(chi_auto, u, psi, iter);
+
+  QDPIO::cout << "|plain - tiled|^2 = " << norm2( chi_plain - chi_tiled ) << endl;
+  QDPIO::cout << "|plain - auto|^2  = " << norm2( chi_plain - chi_auto ) << endl;
+
+  double flops = 8 * (66 + 24) * (double)Layout::vol();
+  QDPIO::cout << "plain: " << t_plain << " us  " << flops / t_plain / 1000.0 << " GFlops" << endl;
+  QDPIO::cout << "tiled: " << t_tiled << " us  " << flops / t_tiled / 1000.0 << " GFlops" << endl;
+  QDPIO::cout << "auto:  " << t_auto  << " us  " << flops / t_auto  / 1000.0 << " GFlops" << endl;
+
+  // Time to bolt
+  QDP_finalize();
+
+  exit(0);
+}
@@ -98,7 +98,12 @@ using std::iostream;
 using std::ostream;
 // END OF YUKKINESS
 
+#include "qdp_host_threads.h"
+#ifdef QDP_USE_PTX_EMULATOR
+#include "qdp_ptx_emu.h"
+#else
 #include "cuda.h"
+#endif
 #include "qdp_forward.h"
 
 // Basic includes
@@ -113,16 +118,19 @@ namespace QDP {
 #include "qdp_cuda.h"
 #include "qdp_cuda_allocator.h"
 #include "qdp_pool_allocator.h"
+#include "qdp_slab_allocator.h"
 #include "qdp_cache.h"
 
 
 
+#include "qdp_philox.h"
 #include "qdp_jit.h"
 
 #include "qdp_multi.h"
 #include "qdp_arrays.h"
 
 #include "qdp_params.h"
+#include "qdp_layout_policy.h"
 #include "qdp_layout.h"
 #include "qdp_io.h"
 #include "qdp_stdio.h"
@@ -137,6 +145,7 @@ namespace QDP {
 
 #include "qdp_subset.h"
 #include "qdp_stopwatch.h"
+#include "qdp_timing.h"
 
 #include "qdp_pete_visitors.h"
 
@@ -168,10 +177,13 @@ namespace QDP {
 
 #include "qdp_profile.h"
 
+#include "qdp_map_route.h"
 #include "qdp_mapresource.h"
 #include "qdp_handle.h"
 #include "qdp_map.h"
+#include "qdp_tuner.h"
 #include "qdp_autotuning.h"
+#include "qdp_kernel_profile.h"
 
 
 #include "qdp_simpleword.h"
@@ -188,6 +200,8 @@ namespace QDP {
 #include "qdp_outersubtype.h"
 
 #include "qdp_viewleaf.h"
+#include "qdp_outercompressed.h"
+#include "qdp_outercb.h"
 
 // Replaces previous ifdef structure. Structure moved into the header file
 #include "qdp_defs.h"
@@ -204,6 +218,7 @@ namespace QDP {
 #include "qdp_jitf_sum.h"
 #include "qdp_jitf_globalmax.h"
 #include "qdp_jitf_gaussian.h"
+#include "qdp_jitf_cb.h"
 
 // Include threading code here if applicable
 #include "qdp_dispatch.h"
@@ -219,7 +234,9 @@ namespace ThreadReductions {
 #include "qdp_scalar_specific.h"
 
 // Include SSE code here if applicable
-#if QDP_USE_SSE == 1
+#if QDP_USE_AVX == 1
+#include "qdp_scalarsite_avx.h"
+#elif QDP_USE_SSE == 1
 #include "qdp_scalarsite_sse.h"
 #elif QDP_USE_BAGEL_QDP == 1
 // USE_BAGEL_QDP
@@ -239,9 +256,13 @@ namespace ThreadReductions {
 #warning "Using parallel scalar architecture"
 #include "qdp_sum.h"
 #include "qdp_parscalar_specific.h"
+#include "qdp_dslash.h"
+#include "qdp_cb.h"
 
 // Include optimized code here if applicable
-#if QDP_USE_SSE == 1
+#if QDP_USE_AVX == 1
+#include "qdp_scalarsite_avx.h"
+#elif QDP_USE_SSE == 1
 #include "qdp_scalarsite_sse.h"
 #elif QDP_USE_BAGEL_QDP == 1
 // Use BAGEL_QDP 
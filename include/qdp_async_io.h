@@ -0,0 +1,134 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief File stream buffer with a background I/O thread
+ *
+ * BinaryFileWriter and BinaryFileReader sit on an AsyncFileBuf. It owns a
+ * ring of aligned chunks of several MB and one thread that moves them
+ * to or from the file:
+ *
+ *  - writing, the caller fills one chunk while the thread writes the
+ *    others. The caller only waits when every chunk is still in flight;
+ *  - reading, the thread reads the chunks ahead of the caller's position,
+ *    and a chunk is refilled as soon as the caller has consumed it.
+ *
+ * With two buffers this is double buffering, with three triple buffering;
+ * one buffer makes every transfer synchronous. With direct I/O the file is
+ * also opened with O_DIRECT and every transfer that is aligned bypasses
+ * the page cache. The others, such as the tail of the file, go through a
+ * normal descriptor. Where O_DIRECT is not supported the file is used
+ * buffered.
+ *
+ * pwrite/pread are used with explicit offsets, so seeking only drains the
+ * transfers in flight. Like qdp_map_route.h this header does not depend
+ * on the rest of QDP.
+ */
+
+#ifndef QDP_ASYNC_IO_H
+#define QDP_ASYNC_IO_H
+
+#include <condition_variable>
+#include <deque>
+#include <ios>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace QDP {
+
+  struct AsyncIOOptions
+  {
+    //! Bytes per chunk, rounded up to a multiple of 4096
+    size_t chunk = 8 << 20;
+    //! Number of chunks
+    int buffers = 2;
+    //! Bypass the page cache where the file system allows it
+    bool direct = false;
+  };
+
+  //! Options of the files opened from now on (-iochunk MB, -iobuffers N, -iodirect)
+  void asyncIOSetOptions( const AsyncIOOptions& opt );
+  const AsyncIOOptions& asyncIOGetOptions();
+
+
+  class AsyncFileBuf : public std::streambuf
+  {
+  public:
+    AsyncFileBuf();
+    ~AsyncFileBuf();
+
+    /*! \brief Open for reading (in) or for writing a new file (out)
+     *
+     * Returns false when the file cannot be opened.
+     */
+    bool open( const std::string& path , std::ios_base::openmode mode ,
+	       const AsyncIOOptions& opt = asyncIOGetOptions() );
+
+    bool is_open() const { return fd >= 0; }
+
+    //! Whether aligned transfers bypass the page cache
+    bool directIO() const { return fd_direct >= 0; }
+
+    //! Finish the pending writes and close; false if any transfer failed
+    bool close();
+
+  protected:
+    int_type overflow( int_type c );
+    std::streamsize xsputn( const char* s , std::streamsize n );
+    int_type underflow();
+    int sync();
+    pos_type seekoff( off_type off , std::ios_base::seekdir dir , std::ios_base::openmode which );
+    pos_type seekpos( pos_type pos , std::ios_base::openmode which );
+
+  private:
+    AsyncFileBuf( const AsyncFileBuf& );
+    AsyncFileBuf& operator=( const AsyncFileBuf& );
+
+    struct Chunk
+    {
+      char*  data = nullptr;
+      long long offset = 0;   // file offset of data[0]
+      size_t len = 0;         // bytes to write or to read
+      bool   busy = false;    // queued or being transferred
+      long long result = 0;   // bytes transferred, -1 on error
+    };
+
+    void run();
+    long long transfer( const Chunk& c );
+    void submit( int i );
+    void wait( int i );
+    void drain();
+    long long fileSize();
+
+    void flushPut();
+    void startRead( long long pos );
+    long long position();
+
+    int fd;
+    int fd_direct;
+    bool writing;
+    size_t chunk;
+    std::vector<Chunk> chunks;
+
+    //! Chunk in the put or get area, -1 for none
+    int cur;
+    //! Writing: file offset of the put area
+    long long put_base;
+    //! Reading: next offset to read ahead, bytes to skip in the next chunk, end of file seen
+    long long next_read;
+    size_t skip;
+    bool eof_seen;
+
+    std::thread io;
+    std::mutex mtx;
+    std::condition_variable cv_io, cv_done;
+    std::deque<int> queue;
+    bool stop;
+    int error;
+  };
+
+} // namespace QDP
+
+#endif
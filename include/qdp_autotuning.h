@@ -3,10 +3,61 @@
 
 namespace QDP {
 
-  void jit_launch(CUfunction function,int th_count,std::vector<void *>& args);
+  //! Launch with block size search. bytes_per_thread only feeds the kernel profile
+  /*! The search (see BlockSizeTuner) runs separately for every thread
+      count a kernel is launched with, so a new problem size is tuned anew. */
+  void jit_launch(CUfunction function,int th_count,std::vector<void *>& args,size_t bytes_per_thread = 0);
+
+  //! Timed launches per block size candidate (-tunesamples)
+  void jit_set_tune_samples( int n );
+
+  //! Forget all tuning results
+  void jit_tune_reset();
 
   int jit_autotuning(CUfunction function,int lo,int hi,void ** param);
 
+
+  //! Shared memory staging of shifted fields (see function_build_tiled)
+  /*! off: plain kernels only, on: tiled kernels where possible,
+      autotune: time both variants per call site and keep the faster one.
+      Set with -tiling off|on|auto on the command line. Only blocked
+      layouts are tiled, see LayoutPolicy::blocked. */
+  enum class JitTiling { off, on, autotune };
+
+  void      jit_set_tiling( JitTiling mode );
+  JitTiling jit_get_tiling();
+  bool      jit_parse_tiling( const char* str , JitTiling& mode );
+
+  //! Launch a tiled kernel
+  /*! args(block) returns the kernel arguments for a given block size, the
+      tile tables depend on it. Each thread needs at least shared_per_thread
+      bytes, which bounds the block size. shared_bytes (the shared memory
+      of the launch) and bytes_per_thread are read after args has run, so
+      args fills them in. */
+  void jit_launch_tiled( CUfunction function , int th_count , int shared_per_thread ,
+			 const std::function< std::vector<void*>& (int) >& args ,
+			 const size_t& shared_bytes ,
+			 const size_t& bytes_per_thread );
+
+  //! Whether the block size search for a kernel has finished, for its latest thread count
+  bool   jit_tune_settled( CUfunction function );
+  double jit_tune_best_time( CUfunction function );
+
+  //! Plain or tiled kernel for one evaluate() call site
+  struct JitTileChoice {
+    JitTileChoice(): decided(false), tiled(false) {}
+    bool decided;
+    bool tiled;
+  };
+
+  //! Whether a call site should build and try its tiled kernel
+  bool jit_tile_enabled( const JitTileChoice& choice );
+
+  bool jit_tile_select( JitTileChoice& choice , CUfunction plain , CUfunction tiled );
+
+  //! The tiled kernel can not run at this call site, do not try it again
+  void jit_tile_reject( JitTileChoice& choice );
+
 }
 
 #endif
@@ -27,12 +27,32 @@ namespace QDPUtil
   //! crc32
   n_uint32_t crc32(n_uint32_t crc, const char *buf, size_t len);
 
+  //! crc32 of the concatenation of two pieces from their crc32's and the length of the second
+  /*! So that pieces can be checksummed separately, e.g. on several threads */
+  n_uint32_t crc32_combine(n_uint32_t crc1, n_uint32_t crc2, size_t len2);
+
+  //! From this size on crc32 and byte_swap_crc32 split the data over the host worker threads
+  const size_t crc32_parallel_bytes = 1 << 20;
+
   //! Is the native byte order big endian?
   bool big_endian();
 
   //! Byte-swap an array of data each of size nmemb
   void byte_swap(void *ptr, size_t size, size_t nmemb);
 
+  //! Byte-swap nmemb words of size bytes from src into dst, which may be src
+  void byte_swap_copy(void *dst, const void *src, size_t size, size_t nmemb);
+
+  //! Byte-swap from src into dst and update the crc32 in the same pass
+  /*! 
+   * The checksum covers the data as it is in the file: the swapped bytes
+   * with crc_of_dst (writing), the bytes of src otherwise (reading). The
+   * data go through the cache in small blocks, each swapped and summed
+   * while it is there. dst may be src.
+   */
+  n_uint32_t byte_swap_crc32(n_uint32_t crc, void *dst, const void *src, size_t size, size_t nmemb,
+			     bool crc_of_dst);
+
   //! fread on a binary file written in big-endian order
   size_t bfread(void *ptr, size_t size, size_t nmemb, FILE *stream);
 
@@ -6,6 +6,7 @@
 #include <vector>
 #include <stack>
 #include <list>
+#include <string>
 #include "string.h"
 #include "math.h"
 
@@ -21,7 +22,27 @@ namespace QDP
   class QDPCache
   {
     struct Entry;
+    struct TraceEvent;
   public:
+    //! Transfer counters, always collected. Times are in seconds
+    struct Stats {
+      size_t h2d_count, h2d_bytes;  double h2d_time;
+      size_t d2h_count, d2h_bytes;  double d2h_time;
+      size_t layout_count, layout_bytes;  double layout_time;  // e.fptr conversions
+      size_t spill_alloc;      // evicted to make room on the device
+      size_t spill_host;       // pulled back to the host by getHostPtr
+      size_t sync_host;        // getHostPtr on a locked object, forced a device sync
+      size_t device_bytes, device_peak;   // resident in the device pool, incl. static
+      size_t host_bytes, host_peak;       // host copies owned by the cache
+    };
+
+    //! Objects pulled back to the host most often, by cache id
+    struct HostPulls {
+      int    id;
+      size_t size;
+      size_t pulls;
+    };
+
     typedef void (* LayoutFptr)(bool toDev,void * outPtr,void * inPtr);
     static QDPCache& Instance();
 
@@ -54,15 +75,27 @@ namespace QDP
     void freeHostMemory(Entry& e);
     void allocateHostMemory(Entry& e);
     void assureDevice(Entry& e);
-    bool assureHost(Entry& e);
+    bool assureHost(Entry& e, bool evict = false);
     bool spill_lru();
     void printTracker();
     void deleteObjects();
+
+    const Stats& getStats() const { return stats; }
+    void resetStats();
+    std::vector<HostPulls> topHostPulls( size_t n ) const;
+    //! Print the counters at QDP_finalize (-cachestats)
+    void setPrintStats( bool p ) { print_stats = p; }
+    void printStats();
+
+    //! Record state transitions per object id in Chrome trace format (-cachetrace)
+    void setTraceFile( const std::string& file );
+    void writeTrace();
+
     QDPCache();
     ~QDPCache();
 
   private:
-    list<void *>        lstStatic;
+    list< pair<void*,size_t> > lstStatic;   // with sizes for the residency counters
 
     vector<Entry>       vecEntry;
     stack<int>          stackFree;
@@ -75,6 +108,18 @@ namespace QDP
     int                 prevLS;
     list<char*>         listBackup;
 
+    void addDevice( long n );
+    void addHost( long n );
+    void trace( char ph , const char* name , int id , double ts , double dur , size_t size );
+    void retirePulls( const Entry& e );
+
+    Stats               stats;
+    bool                print_stats;
+    vector<HostPulls>   retiredPulls;     // signed off objects with host pulls, bounded
+    std::string         trace_file;
+    vector<TraceEvent>  vecTrace;
+    size_t              trace_dropped;
+
   };
 
 
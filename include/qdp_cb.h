@@ -0,0 +1,220 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Operations on checkerboard fields (OLatticeCB)
+ *
+ * Evaluation, zero, pack/unpack to and from full fields and global sums.
+ * A checkerboard field is always written on all of its sites, so evaluate
+ * takes only all or rb[dest.getCB()] as the subset, and every OLatticeCB
+ * leaf of the expression must be on the checkerboard of the destination.
+ */
+
+#ifndef QDP_CB_H
+#define QDP_CB_H
+
+namespace QDP {
+
+  typedef OLatticeCB<LatticeFermion::SubType_t>       LatticeFermionCB;
+  typedef OLatticeCB<LatticeHalfFermion::SubType_t>   LatticeHalfFermionCB;
+  typedef OLatticeCB<LatticeColorVector::SubType_t>   LatticeColorVectorCB;
+  typedef OLatticeCB<LatticeColorMatrix::SubType_t>   LatticeColorMatrixCB;
+  typedef OLatticeCB<LatticeComplex::SubType_t>       LatticeComplexCB;
+  typedef OLatticeCB<LatticeReal::SubType_t>          LatticeRealCB;
+
+
+  //! Checkerboard of the OLatticeCB leaves of rhs, -1 if it has none
+  template<class RHS, class C1>
+  int exprCB(const QDPExpr<RHS,C1>& rhs)
+  {
+    int mask = forEach(rhs, CheckerboardLeaf(), BitOrCombine());
+    if (mask == 3)
+      QDP_error_exit("OLatticeCB: expression mixes fields on rb[0] and rb[1]");
+    return mask == 0 ? -1 : mask >> 1;
+  }
+
+
+  //! Whether a and b are the same subset of the same set
+  inline bool sameSubset(const Subset& a, const Subset& b)
+  {
+    return &a.getSet() == &b.getSet() && a.color() == b.color();
+  }
+
+
+  template<class T, class C1, class Op, class RHS>
+  void evaluate_cb(OLatticeCB<T>& dest, const Op& op, const QDPExpr<RHS,C1>& rhs, const Subset& s)
+  {
+    int cb = exprCB(rhs);
+    if (cb >= 0 && cb != dest.getCB())
+      QDP_error_exit("OLatticeCB: destination on rb[%d], expression on rb[%d]", dest.getCB(), cb);
+    if (!sameSubset(s, all) && !sameSubset(s, rb[dest.getCB()]))
+      QDP_error_exit("OLatticeCB: destination on rb[%d], the subset must be all or rb[%d]", dest.getCB(), dest.getCB());
+
+#if defined(QDP_USE_PROFILING)
+    static QDPProfile_t prof(dest, op, rhs);
+    prof.stime(getClockTime());
+#endif
+
+    static CUfunction function;
+
+    if (function == NULL)
+      function = function_cb_build(dest, op, rhs);
+
+    function_cb_exec(function, dest, op, rhs);
+
+#if defined(QDP_USE_PROFILING)
+    prof.etime(getClockTime(),function);
+    prof.count++;
+    prof.print();
+#endif
+  }
+
+
+  //! OLatticeCB Op OLatticeCB(Expression(source))
+  template<class T, class T1, class Op, class RHS>
+  void evaluate(OLatticeCB<T>& dest, const Op& op, const QDPExpr<RHS,OLatticeCB<T1> >& rhs,
+		const Subset& s)
+  {
+    evaluate_cb(dest, op, rhs, s);
+  }
+
+
+  //! OLatticeCB Op Scalar(Expression(source))
+  template<class T, class T1, class Op, class RHS>
+  void evaluate(OLatticeCB<T>& dest, const Op& op, const QDPExpr<RHS,OScalar<T1> >& rhs,
+		const Subset& s)
+  {
+    evaluate_cb(dest, op, rhs, s);
+  }
+
+
+  //! dest = 0
+  template<class T>
+  void zero_rep(OLatticeCB<T>& dest)
+  {
+    static CUfunction function;
+
+    if (function == NULL)
+      function = function_cb_zero_rep_build( dest );
+
+    function_cb_zero_rep_exec( function , dest );
+  }
+
+
+  //! dest = src on the sites of rb[dest.getCB()]
+  template<class T>
+  void pack(OLatticeCB<T>& dest, const OLattice<T>& src)
+  {
+    static CUfunction function;
+
+    if (function == NULL)
+      function = function_cb_copy_build( dest , src , true );
+
+    function_cb_copy_exec( function , dest , src );
+  }
+
+
+  //! dest = src on the sites of rb[src.getCB()], dest is unchanged elsewhere
+  template<class T>
+  void unpack(OLattice<T>& dest, const OLatticeCB<T>& src)
+  {
+    static CUfunction function;
+
+    if (function == NULL)
+      function = function_cb_copy_build( src , dest , false );
+
+    function_cb_copy_exec( function , src , dest );
+  }
+
+
+  //! First reduction pass, reads checkerboard site idx directly
+  template < class T1 , class T2 >
+  void reduce_convert_cb(int size, int threads, int blocks, int shared_mem_usage,
+			 T1 *d_idata, T2 *d_odata)
+  {
+    static CUfunction function;
+
+    if (function == NULL)
+      function = function_sum_ind_build<T1,T2,JitDeviceLayout::Coalesced>( OLatticeCB<T1>::sites() , false );
+
+    function_sum_ind_exec(function, size, threads, blocks, shared_mem_usage,
+			  (void*)d_idata, (void*)d_odata, NULL, sizeof(T1), sizeof(T2) );
+  }
+
+
+  //! OScalar = sum(OLatticeCB)
+  template<class T1>
+  typename UnaryReturn<OLattice<T1>, FnSum>::Type_t
+  sum(const OLatticeCB<T1>& s1)
+  {
+    typedef typename UnaryReturn<OLattice<T1>, FnSum>::Type_t::SubType_t T2;
+
+    T2 * out_dev;
+    T2 * in_dev;
+
+    typename UnaryReturn<OLattice<T1>, FnSum>::Type_t  d;
+
+    int actsize = OLatticeCB<T1>::sites();
+    bool first=true;
+    while (1) {
+
+      int numThreads = DeviceParams::Instance().getMaxBlockX();
+      while ((numThreads*sizeof(T2) > DeviceParams::Instance().getMaxSMem()) || (numThreads > actsize)) {
+	numThreads >>= 1;
+      }
+      int numBlocks=(int)ceil(float(actsize)/numThreads);
+
+      if (numBlocks > DeviceParams::Instance().getMaxGridX()) {
+	QDP_error_exit( "sum(LatCB) numBlocks(%d) > maxGridX(%d)",numBlocks,(int)DeviceParams::Instance().getMaxGridX());
+      }
+
+      int shared_mem_usage = numThreads*sizeof(T2);
+
+      if (first) {
+	if (!QDPCache::Instance().allocate_device_static( (void**)&out_dev , numBlocks*sizeof(T2) ))
+	  QDP_error_exit( "sum(LatCB) reduction buffer: 1st buffer no memory, exit");
+	if (!QDPCache::Instance().allocate_device_static( (void**)&in_dev , numBlocks*sizeof(T2) ))
+	  QDP_error_exit( "sum(LatCB) reduction buffer: 2nd buffer no memory, exit");
+      }
+
+      T2* dest = numBlocks == 1 ? (T2*)QDPCache::Instance().getDevicePtr( d.getId() ) : out_dev;
+
+      if (first)
+	reduce_convert_cb<T1,T2>( actsize , numThreads , numBlocks , shared_mem_usage ,
+				  (T1*)QDPCache::Instance().getDevicePtr( s1.getId() ) , dest );
+      else
+	reduce_convert<T2>( actsize , numThreads , numBlocks , shared_mem_usage , in_dev , dest );
+
+      first =false;
+
+      if (numBlocks==1)
+	break;
+
+      actsize=numBlocks;
+
+      T2 * tmp = in_dev;
+      in_dev = out_dev;
+      out_dev = tmp;
+    }
+
+    QDPCache::Instance().free_device_static( in_dev );
+    QDPCache::Instance().free_device_static( out_dev );
+
+    QDPInternal::globalSum(d);
+
+    return d;
+  }
+
+
+  //! OScalar = sum(OLatticeCB expression)
+  template<class RHS, class T>
+  typename UnaryReturn<OLattice<T>, FnSum>::Type_t
+  sum(const QDPExpr<RHS,OLatticeCB<T> >& s1)
+  {
+    OLatticeCB<T> l( std::max( exprCB(s1) , 0 ) );
+    l=s1;
+    return sum(l);
+  }
+
+} // namespace QDP
+
+#endif
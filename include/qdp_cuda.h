@@ -18,10 +18,15 @@ namespace QDP {
   int CudaGetConfig(int what);
   void CudaGetSM(int* maj,int* min);
 
+  //! Theoretical device memory bandwidth in bytes/s, 0 if unknown
+  double CudaPeakBandwidth();
+
+  //! bytes_per_thread is the traffic estimate recorded by the kernel profile
   void CudaLaunchKernel( CUfunction f, 
 			 unsigned int  gridDimX, unsigned int  gridDimY, unsigned int  gridDimZ, 
 			 unsigned int  blockDimX, unsigned int  blockDimY, unsigned int  blockDimZ, 
-			 unsigned int  sharedMemBytes, CUstream hStream, void** kernelParams, void** extra );
+			 unsigned int  sharedMemBytes, CUstream hStream, void** kernelParams, void** extra,
+			 size_t bytes_per_thread = 0 );
 
   int CudaAttributeNumRegs( CUfunction f );
   int CudaAttributeLocalSize( CUfunction f );
@@ -42,6 +47,7 @@ namespace QDP {
   void * CudaGetKernelStream();
 
   void CudaSetDevice(int dev);
+  void CudaSetCurrentContext();
   void CudaGetDeviceCount(int * count);
   void CudaGetDeviceProps();
 
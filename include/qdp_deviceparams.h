@@ -65,11 +65,12 @@ namespace QDP {
 
     void autoDetect();
 
+    size_t roundDown2pow(size_t x);
+
   private:
     DeviceParams(): GPUDirect(false), syncDevice(false), maxKernelArg(512) {};   // Private constructor
     DeviceParams(const DeviceParams&);                                           // Prevent copy-construction
     DeviceParams& operator=(const DeviceParams&);
-    size_t roundDown2pow(size_t x);
 
   private:
     int device;
@@ -66,22 +66,28 @@ void dispatch_to_threads(int numSiteTable, Arg a, void (*func)(int,int,int,Arg*)
 }
 }
 #else
+
+ /* Without OpenMP or QMT the persistent host pool does the work. Every
+    thread gets its static chunk once, as with OpenMP, and the chunks
+    match the ones the PTX emulator uses for the same number of sites. */
+
+#include "qdp_host_threads.h"
+
 namespace QDP {
 
  inline
  int qdpNumThreads()
  {
-   return 1;
+   return hostThreadsGetCount();
  }
 
 template<class Arg>
 void dispatch_to_threads(int numSiteTable, Arg a, void (*func)(int,int,int,Arg*)){
-   
-  int low = 0;
-  int high = numSiteTable;
-   
-  func(low, high, 0, &a);
-    
+
+  hostParallelFor(numSiteTable, 1, false, [&](size_t low, size_t high, int myId) {
+      func((int)low, (int)high, myId, &a);
+    });
+
  }
 
 } 
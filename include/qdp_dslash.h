@@ -0,0 +1,72 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Wilson hopping term with spin projection before the shifts
+ *
+ * Written naively, the hopping term shifts full spinors in eight
+ * directions. Here each direction is projected to a half spinor first,
+ * so the gather kernels and the halo carry half spinors, and the
+ * backward link is applied before the shift. The links multiply the
+ * half spinors and the result is reconstructed in registers of the one
+ * kernel that writes chi. With off-node neighbours that kernel runs
+ * once on the inner sites while the halos are in flight and once on the
+ * face sites (function_exec).
+ */
+
+#ifndef QDP_DSLASH_H
+#define QDP_DSLASH_H
+
+namespace QDP {
+
+#if QDP_ND == 4 && QDP_NS == 4
+
+  //! Wilson hopping term on one checkerboard
+  /*!
+   * chi(x) = sum_mu (1 - isign gamma_mu) U_mu(x) psi(x+mu)
+   *               + (1 + isign gamma_mu) U_mu^dag(x-mu) psi(x-mu)
+   *
+   * for x on checkerboard cb (rb[cb]); chi is left alone elsewhere.
+   * gamma_mu is Gamma(1 << mu). Needs Nd = Ns = 4. 1320 flops per site.
+   */
+  template<class T, class U>
+  void wilsonDslash(OLattice<T>& chi, const multi1d< OLattice<U> >& u, const OLattice<T>& psi,
+		    int isign, int cb)
+  {
+    if (u.size() != Nd)
+      QDP_error_exit("wilsonDslash: need %d links, got %d", Nd, u.size());
+
+    if (isign == +1)
+    {
+      chi[rb[cb]] =
+	  spinReconstructDir0Minus( u[0] * shift( spinProjectDir0Minus(psi) , FORWARD , 0 ) )
+	+ spinReconstructDir0Plus( shift( adj(u[0]) * spinProjectDir0Plus(psi) , BACKWARD , 0 ) )
+	+ spinReconstructDir1Minus( u[1] * shift( spinProjectDir1Minus(psi) , FORWARD , 1 ) )
+	+ spinReconstructDir1Plus( shift( adj(u[1]) * spinProjectDir1Plus(psi) , BACKWARD , 1 ) )
+	+ spinReconstructDir2Minus( u[2] * shift( spinProjectDir2Minus(psi) , FORWARD , 2 ) )
+	+ spinReconstructDir2Plus( shift( adj(u[2]) * spinProjectDir2Plus(psi) , BACKWARD , 2 ) )
+	+ spinReconstructDir3Minus( u[3] * shift( spinProjectDir3Minus(psi) , FORWARD , 3 ) )
+	+ spinReconstructDir3Plus( shift( adj(u[3]) * spinProjectDir3Plus(psi) , BACKWARD , 3 ) );
+    }
+    else if (isign == -1)
+    {
+      chi[rb[cb]] =
+	  spinReconstructDir0Plus( u[0] * shift( spinProjectDir0Plus(psi) , FORWARD , 0 ) )
+	+ spinReconstructDir0Minus( shift( adj(u[0]) * spinProjectDir0Minus(psi) , BACKWARD , 0 ) )
+	+ spinReconstructDir1Plus( u[1] * shift( spinProjectDir1Plus(psi) , FORWARD , 1 ) )
+	+ spinReconstructDir1Minus( shift( adj(u[1]) * spinProjectDir1Minus(psi) , BACKWARD , 1 ) )
+	+ spinReconstructDir2Plus( u[2] * shift( spinProjectDir2Plus(psi) , FORWARD , 2 ) )
+	+ spinReconstructDir2Minus( shift( adj(u[2]) * spinProjectDir2Minus(psi) , BACKWARD , 2 ) )
+	+ spinReconstructDir3Plus( u[3] * shift( spinProjectDir3Plus(psi) , FORWARD , 3 ) )
+	+ spinReconstructDir3Minus( shift( adj(u[3]) * spinProjectDir3Minus(psi) , BACKWARD , 3 ) );
+    }
+    else
+    {
+      QDP_error_exit("wilsonDslash: isign must be +1 or -1, got %d", isign);
+    }
+  }
+
+#endif
+
+} // namespace QDP
+
+#endif
@@ -0,0 +1,90 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief 16-bit floating point storage words
+ *
+ * float16 (IEEE binary16) and bfloat16 are storage-only word types. Fields
+ * built on them keep their data in 16 bits, but every load widens to a
+ * 32-bit register and all arithmetic is done in single precision. Stores
+ * round back to 16 bits with the mode selected by setHalfRounding().
+ *
+ * This header does not depend on the rest of QDP so that the conversion
+ * routines can be used (and tested) without a GPU.
+ */
+
+#ifndef QDP_HALF_H
+#define QDP_HALF_H
+
+#include <iostream>
+
+namespace QDP {
+
+  //! Rounding modes for float -> 16-bit conversions (same meaning as the PTX cvt modifiers)
+  enum class HalfRounding { rn, rz, rm, rp };
+
+  //! Rounding mode used by JIT stores and host conversions that do not pass one explicitly
+  /*! The JIT reads the mode when a kernel is built, already built kernels keep theirs.
+      Can be set with -halfround rn|rz|rm|rp on the command line. */
+  void         setHalfRounding( HalfRounding mode );
+  HalfRounding getHalfRounding();
+
+  //! Parse "rn", "rz", "rm" or "rp"; returns false on anything else
+  bool         parseHalfRounding( const char* str , HalfRounding& mode );
+
+  //! IEEE binary16 conversions
+  unsigned short floatToHalfBits( float f , HalfRounding mode );
+  float          halfBitsToFloat( unsigned short h );
+
+  //! bfloat16 conversions (upper half of an IEEE binary32)
+  unsigned short floatToBFloat16Bits( float f , HalfRounding mode );
+  float          bfloat16BitsToFloat( unsigned short b );
+
+
+  //! IEEE half precision storage word
+  struct float16
+  {
+    unsigned short bits;
+
+    float16() {}
+    float16(float f) : bits( floatToHalfBits( f , getHalfRounding() ) ) {}
+    float16(double f) : bits( floatToHalfBits( (float)f , getHalfRounding() ) ) {}
+    float16(int i) : bits( floatToHalfBits( (float)i , getHalfRounding() ) ) {}
+
+    static float16 fromBits( unsigned short b ) { float16 h; h.bits = b; return h; }
+
+    operator float() const { return halfBitsToFloat( bits ); }
+
+    float16& operator+=(float rhs) { *this = float16( float(*this) + rhs ); return *this; }
+    float16& operator-=(float rhs) { *this = float16( float(*this) - rhs ); return *this; }
+    float16& operator*=(float rhs) { *this = float16( float(*this) * rhs ); return *this; }
+    float16& operator/=(float rhs) { *this = float16( float(*this) / rhs ); return *this; }
+  };
+
+
+  //! bfloat16 storage word
+  struct bfloat16
+  {
+    unsigned short bits;
+
+    bfloat16() {}
+    bfloat16(float f) : bits( floatToBFloat16Bits( f , getHalfRounding() ) ) {}
+    bfloat16(double f) : bits( floatToBFloat16Bits( (float)f , getHalfRounding() ) ) {}
+    bfloat16(int i) : bits( floatToBFloat16Bits( (float)i , getHalfRounding() ) ) {}
+
+    static bfloat16 fromBits( unsigned short b ) { bfloat16 h; h.bits = b; return h; }
+
+    operator float() const { return bfloat16BitsToFloat( bits ); }
+
+    bfloat16& operator+=(float rhs) { *this = bfloat16( float(*this) + rhs ); return *this; }
+    bfloat16& operator-=(float rhs) { *this = bfloat16( float(*this) - rhs ); return *this; }
+    bfloat16& operator*=(float rhs) { *this = bfloat16( float(*this) * rhs ); return *this; }
+    bfloat16& operator/=(float rhs) { *this = bfloat16( float(*this) / rhs ); return *this; }
+  };
+
+
+  inline std::ostream& operator<<(std::ostream& s, const float16& h)  { return s << float(h); }
+  inline std::ostream& operator<<(std::ostream& s, const bfloat16& h) { return s << float(h); }
+
+} // namespace QDP
+
+#endif
@@ -0,0 +1,83 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Persistent, NUMA aware host worker threads
+ *
+ * The host side of qdp-jit (the PTX emulator, dispatch_to_threads without
+ * OpenMP or QMT, large host copies) runs its parallel loops on one pool of
+ * worker threads that lives for the whole run. The caller is worker 0.
+ *
+ * Loops over [0,n) are split into one contiguous chunk per worker, always
+ * the same for the same n and worker count. Memory first written through
+ * such a loop therefore lands on the NUMA node of the worker that will
+ * read it in the next loop of the same shape. Workers that finish their
+ * chunk early may steal pieces from the end of the others' chunks, taking
+ * from their own NUMA node first, so uneven subsets still balance.
+ *
+ * Pinning places worker w on the w*ncpu/nworker-th allowed CPU with the
+ * CPUs ordered by NUMA node, so neighbouring chunks share a node and every
+ * node gets its share of workers. NUMA nodes are read from sysfs; without
+ * it the machine counts as one node.
+ *
+ * Like qdp_ptx_emu.h this header does not depend on the rest of QDP.
+ */
+
+#ifndef QDP_HOST_THREADS_H
+#define QDP_HOST_THREADS_H
+
+#include <cstddef>
+#include <functional>
+
+namespace QDP {
+
+  //! Worker count (-hostthreads N), 0 means one per allowed CPU. Applies from the next loop on
+  void hostThreadsSetCount( int n );
+  //! Worker count the next loop will use
+  int  hostThreadsGetCount();
+
+  //! Pinning mode (-hostpin on|off|auto). Auto pins when there is more than one NUMA node
+  enum class HostPinning { off , on , automatic };
+  void hostThreadsSetPinning( HostPinning p );
+  bool hostThreadsParsePinning( const char* s , HostPinning& p );
+  //! Whether the workers are pinned with the current settings
+  bool hostThreadsPinned();
+
+  int hostNumaNodes();
+  //! NUMA node worker w runs on when pinned, -1 when not pinned
+  int hostThreadsNode( int w );
+
+  //! First index of worker w's chunk when [0,n) is split over nw workers
+  inline size_t hostPartitionBegin( size_t n , int w , int nw ) {
+    return (size_t)( (unsigned long long)n * w / nw );
+  }
+
+  /*! \brief Run f(lo,hi,worker) over [0,n) on the pool
+   *
+   * Every worker walks its own chunk in pieces of grain indices. With
+   * steal, idle workers then take pieces from the other chunks; without,
+   * f is called exactly once per worker with its whole chunk (maybe empty
+   * when n is below the worker count), which is what per-thread partial
+   * results need. Returns once all of [0,n) is
+   * done. An exception thrown by f is rethrown here.
+   *
+   * Called from inside a loop, or while another thread runs one, the loop
+   * runs serially on the caller as worker 0.
+   */
+  void hostParallelFor( size_t n , size_t grain , bool steal ,
+			const std::function<void(size_t,size_t,int)>& f );
+
+  /*! \brief Give the pages inside [p,p+bytes) back to the OS
+   *
+   * The contents become zero and the next write to a page places it on
+   * the writer's NUMA node. Only whole pages are released, the partial
+   * ones at both ends keep their contents. The memory must be private
+   * anonymous memory, as from malloc.
+   */
+  void hostReleasePages( void* p , size_t bytes );
+
+  //! Copy with the static partition of the bytes, so the pages of dst are spread like a loop's
+  void hostParallelCopy( void* dst , const void* src , size_t bytes );
+
+} // namespace QDP
+
+#endif
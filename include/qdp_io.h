@@ -12,6 +12,7 @@
 #include <fstream>
 #include <sstream>
 #include "qdp_byteorder.h"
+#include "qdp_async_io.h"
 #include <vector>
 #include <map>
 #include <list>
@@ -938,12 +939,65 @@ namespace QDP
   };
 
 
+  //--------------------------------------------------------------------------------
+  //!  Binary memory input class
+  /*!
+    This class is used to read data from a memory range owned by the caller,
+    for instance a memory mapped file. Unlike BinaryBufferReader the range is
+    not copied. The data is assumed to be big-endian. Only the range on the
+    primary node is read, all nodes end up with the same data.
+
+    The read methods are also wrapped by externally defined functions
+    and >> operators,
+  */
+  class BinaryMemoryReader : public BinaryReader
+  {
+  public:
+    BinaryMemoryReader();
+
+    //! Construct from a memory range
+    BinaryMemoryReader(const char* data, size_t len);
+
+    ~BinaryMemoryReader();
+
+    //! Read from a memory range, positioned at its start
+    void open(const char* data, size_t len);
+
+  protected:
+    //! Get the current checksum to modify
+    QDPUtil::n_uint32_t& internalChecksum() {return checksum;}
+
+    //! Get the internal input stream
+    std::istream& getIstream() {return f;}
+
+  private:
+    //! Read-only stream buffer over a memory range
+    class MemBuf : public std::streambuf
+    {
+    public:
+      void set(const char* data, size_t len);
+
+    protected:
+      pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which);
+      pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+    };
+
+    //! Checksum
+    QDPUtil::n_uint32_t checksum;
+    MemBuf buf;
+    std::istream f;
+  };
+
+
   //--------------------------------------------------------------------------------
   //!  Binary file input class
   /*!
     This class is used to read data from a binary file. The data in the file
     is assumed to be big-endian. If the host machine is little-endian, the data
     is byte-swapped. All nodes end up with the same data
+
+    The file is read ahead in large chunks by a background thread
+    (qdp_async_io.h).
   
     The read methods are also wrapped by externally defined functions
     and >> operators,   
@@ -989,7 +1043,8 @@ namespace QDP
   private:
     //! Checksum
     QDPUtil::n_uint32_t checksum;
-    std::ifstream f;
+    AsyncFileBuf buf;
+    std::istream f;
   };
 
 
@@ -1433,6 +1488,9 @@ namespace QDP
     is byte-swapped.   Output is done from the primary node only.
 
     Files need to be opened before any of the write methods are used  
+
+    The data go to the file in large chunks written by a background
+    thread (qdp_async_io.h); flush() waits until all of it is written.
   
     The write methods are also wrapped by externally defined functions
     and << operators,   
@@ -1481,7 +1539,8 @@ namespace QDP
   private:
     //! Checksum
     QDPUtil::n_uint32_t checksum;
-    std::ofstream f;
+    AsyncFileBuf buf;
+    std::ostream f;
   };
 
 
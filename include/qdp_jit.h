@@ -10,12 +10,14 @@
 #include<array>
 #include<string>
 #include<cstdlib>
+#include<functional>
+#include<stdint.h>
 
 namespace QDP {
 
   //enum jit_ptx_type { f32=0,f64=1,u16=2,u32=3,u64=4,s16=5,s32=6,s64=7,u8=8,b16=9,b32=10,b64=11,pred=12 };
 
-  enum class jit_ptx_type { f32,f64,u16,u32,u64,s16,s32,s64,u8,b16,b32,b64,pred};
+  enum class jit_ptx_type { f32,f64,u16,u32,u64,s16,s32,s64,u8,b16,b32,b64,pred,f16,bf16};
 
 
   enum class jit_state_space { 
@@ -37,6 +39,17 @@ namespace QDP {
   template<> struct jit_type<double>           { static constexpr jit_ptx_type value = jit_ptx_type::f64; };
   template<> struct jit_type<int>              { static constexpr jit_ptx_type value = jit_ptx_type::s32; };
   template<> struct jit_type<bool>             { static constexpr jit_ptx_type value = jit_ptx_type::pred; };
+  template<> struct jit_type<float16>          { static constexpr jit_ptx_type value = jit_ptx_type::f16; };
+  template<> struct jit_type<bfloat16>         { static constexpr jit_ptx_type value = jit_ptx_type::bf16; };
+
+  //
+  // REGISTER TYPE USED TO COMPUTE WITH A WORD
+  // The 16-bit floating point words are storage only: loads widen them to f32
+  // and stores round back (see jit_ins_load/jit_ins_store).
+  //
+  template<class T> struct jit_reg_type        { static constexpr jit_ptx_type value = jit_type<T>::value; };
+  template<> struct jit_reg_type<float16>      { static constexpr jit_ptx_type value = jit_ptx_type::f32; };
+  template<> struct jit_reg_type<bfloat16>     { static constexpr jit_ptx_type value = jit_ptx_type::f32; };
 
 
 
@@ -78,11 +91,19 @@ namespace QDP {
     LocalCountVec vec_local_count;
     int param_count;
     int local_count;
+    int label_count;
     bool m_shared;
     std::vector<bool> m_include_math_ptx_unary;
     std::vector<bool> m_include_math_ptx_binary;
+    std::string m_description;
+    uint64_t m_start;   // getClockNanoseconds() at construction
+    std::shared_ptr<jit_value> m_param_row;
+    int m_param_row_slots;
   public:
     std::string get_kernel_as_string();
+    void set_description(const std::string& d) { m_description = d; }
+    const std::string& get_description() const { return m_description; }
+    double get_build_seconds() const;
     void set_include_math_ptx_unary(int i) { 
       assert(m_include_math_ptx_unary.size()>i); 
       m_include_math_ptx_unary.at(i) = true; 
@@ -96,18 +117,39 @@ namespace QDP {
     void write_reg_defs();
     int get_param_count();
     void inc_param_count();
+    void set_param_row( std::shared_ptr<jit_value> row ) { m_param_row = row; m_param_row_slots = 0; }
+    const std::shared_ptr<jit_value>& get_param_row() const { return m_param_row; }
+    int next_param_row_slot() { return m_param_row_slots++; }
+    int get_param_row_slots() const { return m_param_row_slots; }
     jit_function();
     int reg_alloc( jit_ptx_type type );
+    int label_alloc();
     std::ostringstream& get_prg();
     std::ostringstream& get_signature();
   };
 
-  extern jit_function_t jit_internal_function;
-
+  // The function under construction is kept per thread. Starting a
+  // new function while another one is being built on the same thread
+  // pushes it onto a stack, so generation can nest.
   void jit_start_new_function();
   jit_function_t jit_get_function();
   std::string jit_get_kernel_as_string();
   CUfunction jit_get_cufunction(const char* fname);
+
+  // Label the function under construction in the kernel profile,
+  // usually with the __PRETTY_FUNCTION__ of the builder
+  void jit_describe_function(const std::string& description);
+  CUfunction jit_load_module(const std::string& ptx_kernel, const char* fname);
+
+  // Build a batch of kernels concurrently. Each builder runs the usual
+  // jit_start_new_function() ... jit_get_cufunction() sequence on a
+  // worker thread (with the CUDA context made current) and the
+  // results are returned in the order of the builders.
+  typedef std::function<CUfunction()> jit_builder_t;
+  std::vector<CUfunction> jit_build_concurrent(const std::vector<jit_builder_t>& builders);
+
+  void jit_set_build_threads(int n);
+  int  jit_get_build_threads();
   
 
   // class jit_function_singleton
@@ -121,11 +163,10 @@ namespace QDP {
 
 
   class jit_label {
-    static int count;
     int count_m;
   public:
     jit_label() {
-      count_m = count++;
+      count_m = jit_get_function()->label_alloc();
     }
     friend std::ostream& operator<< (std::ostream& stream, const jit_label& lab) {
       stream << "L" << lab.count_m;
@@ -177,14 +218,23 @@ namespace QDP {
       r_newidx_local(jit_ptx_type::s32),
       r_newidx_buffer(jit_ptx_type::s32),
       r_pred_in_buf(jit_ptx_type::pred),
-      r_rcvbuf(jit_ptx_type::u64)
+      r_rcvbuf(jit_ptx_type::u64),
+      tiled(false),
+      r_tile_base(jit_ptx_type::u64),
+      r_tile_slot(jit_ptx_type::s32)
     {}
     jit_value r_newidx_local;
     jit_value r_newidx_buffer;
     jit_value r_pred_in_buf;
     jit_value r_rcvbuf;
+
+    // Shared memory staging (tiled kernels only)
+    bool      tiled;
+    jit_value r_tile_base;
+    jit_value r_tile_slot;
   };
 
+
   
   
 
@@ -197,11 +247,19 @@ namespace QDP {
   jit_ptx_type jit_type_promote(jit_ptx_type t0,jit_ptx_type t1);
 
   jit_ptx_type jit_bit_type(jit_ptx_type type);
+  bool         jit_type_is_half(jit_ptx_type type);
   jit_ptx_type jit_type_wide_promote(jit_ptx_type t0);
 
   void jit_ins_bar_sync( int a );
 
   jit_value jit_add_param( jit_ptx_type type );
+
+  // Batched kernels: between begin and end jit_add_param does not add a
+  // kernel parameter but loads it from row, an array of 8 byte slots in
+  // global memory laid out like AddressLeaf::addr. end returns the number
+  // of slots used.
+  void jit_param_table_begin( const jit_value& row );
+  int  jit_param_table_end();
   jit_value jit_allocate_local( jit_ptx_type type , int count );
   jit_value jit_get_shared_mem_ptr();
 
@@ -227,6 +285,7 @@ namespace QDP {
 
   // Binary operations
   jit_value jit_ins_mul_wide( const jit_value& lhs , const jit_value& rhs , const jit_value& pred=jit_value(jit_ptx_type::pred) );
+  jit_value jit_ins_mul_hi( const jit_value& lhs , const jit_value& rhs , const jit_value& pred=jit_value(jit_ptx_type::pred) );
   jit_value jit_ins_mul( const jit_value& lhs , const jit_value& rhs , const jit_value& pred=jit_value(jit_ptx_type::pred) );
   jit_value jit_ins_div( const jit_value& lhs , const jit_value& rhs , const jit_value& pred=jit_value(jit_ptx_type::pred) );
   jit_value jit_ins_add( const jit_value& lhs , const jit_value& rhs , const jit_value& pred=jit_value(jit_ptx_type::pred) );
@@ -314,6 +373,69 @@ namespace QDP {
   jit_value jit_geom_get_linear_th_idx();
 
 
+  //! Philox4x32-10 on u32 registers: ctr is replaced by the random block of (ctr, key)
+  void jit_philox4x32_10( std::vector<jit_value>& ctr , const jit_value& key0 , const jit_value& key1 );
+
+
+  //! Counter-based generator of one site inside a random kernel
+  /*! Hands out the words of the site in the order fill_random visits them,
+      the same as Philox::Stream on the host. Passed as seed, skewed seed
+      and multiplier to fill_random, which then stores one uniform per word. */
+  class PhiloxJIT {
+  public:
+    //! site_lo, site_hi: halves of the global site index, call: the call count
+    PhiloxJIT( const jit_value& key0 , const jit_value& key1 ,
+	       const jit_value& site_lo , const jit_value& site_hi , const jit_value& call );
+
+    //! Next uniform in (0,1) of type f32 (one word) or f64 (two words)
+    jit_value nextUniform( jit_ptx_type type );
+
+  private:
+    jit_value nextWord();
+
+    jit_value key0;
+    jit_value key1;
+    jit_value site_lo;
+    jit_value site_hi;
+    jit_value call;
+    int word;
+    std::vector<jit_value> block;
+  };
+
+
+  //! Per-kernel state while building a tiled kernel
+  /*! The maps are grouped by the field they shift. Each group gets a
+      region of shared memory holding the field on the block's sites and
+      their halo, staged once per block before the barrier; every map of
+      the group reads from it. */
+  struct JitTileState {
+    JitTileState( const jit_value& thread , const jit_value& inactive ):
+      r_thread(jit_val_convert( jit_ptx_type::s32 , thread )),
+      r_inactive(inactive),
+      r_tidx(jit_val_convert( jit_ptx_type::s32 , jit_geom_get_tidx() )),
+      r_ntid(jit_val_convert( jit_ptx_type::s32 , jit_geom_get_ntidx() )),
+      r_shared(jit_get_shared_mem_ptr())
+    {}
+    jit_value r_thread;     // linear thread index, indexes the tile tables
+    jit_value r_inactive;   // thread is past the end, takes part in staging and the barrier only
+    jit_value r_tidx;
+    jit_value r_ntid;
+    jit_value r_shared;
+
+    std::vector<int>       fields;      // QDPCache id of the field of each group
+    std::vector<int>       site_bytes;  // bytes per staged site of each group
+    std::vector<jit_value> regions;     // shared memory of each group
+    std::vector<int>       group;       // group of each map, in the order they are visited
+  };
+
+
+  //! What the launch of a tiled kernel needs to know from its build
+  struct JitTileInfo {
+    std::vector<int> group;       // group of each map, see JitTileState
+    std::vector<int> site_bytes;  // bytes per staged site of each group
+  };
+
+
   class JitOp {
   protected:
     virtual std::ostream& writeToStream( std::ostream& stream ) const = 0;
@@ -389,6 +511,16 @@ namespace QDP {
     }
   };
 
+  class JitOpMulHi: public JitOp {
+  public:
+    JitOpMulHi( const jit_value& lhs , const jit_value& rhs ): JitOp(lhs,rhs) {}
+    virtual std::ostream& writeToStream( std::ostream& stream ) const {
+      stream << "mul.hi."
+	     << jit_get_ptx_type( getDestType() );
+      return stream;
+    }
+  };
+
   class JitOpSHL: public JitOp {
   public:
     JitOpSHL( const jit_value& lhs , const jit_value& rhs ): JitOp(lhs,rhs) {}
@@ -0,0 +1,189 @@
+#ifndef QDP_JITF_CB_H
+#define QDP_JITF_CB_H
+
+namespace QDP {
+
+  //! dest Op rhs on all sites of a checkerboard field
+  /*! Thread j works on checkerboard site j. rhs holds OLatticeCB and
+   *  OScalar leaves only, so no member table or site table is needed.
+   */
+  template<class T, class C1, class Op, class RHS>
+  CUfunction
+  function_cb_build(OLatticeCB<T>& dest, const Op& op, const QDPExpr<RHS,C1>& rhs)
+  {
+    jit_start_new_function();
+
+    jit_describe_function(__PRETTY_FUNCTION__);
+
+    jit_value r_th_count = jit_add_param( jit_ptx_type::s32 );
+
+    jit_value r_idx = jit_geom_get_linear_th_idx();
+
+    jit_ins_exit( jit_ins_ge( r_idx , r_th_count ) );
+
+    ParamLeaf param_leaf( r_idx );
+
+    typedef typename LeafFunctor<OLatticeCB<T>, ParamLeaf>::Type_t  FuncRet_t;
+    FuncRet_t dest_jit(forEach(dest, param_leaf, TreeCombine()));
+
+    auto op_jit = AddOpParam<Op,ParamLeaf>::apply(op,param_leaf);
+
+    typedef typename ForEach<QDPExpr<RHS,C1>, ParamLeaf, TreeCombine>::Type_t View_t;
+    View_t rhs_view(forEach(rhs, param_leaf, TreeCombine()));
+
+    op_jit(dest_jit.elem( JitDeviceLayout::Coalesced ), forEach(rhs_view, ViewLeaf( JitDeviceLayout::Coalesced ), OpCombine()));
+
+    return jit_get_cufunction("ptx_eval_cb.ptx");
+  }
+
+
+  template<class T, class C1, class Op, class RHS>
+  void
+  function_cb_exec(CUfunction function, OLatticeCB<T>& dest, const Op& op, const QDPExpr<RHS,C1>& rhs)
+  {
+    AddressLeaf addr_leaf;
+
+    int junk_dest = forEach(dest, addr_leaf, NullCombine());
+    AddOpAddress<Op,AddressLeaf>::apply(op,addr_leaf);
+    int junk_rhs = forEach(rhs, addr_leaf, NullCombine());
+
+    size_t bytes = addr_leaf.bytes_per_site + (std::is_same<Op,OpAssign>::value ? 0 : sizeof(T));
+
+    int th_count = OLatticeCB<T>::sites();
+
+    std::vector<void*> addr;
+
+    addr.push_back( &th_count );
+
+    for(int i=0; i < addr_leaf.addr.size(); ++i)
+      addr.push_back( &addr_leaf.addr[i] );
+
+    jit_launch(function,th_count,addr,bytes);
+  }
+
+
+
+  template<class T>
+  CUfunction
+  function_cb_zero_rep_build(OLatticeCB<T>& dest)
+  {
+    jit_start_new_function();
+
+    jit_value r_th_count = jit_add_param( jit_ptx_type::s32 );
+
+    jit_value r_idx = jit_geom_get_linear_th_idx();
+
+    jit_ins_exit( jit_ins_ge( r_idx , r_th_count ) );
+
+    ParamLeaf param_leaf( r_idx );
+
+    typedef typename LeafFunctor<OLatticeCB<T>, ParamLeaf>::Type_t  FuncRet_t;
+    FuncRet_t dest_jit(forEach(dest, param_leaf, TreeCombine()));
+
+    zero_rep( dest_jit.elem(JitDeviceLayout::Coalesced) );
+
+    return jit_get_cufunction("ptx_zero_cb.ptx");
+  }
+
+
+  template<class T>
+  void
+  function_cb_zero_rep_exec(CUfunction function, OLatticeCB<T>& dest)
+  {
+    AddressLeaf addr_leaf;
+
+    int junk_0 = forEach(dest, addr_leaf, NullCombine());
+
+    int th_count = OLatticeCB<T>::sites();
+
+    std::vector<void*> addr;
+
+    addr.push_back( &th_count );
+
+    for(int i=0; i < addr_leaf.addr.size(); ++i)
+      addr.push_back( &addr_leaf.addr[i] );
+
+    jit_launch(function,th_count,addr,addr_leaf.bytes_per_site);
+  }
+
+
+
+  //! Copy between a checkerboard field and its sites in a full field
+  /*! to_cb: cb(j) = full(site), otherwise full(site) = cb(j), where site is
+   *  start + j for an ordered rb[cb] and siteTable[j] else.
+   */
+  template<class T>
+  CUfunction
+  function_cb_copy_build(const OLatticeCB<T>& cb, const OLattice<T>& full, bool to_cb)
+  {
+    jit_start_new_function();
+
+    jit_describe_function(__PRETTY_FUNCTION__);
+
+    jit_value r_th_count   = jit_add_param( jit_ptx_type::s32 );
+    jit_value r_ordered    = jit_add_param( jit_ptx_type::pred );
+    jit_value r_start      = jit_add_param( jit_ptx_type::s32 );
+    jit_value r_site_table = jit_add_param( jit_ptx_type::u64 );
+    jit_value r_cb         = jit_add_param( jit_ptx_type::u64 );
+    jit_value r_full       = jit_add_param( jit_ptx_type::u64 );
+
+    jit_value r_idx = jit_geom_get_linear_th_idx();
+
+    jit_ins_exit( jit_ins_ge( r_idx , r_th_count ) );
+
+    jit_value r_site = jit_ins_add( r_idx , r_start );
+
+    jit_label_t label_ordered;
+    jit_ins_branch( label_ordered , r_ordered );
+    {
+      jit_value r_table_addr = jit_ins_add( r_site_table , jit_ins_mul( r_idx , jit_value(4) ) );
+      jit_ins_mov( r_site , jit_ins_load( r_table_addr , 0 , jit_ptx_type::s32 ) );
+    }
+    jit_ins_label( label_ordered );
+
+    typedef typename JITType<T>::Type_t  TJIT;
+
+    OLatticeJIT<TJIT> cb_jit( r_cb , r_idx , OLatticeCB<T>::sites() );
+    OLatticeJIT<TJIT> full_jit( r_full , r_site );
+
+    typename REGType<TJIT>::Type_t reg;
+    if (to_cb) {
+      reg.setup( full_jit.elem( JitDeviceLayout::Coalesced ) );
+      cb_jit.elem( JitDeviceLayout::Coalesced ) = reg;
+    } else {
+      reg.setup( cb_jit.elem( JitDeviceLayout::Coalesced ) );
+      full_jit.elem( JitDeviceLayout::Coalesced ) = reg;
+    }
+
+    return jit_get_cufunction("ptx_cb_copy.ptx");
+  }
+
+
+  template<class T>
+  void
+  function_cb_copy_exec(CUfunction function, const OLatticeCB<T>& cb, const OLattice<T>& full)
+  {
+    const Subset& s = rb[cb.getCB()];
+
+    int   th_count   = s.numSiteTable();
+    bool  ordered    = s.hasOrderedRep();
+    int   start      = s.start();
+    void* site_table = QDPCache::Instance().getDevicePtr( s.getId() );
+    void* cb_ptr     = QDPCache::Instance().getDevicePtr( cb.getId() );
+    void* full_ptr   = QDPCache::Instance().getDevicePtr( full.getId() );
+
+    std::vector<void*> addr;
+
+    addr.push_back( &th_count );
+    addr.push_back( &ordered );
+    addr.push_back( &start );
+    addr.push_back( &site_table );
+    addr.push_back( &cb_ptr );
+    addr.push_back( &full_ptr );
+
+    jit_launch(function,th_count,addr,2*sizeof(T));
+  }
+
+} // namespace QDP
+
+#endif
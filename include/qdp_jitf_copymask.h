@@ -71,7 +71,7 @@ namespace QDP {
       //std::cout << "addr = " << addr_leaf.addr[i] << "\n";
     }
 
-    jit_launch(function,hi-lo,addr);
+    jit_launch(function,hi-lo,addr,addr_leaf.bytes_per_site);
   }
 
 }
@@ -106,7 +106,168 @@ function_gaussian_exec(CUfunction function, OLattice<T>& dest,OLattice<T>& r1,OL
     //std::cout << "addr = " << addr_leaf.addr[i] << "\n";
   }
 
-  jit_launch(function,th_count,addr);
+  jit_launch(function,th_count,addr,addr_leaf.bytes_per_site);
+}
+
+
+
+
+//! Gaussian fill in one kernel
+/*! Both uniform fields of the unfused path are made in registers by the
+    same generator calls, so the result is the same as random(r1),
+    random(r2) and function_gaussian_build, and the generator state ends
+    up the same. Only the destination is written. */
+template<class T>
+CUfunction
+function_gaussian_fused_build(OLattice<T>& dest , RNG::Generator gen)
+{
+  CUfunction func;
+
+  jit_start_new_function();
+
+  jit_value r_lo     = jit_add_param(  jit_ptx_type::s32 );
+  jit_value r_hi     = jit_add_param(  jit_ptx_type::s32 );
+
+  jit_value r_idx_thread = jit_geom_get_linear_th_idx();
+
+  jit_value r_out_of_range       = jit_ins_gt( r_idx_thread , jit_ins_sub( r_hi , r_lo ) );
+  jit_ins_exit(  r_out_of_range );
+
+  jit_value r_idx = jit_ins_add( r_lo , r_idx_thread );
+
+  ParamLeaf param_leaf(  r_idx );
+
+  typedef typename REGType< typename JITType<T>::Type_t >::Type_t TREG;
+  TREG r1_reg;
+  TREG r2_reg;
+
+  if (gen == RNG::Generator::philox)
+  {
+    jit_value r_key0  = jit_add_param(  jit_ptx_type::u32 );
+    jit_value r_key1  = jit_add_param(  jit_ptx_type::u32 );
+    jit_value r_call1 = jit_add_param(  jit_ptx_type::u32 );
+    jit_value r_call2 = jit_add_param(  jit_ptx_type::u32 );
+
+    typedef typename LeafFunctor<OLattice<T>, ParamLeaf>::Type_t  FuncRet_t;
+    FuncRet_t dest_jit(forEach(dest, param_leaf, TreeCombine()));
+
+    typedef typename LeafFunctor<LatticeInteger, ParamLeaf>::Type_t  LatticeIntegerJIT;
+    LatticeIntegerJIT index_lo_jit(forEach( RNG::latticeGlobalIndex(0) , param_leaf, TreeCombine()));
+    LatticeIntegerJIT index_hi_jit(forEach( RNG::latticeGlobalIndex(1) , param_leaf, TreeCombine()));
+
+    WordREG<int> site_lo_reg, site_hi_reg;
+    site_lo_reg.setup( index_lo_jit.elem( JitDeviceLayout::Coalesced ).elem().elem().elem() );
+    site_hi_reg.setup( index_hi_jit.elem( JitDeviceLayout::Coalesced ).elem().elem().elem() );
+
+    PhiloxJIT gen1( r_key0 , r_key1 , site_lo_reg.get_val() , site_hi_reg.get_val() , r_call1 );
+    PhiloxJIT gen2( r_key0 , r_key1 , site_lo_reg.get_val() , site_hi_reg.get_val() , r_call2 );
+
+    fill_random( r1_reg , gen1 , gen1 , gen1 );
+    fill_random( r2_reg , gen2 , gen2 , gen2 );
+
+    fill_gaussian( dest_jit.elem(JitDeviceLayout::Coalesced) , r1_reg , r2_reg );
+  }
+  else
+  {
+    typedef typename LeafFunctor<OLattice<T>, ParamLeaf>::Type_t  FuncRet_t;
+    FuncRet_t dest_jit(forEach(dest, param_leaf, TreeCombine()));
+
+    typedef typename LeafFunctor<Seed, ParamLeaf>::Type_t  SeedJIT;
+    typedef typename LeafFunctor<LatticeSeed, ParamLeaf>::Type_t  LatticeSeedJIT;
+    typedef typename REGType<typename SeedJIT::Subtype_t>::Type_t PSeedREG;
+
+    Seed seed_tmp;
+    SeedJIT ran_seed_jit(forEach(RNG::ran_seed, param_leaf, TreeCombine()));
+    SeedJIT seed_tmp_jit(forEach(seed_tmp, param_leaf, TreeCombine()));
+    SeedJIT ran_mult_n_jit(forEach(RNG::ran_mult_n, param_leaf, TreeCombine()));
+    LatticeSeedJIT lattice_ran_mult_jit(forEach( *RNG::lattice_ran_mult , param_leaf, TreeCombine()));
+
+    PSeedREG seed_reg;
+    PSeedREG skewed_seed_reg;
+    PSeedREG ran_mult_n_reg;
+    PSeedREG lattice_ran_mult_reg;
+
+    seed_reg.setup( ran_seed_jit.elem() );
+    lattice_ran_mult_reg.setup( lattice_ran_mult_jit.elem( JitDeviceLayout::Coalesced ) );
+    ran_mult_n_reg.setup( ran_mult_n_jit.elem() );
+
+    // The two calls of random(): the second starts from the seed the first left
+    skewed_seed_reg = seed_reg * lattice_ran_mult_reg;
+    fill_random( r1_reg , seed_reg , skewed_seed_reg , ran_mult_n_reg );
+
+    skewed_seed_reg = seed_reg * lattice_ran_mult_reg;
+    fill_random( r2_reg , seed_reg , skewed_seed_reg , ran_mult_n_reg );
+
+    fill_gaussian( dest_jit.elem(JitDeviceLayout::Coalesced) , r1_reg , r2_reg );
+
+    jit_value r_no_save = jit_ins_ne( r_idx_thread , jit_value(0) );
+
+    jit_label_t label_nosave;
+    jit_ins_branch(  label_nosave , r_no_save );
+    seed_tmp_jit.elem() = seed_reg;
+    jit_ins_label(  label_nosave );
+  }
+
+  return jit_get_cufunction("ptx_gaussian_fused.ptx");
+}
+
+
+template<class T>
+void 
+function_gaussian_fused_exec(CUfunction function, OLattice<T>& dest, const Subset& s , RNG::Generator gen)
+{
+  if (!s.hasOrderedRep())
+    QDP_error_exit("gaussian on subset with unordered representation not implemented");
+
+  AddressLeaf addr_leaf;
+
+  // lo <= idx <= hi
+  int lo = s.start();
+  int hi = s.end();
+
+  std::vector<void*> addr;
+
+  addr.push_back( &lo );
+  addr.push_back( &hi );
+
+  uint32_t key[2];
+  uint32_t call[2];
+  Seed seed_tmp;
+
+  if (gen == RNG::Generator::philox)
+  {
+    // The counters of the two calls of random()
+    RNG::philoxKey( key );
+    call[0] = RNG::philoxCalls();
+    RNG::philoxAdvance();
+    call[1] = RNG::philoxCalls();
+    RNG::philoxAdvance();
+
+    addr.push_back( &key[0] );
+    addr.push_back( &key[1] );
+    addr.push_back( &call[0] );
+    addr.push_back( &call[1] );
+
+    int junk_0 = forEach(dest, addr_leaf, NullCombine());
+    int junk_1 = forEach(RNG::latticeGlobalIndex(0), addr_leaf, NullCombine());
+    int junk_2 = forEach(RNG::latticeGlobalIndex(1), addr_leaf, NullCombine());
+  }
+  else
+  {
+    int junk_0 = forEach(dest, addr_leaf, NullCombine());
+    int junk_1 = forEach(RNG::ran_seed, addr_leaf, NullCombine());
+    int junk_2 = forEach(seed_tmp, addr_leaf, NullCombine());
+    int junk_3 = forEach(RNG::ran_mult_n, addr_leaf, NullCombine());
+    int junk_4 = forEach(*RNG::lattice_ran_mult, addr_leaf, NullCombine());
+  }
+
+  for(int i=0; i < addr_leaf.addr.size(); ++i)
+    addr.push_back( &addr_leaf.addr[i] );
+
+  jit_launch(function,s.numSiteTable(),addr,addr_leaf.bytes_per_site);
+
+  if (gen == RNG::Generator::lcg)
+    RNG::ran_seed = seed_tmp;
 }
 
 
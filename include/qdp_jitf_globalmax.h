@@ -11,7 +11,7 @@ namespace QDP {
 
   void function_global_max_exec( CUfunction function, 
 				 int size, int threads, int blocks, int shared_mem_usage,
-				 void *d_idata, void *d_odata);
+				 void *d_idata, void *d_odata, size_t elem_size );
 
 
   template<class T1>
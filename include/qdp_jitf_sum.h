@@ -5,19 +5,25 @@
 
 namespace QDP {
 
+// in_size, out_size: bytes of one input and one output element, for the
+// kernel profile only
 void function_sum_ind_exec( CUfunction function, 
 			    int size, int threads, int blocks, int shared_mem_usage,
-			    void *d_idata, void *d_odata, void *siteTable);
+			    void *d_idata, void *d_odata, void *siteTable,
+			    size_t in_size, size_t out_size );
 
 void function_sum_exec( CUfunction function, 
 			int size, int threads, int blocks, int shared_mem_usage,
-			void *d_idata, void *d_odata);
+			void *d_idata, void *d_odata,
+			size_t in_size, size_t out_size );
 
   // T1 input
   // T2 output
+  // input_sites: coalesced stride of the input, 0 for Layout::sitesOnNode()
+  // site_perm:   false reads input site idx directly, the table is ignored
   template< class T1 , class T2 , JitDeviceLayout input_layout >
   CUfunction 
-  function_sum_ind_build()
+  function_sum_ind_build( int input_sites = 0 , bool site_perm = true )
   {
     //std::cout << __PRETTY_FUNCTION__ << ": entering\n";
 
@@ -40,15 +46,18 @@ void function_sum_exec( CUfunction function,
     // I'll do always a site perm here
     // Can eventually be optimized if orderedSubset
     jit_value r_perm_array_addr      = jit_add_param( jit_ptx_type::u64 );  // Site permutation array
-    jit_value r_idx_mul_4            = jit_ins_mul( r_idx , jit_value(4) );
-    jit_value r_perm_array_addr_load = jit_ins_add( r_perm_array_addr , r_idx_mul_4 );
-    jit_value r_idx_perm             = jit_ins_load ( r_perm_array_addr_load , 0 , jit_ptx_type::s32 );
+    jit_value r_idx_perm             = r_idx;
+    if (site_perm) {
+      jit_value r_idx_mul_4            = jit_ins_mul( r_idx , jit_value(4) );
+      jit_value r_perm_array_addr_load = jit_ins_add( r_perm_array_addr , r_idx_mul_4 );
+      r_idx_perm                       = jit_ins_load ( r_perm_array_addr_load , 0 , jit_ptx_type::s32 );
+    }
 
     jit_value r_idata      = jit_add_param( jit_ptx_type::u64 );  // Input  array
     jit_value r_odata      = jit_add_param( jit_ptx_type::u64 );  // output array
     jit_value r_block_idx  = jit_geom_get_ctaidx();
   
-    OLatticeJIT<typename JITType<T1>::Type_t> idata( r_idata , r_idx_perm );   // want coal   access later
+    OLatticeJIT<typename JITType<T1>::Type_t> idata( r_idata , r_idx_perm , input_sites );   // want coal   access later
     OLatticeJIT<typename JITType<T2>::Type_t> odata( r_odata , r_block_idx );  // want scalar access later
 
     // zero_rep() branch should be redundant
@@ -18,7 +18,7 @@ function_build(OLattice<T>& dest, const Op& op, const QDPExpr<RHS,OLattice<T1> >
 
   jit_start_new_function();
 
-  //function.setPrettyFunction(__PRETTY_FUNCTION__);
+  jit_describe_function(__PRETTY_FUNCTION__);
 
   jit_value r_ordered      = jit_add_param(  jit_ptx_type::pred );
   jit_value r_th_count     = jit_add_param(  jit_ptx_type::s32 );
@@ -99,6 +99,127 @@ function_build(OLattice<T>& dest, const Op& op, const QDPExpr<RHS,OLattice<T1> >
 }
 
 
+//! Variant of function_build that stages shifted fields in shared memory
+/*! Every field shifted in rhs is staged once per block, on the block's
+ *  sites and their halo (in sorted order, so the reads are coalesced),
+ *  before a barrier; all maps of the field then read their neighbour from
+ *  the stage. Maps of expressions use the plain gather. Pays off for
+ *  blocked layouts only (LayoutPolicy::blocked), for ordered subsets and
+ *  maps without off-node sites. info returns the grouping of the maps.
+ */
+template<class T, class T1, class Op, class RHS>
+CUfunction
+function_build_tiled(OLattice<T>& dest, const Op& op, const QDPExpr<RHS,OLattice<T1> >& rhs, JitTileInfo& info)
+{
+  jit_start_new_function();
+
+  jit_describe_function(__PRETTY_FUNCTION__);
+
+  jit_value r_th_count     = jit_add_param(  jit_ptx_type::s32 );
+  jit_value r_start        = jit_add_param(  jit_ptx_type::s32 );
+
+  jit_value r_idx_thread = jit_geom_get_linear_th_idx();
+
+  // Threads past the end must not exit before the barrier
+  jit_value r_inactive = jit_ins_ge( r_idx_thread , r_th_count );
+
+  jit_value r_idx = jit_ins_add( r_idx_thread , r_start );
+
+  ParamLeaf param_leaf(  r_idx );
+
+  typedef typename LeafFunctor<OLattice<T>, ParamLeaf>::Type_t  FuncRet_t;
+  FuncRet_t dest_jit(forEach(dest, param_leaf, TreeCombine()));
+
+  auto op_jit = AddOpParam<Op,ParamLeaf>::apply(op,param_leaf);
+
+  JitTileState tile( r_idx_thread , r_inactive );
+  ParamLeaf param_leaf_tiled( r_idx , &tile );
+
+  typedef typename ForEach<QDPExpr<RHS,OLattice<T1> >, ParamLeaf, TreeCombine>::Type_t View_t;
+  View_t rhs_view(forEach(rhs, param_leaf_tiled, TreeCombine()));
+
+  jit_ins_bar_sync( 0 );
+  jit_ins_exit( r_inactive );
+
+  op_jit(dest_jit.elem( JitDeviceLayout::Coalesced ), forEach(rhs_view, ViewLeaf( JitDeviceLayout::Coalesced ), OpCombine()));
+
+  info.group      = tile.group;
+  info.site_bytes = tile.site_bytes;
+
+  return jit_get_cufunction("ptx_eval_tiled.ptx");
+}
+
+
+//! Kernel for one expression per element of a multi1d<OLattice>
+/*! Thread t works on array element k = t / sites at site t % sites of the
+ *  subset. The leaves of element k are not kernel parameters: they are
+ *  loaded from row k of a table in device memory (jit_param_table_begin),
+ *  so one launch covers the whole array. dest and rhs are those of
+ *  element 0; all elements must have expressions of the same type.
+ */
+template<class T, class T1, class Op, class RHS>
+CUfunction
+function_batch_build(OLattice<T>& dest, const Op& op, const QDPExpr<RHS,OLattice<T1> >& rhs)
+{
+  jit_start_new_function();
+
+  jit_describe_function(__PRETTY_FUNCTION__);
+
+  jit_value r_ordered      = jit_add_param(  jit_ptx_type::pred );
+  jit_value r_th_count     = jit_add_param(  jit_ptx_type::s32 );
+  jit_value r_sites        = jit_add_param(  jit_ptx_type::s32 );
+  jit_value r_start        = jit_add_param(  jit_ptx_type::s32 );
+  jit_value r_member       = jit_add_param(  jit_ptx_type::u64 );  // Subset
+  jit_value r_table        = jit_add_param(  jit_ptx_type::u64 );  // Leaves of all elements
+  jit_value r_slots        = jit_add_param(  jit_ptx_type::s32 );
+
+  jit_value r_idx_thread = jit_geom_get_linear_th_idx();
+
+  jit_ins_exit( jit_ins_ge( r_idx_thread , r_th_count ) );
+
+  jit_value r_k    = jit_ins_div( r_idx_thread , r_sites );
+  jit_value r_site = jit_ins_sub( r_idx_thread , jit_ins_mul( r_k , r_sites ) );
+
+  jit_value r_idx = r_site;
+
+  jit_label_t label_ordered;
+  jit_label_t label_ordered_exit;
+  jit_ins_branch( label_ordered , r_ordered );
+  {
+    jit_value r_member_addr        = jit_ins_add( r_member , r_idx );   // I don't have to multiply with wordsize, since 1
+    jit_value r_ismember           = jit_ins_load ( r_member_addr , 0 , jit_ptx_type::pred );
+    jit_value r_ismember_not       = jit_ins_not( r_ismember );
+    jit_ins_exit( r_ismember_not );
+    jit_ins_branch( label_ordered_exit );
+  }
+  jit_ins_label(label_ordered);
+  {
+    r_idx = jit_ins_add( r_site , r_start );
+  }
+  jit_ins_label(label_ordered_exit);
+
+  jit_value r_row = jit_ins_add( r_table , jit_ins_mul( jit_ins_mul( r_k , r_slots ) , jit_value(8) ) );
+
+  jit_param_table_begin( r_row );
+
+  ParamLeaf param_leaf(  r_idx );
+
+  typedef typename LeafFunctor<OLattice<T>, ParamLeaf>::Type_t  FuncRet_t;
+  FuncRet_t dest_jit(forEach(dest, param_leaf, TreeCombine()));
+
+  auto op_jit = AddOpParam<Op,ParamLeaf>::apply(op,param_leaf);
+
+  typedef typename ForEach<QDPExpr<RHS,OLattice<T1> >, ParamLeaf, TreeCombine>::Type_t View_t;
+  View_t rhs_view(forEach(rhs, param_leaf, TreeCombine()));
+
+  jit_param_table_end();
+
+  op_jit(dest_jit.elem( JitDeviceLayout::Coalesced ), forEach(rhs_view, ViewLeaf( JitDeviceLayout::Coalesced ), OpCombine()));
+
+  return jit_get_cufunction("ptx_eval_batch.ptx");
+}
+
+
 template<class T, class T1, class Op, class RHS>
 CUfunction
 function_lat_sca_build(OLattice<T>& dest, const Op& op, const QDPExpr<RHS,OScalar<T1> >& rhs)
@@ -109,7 +230,7 @@ function_lat_sca_build(OLattice<T>& dest, const Op& op, const QDPExpr<RHS,OScala
 
   jit_start_new_function();
 
-  //function.setPrettyFunction(__PRETTY_FUNCTION__);
+  jit_describe_function(__PRETTY_FUNCTION__);
 
   jit_value r_ordered      = jit_add_param(  jit_ptx_type::pred );
   jit_value r_th_count     = jit_add_param(  jit_ptx_type::s32 );
@@ -309,6 +430,50 @@ function_random_build(OLattice<T>& dest , Seed& seed_tmp)
 
 
 
+//! Philox random kernel; the counter of a site holds its global lexicographic index and the call
+template<class T>
+CUfunction
+function_random_philox_build(OLattice<T>& dest)
+{
+  CUfunction func;
+
+  jit_start_new_function();
+
+  jit_value r_lo     = jit_add_param(  jit_ptx_type::s32 );
+  jit_value r_hi     = jit_add_param(  jit_ptx_type::s32 );
+  jit_value r_key0   = jit_add_param(  jit_ptx_type::u32 );
+  jit_value r_key1   = jit_add_param(  jit_ptx_type::u32 );
+  jit_value r_call   = jit_add_param(  jit_ptx_type::u32 );
+
+  jit_value r_idx_thread = jit_geom_get_linear_th_idx();
+
+  jit_value r_out_of_range       = jit_ins_gt( r_idx_thread , jit_ins_sub( r_hi , r_lo ) );
+  jit_ins_exit(  r_out_of_range );
+
+  jit_value r_idx = jit_ins_add( r_lo , r_idx_thread );
+
+  ParamLeaf param_leaf(  r_idx );
+
+  typedef typename LeafFunctor<OLattice<T>, ParamLeaf>::Type_t  FuncRet_t;
+  FuncRet_t dest_jit(forEach(dest, param_leaf, TreeCombine()));
+
+  typedef typename LeafFunctor<LatticeInteger, ParamLeaf>::Type_t  LatticeIntegerJIT;
+  LatticeIntegerJIT index_lo_jit(forEach( RNG::latticeGlobalIndex(0) , param_leaf, TreeCombine()));
+  LatticeIntegerJIT index_hi_jit(forEach( RNG::latticeGlobalIndex(1) , param_leaf, TreeCombine()));
+
+  WordREG<int> site_lo_reg, site_hi_reg;
+  site_lo_reg.setup( index_lo_jit.elem( JitDeviceLayout::Coalesced ).elem().elem().elem() );
+  site_hi_reg.setup( index_hi_jit.elem( JitDeviceLayout::Coalesced ).elem().elem().elem() );
+
+  PhiloxJIT gen( r_key0 , r_key1 , site_lo_reg.get_val() , site_hi_reg.get_val() , r_call );
+
+  fill_random( dest_jit.elem(JitDeviceLayout::Coalesced) , gen , gen , gen );
+
+  return jit_get_cufunction("ptx_random_philox.ptx");
+}
+
+
+
 
 
 
@@ -421,7 +586,7 @@ function_gather_exec( CUfunction function, void* send_buf , const Map& map , con
     //std::cout << "addr rhs =" << addr[addr.size()-1] << " " << addr_leaf.addr[i] << "\n";
   }
 
-  jit_launch(function,hi-lo,addr);
+  jit_launch(function,hi-lo,addr,addr_leaf.bytes_per_site + sizeof(T1) + sizeof(int));
 }
 
 
@@ -486,7 +651,8 @@ function_exec(CUfunction function, OLattice<T>& dest, const Op& op, const QDPExp
   AddOpAddress<Op,AddressLeaf>::apply(op,addr_leaf);
   int junk_rhs = forEach(rhs, addr_leaf, NullCombine());
 
-
+  // Estimated traffic per site, the destination is read back unless assigned
+  size_t bytes = addr_leaf.bytes_per_site + (std::is_same<Op,OpAssign>::value ? 0 : sizeof(T));
 
   std::vector<void*> addr;
 
@@ -518,7 +684,7 @@ function_exec(CUfunction function, OLattice<T>& dest, const Op& op, const QDPExp
     //std::cout << "addr = " << addr_leaf.addr[i] << "\n";
   }
 
-  jit_launch(function,th_count,addr);
+  jit_launch(function,th_count,addr,bytes);
 
 
   if (offnode_maps > 0) {
@@ -528,10 +694,166 @@ function_exec(CUfunction function, OLattice<T>& dest, const Op& op, const QDPExp
     th_count = faceCount;
     idx_inner_dev = idx_face_dev;
 
-    jit_launch(function,th_count,addr);
+    jit_launch(function,th_count,addr,bytes);
+  }
+}
+
+//! Execute a kernel from function_build_tiled
+/*! Returns false (without launching) if the subset is not ordered, a map
+ *  needs off-node data or the maps shift other fields than at build time;
+ *  the caller then runs the plain kernel.
+ */
+template<class T, class T1, class Op, class RHS>
+bool
+function_exec_tiled(CUfunction function, const JitTileInfo& info, OLattice<T>& dest, const Op& op, const QDPExpr<RHS,OLattice<T1> >& rhs, const Subset& s)
+{
+  if (!s.hasOrderedRep())
+    return false;
+
+  int th_count = s.numSiteTable();
+  int start = s.start();
+
+  if (forEach(rhs, OffnodeLeaf(), BitOrCombine()))
+    return false;
+
+  MapTileGroups groups;
+  forEach(rhs, TileGroupLeaf(&groups), NullCombine());
+  if (groups.group != info.group)
+    return false;
+
+  int ngroups = info.site_bytes.size();
+
+  // Every thread stages at least one site of each field
+  int shared_per_thread = 0;
+  for(int g=0; g < ngroups; ++g)
+    shared_per_thread += info.site_bytes[g];
+
+  std::vector<TileMapArgs> tile_args( groups.maps.size() );
+  AddressLeaf addr_leaf;
+  std::vector<void*> addr;
+  size_t shared = 0;
+  size_t bytes = 0;
+
+  auto args = [&](int block) -> std::vector<void*>& {
+    // Stage tables and shared memory of each field for this block size
+    shared = 0;
+    for(int g=0; g < ngroups; ++g) {
+      std::vector<const Map*> maps;
+      for(int m=0; m < groups.maps.size(); ++m)
+	if (groups.group[m] == g)
+	  maps.push_back( groups.maps[m] );
+
+      const MapTile& tile = mapTile( maps , start , th_count , block );
+
+      bool first = true;
+      for(int m=0, k=0; m < groups.maps.size(); ++m) {
+	if (groups.group[m] != g)
+	  continue;
+	TileMapArgs& t = tile_args[m];
+	t.first   = first;
+	t.offsets = QDPCache::Instance().getDevicePtr( tile.offsetsId );
+	t.sites   = QDPCache::Instance().getDevicePtr( tile.sitesId );
+	t.region  = (int)shared;
+	t.slots   = (int*)QDPCache::Instance().getDevicePtr( tile.slotsId ) + k++ * th_count;
+	first = false;
+      }
+
+      // Keep the regions 8 byte aligned
+      shared += ( (size_t)tile.max_stage * info.site_bytes[g] + 7 ) & ~(size_t)7;
+    }
+
+    addr_leaf = AddressLeaf();
+    addr_leaf.tile_args = &tile_args;
+
+    int junk_dest = forEach(dest, addr_leaf, NullCombine());
+    AddOpAddress<Op,AddressLeaf>::apply(op,addr_leaf);
+    int junk_rhs = forEach(rhs, addr_leaf, NullCombine());
+
+    bytes = addr_leaf.bytes_per_site + (std::is_same<Op,OpAssign>::value ? 0 : sizeof(T));
+
+    addr.clear();
+    addr.push_back( &th_count );
+    addr.push_back( &start );
+    for(int i=0; i < addr_leaf.addr.size(); ++i)
+      addr.push_back( &addr_leaf.addr[i] );
+    return addr;
+  };
+
+  jit_launch_tiled( function , th_count , shared_per_thread , args , shared , bytes );
+  return true;
+}
+
+
+//! Launch a kernel of function_batch_build for all elements of dest
+/*! f(k) is the expression of element k. The rows of leaf addresses are
+ *  collected on the host and copied in one piece to a device buffer that
+ *  is kept from call to call and only grows. */
+template<class T, class Op, class F>
+void
+function_batch_exec(CUfunction function, multi1d< OLattice<T> >& dest, const Op& op, const F& f, const Subset& s)
+{
+  int n = dest.size();
+  bool ordered = s.hasOrderedRep();
+  int sites = ordered ? s.numSiteTable() : Layout::sitesOnNode();
+  int start = s.start();
+  int th_count = n * sites;
+
+  if (th_count == 0)
+    return;
+
+  std::vector<AddressLeaf::Types> table;
+  int slots = 0;
+  size_t bytes = 0;
+
+  for(int k=0; k < n; ++k)
+  {
+    AddressLeaf addr_leaf;
+
+    int junk_dest = forEach(dest[k], addr_leaf, NullCombine());
+    AddOpAddress<Op,AddressLeaf>::apply(op,addr_leaf);
+    int junk_rhs = forEach(f(k), addr_leaf, NullCombine());
+
+    if (k == 0) {
+      slots = addr_leaf.addr.size();
+      bytes = addr_leaf.bytes_per_site + (std::is_same<Op,OpAssign>::value ? 0 : sizeof(T));
+    } else if (addr_leaf.addr.size() != slots) {
+      QDP_error_exit("evaluate_batch: element %d has %d leaves, element 0 has %d",k,(int)addr_leaf.addr.size(),slots);
+    }
+
+    table.insert( table.end() , addr_leaf.addr.begin() , addr_leaf.addr.end() );
+  }
+
+  void * subset_member = QDPCache::Instance().getDevicePtr( s.getIdMemberTable() );
+
+  static void * table_dev = NULL;
+  static size_t table_capacity = 0;
+  size_t table_bytes = table.size() * sizeof(AddressLeaf::Types);
+
+  if (table_bytes > table_capacity) {
+    if (table_dev)
+      QDPCache::Instance().free_device_static( table_dev );
+    if (!QDPCache::Instance().allocate_device_static( &table_dev , table_bytes ))
+      QDP_error_exit("evaluate_batch: no device memory for the leaf table (%d bytes)",(int)table_bytes);
+    table_capacity = table_bytes;
   }
+
+  // Ordered after the previous launch on the default stream, which reads the table
+  CudaMemcpyH2D( table_dev , table.data() , table_bytes );
+
+  std::vector<void*> addr;
+
+  addr.push_back( &ordered );
+  addr.push_back( &th_count );
+  addr.push_back( &sites );
+  addr.push_back( &start );
+  addr.push_back( &subset_member );
+  addr.push_back( &table_dev );
+  addr.push_back( &slots );
+
+  jit_launch(function,th_count,addr,bytes);
 }
 
+
 template<class T, class T1, class Op, class RHS>
 void 
 function_lat_sca_exec(CUfunction function, OLattice<T>& dest, const Op& op, const QDPExpr<RHS,OScalar<T1> >& rhs, const Subset& s)
@@ -544,6 +866,8 @@ function_lat_sca_exec(CUfunction function, OLattice<T>& dest, const Op& op, cons
   AddOpAddress<Op,AddressLeaf>::apply(op,addr_leaf);
   int junk_rhs = forEach(rhs, addr_leaf, NullCombine());
 
+  size_t bytes = addr_leaf.bytes_per_site + (std::is_same<Op,OpAssign>::value ? 0 : sizeof(T));
+
   int start = s.start();
   int end = s.end();
   bool ordered = s.hasOrderedRep();
@@ -572,7 +896,7 @@ function_lat_sca_exec(CUfunction function, OLattice<T>& dest, const Op& op, cons
     //std::cout << "addr = " << addr_leaf.addr[i] << "\n";
   }
 
-  jit_launch(function,th_count,addr);
+  jit_launch(function,th_count,addr,bytes);
 }
 
 
@@ -620,7 +944,7 @@ function_zero_rep_exec(CUfunction function, OLattice<T>& dest, const Subset& s )
     //std::cout << "addr = " << addr_leaf.addr[i] << "\n";
   }
 
-  jit_launch(function,th_count,addr);
+  jit_launch(function,th_count,addr,addr_leaf.bytes_per_site);
 }
 
 
@@ -692,7 +1016,44 @@ function_random_exec(CUfunction function, OLattice<T>& dest, const Subset& s , S
     //std::cout << "addr = " << addr_leaf.addr[i] << "\n";
   }
 
-  jit_launch(function,s.numSiteTable(),addr);
+  jit_launch(function,s.numSiteTable(),addr,addr_leaf.bytes_per_site);
+}
+
+
+
+template<class T>
+void 
+function_random_philox_exec(CUfunction function, OLattice<T>& dest, const Subset& s)
+{
+  if (!s.hasOrderedRep())
+    QDP_error_exit("random on subset with unordered representation not implemented");
+
+  AddressLeaf addr_leaf;
+
+  int junk_0 = forEach(dest, addr_leaf, NullCombine());
+  int junk_1 = forEach(RNG::latticeGlobalIndex(0), addr_leaf, NullCombine());
+  int junk_2 = forEach(RNG::latticeGlobalIndex(1), addr_leaf, NullCombine());
+
+  // lo <= idx <= hi
+  int lo = s.start();
+  int hi = s.end();
+
+  uint32_t key[2];
+  RNG::philoxKey(key);
+  uint32_t call = RNG::philoxCalls();
+
+  std::vector<void*> addr;
+
+  addr.push_back( &lo );
+  addr.push_back( &hi );
+  addr.push_back( &key[0] );
+  addr.push_back( &key[1] );
+  addr.push_back( &call );
+
+  for(int i=0; i < addr_leaf.addr.size(); ++i)
+    addr.push_back( &addr_leaf.addr[i] );
+
+  jit_launch(function,s.numSiteTable(),addr,addr_leaf.bytes_per_site);
 }
 
 
@@ -0,0 +1,85 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Per-kernel launch statistics
+ *
+ * Every JIT kernel is registered when it is built (kind, description,
+ * build time). With -kernelprofile <file> each launch is bracketed by
+ * two events and the device time, thread count and the bytes estimated
+ * from the expression leaves are accumulated per kernel. At QDP_finalize
+ * the tables of all nodes are combined and written by the primary node,
+ * as CSV if the file name ends in .csv and as JSON otherwise.
+ *
+ * Unlike QDPProfile_t this does not need QDP_USE_PROFILING.
+ */
+
+#ifndef QDP_KERNEL_PROFILE_H
+#define QDP_KERNEL_PROFILE_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace QDP {
+
+  class KernelProfile
+  {
+  public:
+    struct Entry {
+      int          id;            // build order
+      std::string  kind;          // ptx file name given to jit_get_cufunction
+      std::string  description;   // see jit_describe_function
+      double       build_time;    // seconds, code generation and module load
+      int          num_regs;
+      int          local_size;
+      size_t       launches;
+      size_t       threads;
+      size_t       bytes;         // estimate, 0 where the launch site does not know
+      double       device_time;   // seconds
+    };
+
+    static KernelProfile& Instance();
+
+    //! Start collecting, the table goes to file at QDP_finalize
+    void setOutput( const std::string& file );
+    bool enabled() const { return !file.empty(); }
+
+    //! Called by jit_get_cufunction, thread safe
+    void registerKernel( CUfunction f , const std::string& kind , const std::string& description , double build_time );
+
+    //! Bracket one launch on stream s. Only records events when enabled
+    void launchBegin( CUstream s );
+    void launchEnd( CUfunction f , CUstream s , size_t threads , size_t bytes_per_thread );
+
+    //! Kernels of this node sorted by device time, the most expensive first
+    std::vector<Entry> sorted() const;
+
+    //! Kernels of all nodes matched by kind and description, sorted as above. Collective
+    /*! Launches, threads, bytes and device time are summed over the nodes,
+     *  so the bandwidth is the average of one node. Build time, registers
+     *  and local memory are the largest of any node.
+     */
+    std::vector<Entry> reduce() const;
+
+    void write();
+
+  private:
+    KernelProfile();
+    KernelProfile(const KernelProfile&);
+    void operator=(const KernelProfile&);
+
+    void writeJSON( std::ostream& os , const std::vector<Entry>& e , double peak ) const;
+    void writeCSV( std::ostream& os , const std::vector<Entry>& e , double peak ) const;
+
+    std::string                  file;
+    mutable std::mutex           mtx;
+    std::map<CUfunction,Entry>   entries;
+    CUevent                      ev_start;
+    CUevent                      ev_stop;
+    bool                         events;
+  };
+
+}
+
+#endif
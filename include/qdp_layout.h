@@ -46,6 +46,13 @@ namespace Layout
   //! Set number of processors in a multi-threaded implementation
   void setNumProc(int N);
 
+  //! Set the ordering of the sites within a node, used by the next create()
+  /*! The layout chosen at configure time is the default, -layout overrides it */
+  void setPolicy(const std::shared_ptr<LayoutPolicy>& policy);
+
+  //! The ordering of the sites within a node
+  const LayoutPolicy& policy();
+
   //! Returns the logical node number for the corresponding lattice coordinate
   /*! The API requires this function to be here */
   int nodeNumber(const multi1d<int>& coord) QDP_CONST;
@@ -60,6 +67,13 @@ namespace Layout
    * The API requires this function to be here.
    */
   multi1d<int> siteCoords(int node, int index) QDP_CONST;
+
+  //! Allocation-free forms of the three functions above for Nd coordinates
+  /*! Pure integer arithmetic on tables made by create(), so they may be
+      called from several threads at once */
+  void siteCoords(int node, int index, int coord[]);
+  int  nodeNumber(const int coord[]);
+  int  linearSiteIndex(const int coord[]);
   
   extern "C" { 
     /* Export this to "C" */
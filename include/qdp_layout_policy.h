@@ -0,0 +1,109 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Site orderings within a node
+ *
+ * Every layout splits the lattice into the same blocks of sites, one per
+ * node; a LayoutPolicy only decides the order of the sites inside a
+ * block. Layout::create() tabulates the chosen policy once for the
+ * subgrid (LayoutTables), after which the linear index of a coordinate
+ * and its inverse are two table lookups. Policies may order the sites of
+ * different nodes differently, e.g. the checkerboarded ones depend on
+ * the parity of the node's origin; such nodes are in different classes
+ * and each class gets its own table.
+ *
+ * Like qdp_map_route.h this header does not depend on the rest of QDP,
+ * so that the policies can be checked without a lattice.
+ */
+
+#ifndef QDP_LAYOUT_POLICY_H
+#define QDP_LAYOUT_POLICY_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace QDP {
+
+  class LayoutPolicy
+  {
+  public:
+    virtual ~LayoutPolicy() {}
+
+    //! Name as given to -layout
+    virtual std::string name() const = 0;
+
+    //! The lattice extents must be multiples of dim times the node grid
+    virtual void minimalMapping(int nd, int dim[]) const;
+
+    //! Number of node classes
+    virtual int numClasses() const { return 1; }
+
+    //! Class of the node whose first site is at origin
+    virtual int nodeClass(int nd, const int origin[]) const { return 0; }
+
+    /*! \brief Linear index of every site of a subgrid
+     *
+     * index[lex] is the linear index of the site with local coordinate x,
+     * lex = x[0] + sub[0]*(x[1] + sub[1]*(...)), on a node of class cls.
+     * Must be a permutation of the subgrid volume.
+     */
+    virtual void tabulate(int nd, const int sub[], int cls, int index[]) const = 0;
+
+    //! Whether runs of consecutive sites are compact blocks of the subgrid
+    /*! Only then does a thread block and its neighbours fit in shared
+     *  memory (see function_build_tiled); in the lexicographic and
+     *  checkerboarded orders the neighbour gather is contiguous already. */
+    virtual bool blocked() const { return false; }
+  };
+
+  /*! \brief Policy by name, null if unknown
+   *
+   *  - lexico: x fastest, as the local lexicographic order
+   *  - cb2: even sites first, then odd sites, each half lexicographic
+   *  - cb3d: checkerboard of the first nd-1 directions, t fastest inside
+   *  - tiled, tiled:N: blocks of up to N^nd sites (default N=4), one after
+   *    the other; the block extent in a direction is the largest divisor of
+   *    the subgrid extent not above N
+   *  - morton: Z-order curve, bits of the coordinates interleaved
+   */
+  std::shared_ptr<LayoutPolicy> layoutPolicyMake(const std::string& name);
+
+  //! A policy tabulated for one subgrid, in both directions and for every node class
+  struct LayoutTables
+  {
+    int nd = 0;
+    int vol = 0;
+    std::vector<int> sub;
+
+    //! index[cls*vol + lex]: linear index of local lexicographic site lex
+    std::vector<int> index;
+    //! local[cls*vol + linear]: the inverse
+    std::vector<int> local;
+
+    //! Returns an empty string on success, otherwise why the policy is unusable
+    std::string make(const LayoutPolicy& policy, int nd, const int sub[]);
+
+    //! Linear index of the local coordinate x
+    int linear(int cls, const int x[]) const
+    {
+      int lex = 0;
+      for(int i=nd-1; i >= 0; --i)
+	lex = lex * sub[i] + x[i];
+      return index[cls*vol + lex];
+    }
+
+    //! Local coordinate of the linear index
+    void coords(int cls, int linear, int x[]) const
+    {
+      int lex = local[cls*vol + linear];
+      for(int i=0; i < nd; ++i) {
+	x[i] = lex % sub[i];
+	lex /= sub[i];
+      }
+    }
+  };
+
+} // namespace QDP
+
+#endif
@@ -36,6 +36,29 @@ public:
   //! Maps a lattice coordinate under a map to a new lattice coordinate
   /*! sign > 0 for map, sign < 0 for the inverse map */
   virtual multi1d<int> operator() (const multi1d<int>& coordinate, int sign) const = 0;
+
+  //! Whether the map is a constant displacement with periodic wrap
+  /*! If so, sets disp such that the source of x is x + disp. Such maps are
+   *  built without calling operator() and share their tables */
+  virtual bool offset(multi1d<int>& disp) const { return false; }
+};
+
+
+//! OffsetMapFunc
+/*! Constant displacement with periodic wrap: the source of x is x + disp */
+class OffsetMapFunc : public MapFunc
+{
+public:
+  OffsetMapFunc(const multi1d<int>& disp_) : disp(disp_) {}
+
+  virtual ~OffsetMapFunc() {}
+
+  virtual multi1d<int> operator() (const multi1d<int>& coordinate, int sign) const;
+
+  virtual bool offset(multi1d<int>& d) const { d = disp; return true; }
+
+private:
+  multi1d<int> disp;
 };
     
 
@@ -53,11 +76,70 @@ public:
 
   //! Returns the array size - the number of directions which are to be used
   virtual int numArray() const = 0;
+
+  //! Whether direction dir is a constant displacement, see MapFunc::offset
+  virtual bool offset(multi1d<int>& disp, int dir) const { return false; }
 };
     
 /** @} */ // end of group map
 
 
+//! Site tables for staging one field in shared memory for several maps
+/*! Built for a contiguous range of count destination sites cut into
+ *  blocks of 'block' threads. Block b stages the sites
+ *  sites[offsets[b]] .. sites[offsets[b+1]-1], the union of the sources
+ *  of its sites under all the maps: the block and its halo, sorted so
+ *  that the staging reads are coalesced. slots[m*count + t] is the
+ *  position of the source of thread t under map m within its block's
+ *  stage.
+ */
+struct MapTile
+{
+  std::vector<int> offsets;
+  std::vector<int> sites;
+  std::vector<int> slots;
+  int max_stage;           // most sites staged by one block
+  int offsetsId;
+  int sitesId;
+  int slotsId;
+};
+
+
+//! Site tables of a map
+/*! Maps with equal tables share one instance, which is registered with
+ *  QDPCache and MasterMap once and lives until the end of the program */
+struct MapTables
+{
+  //! Offset table used for communications. 
+  /*! 
+   * The direction is in the sense of the Map or Shift functions from QDP.
+   * goffsets(position) 
+   */ 
+  multi1d<int> goffsets;
+  multi1d<int> soffsets;
+
+  multi1d<int> roffsets;
+
+  int roffsetsId;
+  int soffsetsId;
+  int goffsetsId;
+  int myId; // master map id
+
+  //! Peer nodes and their site counts, in the order of the buffer segments
+  multi1d<int> srcenodes;
+  multi1d<int> destnodes;
+
+  multi1d<int> srcenodes_num;
+  multi1d<int> destnodes_num;
+
+  // Indicate off-node communications is needed;
+  bool offnodeP;
+
+  //! Tile tables of the map groups this map leads, see mapTile
+  std::map< std::vector<int> , std::shared_ptr<MapTile> > tiles;
+};
+
+
 struct FnMap
 {
   //PETE_EMPTY_CONSTRUCTORS(FnMap)
@@ -72,9 +154,10 @@ public:
   FnMap(const Map& m);
   FnMap(const FnMap& f);
 
-  const FnMapRsrc& getResource(int srcnum_, int dstnum_) {
+  //! Buffers and messages for all peers, siteBytes per site
+  const FnMapRsrc& getResource(int siteBytes) {
     assert(pRsrc);
-    return pRsrc->getResource( srcnum_ , dstnum_ );
+    return pRsrc->getResource( siteBytes );
   }
 
   const FnMapRsrc& getCached() const {
@@ -138,15 +221,15 @@ public:
 
 public:
   //! Accessor to offsets
-  const multi1d<int>& goffset() const {return goffsets;}
-  const multi1d<int>& soffset() const {return soffsets;}
-  const multi1d<int>& roffset() const {return roffsets;}
-  int getRoffsetsId() const { return roffsetsId;}
-  int getSoffsetsId() const { return soffsetsId;}
-  int getGoffsetsId() const { return goffsetsId;}
+  const multi1d<int>& goffset() const {return tab->goffsets;}
+  const multi1d<int>& soffset() const {return tab->soffsets;}
+  const multi1d<int>& roffset() const {return tab->roffsets;}
+  int getRoffsetsId() const { return tab->roffsetsId;}
+  int getSoffsetsId() const { return tab->soffsetsId;}
+  int getGoffsetsId() const { return tab->goffsetsId;}
 
-  int getId() const {return myId;}
-  bool hasOffnode() const { return offnodeP; }
+  int getId() const {return tab->myId;}
+  bool hasOffnode() const { return tab->offnodeP; }
 
 private:
   //! Hide copy constructor
@@ -159,33 +242,19 @@ private:
   friend class FnMap;
   friend class FnMapRsrc;
   template<class E,class F,class C> friend class ForEach;
+  friend const MapTile& mapTile(const std::vector<const Map*>& maps, int start, int count, int block);
 
-  //! Offset table used for communications. 
-  /*! 
-   * The direction is in the sense of the Map or Shift functions from QDP.
-   * goffsets(position) 
-   */ 
-  multi1d<int> goffsets;
-  multi1d<int> soffsets;
-  multi1d<int> srcnode;
-  multi1d<int> dstnode;
-
-  multi1d<int> roffsets;
-
-  int roffsetsId;
-  int soffsetsId;
-  int goffsetsId;
-  int myId; // master map id
-
-  multi1d<int> srcenodes;
-  multi1d<int> destnodes;
+  //! The tables, possibly shared with other maps
+  std::shared_ptr<MapTables> tab;
+};
 
-  multi1d<int> srcenodes_num;
-  multi1d<int> destnodes_num;
 
-  // Indicate off-node communications is needed;
-  bool offnodeP;
-};
+//! Tile tables of maps that shift the same field
+/*! For destination sites [start,start+count) and blocks of 'block'
+ *  threads. Built on first use and kept with maps[0]. Only for maps
+ *  without off-node sites.
+ */
+const MapTile& mapTile(const std::vector<const Map*>& maps, int start, int count, int block);
 
 
 
@@ -230,9 +299,150 @@ struct TagVisitor<FnMap, PrintTag> : public ParenPrinter<FnMap>
 
 
 
+//! True if the tree E has a leaf the map gather can not read
+/*! The gather copies sites in the uncompressed element layout. Leaf
+ *  containers stored otherwise specialise this to true, see
+ *  qdp_outercompressed.h.
+ */
+template<class E>
+struct MapUnsafeLeaf
+{
+  static const bool value = false;
+};
+
+template<class T, class C>
+struct MapUnsafeLeaf<QDPType<T,C> >
+{
+  static const bool value = MapUnsafeLeaf<C>::value;
+};
+
+template<class T>
+struct MapUnsafeLeaf<Reference<T> >
+{
+  static const bool value = MapUnsafeLeaf<T>::value;
+};
+
+template<class Op, class A>
+struct MapUnsafeLeaf<UnaryNode<Op,A> >
+{
+  static const bool value = MapUnsafeLeaf<A>::value;
+};
+
+template<class Op, class A, class B>
+struct MapUnsafeLeaf<BinaryNode<Op,A,B> >
+{
+  static const bool value = MapUnsafeLeaf<A>::value || MapUnsafeLeaf<B>::value;
+};
+
+template<class Op, class A, class B, class C>
+struct MapUnsafeLeaf<TrinaryNode<Op,A,B,C> >
+{
+  static const bool value = MapUnsafeLeaf<A>::value || MapUnsafeLeaf<B>::value || MapUnsafeLeaf<C>::value;
+};
+
+
+//! Whether a map operand is a field, the only operands a tiled kernel stages
+template<class A>
+struct MapOperandField
+{
+  static const bool value = false;
+  static int id(const A&) { return -1; }
+};
+
+template<class T>
+struct MapOperandField<QDPType<T,OLattice<T> > >
+{
+  static const bool value = true;
+  static int id(const QDPType<T,OLattice<T> >& a) { return static_cast<const OLattice<T>&>(a).getId(); }
+};
+
+template<class T>
+struct MapOperandField<Reference<QDPType<T,OLattice<T> > > >
+{
+  static const bool value = true;
+  static int id(const Reference<QDPType<T,OLattice<T> > >& a) { return MapOperandField<QDPType<T,OLattice<T> > >::id(a.reference()); }
+};
+
+
+//! True if the tree E has a map of a field, i.e. a tiled kernel stages something
+template<class E>
+struct HasTiledMap
+{
+  static const bool value = false;
+};
+
+template<class T>
+struct HasTiledMap<Reference<T> >
+{
+  static const bool value = HasTiledMap<T>::value;
+};
+
+template<class A>
+struct HasTiledMap<UnaryNode<FnMap,A> >
+{
+  static const bool value = MapOperandField<A>::value;
+};
+
+template<class Op, class A>
+struct HasTiledMap<UnaryNode<Op,A> >
+{
+  static const bool value = HasTiledMap<A>::value;
+};
+
+template<class Op, class A, class B>
+struct HasTiledMap<BinaryNode<Op,A,B> >
+{
+  static const bool value = HasTiledMap<A>::value || HasTiledMap<B>::value;
+};
+
+template<class Op, class A, class B, class C>
+struct HasTiledMap<TrinaryNode<Op,A,B,C> >
+{
+  static const bool value = HasTiledMap<A>::value || HasTiledMap<B>::value || HasTiledMap<C>::value;
+};
+
+
+//! The maps of fields in an expression, grouped by field
+/*! Filled by forEach(expr, TileGroupLeaf(&groups), NullCombine()) in the
+ *  order the ParamLeaf pass of function_build_tiled visits them.
+ */
+struct MapTileGroups
+{
+  std::vector<const Map*> maps;
+  std::vector<int>        group;    // group of each map
+  std::vector<int>        fields;   // field of each group
+
+  void add(const Map& map, int field)
+  {
+    int g = std::find( fields.begin() , fields.end() , field ) - fields.begin();
+    if (g == fields.size())
+      fields.push_back( field );
+    maps.push_back( &map );
+    group.push_back( g );
+  }
+};
+
+
+template<class A>
+struct ForEach<UnaryNode<FnMap, A>, TileGroupLeaf, NullCombine>
+{
+  typedef int Type_t;
+  inline static
+  Type_t apply(const UnaryNode<FnMap, A> &expr, const TileGroupLeaf &f, const NullCombine &c)
+  {
+    // Maps inside an expression operand are not tiled
+    if (MapOperandField<A>::value)
+      f.groups->add( expr.operation().map , MapOperandField<A>::id( expr.child() ) );
+    return 0;
+  }
+};
+
+
 template<class A>
 struct ForEach<UnaryNode<FnMap, A>, ParamLeaf, TreeCombine>
   {
+    static_assert( !MapUnsafeLeaf<A>::value , "shift/map of a compressed field is not supported, copy it to an OLattice first" );
+
     //typedef typename ForEach<A, ViewLeaf, OpCombine>::Type_t AInnerTypeA_t;
     typedef typename ForEach< UnaryNode<FnMapJIT, A> , ParamLeaf, TreeCombine>::Type_t Type_t;
     inline
@@ -240,6 +450,9 @@ struct ForEach<UnaryNode<FnMap, A>, ParamLeaf, TreeCombine>
     {
       //std::cout << __PRETTY_FUNCTION__ << ": entering\n";
 
+      if (p.getTile() && MapOperandField<A>::value)
+	return applyTiled( expr , p , c );
+
       const Map& map = expr.operation().map;
       FnMap& fnmap = const_cast<FnMap&>(expr.operation());
 
@@ -265,6 +478,78 @@ struct ForEach<UnaryNode<FnMap, A>, ParamLeaf, TreeCombine>
       return Type_t( FnMapJIT( expr.operation() , index_pack ) , 
 		     ForEach< A, ParamLeaf, TreeCombine >::apply( expr.child() , pp , c ) );
     }
+
+    //! Read the field from its group's stage in shared memory
+    /*! The first map of a field adds the stage tables and stages the
+        field on the block's sites and their halo, all threads of the
+        block taking part. Later maps of the field only add their slots. */
+    static Type_t applyTiled(const UnaryNode<FnMap, A>& expr, const ParamLeaf &p, const TreeCombine &c)
+    {
+      typedef typename ForEach<A, ParamLeaf, TreeCombine>::Type_t  AView_t;
+      typedef typename ForEach<AView_t, ViewLeaf, OpCombine>::Type_t  AReg_t;
+      typedef typename JITType<AReg_t>::Type_t  AJit_t;
+
+      JitTileState& tile = *p.getTile();
+
+      int field = MapOperandField<A>::id( expr.child() );
+      int g = std::find( tile.fields.begin() , tile.fields.end() , field ) - tile.fields.begin();
+      bool first = g == tile.fields.size();
+      tile.group.push_back( g );
+
+      jit_value r_offsets( jit_ptx_type::u64 );
+      jit_value r_sites( jit_ptx_type::u64 );
+      if (first) {
+	jit_ins_comment( "MAP TILE STAGE" );
+	r_offsets = jit_add_param( jit_ptx_type::u64 );
+	r_sites   = jit_add_param( jit_ptx_type::u64 );
+	jit_value r_region = jit_ins_add( tile.r_shared , jit_add_param( jit_ptx_type::u32 ) );
+	r_region.set_state_space( jit_state_space::state_shared );
+
+	tile.fields.push_back( field );
+	tile.site_bytes.push_back( AJit_t::Size_t * sizeof(typename WordType<AJit_t>::Type_t) );
+	tile.regions.push_back( r_region );
+      }
+
+      jit_value r_site( jit_ptx_type::s32 );
+      ParamLeaf pp( r_site );
+      AView_t child_view( ForEach< A, ParamLeaf, TreeCombine >::apply( expr.child() , pp , c ) );
+
+      if (first) {
+	// Block b stages sites[offsets[b]] .. sites[offsets[b+1]-1]
+	jit_value r_blk   = jit_ins_div( tile.r_thread , tile.r_ntid );
+	jit_value r_blk_4 = jit_ins_add( r_offsets , jit_ins_mul( r_blk , jit_value(4) ) );
+	jit_value r_first = jit_ins_load( r_blk_4 , 0 , jit_ptx_type::s32 );
+	jit_value r_end   = jit_ins_load( r_blk_4 , 4 , jit_ptx_type::s32 );
+	jit_value r_i     = jit_ins_add( r_first , tile.r_tidx );
+
+	jit_label_t label_loop;
+	jit_label_t label_done;
+	jit_ins_label( label_loop );
+	jit_ins_branch( label_done , jit_ins_ge( r_i , r_end ) );
+
+	jit_ins_mov( r_site , jit_ins_load( jit_ins_add( r_sites , jit_ins_mul( r_i , jit_value(4) ) ) , 0 , jit_ptx_type::s32 ) );
+	OLatticeJIT<AJit_t> stage( tile.regions[g] , jit_ins_sub( r_i , r_first ) );
+	stage.elem( JitDeviceLayout::Scalar ) = forEach( child_view , ViewLeaf( JitDeviceLayout::Coalesced ) , OpCombine() );
+
+	jit_ins_mov( r_i , jit_ins_add( r_i , tile.r_ntid ) );
+	jit_ins_branch( label_loop );
+	jit_ins_label( label_done );
+      }
+
+      jit_ins_comment( "MAP TILE SLOTS" );
+      jit_value r_slots = jit_add_param( jit_ptx_type::u64 );
+
+      // Threads past the end have no slot, they do not read the stage
+      IndexRet index_pack;
+      index_pack.tiled = true;
+      index_pack.r_tile_slot = jit_ins_load( jit_ins_add( r_slots , jit_ins_mul( tile.r_thread , jit_value(4) ) ) , 0 , jit_ptx_type::s32 ,
+					     jit_ins_not( tile.r_inactive ) );
+      index_pack.r_tile_base = tile.regions[g];
+      index_pack.r_tile_base.set_state_space( jit_state_space::state_shared );
+
+      // The child view is not read again, the map view reads the stage
+      return Type_t( FnMapJIT( expr.operation() , index_pack ) , child_view );
+    }
   };
 
 
@@ -288,6 +573,13 @@ struct ForEach<UnaryNode<FnMapJIT, A>, ViewLeaf, OpCombine>
 
       IndexRet index = expr.operation().index;
 
+      if (index.tiled) {
+	OLatticeJIT< typename JITType<Type_t>::Type_t > lattice_tile( index.r_tile_base , index.r_tile_slot );
+	Type_t ret_tile;
+	ret_tile.setup( lattice_tile.elem( JitDeviceLayout::Scalar ) );
+	return ret_tile;
+      }
+
       jit_label_t label_in_buffer;
       jit_label_t label_in_exit;
 
@@ -331,10 +623,36 @@ struct ForEach<UnaryNode<FnMap, A>, AddressLeaf, NullCombine>
       const Map& map = expr.operation().map;
       FnMap& fnmap = const_cast<FnMap&>(expr.operation());
 
+      if (a.tile_args && MapOperandField<A>::value) {
+	// Tiled kernel: stage tables instead of goffsets and receive buffer.
+	// The caller has made sure with OffnodeLeaf that no map is off-node.
+	const TileMapArgs& t = (*a.tile_args)[ a.tile_map++ ];
+	if (t.first) {
+	  a.setAddr( t.offsets );
+	  a.setAddr( t.sites );
+	  a.setLit( t.region );
+	}
+
+	// The field is read once per staged site, by the first map of its group
+	size_t bytes = a.bytes_per_site;
+	ForEach<A, AddressLeaf, NullCombine>::apply( expr.child() , a , n );
+	if (!t.first)
+	  a.bytes_per_site = bytes;
+
+	a.setAddr( t.slots );
+	a.addBytes( sizeof(int) );
+	return Type_t();
+      }
+
+      // Maps inside an expression operand are not tiled
+      const std::vector<TileMapArgs>* tile_args = a.tile_args;
+      a.tile_args = NULL;
+
       int goffsetsId = expr.operation().map.getGoffsetsId();
       void * goffsetsDev = QDPCache::Instance().getDevicePtr( goffsetsId );
       //QDP_info("Map:AddressLeaf: add goffset p=%p",goffsetsDev);
       a.setAddr(goffsetsDev);
+      a.addBytes( sizeof(int) );
 
       void * rcvBufDev = NULL;
       if (map.hasOffnode()) {
@@ -344,7 +662,9 @@ struct ForEach<UnaryNode<FnMap, A>, AddressLeaf, NullCombine>
       //QDP_info("Map:AddressLeaf: add recv buf p=%p",rcvBufDev);
       a.setAddr(rcvBufDev);
 
-      return Type_t( ForEach<A, AddressLeaf, NullCombine>::apply( expr.child() , a , n ) );
+      ForEach<A, AddressLeaf, NullCombine>::apply( expr.child() , a , n );
+      a.tile_args = tile_args;
+      return Type_t();
     }
   };
 
@@ -352,9 +672,25 @@ struct ForEach<UnaryNode<FnMap, A>, AddressLeaf, NullCombine>
 
 
 
+template<class A>
+struct ForEach<UnaryNode<FnMap, A>, OffnodeLeaf, BitOrCombine>
+{
+  typedef int Type_t;
+  inline static
+  Type_t apply(const UnaryNode<FnMap, A> &expr, const OffnodeLeaf &f, const BitOrCombine &c)
+  {
+    return (expr.operation().map.hasOffnode() ? 1 : 0) | ForEach<A, OffnodeLeaf, BitOrCombine>::apply(expr.child(), f, c);
+  }
+};
+
+
+
+
 template<class A>
 struct ForEach<UnaryNode<FnMap, A>, ShiftPhase1 , BitOrCombine>
 {
+  static_assert( !MapUnsafeLeaf<A>::value , "shift/map of a compressed field is not supported, copy it to an OLattice first" );
+
   typedef typename ForEach<A, EvalLeaf1, OpCombine>::Type_t InnerTypeA_t;
   typedef typename Combine1<InnerTypeA_t, FnMap, OpCombine>::Type_t InnerType_t;
   typedef int Type_t;
@@ -370,16 +706,13 @@ struct ForEach<UnaryNode<FnMap, A>, ShiftPhase1 , BitOrCombine>
 
     Expr subexpr(expr.child());
 
-    if (map.offnodeP)
+    if (map.hasOffnode())
       {
 #if QDP_DEBUG >= 3
 	QDP_info("Map: off-node communications required");
 #endif
 
-	int dstnum = map.destnodes_num[0]*sizeof(InnerType_t);
-	int srcnum = map.srcenodes_num[0]*sizeof(InnerType_t);
-
-	const FnMapRsrc& rRSrc = fnmap.getResource(srcnum,dstnum);
+	const FnMapRsrc& rRSrc = fnmap.getResource( sizeof(InnerType_t) );
 
 	const int my_node = Layout::nodeNumber();
 
@@ -437,7 +770,7 @@ struct ForEach<UnaryNode<FnMap, A>, ShiftPhase2 , CTag>
   {
     const Map& map = expr.operation().map;
     FnMap& fnmap = const_cast<FnMap&>(expr.operation());
-    if (map.offnodeP) {
+    if (map.hasOffnode()) {
       const FnMapRsrc& rRSrc = fnmap.getCached();
       //QDP_info("ShiftPhase2: FnMap");
       rRSrc.qmp_wait();
@@ -682,7 +1015,7 @@ struct ForEach<UnaryNode<FnMap, A>, EvalLeaf1, CTag>
     // 	return recv_buf[-map.goffsets[f.val1()]-1];
     //       } else {
 
-    EvalLeaf1 ff( map.goffsets[f.val1()] );
+    EvalLeaf1 ff( map.goffset()[f.val1()] );
     return Combine1<TypeA_t, FnMap, CTag>::combine(ForEach<A, EvalLeaf1, CTag>::apply(expr.child(), ff, c),expr.operation(), c);
     //}
   }
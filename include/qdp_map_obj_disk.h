@@ -24,6 +24,32 @@ namespace QDP
 
     //! Check if this will be a new file
     bool checkForNewFile(const std::string& filename, std::ios_base::openmode mode);
+
+    //! Read-only shared mapping of a file, used on the primary node only
+    class MappedFile
+    {
+    public:
+      MappedFile() : addr(0), len(0) {}
+      ~MappedFile() {unmap();}
+
+      //! Make sure at least the first nbytes of the file are mapped
+      /*! An existing mapping is kept if it is large enough, otherwise the
+          whole file as it is now on disk is mapped again */
+      void map(const std::string& filename, size_t nbytes);
+
+      //! Release the mapping
+      void unmap();
+
+      const char* data() const {return static_cast<const char*>(addr);}
+      size_t size() const {return len;}
+
+    private:
+      MappedFile(const MappedFile&);
+      void operator=(const MappedFile&);
+
+      void*  addr;
+      size_t len;
+    };
   };
 
 
@@ -36,7 +62,9 @@ namespace QDP
   {
   public:
     //! Empty constructor
-    MapObjectDisk() : file_version(1), state(INIT), level(0) {}
+    MapObjectDisk() : file_version(1), state(INIT), level(0),
+		      flush_records(1), flush_bytes(0), pending_records(0), pending_bytes(0),
+		      append_only(false), mapped_reads(true), append_pos(0) {}
 
     //! Finalizes object
     ~MapObjectDisk();
@@ -47,9 +75,24 @@ namespace QDP
     //! Get debugging level
     int getDebug() const {return level;}
 
+    //! Group commit: sync the file after this many records or bytes, whichever comes first
+    /*! A zero switches that criterion off, so setFlushPolicy(0,0) only syncs
+        in flush() and close(). The default (1,0) syncs after every record. */
+    void setFlushPolicy(unsigned int records, size_t bytes);
+
+    //! Updates of an existing key append a new record instead of overwriting the old one
+    /*! The file then only ever grows at its end, the old record is left unreferenced */
+    void setAppendOnly(bool append) {append_only = append;}
+
+    //! Read values through a memory mapping of the file (default) or through the file stream
+    void setMappedReads(bool mapped) {mapped_reads = mapped;}
+
     //! Open a file
     void open(const std::string& file, std::ios_base::openmode mode = std::ios_base::in | std::ios_base::out);
 
+    //! Open an existing DB for getRecord() only, without reading its key map
+    void openRecords(const std::string& file);
+
     //! Check if a DB file exists before opening.
     bool fileExists(const std::string& file) const {
       return (! MapObjDiskEnv::checkForNewFile(file, std::ios_base::in));
@@ -75,6 +118,23 @@ namespace QDP
      */
     int get(const K& key, V& val) const;
 
+    /**
+     * Get the record at a file offset
+     * @param pos offset as returned by index()
+     * @param data after the call data will be populated
+     * @return 0 on success, otherwise the file is not open
+     */
+    int getRecord(uint64_t pos, V& val) const;
+
+    //! Serialized form of a key as used in the map
+    std::string keyString(const K& key) const;
+
+    /**
+     * Serialized keys and the file offsets of their records
+     * @param index user supplied vector, entries are appended
+     */
+    void index(std::vector< std::pair<std::string,uint64_t> >& index_) const;
+
 
     /**
      * Flush database in memory to disk
@@ -155,6 +215,32 @@ namespace QDP
 
     //! Reader and writer interfaces
     mutable BinaryFileReaderWriter streamer;
+
+    //! Group commit policy and the writes not yet synced
+    unsigned int flush_records;
+    size_t       flush_bytes;
+    mutable unsigned int pending_records;
+    mutable size_t       pending_bytes;
+
+    //! Write and read modes
+    bool append_only;
+    bool mapped_reads;
+
+    //! Where the next new record goes. The stream is left there between calls
+    uint64_t append_pos;
+
+    //! Memory mapped view of the file for reads, primary node only
+    mutable MapObjDiskEnv::MappedFile mapping;
+    mutable BinaryMemoryReader mem_reader;
+
+    //! Reused to serialize keys for lookups
+    mutable BinaryBufferWriter key_buf;
+
+    //! Account a written record and sync if the policy says so
+    void noteWritten(size_t nbytes);
+
+    //! Sync all writes not yet synced
+    void syncPending() const;
     
     //! Convert to known size
     priv_pos_type_t convertToPrivate(const pos_type& input) const;
@@ -202,6 +288,58 @@ namespace QDP
   }
 
 
+  //! Set the group commit policy
+  template<typename K, typename V>
+  void 
+  MapObjectDisk<K,V>::setFlushPolicy(unsigned int records, size_t bytes)
+  {
+    flush_records = records;
+    flush_bytes   = bytes;
+    noteWritten(0);
+  }
+
+
+  //! Serialize a key, reusing the buffer
+  template<typename K, typename V>
+  std::string
+  MapObjectDisk<K,V>::keyString(const K& key) const
+  {
+    key_buf.open(std::string());
+    key_buf.clear();
+    write(key_buf, key);
+    return key_buf.str();
+  }
+
+
+  //! Account a written record
+  template<typename K, typename V>
+  void
+  MapObjectDisk<K,V>::noteWritten(size_t nbytes)
+  {
+    if (nbytes > 0) {
+      pending_records++;
+      pending_bytes += nbytes;
+    }
+
+    if ((flush_records > 0 && pending_records >= flush_records) ||
+	(flush_bytes > 0 && pending_bytes >= flush_bytes))
+      syncPending();
+  }
+
+
+  //! Sync the records written since the last sync
+  template<typename K, typename V>
+  void
+  MapObjectDisk<K,V>::syncPending() const
+  {
+    if (pending_records > 0) {
+      streamer.flush();
+      pending_records = 0;
+      pending_bytes   = 0;
+    }
+  }
+
+
   //! Convert to known size
   template<typename K, typename V>
   typename MapObjectDisk<K,V>::priv_pos_type_t
@@ -333,6 +471,8 @@ namespace QDP
 	QDPIO::cout << "Finished sanity Check 2" << std::endl;
       }
       
+      append_pos = convertToPrivate(streamer.currentPosition()).p;
+
       // Advance state machine state
       state = MODIFIED;
       break;      
@@ -373,6 +513,9 @@ namespace QDP
 	
       /* Read the map in (metadata) */
       readMapBinary(md_start);
+
+      // New records go after the map, as before
+      append_pos = convertToPrivate(streamer.currentPosition()).p;
 	
       /* And we are done */
       state = UNCHANGED;
@@ -387,12 +530,44 @@ namespace QDP
   }
 
 
+  //! Open an existing DB, skip the map
+  template<typename K, typename V>
+  void
+  MapObjectDisk<K,V>::openRecords(const std::string& file)
+  {  
+    switch (state) { 
+    case INIT:
+    {
+      filename = file;
+
+      if (level >= 1) {
+	QDPIO::cout << "MapObjectDisk: opening file " << filename
+		    << " for record reads" << std::endl;
+      }
+      
+      streamer.open(filename, std::ios_base::in);
+
+      // All records lie before the map
+      append_pos = readCheckHeader().p;
+
+      state = UNCHANGED;
+    }
+    break;
+    default:
+      errorState("MapObjectDisk: openRecords() called from invalid state");
+      break;
+    }
+  }
+
+
   
   //! Close
   template<typename K, typename V>
   void
   MapObjectDisk<K,V>::close() 
   {
+    mapping.unmap();
+
     switch(state) { 
     case UNCHANGED:
       if( streamer.is_open() ) { 
@@ -463,6 +638,23 @@ namespace QDP
       }
     }
   }
+
+
+  //! Dump serialized keys with their offsets
+  template<typename K, typename V>
+  void
+  MapObjectDisk<K,V>::index(std::vector< std::pair<std::string,uint64_t> >& index_) const 
+  {
+    index_.reserve(index_.size() + src_map.size());
+
+    typename MapType_t::const_iterator iter;
+    for(iter  = src_map.begin();
+	iter != src_map.end();
+	++iter) 
+    {
+      index_.push_back(std::make_pair(iter->first, iter->second.p));
+    }
+  }
     
 
   /**
@@ -538,11 +730,10 @@ namespace QDP
     case MODIFIED :
     case UNCHANGED : {
       //  Find key
-      BinaryBufferWriter bin;
-      write(bin, key);
-      typename MapType_t::const_iterator key_ptr = src_map.find(bin.str());
+      std::string key_str = keyString(key);
+      typename MapType_t::iterator key_ptr = src_map.find(key_str);
 
-      if (key_ptr != src_map.end()) { 
+      if (key_ptr != src_map.end() && ! append_only) { 
 	// Key does exist
 	pos_type wpos = convertFromPrivate(key_ptr->second);
 	if (level >= 2) {
@@ -561,23 +752,30 @@ namespace QDP
 	  QDPIO::cout << "Wrote value to disk. Current Position: " << streamer.currentPosition() << std::endl;
 	}
 	write(streamer, streamer.getChecksum()); // Write Checksum
-	streamer.flush(); // Sync the file
+	priv_pos_type_t end_pos = convertToPrivate(streamer.currentPosition());
 	
 	if (level >= 2) {
-	  QDPIO::cout << "Wrote checksum " << streamer.getChecksum() << " to disk. Current Position: " << streamer.currentPosition() << std::endl;
+	  QDPIO::cout << "Wrote checksum " << streamer.getChecksum() << " to disk. Current Position: " << end_pos.p << std::endl;
 	}
 
+	// Back to the end for the next new record
+	streamer.seek(static_cast<pos_type>(static_cast<off_type>(append_pos)));
+	noteWritten(end_pos.p - key_ptr->second.p);
+
 	// Done
 	state = MODIFIED;
       }
       else {
-	// Key does not exist
+	// Key does not exist, or updates go to the end of the log
 
-	// Make note of current writer position
-	priv_pos_type_t pos = convertToPrivate(streamer.currentPosition());
+	// The stream already sits at the end of the records
+	priv_pos_type_t pos = convertToPrivate(static_cast<pos_type>(static_cast<off_type>(append_pos)));
       
 	// Insert pos into map
-	src_map.insert(std::make_pair(bin.str(),pos));
+	if (key_ptr != src_map.end())
+	  key_ptr->second = pos;
+	else
+	  src_map.insert(std::make_pair(key_str,pos));
      
 	streamer.resetChecksum();
 
@@ -603,10 +801,11 @@ namespace QDP
 	}
 
 	write(streamer, streamer.getChecksum()); // Write Checksum
-	streamer.flush();
+	append_pos = convertToPrivate(streamer.currentPosition()).p;
+	noteWritten(append_pos - pos.p);
 	
 	if (level >= 2) {
-	  QDPIO::cout << "Wrote checksum " << streamer.getChecksum() << " to disk. Current Position: " << streamer.currentPosition() << std::endl;
+	  QDPIO::cout << "Wrote checksum " << streamer.getChecksum() << " to disk. Current Position: " << append_pos << std::endl;
 	}
 
 	// Done
@@ -636,26 +835,67 @@ namespace QDP
     switch(state) { 
     case UNCHANGED: // Deliberate fallthrough
     case MODIFIED: {
-      BinaryBufferWriter bin;
-      write(bin, key);
-      typename MapType_t::const_iterator key_ptr = src_map.find(bin.str());
+      typename MapType_t::const_iterator key_ptr = src_map.find(keyString(key));
 
       if (key_ptr != src_map.end())
       {
-	// If key exists find file offset
-	priv_pos_type_t pos = key_ptr->second;
+	// If key exists read at its file offset
+	ret = getRecord(key_ptr->second.p, val);
+      }
+      else {
+	ret = 1;
+      }
+      break;
+    }
+    default:
+      ret = 1;
+      break;
+    }
+
+    return ret;
+  }
+
+
+
+  /*! 
+   * Read the record at a file offset.
+   */
+  template<typename K, typename V>
+  int 
+  MapObjectDisk<K,V>::getRecord(uint64_t offset, V& val) const
+  { 
+    int ret = 0;
+
+    switch(state) { 
+    case UNCHANGED: // Deliberate fallthrough
+    case MODIFIED: {
+      {
+	priv_pos_type_t pos = convertToPrivate(static_cast<pos_type>(static_cast<off_type>(offset)));
+
+	// Read from the mapped file, or through the stream
+	BinaryReader* reader = &streamer;
+	if (mapped_reads) {
+	  // Records still in the stream buffer are not visible in the mapping
+	  syncPending();
+
+	  if (Layout::primaryNode()) {
+	    mapping.map(filename, append_pos);
+	    mem_reader.open(mapping.data(), mapping.size());
+	  }
+	  reader = &mem_reader;
+	}
 
 	// Do the seek and time it 
 	StopWatch swatch;
 
 	swatch.reset();
 	swatch.start();
-	streamer.seek(convertFromPrivate(pos));
+	reader->seek(convertFromPrivate(pos));
 	swatch.stop();
 	double seek_time = swatch.getTimeInSeconds();
 
 	// Reset the checkums
-	streamer.resetChecksum();
+	reader->resetChecksum();
 
 	// Grab start pos: We've just seeked it
 	priv_pos_type_t start_pos = pos;
@@ -663,14 +903,14 @@ namespace QDP
 	// Time the read
 	swatch.reset();
 	swatch.start();
-	read(streamer, val);
+	read(*reader, val);
 	swatch.stop();
 
 	double read_time = swatch.getTimeInSeconds();
-	priv_pos_type_t end_pos = convertToPrivate(streamer.currentPosition());
 
 	// Print data
 	if (level >= 1) { 
+	  priv_pos_type_t end_pos = convertToPrivate(reader->currentPosition());
 	  double MiBRead = (double)(end_pos.p - start_pos.p)/(double)(1024*1024);
 	  QDPIO::cout << " seek time: " << seek_time 
 	  	      << " sec. read time: " << read_time 
@@ -679,15 +919,15 @@ namespace QDP
 
 
 	if (level >= 2) { 
-	  QDPIO::cout << "Read record. Current position: " << streamer.currentPosition() << std::endl;
+	  QDPIO::cout << "Read record. Current position: " << reader->currentPosition() << std::endl;
 	}
 
-	QDPUtil::n_uint32_t calc_checksum=streamer.getChecksum();
+	QDPUtil::n_uint32_t calc_checksum=reader->getChecksum();
 	QDPUtil::n_uint32_t read_checksum;
-	read(streamer, read_checksum);
+	read(*reader, read_checksum);
 
 	if (level >= 2) {
-	  QDPIO::cout << " Record checksum: " << read_checksum << "  Current Position: " << streamer.currentPosition() << std::endl;
+	  QDPIO::cout << " Record checksum: " << read_checksum << "  Current Position: " << reader->currentPosition() << std::endl;
 	}
 
 	if( read_checksum != calc_checksum ) { 
@@ -698,9 +938,10 @@ namespace QDP
 	if (level >= 2) {
 	  QDPIO::cout << "  Checksum OK!" << std::endl;
 	}
-      }
-      else {
-	ret = 1;
+
+	// Inserts expect the stream at the end of the records
+	if (! mapped_reads)
+	  streamer.seek(static_cast<pos_type>(static_cast<off_type>(append_pos)));
       }
       break;
     }
@@ -722,9 +963,7 @@ namespace QDP
   bool 
   MapObjectDisk<K,V>::exist(const K& key) const 
   {
-    BinaryBufferWriter bin;
-    write(bin, key);
-    return (src_map.find(bin.str()) == src_map.end()) ? false : true;
+    return (src_map.find(keyString(key)) == src_map.end()) ? false : true;
   }
   
   
@@ -960,6 +1199,9 @@ namespace QDP
       // skip to end and close
       streamer.seekEnd(0);
       streamer.flush();
+      pending_records = 0;
+      pending_bytes   = 0;
+      append_pos = convertToPrivate(streamer.currentPosition()).p;
 	
       QDPIO::cout << "MapObjectDisk: Closed file " << filename<< " for write access" <<  std::endl;
     }
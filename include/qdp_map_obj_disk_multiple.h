@@ -8,11 +8,59 @@
 #define __qdp_map_obj_disk_multiple_h__
 
 #include "qdp_map_obj_disk.h"
+#include <unordered_map>
 #include <vector>
 
 namespace QDP
 {
 
+  //----------------------------------------------------------------------------
+  //! Merged key index over several MapObjectDisk files
+  /*!
+    Maps a serialized key to the file holding it and the offset of its record.
+    A key present in several files belongs to the first one, as when probing
+    the files in order. The index can be kept in a sidecar file that records
+    the size and modification time of every data file; a sidecar that does
+    not match the data files any more is ignored. The sidecar is written to
+    a temporary name and renamed into place, so concurrent readers either see
+    a complete index or none.
+  */
+  class MapObjectDiskIndex
+  {
+  public:
+    struct Location
+    {
+      int      file;
+      uint64_t pos;
+    };
+
+    typedef std::unordered_map<std::string, Location> MapType_t;
+
+    //! Add the keys of one file. Keys already present stay with their file
+    void add(int file, const std::vector< std::pair<std::string,uint64_t> >& keys);
+
+    //! Location of a serialized key, 0 if not present
+    const Location* find(const std::string& key) const
+    {
+      MapType_t::const_iterator it = index.find(key);
+      return (it == index.end()) ? 0 : &it->second;
+    }
+
+    const MapType_t& entries() const {return index;}
+    size_t size() const {return index.size();}
+    void clear() {index.clear();}
+
+    //! Read a sidecar file. False if it is missing or does not match the files
+    bool read(const std::string& index_file, const std::vector<std::string>& files);
+
+    //! Write a sidecar file for the files, replacing an old one
+    void write(const std::string& index_file, const std::vector<std::string>& files) const;
+
+  private:
+    MapType_t index;
+  };
+
+
   //----------------------------------------------------------------------------
   //! Class that holds multiple DBs. Can only be used in a read-only mode.
   template<typename K, typename V>
@@ -38,12 +86,42 @@ namespace QDP
     //! Open files
     void open(const std::vector<std::string>& files)
     {
+      open(files, std::string());
+    }
+
+    //! Open files, using or creating a sidecar index file
+    /*!
+      If index_file matches the files, the key maps of the files are not
+      read at all. Otherwise the merged index is built from them and written
+      to index_file. With an empty name the index is only kept in memory.
+    */
+    void open(const std::vector<std::string>& files, const std::string& index_file)
+    {
+      bool have_index = (! index_file.empty()) && index_.read(index_file, files);
+
       dbs_.resize(files.size());
 
       for(int i=0; i < dbs_.size(); ++i)
       {
 	dbs_[i] = new MapObjectDisk<K,V>();
-	dbs_[i]->open(files[i], std::ios_base::in);
+	if (have_index)
+	  dbs_[i]->openRecords(files[i]);
+	else
+	  dbs_[i]->open(files[i], std::ios_base::in);
+      }
+
+      if (! have_index)
+      {
+	index_.clear();
+	for(int i=0; i < dbs_.size(); ++i)
+	{
+	  std::vector< std::pair<std::string,uint64_t> > kk;
+	  dbs_[i]->index(kk);
+	  index_.add(i, kk);
+	}
+
+	if (! index_file.empty())
+	  index_.write(index_file, files);
       }
     }
 
@@ -71,6 +149,8 @@ namespace QDP
 	dbs_[i]->close();
 	delete dbs_[i];
       }
+      dbs_.clear();
+      index_.clear();
     }
 
 
@@ -82,15 +162,14 @@ namespace QDP
      */
     int get(const K& key, V& val) const
     {
-      int ret = -1;
+      if (dbs_.size() == 0)
+	return 1;
 
-      for(int i=0; i < dbs_.size(); ++i) 
-      {
-	ret = dbs_[i]->get(key, val);
-	if (ret == 0)
-	  break;
-      }
-      return ret;
+      const MapObjectDiskIndex::Location* loc = index_.find(dbs_[0]->keyString(key));
+      if (! loc)
+	return 1;
+
+      return dbs_[loc->file]->getRecord(loc->pos, val);
     }
 
 
@@ -101,24 +180,10 @@ namespace QDP
      */
     void keys(std::vector<K>& keys_) const {
       keys_.clear();
+      keys_.reserve(index_.size());
 
-      std::unordered_map<std::string,int> unique_it;
-
-      for(int i=0; i < dbs_.size(); ++i) 
-      {
-	std::vector<K> kk;
-	dbs_[i]->keys(kk);
-
-	for(typename std::vector<K>::const_iterator k=kk.begin(); k != kk.end(); ++k)
-	{
-	  BinaryBufferWriter bin;
-	  write(bin, *k);
-
-	  unique_it.insert(std::make_pair(bin.str(),1));
-	}
-      }
-
-      for(typename std::unordered_map<std::string,int>::const_iterator k=unique_it.begin(); k != unique_it.end(); ++k)
+      // The index already holds every key once
+      for(MapObjectDiskIndex::MapType_t::const_iterator k=index_.entries().begin(); k != index_.entries().end(); ++k)
       {
 	BinaryBufferReader bin(k->first);
 	K key;
@@ -146,16 +211,10 @@ namespace QDP
      */
     bool exist(const K& key) const
     {
-      bool ret = false;
-      
-      for(int i=0; i < dbs_.size(); ++i)
-      {
-	ret = dbs_[i]->exist(key);
-	if (ret)
-	  break;
-      }
-      
-      return ret;
+      if (dbs_.size() == 0)
+	return false;
+
+      return index_.find(dbs_[0]->keyString(key)) != 0;
     }
 
     /**
@@ -187,6 +246,9 @@ namespace QDP
   private:
     //! Array of read-only maps
     std::vector< MapObjectDisk<K,V>* > dbs_;
+
+    //! Merged index over all files
+    MapObjectDiskIndex index_;
   };
 
 } // namespace Chroma
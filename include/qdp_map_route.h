@@ -0,0 +1,81 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Communication tables of a general map
+ *
+ * A map dest(x) = source(f(x)) moves every site to exactly one other
+ * site, possibly on another node. The route of one node lists, for the
+ * sites it holds, where their sources are and which of its own sites the
+ * other nodes need:
+ *
+ *  - the receive buffer holds one segment per source node, in the order
+ *    of srcenodes; inside a segment the sites are in the order of the
+ *    destination sites they feed,
+ *  - the send buffer holds one segment per destination node, in the
+ *    order of destnodes, and soffsets lists the local sites gathered into
+ *    it. Its segment for node n is exactly n's receive segment for this
+ *    node, so one gather fills the buffer for all peers and every segment
+ *    goes out as one message.
+ *
+ * The route is built from the map applied to this node's sites only, in
+ * both directions. Like qdp_tuner.h this header does not depend on the
+ * rest of QDP, so that the tables can be checked by simulating several
+ * nodes in one process.
+ */
+
+#ifndef QDP_MAP_ROUTE_H
+#define QDP_MAP_ROUTE_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace QDP {
+
+  //! A site given by its node and its linear index on that node
+  struct MapSite
+  {
+    int node;
+    int linear;
+  };
+
+  //! f(linear,sign) for the site 'linear' of this node: the source site for sign > 0, the destination for sign < 0
+  typedef std::function<MapSite(int,int)> MapSiteFunc;
+
+  struct MapRoute
+  {
+    //! Per local site: the local source site, or -(i+1) for position i of the receive buffer
+    std::vector<int> goffsets;
+    //! Local sites fed from the receive buffer, ascending
+    std::vector<int> roffsets;
+    //! Local sites in send buffer order
+    std::vector<int> soffsets;
+
+    //! Nodes sending to this one, their site counts and first receive buffer positions
+    std::vector<int> srcenodes;
+    std::vector<int> srcenodes_num;
+    std::vector<int> srcenodes_off;
+
+    //! Nodes this one sends to, their site counts and first send buffer positions
+    std::vector<int> destnodes;
+    std::vector<int> destnodes_num;
+    std::vector<int> destnodes_off;
+
+    bool offnode() const { return !srcenodes.empty(); }
+  };
+
+  /*! \brief Build the route of my_node for a map on nodeSites sites per node
+   *
+   * With threads, f is evaluated on the host worker threads
+   * (qdp_host_threads.h) and must be safe to call concurrently.
+   *
+   * Returns an empty string on success, otherwise what is wrong with the
+   * map (the two directions do not agree on this node, or the node would
+   * only send or only receive).
+   */
+  std::string mapRouteMake( MapRoute& route , int my_node , int nodeSites , const MapSiteFunc& f ,
+			    bool threads = false );
+
+} // namespace QDP
+
+#endif
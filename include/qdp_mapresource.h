@@ -6,12 +6,11 @@
 namespace QDP {
 
   // The MPI resources class for an FnMap.
-  // An instance for each (dest/src node,msg_size) combination
-  // exists so they can be reused over the whole program lifetime.
-  // Can't allocate resources in constructor, since I use ::operator new
-  // to allocate a whole array of them. This is necessary since if a 
-  // size of 2 occurs in the logical machine grid, then forward/backward
-  // points to the same MPI node.
+  // An instance for each combination of peers, per-peer site counts and
+  // site size exists so they can be reused over the whole program
+  // lifetime. One send and one receive buffer hold a segment per peer
+  // (see qdp_map_route.h); every segment is its own message and all of
+  // them are started together.
 
 struct FnMapRsrc
 {
@@ -20,7 +19,8 @@ private:
 public:
   FnMapRsrc():bSet(false) {};
 
-  void setup(int _destNode,int _srcNode,int _sendMsgSize,int _rcvMsgSize);
+  void setup(const multi1d<int>& destnodes, const multi1d<int>& destnodes_num,
+	     const multi1d<int>& srcenodes, const multi1d<int>& srcenodes_num, int siteBytes);
   void cleanup();
 
   ~FnMapRsrc() {
@@ -38,114 +38,69 @@ public:
   mutable void * recv_buf;
   void * send_buf_dev;
   void * recv_buf_dev;
-  int srcnum, dstnum;
-  QMP_msgmem_t msg[2];
-  QMP_msghandle_t mh_a[2], mh;
-  QMP_mem_t *send_buf_mem;
-  QMP_mem_t *recv_buf_mem;
+  int srcnum, dstnum;              // total bytes received and sent
+  std::vector<QMP_msgmem_t> msg;   // receives first, then sends
+  std::vector<QMP_msghandle_t> mh_a;
+  QMP_msghandle_t mh;
 };
 
 
-  // A 2D container of resource classes.
-  // We index msg_size and dest_node and take the
-  // index as the coordinate in the 2D matrix.
+  // The pool of resource classes, keyed by site size and the peers with
+  // their site counts. Several in-flight FnMaps with the same key each
+  // get their own instance.
 
 class FnMapRsrcMatrix {
 
-  multi2d< std::pair< int , std::vector<FnMapRsrc*> >* > m2d;
-  std::vector<int> sendMsgSize;
-  std::vector<int> destNode;
-  int numSendMsgSize;
-  int numDestNode;
-
-  FnMapRsrcMatrix(): numSendMsgSize(32), 
-		     numDestNode(Nd*2), 
-		     sendMsgSize(0), 
-		     destNode(0) {
-    m2d.resize(numSendMsgSize,numDestNode);
-
-    for(int i=0;i<numSendMsgSize;i++) {
-      for(int q=0;q<numDestNode;q++) {
-	m2d(i,q)=new std::pair< int , std::vector<FnMapRsrc*> >;
-	(*m2d(i,q)).first=0;
-      }
-    }
-  }
+  typedef std::pair< int , std::vector<FnMapRsrc*> > Slot;
+  std::map< std::vector<int> , Slot* > slots;
 
+  FnMapRsrcMatrix() {}
 
   public:
 
   void cleanup() {
     //QDPIO::cout << "FnMapRsrcMatrix cleanup\n";
-    for(int i=0;i<numSendMsgSize;i++) {
-      for(int q=0;q<numDestNode;q++) {
-	//QDPIO::cout << "cleanup m2d(" << i << "," << q << ")\n";
-	for (std::vector<FnMapRsrc*>::iterator v = (*m2d(i,q)).second.begin() ; v != (*m2d(i,q)).second.end() ; ++v )
-	  delete *v;
-	//std::for_each( (*m2d(i,q)).second.begin() , (*m2d(i,q)).second.end() , this->*del );
-	delete m2d(i,q);
-      }
+    for (auto& s : slots) {
+      for (std::vector<FnMapRsrc*>::iterator v = s.second->second.begin() ; v != s.second->second.end() ; ++v )
+	delete *v;
+      delete s.second;
     }
+    slots.clear();
   }
 
 
-  std::pair< int , std::vector<FnMapRsrc*> >* get(int _destNode,int _srcNode,
-						  int _sendMsgSize,int _rcvMsgSize) {
-    bool found = false;
-    int xDestNode=0;
-    for(; xDestNode < destNode.size(); ++xDestNode)
-      if (destNode[xDestNode] == _destNode)
-	{
-	  found = true;
-	  break;
-	}
-    if (! found) {
-      if (destNode.size() == numDestNode) {
-	QDP_error_exit("FnMapRsrcMatrix not enough space in destNode");
-      } else {
-	destNode.push_back(_destNode);
-	xDestNode=destNode.size()-1;
-      }
-    }
-    //QDPIO::cout << "using node place = " << xDestNode << "\n";
-
-
-    found = false;
-    int xSendmsgsize=0;
-    for(; xSendmsgsize < sendMsgSize.size(); ++xSendmsgsize)
-      if (sendMsgSize[xSendmsgsize] == _sendMsgSize)
-	{
-	  found = true;
-	  break;
-	}
-    if (! found) {
-      if (sendMsgSize.size() == numSendMsgSize) {
-	QDP_error_exit("FnMapRsrcMatrix not enough space in sendmsgsize");
-      } else {
-	sendMsgSize.push_back(_sendMsgSize);
-	xSendmsgsize=sendMsgSize.size()-1;
-      }
-    }
-    //QDPIO::cout << "using msg_size place = " << xSendmsgsize << "\n";
+  Slot* get(const multi1d<int>& destnodes, const multi1d<int>& destnodes_num,
+	    const multi1d<int>& srcenodes, const multi1d<int>& srcenodes_num, int siteBytes) {
+    std::vector<int> key;
+    key.push_back( siteBytes );
+    key.push_back( destnodes.size() );
+    for (int i=0;i<destnodes.size();i++) { key.push_back( destnodes[i] ); key.push_back( destnodes_num[i] ); }
+    key.push_back( srcenodes.size() );
+    for (int i=0;i<srcenodes.size();i++) { key.push_back( srcenodes[i] ); key.push_back( srcenodes_num[i] ); }
 
-    std::pair< int , std::vector<FnMapRsrc*> >& pos = *m2d(xSendmsgsize,xDestNode);
+    Slot*& pos = slots[key];
+    if (!pos) {
+      pos = new Slot;
+      pos->first = 0;
+    }
 
 #if QDP_DEBUG >= 3
     // SANITY
-    if ( pos.second.size() <  pos.first )
-      QDP_error_exit(" pos.second.size()=%d  pos.first=%d",pos.second.size(), pos.first);
+    if ( pos->second.size() <  pos->first )
+      QDP_error_exit(" pos.second.size()=%d  pos.first=%d",pos->second.size(), pos->first);
 #endif
 
     // Vector's size large enough ?
-    if ( pos.second.size() ==  pos.first ) {
-      QDPIO::cout << "allocate and setup new rsrc-obj (destnode=" << _destNode << ",sndmsgsize=" << _sendMsgSize << ")\n";
-      pos.second.push_back( new FnMapRsrc() );
-      pos.second.at(pos.first)->setup( _destNode, _srcNode, _sendMsgSize, _rcvMsgSize );
+    if ( pos->second.size() ==  pos->first ) {
+      QDPIO::cout << "allocate and setup new rsrc-obj (destnodes=" << destnodes.size()
+		  << ",srcenodes=" << srcenodes.size() << ",sitebytes=" << siteBytes << ")\n";
+      pos->second.push_back( new FnMapRsrc() );
+      pos->second.at(pos->first)->setup( destnodes, destnodes_num, srcenodes, srcenodes_num, siteBytes );
     }
 
-    //QDPIO::cout << "returning rsrc-obj " << pos.first << "\n";
+    //QDPIO::cout << "returning rsrc-obj " << pos->first << "\n";
 
-    return &pos;
+    return pos;
   }
 
   static FnMapRsrcMatrix& Instance() {
@@ -164,7 +119,9 @@ class FnMapRsrcMatrix {
 class RsrcWrapper
 {
   const multi1d<int>& destnodes;
+  const multi1d<int>& destnodes_num;
   const multi1d<int>& srcenodes;
+  const multi1d<int>& srcenodes_num;
   std::pair< int , std::vector<FnMapRsrc*> > * pPair;
   const FnMapRsrc* cached;
   bool rAlloc;
@@ -179,17 +136,19 @@ public:
 #endif
     }
   }
-  RsrcWrapper(  const multi1d<int>& destnodes_, const multi1d<int>& srcenodes_): 
-    destnodes(destnodes_),srcenodes(srcenodes_),rAlloc(false),cached(NULL) {
+  RsrcWrapper(  const multi1d<int>& destnodes_, const multi1d<int>& destnodes_num_,
+		const multi1d<int>& srcenodes_, const multi1d<int>& srcenodes_num_):
+    destnodes(destnodes_),destnodes_num(destnodes_num_),
+    srcenodes(srcenodes_),srcenodes_num(srcenodes_num_),rAlloc(false),cached(NULL) {
     //QDPIO::cout << "wrapper ctor " << srcenodes.size() << " " << destnodes.size() << "\n";
   }
 
-  const FnMapRsrc& getResource(int srcnum_, int dstnum_) {
+  const FnMapRsrc& getResource(int siteBytes) {
 #if QDP_DEBUG >= 3
     if ( !srcenodes.size() || !destnodes.size() )
       QDP_error_exit("FnMapRsrc& getResource srcnode_size=%d destnode_size=%d", srcenodes.size() , destnodes.size() );
 #endif
-    pPair = FnMapRsrcMatrix::Instance().get( destnodes[0] , srcenodes[0] , dstnum_ , srcnum_ );
+    pPair = FnMapRsrcMatrix::Instance().get( destnodes , destnodes_num , srcenodes , srcenodes_num , siteBytes );
     //QDPIO::cout << "wrapper: returning obj " << pPair->first << "\n";
     cached = pPair->second.at(pPair->first++);
     rAlloc=true;
@@ -671,10 +671,17 @@ struct LeafFunctor<OLattice<T>, AddressLeaf>
   Type_t apply(const OLattice<T>& s, const AddressLeaf& p) 
   {
     p.setAddr( QDPCache::Instance().getDevicePtr( s.getId() ) );
+    p.addBytes( sizeof(T) );
     return 0;
   }
 };
 
+template<class T>
+struct LeafSiteBytes<OLattice<T> >
+{
+  static const size_t value = sizeof(T);
+};
+
 template<class T>
 struct LeafFunctor<OScalar<T>, AddressLeaf>
 {
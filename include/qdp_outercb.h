@@ -0,0 +1,289 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Half-volume storage for fields that live on one checkerboard
+ *
+ * OLatticeCB<T> holds the Layout::sitesOnNode()/2 sites of rb[cb] only.
+ * Element j is site rb[cb].siteTable()[j] of the full lattice, and on the
+ * device the field is coalesced with a stride of half the node volume.
+ * Kernels on these fields index by the thread id directly: there is no
+ * subset member table and no site permutation. Expressions may mix
+ * OLatticeCB and OScalar leaves; full fields are moved in and out with
+ * pack() and unpack() (qdp_cb.h). Shifts are not supported.
+ */
+
+#ifndef QDP_OUTERCB_H
+#define QDP_OUTERCB_H
+
+namespace QDP {
+
+  //! Lattice field on one checkerboard, half-volume storage
+  template<class T>
+  class OLatticeCB: public QDPType<T, OLatticeCB<T> >
+  {
+  public:
+    typedef T SubType_t;
+
+    explicit OLatticeCB(int cb_ = 0): cb(cb_) { alloc_mem(); }
+
+    OLatticeCB(const OLatticeCB& rhs): QDPType<T, OLatticeCB<T> >(), cb(rhs.cb) {
+      alloc_mem();
+      this->assign(rhs);
+    }
+
+    ~OLatticeCB() { free_mem(); }
+
+    inline
+    OLatticeCB& operator=(const typename WordType<T>::Type_t& rhs)
+    {
+      return this->assign(rhs);
+    }
+
+    inline
+    OLatticeCB& operator=(const Zero& rhs)
+    {
+      return this->assign(rhs);
+    }
+
+    template<class T1,class C1>
+    inline
+    OLatticeCB& operator=(const QDPType<T1,C1>& rhs)
+    {
+      return this->assign(rhs);
+    }
+
+    template<class T1,class C1>
+    inline
+    OLatticeCB& operator=(const QDPExpr<T1,C1>& rhs)
+    {
+      return this->assign(rhs);
+    }
+
+    //! Copies the data, both fields must be on the same checkerboard
+    inline
+    OLatticeCB& operator=(const OLatticeCB& rhs)
+    {
+      if (rhs.cb != cb)
+	QDP_error_exit("OLatticeCB: assigning a field on rb[%d] to one on rb[%d]", rhs.cb, cb);
+      return this->assign(rhs);
+    }
+
+    //! Checkerboard this field lives on, rb[getCB()]
+    int getCB() const { return cb; }
+
+    //! Number of sites on this node
+    static int sites() { return Layout::sitesOnNode() / 2; }
+
+    int getId() const { return myId; }
+
+    inline T* getF() const {
+      T* F;
+      QDPCache::Instance().getHostPtr( (void**)&F , myId );
+      return F;
+    }
+
+    //! Host access to checkerboard site j
+    inline T& elem(int j) { return getF()[j]; }
+    inline const T& elem(int j) const { return getF()[j]; }
+
+  private:
+    static void changeLayout(bool toDev,void * outPtr,void * inPtr)
+    {
+      QDP_info_primary("changing checkerboard data layout to %s format" , toDev? "device" : "host");
+
+      typename WordType<T>::Type_t * in_data  = (typename WordType<T>::Type_t *)inPtr;
+      typename WordType<T>::Type_t * out_data = (typename WordType<T>::Type_t *)outPtr;
+
+      size_t lim_rea = GetLimit<T,2>::Limit_v;
+      size_t lim_col = GetLimit<T,1>::Limit_v;
+      size_t lim_spi = GetLimit<T,0>::Limit_v;
+
+      size_t n = sites();
+
+      for ( size_t site = 0 ; site < n ; site++ ) {
+	for ( size_t reality = 0 ; reality < lim_rea ; reality++ ) {
+	  for ( size_t color = 0 ; color < lim_col ; color++ ) {
+	    for ( size_t spin = 0 ; spin < lim_spi ; spin++ ) {
+	      size_t hst_idx =
+		reality +
+		lim_rea * color +
+		lim_rea * lim_col * spin +
+		lim_rea * lim_col * lim_spi * site;
+	      size_t dev_idx =
+		site +
+		n * spin +
+		n * lim_spi * color +
+		n * lim_spi * lim_col * reality;
+	      if (toDev)
+		out_data[dev_idx] = in_data[hst_idx];
+	      else
+		out_data[hst_idx] = in_data[dev_idx];
+	    }
+	  }
+	}
+      }
+    }
+
+    inline void alloc_mem() {
+      if (cb < 0 || cb > 1)
+	QDP_error_exit("OLatticeCB: checkerboard %d, must be 0 or 1", cb);
+      if (rb[cb].numSiteTable() != sites())
+	QDP_error_exit("OLatticeCB: rb[%d] has %d sites on this node, expected %d",
+		       cb, rb[cb].numSiteTable(), sites());
+      myId = QDPCache::Instance().registrate( sites() * sizeof(T) , 1 , &changeLayout );
+    }
+    inline void free_mem() {
+      QDPCache::Instance().signoff( myId );
+    }
+
+    int cb;
+    int myId;
+  };
+
+
+
+  //-----------------------------------------------------------------------------
+  // Leaf functors: the JIT view is an OLatticeJIT with half the stride
+  //-----------------------------------------------------------------------------
+
+  template<class T>
+  struct JITType<OLatticeCB<T> >
+  {
+    typedef OLatticeJIT<typename JITType<T>::Type_t>  Type_t;
+  };
+
+
+  template<class T>
+  struct LeafFunctor<OLatticeCB<T>, ParamLeaf>
+  {
+    typedef typename JITType< OLatticeCB<T> >::Type_t  Type_t;
+    inline static
+    Type_t apply(const OLatticeCB<T>& do_not_use, const ParamLeaf& p)
+    {
+      jit_value    base_addr = jit_add_param( jit_ptx_type::u64 );
+      jit_value    index     = p.getRegIdx();
+      return Type_t( base_addr , index , OLatticeCB<T>::sites() );
+    }
+  };
+
+
+  template<class T>
+  struct LeafFunctor<QDPType<T,OLatticeCB<T> >, ParamLeaf>
+  {
+    typedef QDPTypeJIT<typename JITType<T>::Type_t,typename JITType<OLatticeCB<T> >::Type_t>  Type_t;
+    inline static Type_t apply(const QDPType<T,OLatticeCB<T> > &a, const ParamLeaf& p)
+    {
+      jit_value    base_addr = jit_add_param( jit_ptx_type::u64 );
+      jit_value    index     = p.getRegIdx();
+      return Type_t( base_addr , index , OLatticeCB<T>::sites() );
+    }
+  };
+
+
+  template<class T>
+  struct LeafFunctor<OLatticeCB<T>, AddressLeaf>
+  {
+    typedef int Type_t;
+    inline static
+    Type_t apply(const OLatticeCB<T>& s, const AddressLeaf& p)
+    {
+      p.setAddr( QDPCache::Instance().getDevicePtr( s.getId() ) );
+      p.addBytes( sizeof(T) );
+      return 0;
+    }
+  };
+
+
+  //! forEach(expr, CheckerboardLeaf(), BitOrCombine()) has bit cb set for each OLatticeCB leaf on rb[cb]
+  struct CheckerboardLeaf
+  {
+  };
+
+  template<class LeafType>
+  struct LeafFunctor<LeafType, CheckerboardLeaf>
+  {
+    typedef int Type_t;
+    static int apply(const LeafType&, const CheckerboardLeaf&) { return 0; }
+  };
+
+  template<class T>
+  struct LeafFunctor<OLatticeCB<T>, CheckerboardLeaf>
+  {
+    typedef int Type_t;
+    static int apply(const OLatticeCB<T>& s, const CheckerboardLeaf&) { return 1 << s.getCB(); }
+  };
+
+  template<class T>
+  struct LeafFunctor<QDPType<T,OLatticeCB<T> >, CheckerboardLeaf>
+  {
+    typedef int Type_t;
+    static int apply(const QDPType<T,OLatticeCB<T> >& s, const CheckerboardLeaf&)
+    {
+      return 1 << static_cast<const OLatticeCB<T>&>(s).getCB();
+    }
+  };
+
+
+  template<class T>
+  struct LeafSiteBytes<OLatticeCB<T> >
+  {
+    static const size_t value = sizeof(T);
+  };
+
+
+  template<class T>
+  struct LeafFunctor<OLatticeCB<T>, PrintTag>
+  {
+    typedef int Type_t;
+    static int apply(const OLatticeCB<T> &s, const PrintTag &f)
+    {
+      f.os_m << "OLatticeCB";
+      return 0;
+    }
+  };
+
+
+  //-----------------------------------------------------------------------------
+  // Traits: results follow OLattice, with lattice results on the checkerboard
+  //-----------------------------------------------------------------------------
+
+  //! OLattice<T> -> OLatticeCB<T>, anything else (reductions) unchanged
+  template<class R>
+  struct CBReturn {
+    typedef R  Type_t;
+  };
+
+  template<class T>
+  struct CBReturn<OLattice<T> > {
+    typedef OLatticeCB<T>  Type_t;
+  };
+
+  template<class T>
+  struct WordType<OLatticeCB<T> >
+  {
+    typedef typename WordType<T>::Type_t  Type_t;
+  };
+
+  template<class T1, class Op>
+  struct UnaryReturn<OLatticeCB<T1>, Op> {
+    typedef typename CBReturn<typename UnaryReturn<OLattice<T1>, Op>::Type_t>::Type_t  Type_t;
+  };
+
+  template<class T1, class T2, class Op>
+  struct BinaryReturn<OLatticeCB<T1>, OLatticeCB<T2>, Op> {
+    typedef typename CBReturn<typename BinaryReturn<OLattice<T1>, OLattice<T2>, Op>::Type_t>::Type_t  Type_t;
+  };
+
+  template<class T1, class T2, class Op>
+  struct BinaryReturn<OLatticeCB<T1>, OScalar<T2>, Op> {
+    typedef typename CBReturn<typename BinaryReturn<OLattice<T1>, OScalar<T2>, Op>::Type_t>::Type_t  Type_t;
+  };
+
+  template<class T1, class T2, class Op>
+  struct BinaryReturn<OScalar<T1>, OLatticeCB<T2>, Op> {
+    typedef typename CBReturn<typename BinaryReturn<OScalar<T1>, OLattice<T2>, Op>::Type_t>::Type_t  Type_t;
+  };
+
+} // namespace QDP
+
+#endif
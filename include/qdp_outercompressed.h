@@ -0,0 +1,282 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Compressed storage for lattice SU(3) fields
+ *
+ * OLatticeCompressed<T,R> keeps R reals per site instead of 18:
+ *   R=12  first two rows, the third is (row0 x row1)^*
+ *   R=8   a1, a2, b0 and the phases of a0 and c0 (QUDA's 8-real form);
+ *         if a1 = a2 = 0 (unit gauge, diagonal links) the form is singular
+ *         and b1, b2 and the phase of a0 are stored instead, see su3Compress
+ * The field is a read-only leaf in expressions. JIT kernels load the R
+ * reals and rebuild the full matrix in registers, so the gauge bandwidth
+ * drops by 1/3 (R=12) or 5/9 (R=8). The field can not be shifted; shift
+ * an OLattice copy instead.
+ */
+
+#ifndef QDP_OUTERCOMPRESSED_H
+#define QDP_OUTERCOMPRESSED_H
+
+#include <vector>
+#include <cstring>
+#include <limits>
+
+namespace QDP {
+
+  //! Pack one SU(3) matrix, m holds 18 reals in (row,col,re/im) order
+  /*! eps is the precision the packed reals are stored in. For reals=8 it
+   *  decides when |a1|^2+|a2|^2 is too small to divide by, the matrix is
+   *  then packed as block diagonal and packed[7] holds a flag. */
+  void su3Compress( const double* m , int reals , double* packed , double eps );
+
+  //! Rebuild the 18 reals of an SU(3) matrix from its packed form
+  void su3Reconstruct( const double* packed , int reals , double* m );
+
+  //! JIT version of su3Reconstruct, returns 18 registers in (row,col,re/im) order
+  std::vector<jit_value> jit_su3_reconstruct( const std::vector<jit_value>& packed , int reals );
+
+
+  //! Compressed lattice color matrix
+  /*! T is the uncompressed site type, PScalar<PColorMatrix<RComplex<Word<W> >,3> > */
+  template<class T, int R>
+  class OLatticeCompressed: public QDPType<T, OLatticeCompressed<T,R> >
+  {
+    static_assert( R == 12 || R == 8 , "OLatticeCompressed supports 12 and 8 reals per site" );
+
+    typedef typename WordType<T>::Type_t W;
+
+  public:
+    OLatticeCompressed() { alloc_mem(); }
+
+    OLatticeCompressed(const OLattice<T>& rhs) {
+      alloc_mem();
+      pack(rhs);
+    }
+
+    OLatticeCompressed(const OLatticeCompressed& rhs): QDPType<T, OLatticeCompressed<T,R> >() {
+      alloc_mem();
+      std::memcpy( getF() , rhs.getF() , Layout::sitesOnNode() * R * sizeof(W) );
+    }
+
+    ~OLatticeCompressed() { free_mem(); }
+
+    OLatticeCompressed& operator=(const OLattice<T>& rhs) {
+      pack(rhs);
+      return *this;
+    }
+
+    OLatticeCompressed& operator=(const OLatticeCompressed& rhs) {
+      if (this != &rhs)
+	std::memcpy( getF() , rhs.getF() , Layout::sitesOnNode() * R * sizeof(W) );
+      return *this;
+    }
+
+    //! Compress u into this field. Assumes the sites of u are in SU(3)
+    void pack(const OLattice<T>& u)
+    {
+      const T* uF = u.getF();
+      W*       F  = getF();
+      double   m[18];
+      double   p[R];
+
+      for ( int site = 0 ; site < Layout::sitesOnNode() ; ++site ) {
+	for ( int i = 0 ; i < 3 ; ++i ) {
+	  for ( int j = 0 ; j < 3 ; ++j ) {
+	    m[ 2*(3*i+j)     ] = uF[site].elem().elem(i,j).real().elem();
+	    m[ 2*(3*i+j) + 1 ] = uF[site].elem().elem(i,j).imag().elem();
+	  }
+	}
+	su3Compress( m , R , p , std::numeric_limits<W>::epsilon() );
+	for ( int k = 0 ; k < R ; ++k )
+	  F[ R*site + k ] = p[k];
+      }
+    }
+
+    int getId() const { return myId; }
+
+    //! Host pointer to the packed data, R words per site
+    W* getF() const {
+      W* F;
+      QDPCache::Instance().getHostPtr( (void**)&F , myId );
+      return F;
+    }
+
+  private:
+    static void changeLayout(bool toDev,void * outPtr,void * inPtr)
+    {
+      QDP_info_primary("changing compressed data layout to %s format" , toDev? "device" : "host");
+
+      W * in_data  = (W *)inPtr;
+      W * out_data = (W *)outPtr;
+
+      size_t sites = Layout::sitesOnNode();
+
+      for ( size_t site = 0 ; site < sites ; site++ ) {
+	for ( size_t k = 0 ; k < R ; k++ ) {
+	  size_t hst_idx = k + R * site;
+	  size_t dev_idx = site + sites * k;
+	  if (toDev)
+	    out_data[dev_idx] = in_data[hst_idx];
+	  else
+	    out_data[hst_idx] = in_data[dev_idx];
+	}
+      }
+    }
+
+    inline void alloc_mem() {
+      myId = QDPCache::Instance().registrate( Layout::sitesOnNode() * R * sizeof(W) , 1 , &changeLayout );
+    }
+    inline void free_mem() {
+      QDPCache::Instance().signoff( myId );
+    }
+
+    int myId;
+  };
+
+
+
+  //! Kernel-side view of a compressed field
+  template<class T, int R>
+  class OLatticeCompressedJIT
+  {
+    typedef typename WordType<T>::Type_t W;
+
+  public:
+    OLatticeCompressedJIT( jit_value base_ , jit_value index_ ): base_m(base_), index_m(index_) {}
+    OLatticeCompressedJIT( const OLatticeCompressedJIT& rhs ): base_m(rhs.base_m), index_m(rhs.index_m) {}
+
+    //! Load the R packed reals of this thread's site (coalesced layout)
+    std::vector<jit_value> load() const
+    {
+      jit_value ws      = jit_value( sizeof(W) );
+      jit_value address = jit_ins_add( base_m , jit_ins_mul( index_m , ws ) );
+      std::vector<jit_value> packed;
+      for ( int k = 0 ; k < R ; ++k )
+	packed.push_back( jit_ins_load( address , k * Layout::sitesOnNode() * sizeof(W) , jit_type<W>::value ) );
+      return packed;
+    }
+
+  private:
+    jit_value base_m;
+    jit_value index_m;
+  };
+
+
+
+  //-----------------------------------------------------------------------------
+  // Leaf functors
+  //-----------------------------------------------------------------------------
+
+  template<class T, int R>
+  struct LeafFunctor<QDPType<T,OLatticeCompressed<T,R> >, ParamLeaf>
+  {
+    typedef OLatticeCompressedJIT<T,R>  Type_t;
+    inline static Type_t apply(const QDPType<T,OLatticeCompressed<T,R> > &a, const ParamLeaf& p)
+    {
+      jit_value    base_addr = jit_add_param( jit_ptx_type::u64 );
+      jit_value    index     = p.getRegIdx();
+      return Type_t( base_addr , index );
+    }
+  };
+
+
+  template<class T, int R>
+  struct LeafFunctor<OLatticeCompressedJIT<T,R>, ViewLeaf>
+  {
+    typedef typename REGType< typename JITType<T>::Type_t >::Type_t Type_t;
+    inline static
+    Type_t apply(const OLatticeCompressedJIT<T,R>& s, const ViewLeaf& v)
+    {
+      std::vector<jit_value> m = jit_su3_reconstruct( s.load() , R );
+      Type_t reg;
+      for ( int i = 0 ; i < 3 ; ++i ) {
+	for ( int j = 0 ; j < 3 ; ++j ) {
+	  reg.elem().elem(i,j).real().setup( m[ 2*(3*i+j)     ] );
+	  reg.elem().elem(i,j).imag().setup( m[ 2*(3*i+j) + 1 ] );
+	}
+      }
+      return reg;
+    }
+  };
+
+
+  template<class T, int R>
+  struct LeafSiteBytes<OLatticeCompressed<T,R> >
+  {
+    static const size_t value = R * sizeof(typename WordType<T>::Type_t);
+  };
+
+
+  //! The map gather assumes the uncompressed layout, shifts are rejected
+  template<class T, int R>
+  struct MapUnsafeLeaf<OLatticeCompressed<T,R> >
+  {
+    static const bool value = true;
+  };
+
+
+  template<class T, int R>
+  struct LeafFunctor<OLatticeCompressed<T,R>, PrintTag>
+  {
+    typedef int Type_t;
+    static int apply(const OLatticeCompressed<T,R> &s, const PrintTag &f)
+    {
+      f.os_m << "OLatticeCompressed<" << R << ">";
+      return 0;
+    }
+  };
+
+
+  //-----------------------------------------------------------------------------
+  // Traits: anything computed from a compressed field is an ordinary lattice object
+  //-----------------------------------------------------------------------------
+
+  template<class T, int R>
+  struct WordType<OLatticeCompressed<T,R> >
+  {
+    typedef typename WordType<T>::Type_t  Type_t;
+  };
+
+  template<class T1, int R, class Op>
+  struct UnaryReturn<OLatticeCompressed<T1,R>, Op> {
+    typedef typename UnaryReturn<OLattice<T1>, Op>::Type_t  Type_t;
+  };
+
+  template<class T1, int R, class T2, class Op>
+  struct BinaryReturn<OLatticeCompressed<T1,R>, OLattice<T2>, Op> {
+    typedef typename BinaryReturn<OLattice<T1>, OLattice<T2>, Op>::Type_t  Type_t;
+  };
+
+  template<class T1, class T2, int R, class Op>
+  struct BinaryReturn<OLattice<T1>, OLatticeCompressed<T2,R>, Op> {
+    typedef typename BinaryReturn<OLattice<T1>, OLattice<T2>, Op>::Type_t  Type_t;
+  };
+
+  template<class T1, int R1, class T2, int R2, class Op>
+  struct BinaryReturn<OLatticeCompressed<T1,R1>, OLatticeCompressed<T2,R2>, Op> {
+    typedef typename BinaryReturn<OLattice<T1>, OLattice<T2>, Op>::Type_t  Type_t;
+  };
+
+  template<class T1, int R, class T2, class Op>
+  struct BinaryReturn<OLatticeCompressed<T1,R>, OScalar<T2>, Op> {
+    typedef typename BinaryReturn<OLattice<T1>, OScalar<T2>, Op>::Type_t  Type_t;
+  };
+
+  template<class T1, class T2, int R, class Op>
+  struct BinaryReturn<OScalar<T1>, OLatticeCompressed<T2,R>, Op> {
+    typedef typename BinaryReturn<OScalar<T1>, OLattice<T2>, Op>::Type_t  Type_t;
+  };
+
+
+  //! dest = compressed field (a lone leaf keeps the compressed container type)
+  template<class T, class T1, int R, class Op, class RHS>
+  inline
+  void evaluate(OLattice<T>& dest, const Op& op, const QDPExpr<RHS,OLatticeCompressed<T1,R> >& rhs,
+		const Subset& s)
+  {
+    evaluate( dest , op , QDPExpr<RHS,OLattice<T1> >( rhs.expression() ) , s );
+  }
+
+} // namespace QDP
+
+#endif
@@ -8,7 +8,7 @@ namespace QDP {
   class OLatticeJIT: public QDPTypeJIT<T, OLatticeJIT<T> >
   {
   public:
-    OLatticeJIT( jit_value base_, jit_value index_) : QDPTypeJIT<T, OLatticeJIT<T> >(base_,index_) {}
+    OLatticeJIT( jit_value base_, jit_value index_, int sites_ = 0 ) : QDPTypeJIT<T, OLatticeJIT<T> >(base_,index_,sites_) {}
     OLatticeJIT( const OLatticeJIT& rhs ) : QDPTypeJIT<T, OLatticeJIT<T> >(rhs) {}
 
   private:
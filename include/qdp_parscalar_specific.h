@@ -309,8 +309,26 @@ void evaluate(OLattice<T>& dest, const Op& op, const QDPExpr<RHS,OLattice<T1> >&
       //QDPIO::cout << __PRETTY_FUNCTION__ << ": is already built\n";
     }
 
+  // Shared memory tiled variant for expressions with maps of fields
+  static CUfunction    function_tiled;
+  static JitTileInfo   tile_info;
+  static JitTileChoice tile_choice;
+
+  bool done = false;
+  if (HasTiledMap<RHS>::value && jit_tile_enabled(tile_choice)) {
+    if (function_tiled == NULL)
+      function_tiled = function_build_tiled(dest, op, rhs, tile_info);
+
+    if (jit_tile_select(tile_choice, function, function_tiled)) {
+      done = function_exec_tiled(function_tiled, tile_info, dest, op, rhs, s);
+      if (!done)
+	jit_tile_reject(tile_choice);
+    }
+  }
+
   // Execute the function
-  function_exec(function, dest, op, rhs, s);
+  if (!done)
+    function_exec(function, dest, op, rhs, s);
 #endif
 
 
@@ -322,6 +340,75 @@ void evaluate(OLattice<T>& dest, const Op& op, const QDPExpr<RHS,OLattice<T1> >&
 }
 
 
+
+//! Whether evaluate_batch may take f(k) by value: expressions only hold references
+template<class R>
+struct BatchByValue
+{
+  static const bool value = false;
+};
+
+template<class T, class C>
+struct BatchByValue<QDPExpr<T,C> >
+{
+  static const bool value = true;
+};
+
+
+//! dest[k] Op f(k) for all k under a Subset, in one kernel
+/*! 
+ * f(k) returns the expression for element k, e.g.
+ * [&](int mu){ return u[mu] * staple[mu]; }, or a reference to a field,
+ * e.g. [&](int mu) -> const LatticeColorMatrix& { return u[mu]; }, and
+ * must have the same type for every k. A field returned by value would
+ * be copied on every call and does not compile. The leaves of all
+ * elements are passed in one table. An element may read its own
+ * destination but not those of the other elements, since they are
+ * written by the same kernel. Expressions with off-node shifts are
+ * evaluated element by element.
+ */
+template<class T, class Op, class F>
+void evaluate_batch(multi1d< OLattice<T> >& dest, const Op& op, const F& f, const Subset& s)
+{
+  typedef decltype( f(0) ) Ret_t;
+  static_assert( std::is_reference<Ret_t>::value || BatchByValue<Ret_t>::value ,
+		 "evaluate_batch: f(k) returns a field by value, return a reference to it instead" );
+
+  if (dest.size() == 0)
+    return;
+
+  auto rhs = [&](int k) { return PETE_identity( f(k) ); };
+
+  bool offnode = false;
+  for(int k=0; k < dest.size() && !offnode; ++k)
+    offnode = forEach(rhs(k), OffnodeLeaf(), BitOrCombine());
+
+  if (offnode)
+  {
+    for(int k=0; k < dest.size(); ++k)
+      evaluate(dest[k], op, rhs(k), s);
+    return;
+  }
+
+  static CUfunction function;
+
+  // Build the function
+  if (function == NULL)
+    function = function_batch_build(dest[0], op, rhs(0));
+
+  // Execute the function
+  function_batch_exec(function, dest, op, rhs, s);
+}
+
+
+//! dest[k] Op f(k) for all k
+template<class T, class Op, class F>
+void evaluate_batch(multi1d< OLattice<T> >& dest, const Op& op, const F& f)
+{
+  evaluate_batch(dest, op, f, all);
+}
+
+
 //-----------------------------------------------------------------------------
 //! dest = (mask) ? s1 : dest
 template<class T1, class T2>
@@ -386,6 +473,16 @@ template<class T>
 void 
 random(OScalar<T>& d)
 {
+  if (RNG::getGenerator() == RNG::Generator::philox)
+  {
+    uint32_t key[2];
+    RNG::philoxKey(key);
+    Philox::Stream stream(key, Philox::scalar_site, RNG::philoxCalls());
+    fill_random(d.elem(), stream, stream, stream);
+    RNG::philoxAdvance();
+    return;
+  }
+
   Seed seed = RNG::ran_seed;
   Seed skewed_seed = RNG::ran_seed * RNG::ran_mult;
 
@@ -400,6 +497,20 @@ template<class T>
 void 
 random(OLattice<T>& d, const Subset& s)
 {
+  // Counter-based: no seeds to load or store
+  if (RNG::getGenerator() == RNG::Generator::philox)
+  {
+    static CUfunction function;
+
+    if (function == NULL)
+      function = function_random_philox_build( d );
+
+    function_random_philox_exec( function, d, s );
+
+    RNG::philoxAdvance();
+    return;
+  }
+
 
   // Do cross check with CPU
 #if 0
@@ -536,42 +647,23 @@ void random(OLattice<T>& d)
 
 
 //! dest  = gaussian   under a subset
+/*! Both uniforms are made in registers and only d is written. The numbers
+    and the new seed are those of random(r1,s), random(r2,s) followed by
+    the Box-Muller kernel (function_gaussian_build). */
 template<class T>
 void gaussian(OLattice<T>& d, const Subset& s)
 {
-  //assert(!"ni");
-#if 1
-  OLattice<T>  r1, r2;
-
-  random(r1,s);
-  random(r2,s);
+  static CUfunction function[2];
 
-  static CUfunction function;
+  RNG::Generator gen = RNG::getGenerator();
+  CUfunction& func = function[ gen == RNG::Generator::philox ];
 
   // Build the function
-  if (function == NULL)
-    {
-      //QDPIO::cout << __PRETTY_FUNCTION__ << ": does not exist - will build\n";
-      function = function_gaussian_build( d , r1 , r2 );
-      //QDPIO::cout << __PRETTY_FUNCTION__ << ": did not exist - finished building\n";
-    }
-  else
-    {
-      //QDPIO::cout << __PRETTY_FUNCTION__ << ": is already built\n";
-    }
+  if (func == NULL)
+    func = function_gaussian_fused_build( d , gen );
 
   // Execute the function
-  function_gaussian_exec(function, d, r1, r2, s );
-
-#if 0
-  const int *tab = s.siteTable().slice();
-  for(int j=0; j < s.numSiteTable(); ++j) 
-  {
-    int i = tab[j];
-    fill_gaussian(d.elem(i), r1.elem(i), r2.elem(i));
-  }
-#endif
-#endif
+  function_gaussian_fused_exec( func, d, s, gen );
 }
 
 
@@ -18,6 +18,21 @@ struct ShiftPhase2
 {
 };
 
+//! forEach(expr, OffnodeLeaf(), BitOrCombine()) is nonzero if a map of expr needs off-node data
+/*! Only the maps are looked at; nothing is communicated or moved to the device. */
+struct OffnodeLeaf
+{
+};
+
+struct MapTileGroups;
+
+//! Collects the maps a tiled kernel stages, grouped by field (MapTileGroups in qdp_map.h)
+struct TileGroupLeaf
+{
+  MapTileGroups* groups;
+  explicit TileGroupLeaf( MapTileGroups* groups_ ) : groups(groups_) {}
+};
+
 
 
 struct ViewLeaf
@@ -33,8 +48,11 @@ struct ViewLeaf
 struct ParamLeaf
 {
   jit_value    index;
-  ParamLeaf( jit_value index_ ) : index(index_) {}
+  JitTileState* tile;
+  ParamLeaf( jit_value index_ , JitTileState* tile_ = NULL ) : index(index_), tile(tile_) {}
   jit_value getRegIdx() const {return index;}
+  //! Non-null when maps should stage their operand in shared memory
+  JitTileState* getTile() const {return tile;}
 };
 
   // int getParamLattice( int idx_multiplier ) const {
@@ -50,6 +68,17 @@ struct ParamLeaf
 
 
 
+//! Launch arguments of one map in a tiled kernel
+struct TileMapArgs
+{
+  bool  first;    // first map of its group, stages the field
+  void* offsets;  // group's stage table, see MapTile
+  void* sites;
+  int   region;   // byte offset of the group's shared memory
+  void* slots;    // this map's slots
+};
+
+
 struct AddressLeaf
 {
   union Types {
@@ -61,6 +90,18 @@ struct AddressLeaf
   };
 
   mutable std::vector<Types> addr;
+
+  // Tiled kernels: the arguments of each tiled map, in the order they are visited
+  mutable const std::vector<TileMapArgs>* tile_args;
+  mutable int                             tile_map;
+
+  // Global memory traffic per site of the lattice leaves (kernel profile)
+  mutable size_t bytes_per_site;
+
+  AddressLeaf(): tile_args(NULL), tile_map(0), bytes_per_site(0) {}
+
+  void addBytes(size_t n) const { bytes_per_site += n; }
+
   void setAddr(void* p) const {
     //std::cout << "AddressLeaf::setAddr " << p << "\n";
     Types t;
@@ -94,6 +135,30 @@ struct AddressLeaf
 };
 
 
+  //! Bytes per site a leaf of container type C moves, 0 for scalars
+  template<class C>
+  struct LeafSiteBytes
+  {
+    static const size_t value = 0;
+  };
+
+
+  //! Leaves never need off-node data, only maps do
+  template<class LeafType>
+  struct LeafFunctor<LeafType, OffnodeLeaf>
+  {
+    typedef int Type_t;
+    static int apply(const LeafType&, const OffnodeLeaf&) { return 0; }
+  };
+
+  template<class LeafType>
+  struct LeafFunctor<LeafType, TileGroupLeaf>
+  {
+    typedef int Type_t;
+    static int apply(const LeafType&, const TileGroupLeaf&) { return 0; }
+  };
+
+
   template<class LeafType, class LeafTag>
   struct AddOpParam
   { };
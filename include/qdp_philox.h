@@ -0,0 +1,132 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Philox4x32-10 counter-based random numbers
+ *
+ * Philox (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3",
+ * SC11) maps a 128 bit counter and a 64 bit key to 128 random bits with
+ * ten rounds of 32x32->64 bit multiplications. There is no state to carry
+ * from one number to the next, so any number of any stream can be made
+ * directly and in any order.
+ *
+ * The lattice generator (RNG::setGenerator(RNG::Generator::philox), or
+ * -rng philox) uses the counter
+ *
+ *     ( index low , index high , block , call )
+ *
+ * where index is the 64 bit global lexicographic site index, block numbers
+ * the groups of four words within the site and call counts the random()
+ * calls made since the seed was set. The key is the seed and stays fixed,
+ * so every seed is one stream. Nothing depends on the node layout and no
+ * seed lattice is stored.
+ *
+ * The kernel side is jit_philox4x32_10 in qdp_jit.h. Like qdp_map_route.h
+ * this header does not depend on the rest of QDP.
+ */
+
+#ifndef QDP_PHILOX_H
+#define QDP_PHILOX_H
+
+#include <cstdint>
+
+namespace QDP {
+
+  namespace Philox {
+
+    const uint32_t mult0 = 0xD2511F53;
+    const uint32_t mult1 = 0xCD9E8D57;
+    const uint32_t weyl0 = 0x9E3779B9;
+    const uint32_t weyl1 = 0xBB67AE85;
+
+    const int rounds = 10;
+
+    //! Site index of the stream used for OScalar; no lattice site has it
+    const uint64_t scalar_site = ~(uint64_t)0;
+
+
+    //! One round; the key is bumped by the caller
+    inline void round( uint32_t ctr[4] , const uint32_t key[2] )
+    {
+      uint64_t p0 = (uint64_t)mult0 * ctr[0];
+      uint64_t p1 = (uint64_t)mult1 * ctr[2];
+      uint32_t out[4] = { (uint32_t)(p1 >> 32) ^ ctr[1] ^ key[0] , (uint32_t)p1 ,
+			  (uint32_t)(p0 >> 32) ^ ctr[3] ^ key[1] , (uint32_t)p0 };
+      ctr[0] = out[0];
+      ctr[1] = out[1];
+      ctr[2] = out[2];
+      ctr[3] = out[3];
+    }
+
+    //! Replace ctr by the random block of (ctr, key)
+    inline void philox4x32_10( uint32_t ctr[4] , const uint32_t key_in[2] )
+    {
+      uint32_t key[2] = { key_in[0] , key_in[1] };
+      for (int r = 0; r < rounds; ++r)
+      {
+	if (r > 0)
+	{
+	  key[0] += weyl0;
+	  key[1] += weyl1;
+	}
+	round( ctr , key );
+      }
+    }
+
+
+    //! Uniform in (0,1): an odd multiple of 2^-24, exact in single precision
+    inline float uniformFloat( uint32_t x )
+    {
+      return (float)((x >> 8) | 1) * (1.0f / 16777216.0f);
+    }
+
+    //! Uniform in (0,1) from two words: an odd multiple of 2^-53, exact in double precision
+    /*! The 26 high bits of hi and the 27 high bits of lo with the last one
+     *  set make the 53 bit mantissa. */
+    inline double uniformDouble( uint32_t hi , uint32_t lo )
+    {
+      return ((double)(hi >> 6) * 134217728.0 + (double)((lo >> 5) | 1)) * (1.0 / 9007199254740992.0);
+    }
+
+
+    /*! \brief The words of one site, in the order fill_random visits them
+     *
+     * Each call to next() returns the following word; a new block is
+     * made every fourth word. A float takes one word, a double two.
+     */
+    class Stream
+    {
+    public:
+      Stream( const uint32_t key_[2] , uint64_t site_ , uint32_t call_ ) : call(call_), word(0)
+      {
+	key[0] = key_[0];
+	key[1] = key_[1];
+	site[0] = (uint32_t)site_;
+	site[1] = (uint32_t)(site_ >> 32);
+      }
+
+      uint32_t next()
+      {
+	if (word % 4 == 0)
+	{
+	  block[0] = site[0];
+	  block[1] = site[1];
+	  block[2] = word / 4;
+	  block[3] = call;
+	  philox4x32_10( block , key );
+	}
+	return block[word++ % 4];
+      }
+
+    private:
+      uint32_t key[2];
+      uint32_t site[2];
+      uint32_t call;
+      uint32_t word;
+      uint32_t block[4];
+    };
+
+  } // namespace Philox
+
+} // namespace QDP
+
+#endif
@@ -35,6 +35,10 @@ namespace QDP
     void   printPoolInfo();
     size_t getPoolSize();
 
+    //! Bytes handed out (after alignment) and the high-water mark
+    size_t getBytesInUse() const { return bytes_in_use; }
+    size_t getBytesPeak() const { return bytes_peak; }
+
     bool allocate( void** ptr, size_t n_bytes );
 
     void free(const void *mem);
@@ -58,6 +62,8 @@ namespace QDP
     void *             unaligned;
     size_t             poolSize;
     size_t             bytes_allocated;
+    size_t             bytes_in_use;
+    size_t             bytes_peak;
     listEntry_t        listEntry;
     listEntryIter_t    listAllocOrder;
     typename listEntry_t::iterator iterNextNotAllocated;
@@ -105,7 +111,7 @@ namespace QDP
 
 
   template<class Allocator>
-    QDPPoolAllocator<Allocator>::QDPPoolAllocator(): bufferAllocated(false) {
+    QDPPoolAllocator<Allocator>::QDPPoolAllocator(): bufferAllocated(false), bytes_in_use(0), bytes_peak(0) {
       QDP_debug("Pool allocator construct");
       setPoolSize( 50*1024*1024 );
     }
@@ -282,6 +288,9 @@ namespace QDP
 	  listAllocOrder.push_front(candidate);
 	  *ptr = candidate->ptr;
 
+	  bytes_in_use += size;
+	  bytes_peak = std::max( bytes_peak , bytes_in_use );
+
 	  return true;
 
 	} else {
@@ -304,6 +313,9 @@ namespace QDP
 
 	  *ptr = e.ptr;
 
+	  bytes_in_use += size;
+	  bytes_peak = std::max( bytes_peak , bytes_in_use );
+
 	  return true;
 
 	}
@@ -338,6 +350,7 @@ namespace QDP
 
     typename listEntry_t::iterator p = *q;
     p->allocated = false;
+    bytes_in_use -= p->size;
 
     if ( p != listEntry.begin() ) {
       typename listEntry_t::iterator prev = p;
@@ -10,6 +10,7 @@
 
 // Fix Definitions
 #include <qdp_config.h>
+#include "qdp_half.h"
 
 // Fix default precision
 #if ! defined(BASE_PRECISION)
@@ -22,6 +23,10 @@ typedef float     REAL32;
 typedef double    REAL64;
 typedef bool      LOGICAL;
 
+// 16-bit storage words, see qdp_half.h
+typedef QDP::float16   REAL16;
+typedef QDP::bfloat16  BFLOAT16;
+
 // Set the base floating precision
 #if BASE_PRECISION == 32
 // Use single precision for base precision
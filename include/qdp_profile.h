@@ -13,9 +13,9 @@ namespace QDP {
 
 typedef unsigned long  QDPTime_t;
 
-//! Get the wallclock time
+//! Get the time on the monotonic clock
 /*!
-  \return The wallclock time (since Epoch) in seconds.
+  \return Microseconds since an arbitrary start, see getClockNanoseconds
 */
 QDPTime_t getClockTime();
 void initProfile(const std::string& file, const std::string& caller, int line);
@@ -0,0 +1,225 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Host emulation of the CUDA driver API subset used by qdp-jit
+ *
+ * Configured with --enable-ptx-emulator this header takes the place of
+ * cuda.h. Device memory is host memory, modules are parsed from the PTX
+ * the JIT emits and kernels are interpreted on the CPU, thread blocks
+ * spread over a few host threads. Streams are accepted but everything
+ * completes before the call returns, events record the host clock.
+ *
+ * Only the PTX subset generated by lib/qdp_jit.cc (plus min/max/mad/fma)
+ * is understood. The math library calls (func_sin_f32 and friends) are
+ * evaluated with libm instead of interpreting their bodies. Every load
+ * and store is checked against the known allocations, shared memory and
+ * the thread's local frame.
+ *
+ * Like qdp_half.h this header does not depend on the rest of QDP so the
+ * emulator can be tested on its own.
+ */
+
+#ifndef QDP_PTX_EMU_H
+#define QDP_PTX_EMU_H
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+extern "C" {
+
+  // Values as in cuda.h
+  typedef enum cudaError_enum {
+    CUDA_SUCCESS                              = 0,
+    CUDA_ERROR_INVALID_VALUE                  = 1,
+    CUDA_ERROR_OUT_OF_MEMORY                  = 2,
+    CUDA_ERROR_NOT_INITIALIZED                = 3,
+    CUDA_ERROR_DEINITIALIZED                  = 4,
+    CUDA_ERROR_PROFILER_DISABLED              = 5,
+    CUDA_ERROR_PROFILER_NOT_INITIALIZED       = 6,
+    CUDA_ERROR_PROFILER_ALREADY_STARTED       = 7,
+    CUDA_ERROR_PROFILER_ALREADY_STOPPED       = 8,
+    CUDA_ERROR_NO_DEVICE                      = 100,
+    CUDA_ERROR_INVALID_DEVICE                 = 101,
+    CUDA_ERROR_INVALID_IMAGE                  = 200,
+    CUDA_ERROR_INVALID_CONTEXT                = 201,
+    CUDA_ERROR_CONTEXT_ALREADY_CURRENT        = 202,
+    CUDA_ERROR_MAP_FAILED                     = 205,
+    CUDA_ERROR_UNMAP_FAILED                   = 206,
+    CUDA_ERROR_ARRAY_IS_MAPPED                = 207,
+    CUDA_ERROR_ALREADY_MAPPED                 = 208,
+    CUDA_ERROR_NO_BINARY_FOR_GPU              = 209,
+    CUDA_ERROR_ALREADY_ACQUIRED               = 210,
+    CUDA_ERROR_NOT_MAPPED                     = 211,
+    CUDA_ERROR_NOT_MAPPED_AS_ARRAY            = 212,
+    CUDA_ERROR_NOT_MAPPED_AS_POINTER          = 213,
+    CUDA_ERROR_ECC_UNCORRECTABLE              = 214,
+    CUDA_ERROR_UNSUPPORTED_LIMIT              = 215,
+    CUDA_ERROR_CONTEXT_ALREADY_IN_USE         = 216,
+    CUDA_ERROR_INVALID_SOURCE                 = 300,
+    CUDA_ERROR_FILE_NOT_FOUND                 = 301,
+    CUDA_ERROR_SHARED_OBJECT_SYMBOL_NOT_FOUND = 302,
+    CUDA_ERROR_SHARED_OBJECT_INIT_FAILED      = 303,
+    CUDA_ERROR_OPERATING_SYSTEM               = 304,
+    CUDA_ERROR_INVALID_HANDLE                 = 400,
+    CUDA_ERROR_NOT_FOUND                      = 500,
+    CUDA_ERROR_NOT_READY                      = 600,
+    CUDA_ERROR_LAUNCH_OUT_OF_RESOURCES        = 701,
+    CUDA_ERROR_LAUNCH_TIMEOUT                 = 702,
+    CUDA_ERROR_LAUNCH_INCOMPATIBLE_TEXTURING  = 703,
+    CUDA_ERROR_PEER_ACCESS_ALREADY_ENABLED    = 704,
+    CUDA_ERROR_PEER_ACCESS_NOT_ENABLED        = 705,
+    CUDA_ERROR_PRIMARY_CONTEXT_ACTIVE         = 708,
+    CUDA_ERROR_CONTEXT_IS_DESTROYED           = 709,
+    CUDA_ERROR_ASSERT                         = 710,
+    CUDA_ERROR_TOO_MANY_PEERS                 = 711,
+    CUDA_ERROR_HOST_MEMORY_ALREADY_REGISTERED = 712,
+    CUDA_ERROR_HOST_MEMORY_NOT_REGISTERED     = 713,
+    CUDA_ERROR_LAUNCH_FAILED                  = 719,
+    CUDA_ERROR_UNKNOWN                        = 999
+  } CUresult;
+
+  typedef int                  CUdevice;
+  typedef unsigned long long   CUdeviceptr;
+  typedef struct CUctx_st*     CUcontext;
+  typedef struct CUmod_st*     CUmodule;
+  typedef struct CUfunc_st*    CUfunction;
+  typedef struct CUstream_st*  CUstream;
+  typedef struct CUevent_st*   CUevent;
+
+  typedef enum CUdevice_attribute_enum {
+    CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_BLOCK       = 1,
+    CU_DEVICE_ATTRIBUTE_MAX_BLOCK_DIM_X             = 2,
+    CU_DEVICE_ATTRIBUTE_MAX_BLOCK_DIM_Y             = 3,
+    CU_DEVICE_ATTRIBUTE_MAX_BLOCK_DIM_Z             = 4,
+    CU_DEVICE_ATTRIBUTE_MAX_GRID_DIM_X              = 5,
+    CU_DEVICE_ATTRIBUTE_MAX_GRID_DIM_Y              = 6,
+    CU_DEVICE_ATTRIBUTE_MAX_GRID_DIM_Z              = 7,
+    CU_DEVICE_ATTRIBUTE_MAX_SHARED_MEMORY_PER_BLOCK = 8,
+    CU_DEVICE_ATTRIBUTE_WARP_SIZE                   = 10,
+    CU_DEVICE_ATTRIBUTE_GPU_OVERLAP                 = 15,
+    CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT        = 16,
+    CU_DEVICE_ATTRIBUTE_MEMORY_CLOCK_RATE           = 36,
+    CU_DEVICE_ATTRIBUTE_GLOBAL_MEMORY_BUS_WIDTH     = 37,
+    CU_DEVICE_ATTRIBUTE_UNIFIED_ADDRESSING          = 41
+  } CUdevice_attribute;
+
+  typedef enum CUfunction_attribute_enum {
+    CU_FUNC_ATTRIBUTE_MAX_THREADS_PER_BLOCK = 0,
+    CU_FUNC_ATTRIBUTE_SHARED_SIZE_BYTES     = 1,
+    CU_FUNC_ATTRIBUTE_CONST_SIZE_BYTES      = 2,
+    CU_FUNC_ATTRIBUTE_LOCAL_SIZE_BYTES      = 3,
+    CU_FUNC_ATTRIBUTE_NUM_REGS              = 4
+  } CUfunction_attribute;
+
+  typedef enum CUfunc_cache_enum {
+    CU_FUNC_CACHE_PREFER_NONE   = 0,
+    CU_FUNC_CACHE_PREFER_SHARED = 1,
+    CU_FUNC_CACHE_PREFER_L1     = 2,
+    CU_FUNC_CACHE_PREFER_EQUAL  = 3
+  } CUfunc_cache;
+
+  //! JIT options are accepted and ignored
+  typedef enum CUjit_option_enum {
+    CU_JIT_MAX_REGISTERS = 0
+  } CUjit_option;
+
+  typedef enum CUoutput_mode_enum {
+    CU_OUT_KEY_VALUE_PAIR = 0,
+    CU_OUT_CSV            = 1
+  } CUoutput_mode;
+
+#define CU_CTX_MAP_HOST        0x08
+#define CU_EVENT_BLOCKING_SYNC 0x01
+
+  CUresult cuInit( unsigned int flags );
+  CUresult cuDeviceGetCount( int* count );
+  CUresult cuDeviceGet( CUdevice* device , int ordinal );
+  CUresult cuDeviceGetAttribute( int* pi , CUdevice_attribute attrib , CUdevice dev );
+  CUresult cuDeviceComputeCapability( int* major , int* minor , CUdevice dev );
+
+  CUresult cuCtxCreate( CUcontext* pctx , unsigned int flags , CUdevice dev );
+  CUresult cuCtxSetCurrent( CUcontext ctx );
+  CUresult cuCtxSetCacheConfig( CUfunc_cache config );
+  CUresult cuCtxSynchronize( void );
+
+  CUresult cuModuleLoadDataEx( CUmodule* module , const void* image , unsigned int numOptions ,
+			       CUjit_option* options , void** optionValues );
+  CUresult cuModuleGetFunction( CUfunction* hfunc , CUmodule hmod , const char* name );
+  CUresult cuFuncGetAttribute( int* pi , CUfunction_attribute attrib , CUfunction hfunc );
+  CUresult cuLaunchKernel( CUfunction f ,
+			   unsigned int gridDimX , unsigned int gridDimY , unsigned int gridDimZ ,
+			   unsigned int blockDimX , unsigned int blockDimY , unsigned int blockDimZ ,
+			   unsigned int sharedMemBytes , CUstream hStream ,
+			   void** kernelParams , void** extra );
+
+  CUresult cuMemGetInfo( size_t* free , size_t* total );
+  CUresult cuMemAlloc( CUdeviceptr* dptr , size_t bytesize );
+  CUresult cuMemFree( CUdeviceptr dptr );
+  CUresult cuMemHostAlloc( void** pp , size_t bytesize , unsigned int flags );
+  CUresult cuMemFreeHost( void* p );
+  CUresult cuMemHostRegister( void* p , size_t bytesize , unsigned int flags );
+  CUresult cuMemHostUnregister( void* p );
+
+  CUresult cuMemcpy( CUdeviceptr dst , CUdeviceptr src , size_t bytes );
+  CUresult cuMemcpyAsync( CUdeviceptr dst , CUdeviceptr src , size_t bytes , CUstream hStream );
+  CUresult cuMemcpyHtoD( CUdeviceptr dst , const void* src , size_t bytes );
+  CUresult cuMemcpyDtoH( void* dst , CUdeviceptr src , size_t bytes );
+  CUresult cuMemcpyHtoDAsync( CUdeviceptr dst , const void* src , size_t bytes , CUstream hStream );
+  CUresult cuMemcpyDtoHAsync( void* dst , CUdeviceptr src , size_t bytes , CUstream hStream );
+
+  CUresult cuStreamCreate( CUstream* phStream , unsigned int flags );
+  CUresult cuStreamSynchronize( CUstream hStream );
+  CUresult cuStreamWaitEvent( CUstream hStream , CUevent hEvent , unsigned int flags );
+  CUresult cuEventCreate( CUevent* phEvent , unsigned int flags );
+  CUresult cuEventRecord( CUevent hEvent , CUstream hStream );
+  CUresult cuEventSynchronize( CUevent hEvent );
+  CUresult cuEventElapsedTime( float* pMilliseconds , CUevent hStart , CUevent hEnd );
+
+  CUresult cuProfilerInitialize( const char* configFile , const char* outputFile , CUoutput_mode outputMode );
+  CUresult cuProfilerStart( void );
+  CUresult cuProfilerStop( void );
+
+}
+
+
+namespace QDP {
+
+  //! Dynamic counts of one kernel, summed over all its launches
+  struct PTXEmuCounters {
+    unsigned long long launches;
+    unsigned long long threads;
+    unsigned long long instructions;   // issued, including predicated off
+    unsigned long long flops;          // f32/f64 arithmetic, fma counts 2
+    unsigned long long bytes_loaded;   // global and generic
+    unsigned long long bytes_stored;
+    unsigned long long shared_loaded;
+    unsigned long long shared_stored;
+  };
+
+  //! Collect PTXEmuCounters (-emucount on|off). Off by default, costs a few percent
+  void ptxEmuSetCounting( bool on );
+  bool ptxEmuGetCounting();
+
+  //! Host threads used per launch (-emuthreads N), 0 means one per core.
+  //! The launches run on the pool of qdp_host_threads.h, this sets its size
+  void ptxEmuSetThreads( int n );
+  int  ptxEmuGetThreads();
+
+  //! Device memory reported by cuMemGetInfo, default 1 GiB
+  void ptxEmuSetMemory( size_t bytes );
+
+  //! Counters of one kernel, false if f was never loaded
+  bool ptxEmuGetCounters( CUfunction f , PTXEmuCounters& c );
+  void ptxEmuResetCounters();
+
+  //! One line per launched kernel (in load order) and the totals
+  void ptxEmuPrintCounters( std::ostream& os );
+
+  //! Description of the last parse or launch failure
+  std::string ptxEmuLastError();
+
+} // namespace QDP
+
+#endif
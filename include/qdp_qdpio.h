@@ -11,6 +11,7 @@
 #include <sstream>
 #include "qdp_defs.h"
 #include <cstring>
+#include <type_traits>
 
 using namespace std;
 
@@ -711,6 +712,78 @@ namespace QDP
   }
 
 
+  //! Convert records of the file precision into the destination precision
+  /*!
+    QIO hands over the data already in host byte order, so only the words
+    need converting. T and TF are the same type up to the word type.
+
+    \param dest The destination records
+    \param src The source records
+    \param count The number of records
+  */
+  template<class T, class TF>
+  inline void QDPFactoryConvert(T* dest, const char* src, size_t count)
+  {
+    if (std::is_same<T,TF>::value)
+    {
+      memcpy((void*)dest,(const void*)src,count*sizeof(T));
+      return;
+    }
+
+    typedef typename WordType<T>::Type_t  W;
+    typedef typename WordType<TF>::Type_t WF;
+    static_assert(sizeof(T)/sizeof(W) == sizeof(TF)/sizeof(WF), "QDPFactoryConvert: types differ in more than precision");
+
+    const size_t nw = count * (sizeof(T)/sizeof(W));
+    W* d = (W*)dest;
+    const WF* f = (const WF*)src;
+    for(size_t i=0; i < nw; ++i)
+      d[i] = static_cast<W>(f[i]);
+  }
+
+
+  //! Function for moving data with a precision change
+  /*!
+    Like QDPOScalarFactoryPut, but the source buffer holds records of type TF
+    which are converted while they are copied.
+
+    \param buf The source buffer
+    \param linear The offset
+    \param count The number of data to move
+    \param arg The destination buffer.
+  */
+  template<class T, class TF> void QDPOScalarFactoryPutConvert(char *buf, size_t linear, int count, void *arg) 
+  {
+    /* Translate arg */
+    T *field = (T *)arg;
+
+    QDPFactoryConvert<T,TF>(field+linear, buf, count);
+  }
+
+
+  //! Function for moving array data with a precision change
+  /*!
+    The whole array is one record of TF data. The destination is taken
+    to be in multi1d< OScalar<T> > form.
+
+    \param buf The source buffer
+    \param linear Ignored
+    \param count Ignored
+    \param arg The destination buffer.
+  */
+  template<class T, class TF> void QDPOScalarFactoryPutArrayConvert(char *buf, size_t linear, int count, void *arg) 
+  {
+    /* Translate arg */
+    multi1d< OScalar<T> >& field = *(multi1d< OScalar<T> > *)arg;
+
+    for(int i=0; i < field.size(); ++i)
+    {
+      QDPFactoryConvert<T,TF>(&(field[i].elem()), buf, 1);
+      buf += sizeof(TF);
+    }
+  }
+
+
   //! Reads an OScalar object
   /*!
     This implementation is only correct for scalar ILattice
@@ -738,38 +811,33 @@ namespace QDP
     case 'F' :
     {
       QDPIO::cout << "Single Precision Read" << endl;
-      OScalar< typename SinglePrecType<T>::Type_t > from_disk;
       status = QIO_read_record_data(qio_in,
-				    &(QDPOScalarFactoryPut<typename SinglePrecType<T>::Type_t> ),
+				    &(QDPOScalarFactoryPutConvert<T, typename SinglePrecType<T>::Type_t> ),
 				    sizeof(typename SinglePrecType<T>::Type_t),
 				    sizeof(typename WordType< typename SinglePrecType<T>::Type_t >::Type_t),
-				    (void *)(&(from_disk.elem())));
+				    (void *)(&(s1.elem())));
       if (status != QIO_SUCCESS) { 
 	QDPIO::cerr << "Failed to read data" << endl;
 	clear(QDPIO_badbit);
 	QDP_abort(1);
       }
       QDPIO::cout << "QIO_read_finished" << endl;
-      s1 = from_disk;
     }
     break;
     case 'D' :
     {
       QDPIO::cout << "Reading Double Precision" << endl;
-      OScalar< typename DoublePrecType<T>::Type_t > from_disk;
       status = QIO_read_record_data(qio_in,
-				    &(QDPOScalarFactoryPut< typename DoublePrecType<T>::Type_t > ),
+				    &(QDPOScalarFactoryPutConvert<T, typename DoublePrecType<T>::Type_t> ),
 				    sizeof(typename DoublePrecType<T>::Type_t),
 				    sizeof(typename WordType< typename DoublePrecType<T>::Type_t >::Type_t),
-				    (void *)(&(from_disk.elem())));
+				    (void *)(&(s1.elem())));
       if (status != QIO_SUCCESS) { 
 	QDPIO::cerr << "Failed to read data" << endl;
 	clear(QDPIO_badbit);
 	QDP_abort(1);
       }
       QDPIO::cout << "QIO_read_finished" << endl;
-      
-      s1 = from_disk;
     }
     break;
     default:
@@ -829,56 +897,43 @@ namespace QDP
     case 'F' :
     {
       QDPIO::cout << "Single Precision Read" << endl;
-      multi1d< OScalar< typename SinglePrecType<T>::Type_t > > from_disk(s1.size());
       status = QIO_read_record_data(qio_in,
-				    &(QDPOScalarFactoryPut<typename SinglePrecType<T>::Type_t> ),
+				    &(QDPOScalarFactoryPutArrayConvert<T, typename SinglePrecType<T>::Type_t> ),
 				    s1.size()*sizeof(typename SinglePrecType<T>::Type_t),
 				    sizeof(typename WordType< typename SinglePrecType<T>::Type_t >::Type_t),
-				    (void *)from_disk.slice());
+				    (void *)&s1);
       if (status != QIO_SUCCESS) { 
 	QDPIO::cerr << "Failed to read data" << endl;
 	clear(QDPIO_badbit);
 	QDP_abort(1);
       }
       QDPIO::cout << "QIO_read_finished" << endl;
-      
-      // Cast appropriately
-      for(int i=0; i < from_disk.size(); i++) { 
-	s1[i] = from_disk[i];
-      }
-      
     }
     break;
     case 'D' :
     {
       QDPIO::cout << "Reading Double Precision" << endl;
-      multi1d< typename DoublePrecType< OScalar<T> >::Type_t > from_disk(s1.size());
       status = QIO_read_record_data(qio_in,
-				    &(QDPOScalarFactoryPut< typename DoublePrecType<T>::Type_t > ),
+				    &(QDPOScalarFactoryPutArrayConvert<T, typename DoublePrecType<T>::Type_t> ),
 				    s1.size()*sizeof(typename DoublePrecType<T>::Type_t),
 				    sizeof(typename WordType< typename DoublePrecType<T>::Type_t >::Type_t),
-				    (void *)from_disk.slice());
+				    (void *)&s1);
       if (status != QIO_SUCCESS) { 
 	QDPIO::cerr << "Failed to read data" << endl;
 	clear(QDPIO_badbit);
 	QDP_abort(1);
       }
       QDPIO::cout << "QIO_read_finished" << endl;
-      
-      // Cast appropriately
-      for(int i=0; i < from_disk.size(); i++) { 
-	s1[i] = from_disk[i];
-      }
     }
     break;
     default:
     {
       QDPIO::cout << "Reading I or U Precision" << endl;
       status = QIO_read_record_data(qio_in,
-				    &(QDPOScalarFactoryPut<T> ),
+				    &(QDPOScalarFactoryPutArrayConvert<T,T> ),
 				    s1.size()*sizeof(T),
 				    sizeof(typename WordType<T>::Type_t),
-				    (void *)s1.slice());
+				    (void *)&s1);
       if (status != QIO_SUCCESS) { 
 	QDPIO::cerr << "Failed to read data" << endl;
 	clear(QDPIO_badbit);
@@ -1084,6 +1139,47 @@ namespace QDP
   }
 
 
+  //! Function for moving data with a precision change
+  /*!
+    Like QDPOLatticeFactoryPut, but the source buffer holds sites of type TF
+    which are converted straight into the host buffer of the field.
+
+    \param buf The source buffer
+    \param linear The destination buffer offset
+    \param count The number of data to move
+    \param arg The destination buffer.
+  */
+  template<class T, class TF> void QDPOLatticeFactoryPutConvert(char *buf, size_t linear, int count, void *arg)
+  {
+    /* Translate arg */
+    T *field = (T *)arg;
+
+    QDPFactoryConvert<T,TF>(field+linear, buf, count);
+  }
+
+  //! Function for moving array data with a precision change
+  /*!
+    Like QDPOLatticeFactoryPutArray, but the source buffer holds sites of
+    type TF.
+
+    \param buf The source buffer
+    \param linear The destination buffer offset
+    \param count Ignored
+    \param arg The destination buffer.
+  */
+  template<class T, class TF> void QDPOLatticeFactoryPutArrayConvert(char *buf, size_t linear, int count, void *arg)
+  {
+    /* Translate arg */
+    multi1d< OLattice<T> >& field = *(multi1d< OLattice<T> > *)arg;
+
+    for(int i=0; i < field.size(); ++i)
+    {
+      QDPFactoryConvert<T,TF>(&(field[i].elem(linear)), buf, 1);
+      buf += sizeof(TF);
+    }
+  }
+
+
   //! Reads an OLattice object
   /*!
     This implementation is only correct for scalar ILattice.
@@ -1110,15 +1206,13 @@ namespace QDP
     case 'F' :
     {
       QDPIO::cout << "Single Precision Read" << endl;
-      OLattice< typename SinglePrecType<T>::Type_t > from_disk;
-      zero_rep(from_disk);
 
       
       status = QIO_read_record_data(qio_in,
-				    &(QDPOLatticeFactoryPut<typename SinglePrecType<T>::Type_t> ),
+				    &(QDPOLatticeFactoryPutConvert<T, typename SinglePrecType<T>::Type_t> ),
 				    sizeof(typename SinglePrecType<T>::Type_t),
 				    sizeof(typename WordType< typename SinglePrecType<T>::Type_t >::Type_t),
-				    (void *)from_disk.getF());
+				    (void *)s1.getF());
       
       if (status != QIO_SUCCESS) { 
 	QDPIO::cerr << "Failed to read data" << endl;
@@ -1126,21 +1220,18 @@ namespace QDP
 	QDP_abort(1);
       }
       QDPIO::cout << "QIO_read_finished" << endl;
-      s1 = from_disk; // Cast
     }
     break;
     case 'D' :
     {
       QDPIO::cout << "Reading Double Precision" << endl;
-      OLattice< typename DoublePrecType<T>::Type_t > from_disk;
-      zero_rep(from_disk);
 
       /* Disagnostics */
       status = QIO_read_record_data(qio_in,
-				    &(QDPOLatticeFactoryPut< typename DoublePrecType<T>::Type_t>),
+				    &(QDPOLatticeFactoryPutConvert<T, typename DoublePrecType<T>::Type_t> ),
 				    sizeof(typename DoublePrecType<T>::Type_t),
 				    sizeof(typename WordType< typename DoublePrecType<T>::Type_t >::Type_t),
-				    (void *)from_disk.getF());
+				    (void *)s1.getF());
       
       if (status != QIO_SUCCESS) { 
 	QDPIO::cerr << "Failed to read data" << endl;
@@ -1148,10 +1239,6 @@ namespace QDP
 	QDP_abort(1);
       }
       QDPIO::cout << "QIO_read_finished" << endl;
-      
-      // Cast appropriately
-      s1= from_disk;
-	
     }
     break;
     default:
@@ -1210,50 +1297,33 @@ namespace QDP
     case 'F' :
     {
       QDPIO::cout << "Single Precision Read" << endl;
-      multi1d< OLattice< typename SinglePrecType<T>::Type_t > > from_disk(s1.size());
-      for(int i=0; i < s1.size(); i++) { zero_rep(from_disk[i]); }
-
       status = QIO_read_record_data(qio_in,
-				    &(QDPOLatticeFactoryPutArray<typename SinglePrecType<T>::Type_t> ),
+				    &(QDPOLatticeFactoryPutArrayConvert<T, typename SinglePrecType<T>::Type_t> ),
 				    s1.size()*sizeof(typename SinglePrecType<T>::Type_t),
 				    sizeof(typename WordType< typename SinglePrecType<T>::Type_t >::Type_t),
-				    (void *)&from_disk);
+				    (void *)&s1);
       if (status != QIO_SUCCESS) { 
 	QDPIO::cerr << "Failed to read data" << endl;
 	clear(QDPIO_badbit);
 	QDP_abort(1);
       }
       QDPIO::cout << "QIO_read_finished" << endl;
-      
-      // Cast appropriately
-      for(int i=0; i < from_disk.size(); i++) { 
-	s1[i] = from_disk[i];
-      }
-      
     }
     break;
     case 'D' :
     {
       QDPIO::cout << "Reading Double Precision" << endl;
-      multi1d< typename DoublePrecType< OLattice<T> >::Type_t > from_disk(s1.size());
-      for(int i=0; i < s1.size(); i++) { zero_rep(from_disk[i]); }
-
       status = QIO_read_record_data(qio_in,
-				    &(QDPOLatticeFactoryPutArray< typename DoublePrecType<T>::Type_t > ),
+				    &(QDPOLatticeFactoryPutArrayConvert<T, typename DoublePrecType<T>::Type_t> ),
 				    s1.size()*sizeof(typename DoublePrecType<T>::Type_t),
 				    sizeof(typename WordType< typename DoublePrecType<T>::Type_t >::Type_t),
-				    (void *)&from_disk);
+				    (void *)&s1);
       if (status != QIO_SUCCESS) { 
 	QDPIO::cerr << "Failed to read data" << endl;
 	clear(QDPIO_badbit);
 	QDP_abort(1);
       }
       QDPIO::cout << "QIO_read_finished" << endl;
-      
-      // Cast appropriately
-      for(int i=0; i < from_disk.size(); i++) { 
-	s1[i] = from_disk[i];
-      }
     }
     break;
     default:
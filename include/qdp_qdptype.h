@@ -499,6 +499,7 @@ struct LeafFunctor<QDPType<T,C>, AddressLeaf>
   {
     //p.setAddr( s.getFdev() );
     p.setAddr( QDPCache::Instance().getDevicePtr( s.getId() ) );
+    p.addBytes( LeafSiteBytes<C>::value );
     return 0;
   }
 };
@@ -20,8 +20,10 @@ namespace QDP {
     typedef C Container_t;
 
 
+    //! sites_ is the stride of the coalesced layout, 0 for Layout::sitesOnNode()
     QDPTypeJIT( jit_value base_ ,
-		jit_value index_ ): base_m(base_), index_m(index_) {
+		jit_value index_ ,
+		int sites_ = 0 ): base_m(base_), index_m(index_), sites_m(sites_) {
       //std::cout << "QDPTypeJIT 3er ctor\n";
     }
 
@@ -32,7 +34,7 @@ namespace QDP {
     //   assert(base_m);
     // }
 
-    QDPTypeJIT(const QDPTypeJIT& a) : base_m(a.base_m), index_m(a.index_m) { }
+    QDPTypeJIT(const QDPTypeJIT& a) : base_m(a.base_m), index_m(a.index_m), sites_m(a.sites_m) { }
 
     ~QDPTypeJIT(){}
 
@@ -53,7 +55,7 @@ namespace QDP {
 
     jit_value getInnerSites( JitDeviceLayout lay) const {
       if ( lay == JitDeviceLayout::Coalesced )
-	return jit_value(Layout::sitesOnNode());
+	return jit_value( sites_m > 0 ? sites_m : Layout::sitesOnNode() );
       else 
 	return jit_value(1);
     }
@@ -84,6 +86,7 @@ namespace QDP {
   private:
     jit_value    base_m;
     jit_value    index_m;
+    int          sites_m;
     mutable T F;
 
 
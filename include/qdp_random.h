@@ -57,6 +57,63 @@ namespace RNG
 
   //! Internal seed multiplier
   void sranf(float* d, int N, Seed& seed, ILatticeSeed&, const Seed&);
+
+
+  //! Generators of random() on lattice fields
+  /*!
+   * lcg is the linear congruential generator above, philox the
+   * counter-based Philox4x32-10 of qdp_philox.h. Philox needs neither the
+   * lattice of multipliers nor its initialization, and gives the same
+   * field for any node layout.
+   */
+  enum class Generator { lcg, philox };
+
+  //! Select the generator (-rng lcg|philox); lcg is the default
+  void setGenerator(Generator g);
+  Generator getGenerator();
+
+  //! "lcg" or "philox"; false for anything else
+  bool parseGenerator(const std::string& name, Generator& g);
+
+  //! Philox key of the current global seed, fixed until the next setrn
+  void philoxKey(uint32_t key[2]);
+
+  //! Count one Philox call
+  void philoxAdvance();
+
+  //! Philox calls since the last setrn, the counter word of the next call
+  /*! Below 2^32. savern only returns the seed, i.e. the key. To resume a Philox
+      stream later save this count too and restore it after setrn, which
+      starts the stream of the seed from its first call. */
+  uint64_t philoxCalls();
+  void setPhiloxCalls(uint64_t n);
+
+  //! Low (half=0) or high (half=1) 32 bits of the global lexicographic index of every site
+  /*! Built on the first use. */
+  const LatticeInteger& latticeGlobalIndex(int half);
+}
+
+
+namespace Philox
+{
+  //! dest  = random, counter-based
+  /*! The stream is passed as seed, skewed seed and multiplier, so that
+      fill_random of every type visits the words in the same order as the
+      kernel. Found by argument dependent lookup. */
+  inline void
+  fill_random(float& d, Stream& s, Stream&, const Stream&)
+  {
+    d = uniformFloat(s.next());
+  }
+
+  //! dest  = random, counter-based, from two words
+  inline void
+  fill_random(double& d, Stream& s, Stream&, const Stream&)
+  {
+    uint32_t hi = s.next();
+    uint32_t lo = s.next();
+    d = uniformDouble(hi, lo);
+  }
 }
 
 //! dest  = random
@@ -0,0 +1,30 @@
+// -*- C++ -*-
+
+/*! @file
+ * @brief Intel AVX2/AVX-512 optimizations
+ *
+ * AVX optimizations of basic operations. The kernels pick the widest
+ * instruction set the CPU supports at run time (see
+ * scalarsite_avx/avx_dispatch.h), so one build runs on every x86-64 host.
+ *
+ * The double precision hooks are those of the SSE build, whose entry
+ * points the AVX build implements. Single precision uses the generic
+ * hooks; the gamma_5 hooks call the AVX kernels in either precision.
+ */
+
+#ifndef QDP_SCALARSITE_AVX_H
+#define QDP_SCALARSITE_AVX_H
+
+#include "scalarsite_avx/avx_dispatch.h"
+
+#if BASE_PRECISION == 32
+#include "scalarsite_generic/qdp_scalarsite_generic_linalg.h"
+#include "scalarsite_generic/qdp_scalarsite_generic_blas.h"
+#endif
+#include "scalarsite_sse/qdp_scalarsite_sse_blas_double.h"
+#include "scalarsite_sse/qdp_scalarsite_sse_linalg_double.h"
+#include "scalarsite_avx/qdp_scalarsite_avx_linalg_double.h"
+#include "scalarsite_generic/qdp_scalarsite_generic_cblas.h"
+#include "scalarsite_generic/qdp_scalarsite_generic_blas_g5.h"
+
+#endif  // guard
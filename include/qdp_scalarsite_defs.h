@@ -378,6 +378,27 @@ typedef OScalar< PScalar< PColorVector< RComplex<Word<REAL64> >, 1> > > ColorVec
 typedef OScalar< PScalar< PScalar< RComplex<Word<REAL64> > > > > ComplexD;
 typedef OScalar< PScalar< PScalar< RScalar<Word<REAL64> > > > > RealD;
 
+// Word<REAL16>/Word<BFLOAT16>  storage types (arithmetic is done in REAL32)
+typedef OLattice< PSpinVector< PColorVector< RComplex<Word<REAL16> >, Nc>, Ns> > LatticeFermionH;
+typedef OLattice< PSpinVector< PColorVector< RComplex<Word<REAL16> >, Nc>, (Ns>>1) > > LatticeHalfFermionH;
+typedef OLattice< PScalar< PColorMatrix< RComplex<Word<REAL16> >, Nc> > > LatticeColorMatrixH;
+typedef OLattice< PScalar< PColorVector< RComplex<Word<REAL16> >, Nc> > > LatticeColorVectorH;
+typedef OLattice< PScalar< PScalar< RComplex<Word<REAL16> > > > > LatticeComplexH;
+typedef OLattice< PScalar< PScalar< RScalar<Word<REAL16> > > > > LatticeRealH;
+
+typedef OLattice< PSpinVector< PColorVector< RComplex<Word<BFLOAT16> >, Nc>, Ns> > LatticeFermionBF;
+typedef OLattice< PScalar< PColorMatrix< RComplex<Word<BFLOAT16> >, Nc> > > LatticeColorMatrixBF;
+typedef OLattice< PScalar< PColorVector< RComplex<Word<BFLOAT16> >, Nc> > > LatticeColorVectorBF;
+typedef OLattice< PScalar< PScalar< RScalar<Word<BFLOAT16> > > > > LatticeRealBF;
+
+// Compressed gauge fields (12 or 8 reals per site), see qdp_outercompressed.h
+typedef OLatticeCompressed< PScalar< PColorMatrix< RComplex<Word<REAL> >, 3> >, 12 > LatticeColorMatrixRecon12;
+typedef OLatticeCompressed< PScalar< PColorMatrix< RComplex<Word<REAL> >, 3> >, 8 >  LatticeColorMatrixRecon8;
+typedef OLatticeCompressed< PScalar< PColorMatrix< RComplex<Word<REAL32> >, 3> >, 12 > LatticeColorMatrixRecon12F;
+typedef OLatticeCompressed< PScalar< PColorMatrix< RComplex<Word<REAL32> >, 3> >, 8 >  LatticeColorMatrixRecon8F;
+typedef OLatticeCompressed< PScalar< PColorMatrix< RComplex<Word<REAL64> >, 3> >, 12 > LatticeColorMatrixRecon12D;
+typedef OLatticeCompressed< PScalar< PColorMatrix< RComplex<Word<REAL64> >, 3> >, 8 >  LatticeColorMatrixRecon8D;
+
 // Equivalent names
 typedef Integer  Int;
 
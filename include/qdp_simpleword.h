@@ -766,6 +766,72 @@ struct TrinaryReturn<float, float, float, FnColorContract> {
   typedef float Type_t;
 };
 
+
+//-----------------------------------------------------------------------------
+// 16-bit storage words: arithmetic is done in single precision
+//-----------------------------------------------------------------------------
+
+template<> struct Promote<float16, float16>   { typedef float  Type_t; };
+template<> struct Promote<bfloat16, bfloat16> { typedef float  Type_t; };
+template<> struct Promote<float16, bfloat16>  { typedef float  Type_t; };
+template<> struct Promote<bfloat16, float16>  { typedef float  Type_t; };
+template<> struct Promote<float16, float>     { typedef float  Type_t; };
+template<> struct Promote<float, float16>     { typedef float  Type_t; };
+template<> struct Promote<bfloat16, float>    { typedef float  Type_t; };
+template<> struct Promote<float, bfloat16>    { typedef float  Type_t; };
+template<> struct Promote<float16, double>    { typedef double Type_t; };
+template<> struct Promote<double, float16>    { typedef double Type_t; };
+template<> struct Promote<bfloat16, double>   { typedef double Type_t; };
+template<> struct Promote<double, bfloat16>   { typedef double Type_t; };
+
+template<> struct UnaryReturn<float16, FnSum>          { typedef DOUBLE_TYPE  Type_t; };
+template<> struct UnaryReturn<float16, FnSumMulti>     { typedef DOUBLE_TYPE  Type_t; };
+template<> struct UnaryReturn<float16, FnNorm2>        { typedef DOUBLE_TYPE  Type_t; };
+template<> struct UnaryReturn<float16, FnLocalNorm2>   { typedef DOUBLE_TYPE  Type_t; };
+template<> struct UnaryReturn<float16, FnGlobalMax>    { typedef float  Type_t; };
+template<> struct UnaryReturn<float16, FnGlobalMin>    { typedef float  Type_t; };
+template<> struct BinaryReturn<float16, float16, FnInnerProduct>      { typedef DOUBLE_TYPE  Type_t; };
+template<> struct BinaryReturn<float16, float16, FnLocalInnerProduct> { typedef DOUBLE_TYPE  Type_t; };
+
+template<> struct UnaryReturn<bfloat16, FnSum>         { typedef DOUBLE_TYPE  Type_t; };
+template<> struct UnaryReturn<bfloat16, FnSumMulti>    { typedef DOUBLE_TYPE  Type_t; };
+template<> struct UnaryReturn<bfloat16, FnNorm2>       { typedef DOUBLE_TYPE  Type_t; };
+template<> struct UnaryReturn<bfloat16, FnLocalNorm2>  { typedef DOUBLE_TYPE  Type_t; };
+template<> struct UnaryReturn<bfloat16, FnGlobalMax>   { typedef float  Type_t; };
+template<> struct UnaryReturn<bfloat16, FnGlobalMin>   { typedef float  Type_t; };
+template<> struct BinaryReturn<bfloat16, bfloat16, FnInnerProduct>      { typedef DOUBLE_TYPE  Type_t; };
+template<> struct BinaryReturn<bfloat16, bfloat16, FnLocalInnerProduct> { typedef DOUBLE_TYPE  Type_t; };
+
+//! dest = 0
+inline
+void zero_rep(float16& dest) 
+{
+  dest.bits = 0;
+}
+
+//! dest = 0
+inline
+void zero_rep(bfloat16& dest) 
+{
+  dest.bits = 0;
+}
+
+//! d = (mask) ? s1 : d;
+inline
+void copymask(float16& d, bool mask, float16 s1) 
+{
+  if (mask)
+    d = s1;
+}
+
+//! d = (mask) ? s1 : d;
+inline
+void copymask(bfloat16& d, bool mask, bfloat16 s1) 
+{
+  if (mask)
+    d = s1;
+}
+
 } // namespace QDP
 
 #endif
@@ -0,0 +1,81 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Slab allocator for small host objects
+ *
+ * OScalar host storage is tiny (a Complex is 8 bytes, a DColorMatrix
+ * 144) and short lived. Objects up to maxSize() bytes are served from
+ * per size-class freelists carved out of pinned chunks instead of the
+ * first-fit pool, which keeps allocate and free O(1) and leaves the pool
+ * to the large buffers.
+ */
+
+#ifndef QDP_SLAB_ALLOCATOR
+#define QDP_SLAB_ALLOCATOR
+
+#include <vector>
+
+namespace QDP
+{
+
+  class QDPSlabAllocator {
+  public:
+    enum { MIN_SHIFT   = 4 };            // smallest class 16 bytes
+    enum { NUM_CLASSES = 6 };            // 16 ... 512 bytes
+    enum { CHUNK_SIZE  = 256 * 1024 };
+
+    static QDPSlabAllocator& Instance();
+
+    //! Largest object size handled by the slab allocator
+    static size_t maxSize() { return (size_t)1 << (MIN_SHIFT + NUM_CLASSES - 1); }
+
+    //! Objects are only served while enabled (-slab on|off), frees always work
+    void setEnabled(bool e) { enabled = e; }
+    bool isEnabled() const { return enabled; }
+
+    bool allocate( void** ptr , size_t n_bytes );
+    void free( void* ptr , size_t n_bytes );
+
+    //! Pin all chunks with the driver, and chunks allocated later right away
+    void registerMemory();
+    void unregisterMemory();
+
+    //! Counters of one size class
+    struct ClassInfo {
+      size_t size;
+      size_t live;     // objects currently allocated
+      size_t peak;     // maximum of live
+      size_t total;    // allocations since start
+      size_t chunks;   // chunks carved into this class
+    };
+
+    ClassInfo getClassInfo( int cls ) const;
+    void      printInfo() const;
+
+  private:
+    QDPSlabAllocator();
+    ~QDPSlabAllocator();
+
+    QDPSlabAllocator(const QDPSlabAllocator&);                 // Prevent copy-construction
+    QDPSlabAllocator& operator=(const QDPSlabAllocator&);
+
+    static int sizeClass( size_t n_bytes );
+    void       newChunk( int cls );
+
+    struct FreeObj { FreeObj* next; };
+
+    struct Chunk {
+      void* unaligned;
+      void* ptr;
+    };
+
+    FreeObj*           freelist[NUM_CLASSES];
+    ClassInfo          info[NUM_CLASSES];
+    std::vector<Chunk> chunks;
+    bool               enabled;
+    bool               registered;
+  };
+
+} // namespace QDP
+
+#endif
@@ -2,16 +2,26 @@
 /*! @file
  * @brief Timer support
  *
- * A stopwatch like timer.
+ * A stopwatch like timer on the monotonic clock.
  */
 
 #ifndef QDP_STOPWATCH_H
 #define QDP_STOPWATCH_H
 
 #include<sys/time.h>
+#include<time.h>
+#include<stdint.h>
 
 namespace QDP {
 
+//! Monotonic clock in nanoseconds, unaffected by changes to the wall clock
+inline uint64_t getClockNanoseconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
 /*! @defgroup timer Timer
  *
  * @ingroup qdp
@@ -36,6 +46,9 @@ public:
   //! Stop the timer
   void stop();
 
+  //! Get time in nanoseconds
+  uint64_t getTimeInNanoseconds();
+
   //! Get time in microseconds
   double getTimeInMicroseconds();
 
@@ -43,13 +56,11 @@ public:
   double getTimeInSeconds();
 
 private:
-  long sec;
-  long usec;
   bool startedP;
   bool stoppedP;
 
-  struct timeval t_start;
-  struct timeval t_end;
+  uint64_t t_start;
+  uint64_t t_end;
 };
 
 } // namespace QDP  
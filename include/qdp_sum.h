@@ -22,7 +22,7 @@ namespace QDP {
 	//std::cout << __PRETTY_FUNCTION__ << ": is already built\n";
       }
 
-    function_sum_exec(function, size, threads, blocks, shared_mem_usage, (void*)d_idata, (void*)d_odata );
+    function_sum_exec(function, size, threads, blocks, shared_mem_usage, (void*)d_idata, (void*)d_odata, sizeof(T2), sizeof(T2) );
   }
 
 
@@ -53,7 +53,7 @@ namespace QDP {
 
     // Execute the function
     function_sum_ind_exec(function, size, threads, blocks, shared_mem_usage, 
-			  (void*)d_idata, (void*)d_odata, (void*)siteTable );
+			  (void*)d_idata, (void*)d_odata, (void*)siteTable, sizeof(T1), sizeof(T2) );
   }
 
 
@@ -173,7 +173,7 @@ namespace QDP {
 	//std::cout << __PRETTY_FUNCTION__ << ": is already built\n";
       }
 
-    function_global_max_exec(function, size, threads, blocks, shared_mem_usage, (void*)d_idata, (void*)d_odata );
+    function_global_max_exec(function, size, threads, blocks, shared_mem_usage, (void*)d_idata, (void*)d_odata, sizeof(T) );
   }
 
 
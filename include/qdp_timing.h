@@ -0,0 +1,109 @@
+// -*- C++ -*-
+/*! @file
+ * @brief Named timing regions
+ *
+ * Regions nest, a region opened while another one is running is recorded
+ * under the path "outer/inner". For every path the number of calls and the
+ * total, minimum and maximum time are kept. At QDP_finalize the table is
+ * reduced across all nodes and printed by the primary node.
+ *
+ * \code
+ *   {
+ *     ScopedTimer t("solver");
+ *     ...
+ *     {
+ *       ScopedTimer t2("dslash");   // recorded as solver/dslash
+ *       ...
+ *     }
+ *   }
+ * \endcode
+ */
+
+#ifndef QDP_TIMING_H
+#define QDP_TIMING_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace QDP {
+
+  class TimingRegions
+  {
+  public:
+    struct Stats {
+      uint64_t count;
+      uint64_t total;       // nanoseconds
+      uint64_t min;
+      uint64_t max;
+      uint64_t node_max;    // largest total of a single node, after reduce()
+
+      Stats(): count(0), total(0), min(~(uint64_t)0), max(0), node_max(0) {}
+      double mean() const { return count ? (double)total / count : 0.0; }
+      void add( uint64_t t );
+    };
+
+    typedef std::map<std::string,Stats> Table;
+
+    static TimingRegions& Instance();
+
+    //! Open a region nested in the innermost open region of this thread
+    void begin( const std::string& name );
+
+    //! Close the innermost open region of this thread
+    void end();
+
+    //! Add a measurement for a full path without opening a region
+    void record( const std::string& path , uint64_t ns );
+
+    //! Regions of this node
+    Table local() const;
+
+    //! Combine the tables of all nodes, collective
+    Table reduce() const;
+
+    //! Reduce and print by the primary node. Collective, does nothing without regions
+    void print() const;
+
+    void clear();
+
+  private:
+    TimingRegions() {}
+    TimingRegions(const TimingRegions&);
+    void operator=(const TimingRegions&);
+
+    struct Open {
+      std::string path;
+      uint64_t    start;
+    };
+
+    static std::vector<Open>& stack();
+
+    mutable std::mutex mtx;
+    Table              table;
+  };
+
+
+  namespace QDPInternal
+  {
+    //! Union of the names of all nodes in name order, collective. Names must not contain newlines
+    std::vector<std::string> unionOverNodes( const std::vector<std::string>& mine );
+  }
+
+
+  //! Times its own lifetime as a named region
+  class ScopedTimer
+  {
+  public:
+    explicit ScopedTimer( const std::string& name ) { TimingRegions::Instance().begin( name ); }
+    ~ScopedTimer() { TimingRegions::Instance().end(); }
+
+  private:
+    ScopedTimer(const ScopedTimer&);
+    void operator=(const ScopedTimer&);
+  };
+
+}
+
+#endif
@@ -44,11 +44,15 @@ template<> struct JITType<int>    { typedef int    Type_t; };
 template<> struct JITType<float>  { typedef float  Type_t; };
 template<> struct JITType<double> { typedef double Type_t; };
 template<> struct JITType<bool>   { typedef bool   Type_t; };
+template<> struct JITType<float16>  { typedef float16  Type_t; };
+template<> struct JITType<bfloat16> { typedef bfloat16 Type_t; };
 
 template<> struct REGType<int>    { typedef int    Type_t; };
 template<> struct REGType<float>  { typedef float  Type_t; };
 template<> struct REGType<double> { typedef double Type_t; };
 template<> struct REGType<bool>   { typedef bool   Type_t; };
+template<> struct REGType<float16>  { typedef float16  Type_t; };
+template<> struct REGType<bfloat16> { typedef bfloat16 Type_t; };
 
 
 
@@ -87,6 +91,8 @@ struct QDPSubTypeTrait {};
   template<> struct WordType<double> { typedef double Type_t; };
   template<> struct WordType<int>    { typedef int    Type_t; };
   template<> struct WordType<bool>   { typedef bool   Type_t; };
+  template<> struct WordType<float16>  { typedef float16  Type_t; };
+  template<> struct WordType<bfloat16> { typedef bfloat16 Type_t; };
 
 #if 0
 template<class T>
@@ -145,6 +151,31 @@ struct DoublePrecType<REAL32>
 
 template<>
 struct DoublePrecType<REAL64>
+{
+  typedef REAL64 Type_t;
+};
+
+// The 16-bit storage words widen to the usual fixed precisions
+template<>
+struct SinglePrecType<float16>
+{
+  typedef REAL32 Type_t;
+};
+
+template<>
+struct SinglePrecType<bfloat16>
+{
+  typedef REAL32 Type_t;
+};
+
+template<>
+struct DoublePrecType<float16>
+{
+  typedef REAL64 Type_t;
+};
+
+template<>
+struct DoublePrecType<bfloat16>
 {
   typedef REAL64 Type_t;
 };
@@ -0,0 +1,81 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Block size search for one kernel and thread count
+ *
+ * The search itself knows nothing about CUDA: the launcher asks next()
+ * for the block size to use, launches, and hands the measured time to
+ * report(). Every candidate is sampled several times and scored by the
+ * mean of the samples that survive a median/MAD outlier cut, so a single
+ * slow launch (page fault, context switch, cache flush) cannot decide
+ * the outcome.
+ *
+ * The search runs in two passes:
+ *  - powers of two from the largest useful block size downwards, until
+ *    the score rises clearly above the best one (the old heuristic),
+ *  - multiples of the warp size between half and twice the best power
+ *    of two.
+ *
+ * This header does not depend on the rest of QDP so that the search can
+ * be tested against a simulated timing model without a GPU.
+ */
+
+#ifndef QDP_TUNER_H
+#define QDP_TUNER_H
+
+#include <cstddef>
+#include <vector>
+
+namespace QDP {
+
+  class BlockSizeTuner
+  {
+  public:
+    //! max_block: device limit, th_count: threads of the launch, samples: per candidate
+    BlockSizeTuner( int max_block , int th_count , int samples = 5 , int warp = 32 );
+
+    //! Block size for the next launch, the best one once settled. 0 if all failed
+    int  next() const;
+
+    //! Time of the launch done with next()
+    void report( double time );
+
+    //! The launch with next() ran out of resources, drop it and all larger sizes
+    void failed();
+
+    bool   settled() const { return phase == Settled; }
+    int    best() const { return best_block; }
+    double bestTime() const { return best_score; }
+
+    //! Number of launches measured so far, including discarded warm-up
+    int    launches() const { return num_launches; }
+
+    //! Mean of the samples within k robust standard deviations of the median
+    static double robustMean( std::vector<double> v , double k = 3.0 );
+
+  private:
+    enum Phase { Coarse , Fine , Settled };
+
+    void finishCandidate();
+    void advance();
+    void startFine();
+
+    int    max_block;
+    int    samples;
+    int    warp;
+    Phase  phase;
+
+    std::vector<int>    cand;      // candidates of the current pass, in order
+    size_t              pos;       // current candidate
+    std::vector<double> times;     // samples of the current candidate
+    bool                warm;      // first launch of the kernel seen
+
+    std::vector<int>    measured;  // block sizes with a score
+    int    best_block;
+    double best_score;
+    int    num_launches;
+  };
+
+}
+
+#endif
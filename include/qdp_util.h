@@ -16,6 +16,10 @@ multi1d<int> crtesn(int ipos, const multi1d<int>& latt_size);
 //! Calculates the lexicographic site index from the coordinate of a site
 int local_site(const multi1d<int>& coord, const multi1d<int>& latt_size);
 
+//! Allocation-free crtesn and local_site for n dimensions
+void crtesn(int ipos, const int latt_size[], int n, int coord[]);
+int local_site(const int coord[], const int latt_size[], int n);
+
 //! Unique-ify a list
 multi1d<int> uniquify_list(const multi1d<int>& ll);
 
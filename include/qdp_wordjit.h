@@ -240,6 +240,18 @@ namespace QDP {
     jit_ins_store( dest.getAddress() , 0 , jit_type<int>::value , jit_value( 0 ) );
   }
 
+  inline void 
+  zero_rep(WordJIT<float16>& dest)
+  {
+    jit_ins_store( dest.getAddress() , 0 , jit_type<float16>::value , jit_value( 0.0 ) );
+  }
+
+  inline void 
+  zero_rep(WordJIT<bfloat16>& dest)
+  {
+    jit_ins_store( dest.getAddress() , 0 , jit_type<bfloat16>::value , jit_value( 0.0 ) );
+  }
+
 
   //! dest  = random  
   template<class T, class T1, class T2, class T3>
@@ -252,6 +264,17 @@ namespace QDP {
   }
 
 
+  //! dest  = random, counter-based: one Philox word per real
+  template<class T>
+  inline void
+  fill_random(WordJIT<T>& d, PhiloxJIT& gen, PhiloxJIT&, const PhiloxJIT&)
+  {
+    WordREG<T> r;
+    r.setup( gen.nextUniform( jit_reg_type<T>::value == jit_ptx_type::f64 ? jit_ptx_type::f64 : jit_ptx_type::f32 ) );
+    d = r;
+  }
+
+
 
 } // namespace QDP
 
@@ -20,12 +20,12 @@ namespace QDP {
     // Default constructing should be possible
     // then there is no need for MPL index when
     // construction a PMatrix<T,N>
-    WordREG(): val(jit_type<T>::value) {}
+    WordREG(): val(jit_reg_type<T>::value) {}
 
     WordREG(int i): val(i) {}
     WordREG(double f): val(f) {}
 
-    WordREG(const WordREG& rhs): val(jit_type<T>::value) {
+    WordREG(const WordREG& rhs): val(jit_reg_type<T>::value) {
       assert(rhs.get_val().get_ever_assigned());      
       val = rhs.get_val();
       //      setup_m=true;
@@ -639,6 +639,25 @@ localInnerProductReal(const WordREG<T1>& s1, const WordREG<T2>& s2)
   }
 
 
+  //! dest  = random, kept in a register
+  template<class T, class T1, class T2, class T3>
+  inline void
+  fill_random(WordREG<T>& d, T1& seed, T2& skewed_seed, const T3& seed_mult)
+  {
+    d = seedToFloat( skewed_seed ).elem().elem().elem();
+    seed        = seed        * seed_mult;
+    skewed_seed = skewed_seed * seed_mult;
+  }
+
+  //! dest  = random, counter-based, kept in a register
+  template<class T>
+  inline void
+  fill_random(WordREG<T>& d, PhiloxJIT& gen, PhiloxJIT&, const PhiloxJIT&)
+  {
+    d.setup( gen.nextUniform( jit_reg_type<T>::value == jit_ptx_type::f64 ? jit_ptx_type::f64 : jit_ptx_type::f32 ) );
+  }
+
+
 
 
 typename UnaryReturn<WordREG<float>, FnArcCos>::Type_t acos(const WordREG<float>& s1);
@@ -0,0 +1,57 @@
+// -*- C++ -*-
+
+/*! @file
+ * @brief AVX2/AVX-512 double precision BLAS kernels
+ *
+ * Same arguments as the SSE kernels in scalarsite_sse/sse_blas_*_double.h:
+ * the vectors hold n_4vec Dirac fermions of 24 doubles each, the scalars
+ * are real. Unlike the SSE versions no alignment is required.
+ */
+
+#ifndef QDP_AVX_BLAS_DOUBLE_H
+#define QDP_AVX_BLAS_DOUBLE_H
+
+#include "qdp_precision.h"
+#include "scalarsite_avx/avx_dispatch.h"
+
+namespace QDP {
+  namespace AVX {
+
+    // z = a*x + b*y and z = a*x over n doubles, z may alias x or y
+    void axpby(double* z, double a, const double* x, double b, const double* y, int n);
+    void scal(double* z, double a, const double* x, int n);
+
+    // Out += a*In
+    void vaxpy4(REAL64 *Out, REAL64 *scalep, REAL64 *InScale, int n_4vec);
+    // Out = a*In + Add
+    void vaxpyz4(REAL64 *Out, REAL64 *scalep, REAL64 *InScale, REAL64 *Add, int n_4vec);
+    // Out = a*In - Out
+    void vaxmy4(REAL64 *Out, REAL64 *scalep, REAL64 *InScale, int n_4vec);
+    // Out = a*In - Sub
+    void vaxmyz4(REAL64 *Out, REAL64 *scalep, REAL64 *InScale, REAL64 *Sub, int n_4vec);
+    // Out = In + a*Out
+    void vaypx4(REAL64 *Out, REAL64 *scalep, REAL64 *InScale, int n_4vec);
+
+    // y = a*x + b*y
+    void vaxpby4(REAL64 *y, REAL64 *a, REAL64 *x, REAL64 *b, int n_4vec);
+    // z = a*x + b*y
+    void vaxpbyz4(REAL64 *z, REAL64 *a, REAL64 *x, REAL64 *b, REAL64 *y, int n_4vec);
+    // y = a*x - b*y
+    void vaxmby4(REAL64 *y, REAL64 *a, REAL64 *x, REAL64 *b, int n_4vec);
+    // z = a*x - b*y
+    void vaxmbyz4(REAL64 *z, REAL64 *a, REAL64 *x, REAL64 *b, REAL64 *y, int n_4vec);
+
+    // z = a*x
+    void vscal4(REAL64 *z, REAL64 *a, REAL64 *x, int n_4vec);
+
+    // sum = |x|^2
+    void local_sumsq4(REAL64 *sum, REAL64 *x, int n_4vec);
+    // sum[0] + i sum[1] = y^dagger x
+    void local_vcdot4(REAL64 *sum, REAL64 *y, REAL64 *x, int n_4vec);
+    // sum = Re(y^dagger x)
+    void local_vcdot_real4(REAL64 *sum, REAL64 *y, REAL64 *x, int n_4vec);
+
+  } // namespace AVX
+} // namespace QDP
+
+#endif
@@ -0,0 +1,65 @@
+// -*- C++ -*-
+
+/*! @file
+ * @brief AVX2/AVX-512 versions of the gamma_5 BLAS kernels
+ *
+ * Same names and arguments as the inline kernels in
+ * scalarsite_generic/generic_blas_*g5.h, for single and double precision.
+ * P+ keeps the upper two spin components of a Dirac fermion and P- the
+ * lower two; a and b are the real scalars *scalep and *scalep2.
+ *
+ * The functions are templates on the floating point type, explicitly
+ * instantiated for REAL32 and REAL64, so that the generic hooks can keep
+ * calling them and taking their address with REAL arguments.
+ */
+
+#ifndef QDP_AVX_BLAS_G5_H
+#define QDP_AVX_BLAS_G5_H
+
+#include "scalarsite_avx/avx_dispatch.h"
+
+namespace QDP {
+  namespace AVX {
+
+    // Out = a*InScale + P{+,-} Add,  Out = a*InScale - P{+,-} Add
+    template<typename T> void axpyz_g5ProjPlus(T *Out, T *scalep, T *InScale, T *Add, int n_4vec);
+    template<typename T> void axpyz_g5ProjMinus(T *Out, T *scalep, T *InScale, T *Add, int n_4vec);
+    template<typename T> void axmyz_g5ProjPlus(T *Out, T *scalep, T *InScale, T *Add, int n_4vec);
+    template<typename T> void axmyz_g5ProjMinus(T *Out, T *scalep, T *InScale, T *Add, int n_4vec);
+
+    // Out = Add + a*P{+,-} InScale,  Out = Add - a*P{+,-} InScale
+    template<typename T> void xpayz_g5ProjPlus(T *Out, T *scalep, T *Add, T *InScale, int n_4vec);
+    template<typename T> void xpayz_g5ProjMinus(T *Out, T *scalep, T *Add, T *InScale, int n_4vec);
+    template<typename T> void xmayz_g5ProjPlus(T *Out, T *scalep, T *Add, T *InScale, int n_4vec);
+    template<typename T> void xmayz_g5ProjMinus(T *Out, T *scalep, T *Add, T *InScale, int n_4vec);
+
+    // Out = X + P{+,-} Y,  Out = X - P{+,-} Y
+    template<typename T> void add_g5ProjPlus(T *Out, T *X, T *Y, int n_4vec);
+    template<typename T> void add_g5ProjMinus(T *Out, T *X, T *Y, int n_4vec);
+    template<typename T> void sub_g5ProjPlus(T *Out, T *X, T *Y, int n_4vec);
+    template<typename T> void sub_g5ProjMinus(T *Out, T *X, T *Y, int n_4vec);
+
+    // Out = a*P{+,-} In
+    template<typename T> void scal_g5ProjPlus(T *Out, T *scalep, T *In, int n_4vec);
+    template<typename T> void scal_g5ProjMinus(T *Out, T *scalep, T *In, int n_4vec);
+
+    // Out = a*InScale + b*P{+,-} Add,  Out = a*InScale - b*P{+,-} Add
+    template<typename T> void axpbyz_g5ProjPlus(T *Out, T *scalep, T *InScale, T *scalep2, T *Add, int n_4vec);
+    template<typename T> void axpbyz_g5ProjMinus(T *Out, T *scalep, T *InScale, T *scalep2, T *Add, int n_4vec);
+    template<typename T> void axmbyz_g5ProjPlus(T *Out, T *scalep, T *InScale, T *scalep2, T *Add, int n_4vec);
+    template<typename T> void axmbyz_g5ProjMinus(T *Out, T *scalep, T *InScale, T *scalep2, T *Add, int n_4vec);
+
+    // Full gamma_5 and i*gamma_5 variants, see scalarsite_generic/generic_blas_g5.h
+    template<typename T> void scal_g5(T *Out, T *scalep, T *In, int n_4vec);
+    template<typename T> void axpbyz_g5(T *Out, T *scalep, T *InScale, T *scalep2, T *Add, int n_4vec);
+    template<typename T> void xmayz_g5(T *Out, T *scalep, T *Add, T *InScale, int n_4vec);
+    template<typename T> void g5_axmbyz(T *Out, T *scalep, T *InScale, T *scalep2, T *Add, int n_4vec);
+    template<typename T> void axpbyz_ig5(T *Out, T *scalep, T *InScale, T *scalep2, T *Add, int n_4vec);
+    template<typename T> void axmbyz_ig5(T *Out, T *scalep, T *InScale, T *scalep2, T *Add, int n_4vec);
+    template<typename T> void xpayz_ig5(T *Out, T *scalep, T *InScale, T *Add, int n_4vec);
+    template<typename T> void xmayz_ig5(T *Out, T *scalep, T *InScale, T *Add, int n_4vec);
+
+  } // namespace AVX
+} // namespace QDP
+
+#endif
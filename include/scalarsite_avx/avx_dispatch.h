@@ -0,0 +1,46 @@
+// -*- C++ -*-
+
+/*! @file
+ * @brief Instruction set selection for the scalarsite AVX kernels
+ *
+ * Every kernel of the scalarsite_avx family exists in three variants:
+ * portable C++, AVX2 with FMA, and AVX-512F. The widest variant the
+ * CPU supports is picked from CPUID on first use. setIsa() can force a
+ * narrower one, e.g. to compare the paths or to stay clear of the
+ * AVX-512 frequency drop on some Xeons.
+ */
+
+#ifndef QDP_AVX_DISPATCH_H
+#define QDP_AVX_DISPATCH_H
+
+// The vector variants need the GCC/Clang target attribute, so that the
+// rest of the library does not have to be built with -mavx2
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QDP_AVX_HAVE_TARGET 1
+#define QDP_AVX2_TARGET   __attribute__((target("avx2,fma")))
+#define QDP_AVX512_TARGET __attribute__((target("avx512f")))
+#endif
+
+namespace QDP {
+  namespace AVX {
+
+    enum Isa { Generic = 0 , AVX2 = 1 , AVX512 = 2 };
+
+    //! Widest instruction set supported by both the build and the CPU
+    Isa detectedIsa();
+
+    //! Instruction set the kernels currently use
+    Isa currentIsa();
+
+    //! Use isa, or the widest supported one below it
+    void setIsa(Isa isa);
+
+    const char* isaName(Isa isa);
+
+    //! Parse "generic", "avx2" or "avx512". Returns false if unknown
+    bool parseIsa(const char* name, Isa& isa);
+
+  } // namespace AVX
+} // namespace QDP
+
+#endif
@@ -0,0 +1,60 @@
+// -*- C++ -*-
+
+/*! @file
+ * @brief AVX2/AVX-512 double precision SU(3) kernels
+ *
+ * Matrices are 18 doubles, row major with interleaved real and imaginary
+ * parts, color vectors are 6 doubles. The matrix functions take the
+ * arguments of the SSE kernels in scalarsite_sse/sse_linalg_mm_su3_double.h
+ * and work on n_mat consecutive matrices. No alignment is required, so
+ * there are no separate _u variants.
+ */
+
+#ifndef QDP_AVX_LINALG_SU3_DOUBLE_H
+#define QDP_AVX_LINALG_SU3_DOUBLE_H
+
+#include "qdp_precision.h"
+#include "scalarsite_avx/avx_dispatch.h"
+
+namespace QDP {
+  namespace AVX {
+
+    /* M2 = a*M1, a is real */
+    void m_eq_scal_m(REAL64* m2, REAL64* a, REAL64* m1, int n_mat);
+    /* M *= a, a is real */
+    void m_muleq_scal(REAL64* m, REAL64* a, int n_mat);
+    /* M2 += M1 */
+    void m_peq_m(REAL64* m2, REAL64* m1, int n_mat);
+    /* M2 -= M1 */
+    void m_meq_m(REAL64* m2, REAL64* m1, int n_mat);
+    /* M2 += adj(M1) */
+    void m_peq_h(REAL64* m2, REAL64* m1, int n_mat);
+    /* M2 -= adj(M1) */
+    void m_meq_h(REAL64* m2, REAL64* m1, int n_mat);
+
+    /* M3 = M1*M2 */
+    void m_eq_mm(REAL64* m3, REAL64* m1, REAL64* m2, int n_mat);
+    /* M3 += a M1*M2 */
+    void m_peq_amm(REAL64* m3, REAL64* a, REAL64* m1, REAL64* m2, int n_mat);
+    /* M3 = M1*adj(M2) */
+    void m_eq_mh(REAL64* m3, REAL64* m1, REAL64* m2, int n_mat);
+    /* M3 += a M1*adj(M2) */
+    void m_peq_amh(REAL64* m3, REAL64* a, REAL64* m1, REAL64* m2, int n_mat);
+    /* M3 = adj(M1)*M2 */
+    void m_eq_hm(REAL64* m3, REAL64* m1, REAL64* m2, int n_mat);
+    /* M3 += a adj(M1)*M2 */
+    void m_peq_ahm(REAL64* m3, REAL64* a, REAL64* m1, REAL64* m2, int n_mat);
+    /* M3 = adj(M1)*adj(M2) */
+    void m_eq_hh(REAL64* m3, REAL64* m1, REAL64* m2, int n_mat);
+    /* M3 += a adj(M1)*adj(M2) */
+    void m_peq_ahh(REAL64* m3, REAL64* a, REAL64* m1, REAL64* m2, int n_mat);
+
+    /* v2[k] = M*v1[k] for the n_vec color vectors of one site */
+    void mult_su3_mat_vec(REAL64* v2, const REAL64* m, const REAL64* v1, int n_vec);
+    /* v2[k] = adj(M)*v1[k] */
+    void mult_adj_su3_mat_vec(REAL64* v2, const REAL64* m, const REAL64* v1, int n_vec);
+
+  } // namespace AVX
+} // namespace QDP
+
+#endif
@@ -0,0 +1,45 @@
+// -*- C++ -*-
+
+/*! @file
+ * @brief AVX gamma_5 BLAS kernels for the generic hooks
+ *
+ * Brings the AVX versions of the kernels into namespace QDP under the
+ * names of the inline kernels in scalarsite_generic/generic_blas_*g5.h,
+ * so that qdp_scalarsite_generic_blas_g5.h can use either set.
+ */
+
+#ifndef QDP_SCALARSITE_AVX_BLAS_G5_H
+#define QDP_SCALARSITE_AVX_BLAS_G5_H
+
+#include "scalarsite_avx/avx_blas_g5.h"
+
+namespace QDP {
+  using AVX::axpyz_g5ProjPlus;
+  using AVX::axpyz_g5ProjMinus;
+  using AVX::axmyz_g5ProjPlus;
+  using AVX::axmyz_g5ProjMinus;
+  using AVX::xpayz_g5ProjPlus;
+  using AVX::xpayz_g5ProjMinus;
+  using AVX::xmayz_g5ProjPlus;
+  using AVX::xmayz_g5ProjMinus;
+  using AVX::add_g5ProjPlus;
+  using AVX::add_g5ProjMinus;
+  using AVX::sub_g5ProjPlus;
+  using AVX::sub_g5ProjMinus;
+  using AVX::scal_g5ProjPlus;
+  using AVX::scal_g5ProjMinus;
+  using AVX::axpbyz_g5ProjPlus;
+  using AVX::axpbyz_g5ProjMinus;
+  using AVX::axmbyz_g5ProjPlus;
+  using AVX::axmbyz_g5ProjMinus;
+  using AVX::scal_g5;
+  using AVX::axpbyz_g5;
+  using AVX::xmayz_g5;
+  using AVX::g5_axmbyz;
+  using AVX::axpbyz_ig5;
+  using AVX::axmbyz_ig5;
+  using AVX::xpayz_ig5;
+  using AVX::xmayz_ig5;
+}
+
+#endif
@@ -0,0 +1,148 @@
+// -*- C++ -*-
+
+/*! @file
+ * @brief AVX double precision SU(3) matrix-vector optimizations
+ *
+ * The double precision counterparts of the matrix-vector hooks in
+ * scalarsite_generic/qdp_scalarsite_generic_linalg.h. The matrix-matrix
+ * products go through the ssed_* entry points of
+ * scalarsite_sse/qdp_scalarsite_sse_linalg_double.h, which the AVX build
+ * implements with the kernels in avx_linalg_su3_double.h.
+ */
+
+#ifndef QDP_SCALARSITE_AVX_LINALG_DOUBLE_H
+#define QDP_SCALARSITE_AVX_LINALG_DOUBLE_H
+
+#include "scalarsite_avx/avx_linalg_su3_double.h"
+
+namespace QDP {
+
+typedef RComplex<REAL64>  RComplexDouble;
+
+// Optimized version of
+//    PColorVector<RComplexDouble,3> <- PColorMatrix<RComplexDouble,3> * PColorVector<RComplexDouble,3>
+template<>
+inline BinaryReturn<PMatrix<RComplexDouble,3,PColorMatrix>,
+  PVector<RComplexDouble,3,PColorVector>, OpMultiply>::Type_t
+operator*(const PMatrix<RComplexDouble,3,PColorMatrix>& l,
+	  const PVector<RComplexDouble,3,PColorVector>& r)
+{
+  BinaryReturn<PMatrix<RComplexDouble,3,PColorMatrix>,
+    PVector<RComplexDouble,3,PColorVector>, OpMultiply>::Type_t  d;
+
+#if defined(QDP_SCALARSITE_DEBUG)
+  cout << "M*V" << endl;
+#endif
+
+  AVX::mult_su3_mat_vec(&(d.elem(0).real()), &(l.elem(0,0).real()), &(r.elem(0).real()), 1);
+
+  return d;
+}
+
+
+// Optimized version of
+//    PScalar<PColorVector<RComplexDouble,3>> <- PScalar<PColorMatrix<RComplexDouble,3>> * PScalar<PColorVector<RComplexDouble,3>>
+template<>
+inline BinaryReturn<PScalar<PColorMatrix<RComplexDouble,3> >,
+  PScalar<PColorVector<RComplexDouble,3> >, OpMultiply>::Type_t
+operator*(const PScalar<PColorMatrix<RComplexDouble,3> >& l,
+	  const PScalar<PColorVector<RComplexDouble,3> >& r)
+{
+  BinaryReturn<PScalar<PColorMatrix<RComplexDouble,3> >,
+    PScalar<PColorVector<RComplexDouble,3> >, OpMultiply>::Type_t  d;
+
+#if defined(QDP_SCALARSITE_DEBUG)
+  cout << "PSc<M>*PSc<V>" << endl;
+#endif
+
+  AVX::mult_su3_mat_vec(&(d.elem().elem(0).real()), &(l.elem().elem(0,0).real()),
+			&(r.elem().elem(0).real()), 1);
+
+  return d;
+}
+
+
+// Optimized version of
+//    PColorVector<RComplexDouble,3> <- adj(PColorMatrix<RComplexDouble,3>) * PColorVector<RComplexDouble,3>
+template<>
+inline BinaryReturn<PMatrix<RComplexDouble,3,PColorMatrix>,
+  PVector<RComplexDouble,3,PColorVector>, OpAdjMultiply>::Type_t
+adjMultiply(const PMatrix<RComplexDouble,3,PColorMatrix>& l,
+	    const PVector<RComplexDouble,3,PColorVector>& r)
+{
+  BinaryReturn<PMatrix<RComplexDouble,3,PColorMatrix>,
+    PVector<RComplexDouble,3,PColorVector>, OpAdjMultiply>::Type_t  d;
+
+#if defined(QDP_SCALARSITE_DEBUG)
+  cout << "adj(M)*V" << endl;
+#endif
+
+  AVX::mult_adj_su3_mat_vec(&(d.elem(0).real()), &(l.elem(0,0).real()), &(r.elem(0).real()), 1);
+
+  return d;
+}
+
+
+// Optimized version of
+//    PScalar<PColorVector<RComplexDouble,3>> <- adj(PScalar<PColorMatrix<RComplexDouble,3>>) * PScalar<PColorVector<RComplexDouble,3>>
+template<>
+inline BinaryReturn<PScalar<PColorMatrix<RComplexDouble,3> >,
+  PScalar<PColorVector<RComplexDouble,3> >, OpAdjMultiply>::Type_t
+adjMultiply(const PScalar<PColorMatrix<RComplexDouble,3> >& l,
+	    const PScalar<PColorVector<RComplexDouble,3> >& r)
+{
+  BinaryReturn<PScalar<PColorMatrix<RComplexDouble,3> >,
+    PScalar<PColorVector<RComplexDouble,3> >, OpAdjMultiply>::Type_t  d;
+
+#if defined(QDP_SCALARSITE_DEBUG)
+  cout << "adj(PSc<M>)*PSc<V>" << endl;
+#endif
+
+  AVX::mult_adj_su3_mat_vec(&(d.elem().elem(0).real()), &(l.elem().elem(0,0).real()),
+			    &(r.elem().elem(0).real()), 1);
+
+  return d;
+}
+
+
+// Optimized version of   StaggeredFermion, HalfFermion and DiracFermion
+//    PSpinVector<PColorVector<RComplexDouble,3>,N> <- PScalar<PColorMatrix<RComplexDouble,3>> * PSpinVector<PColorVector<RComplexDouble,3>,N>
+// The color vectors of one site are contiguous, so a single call covers all spins
+#define QDP_AVX_MAT_SPINVEC(N)						\
+template<>								\
+inline BinaryReturn<PScalar<PColorMatrix<RComplexDouble,3> >,		\
+  PVector<PColorVector<RComplexDouble,3>,N,PSpinVector>, OpMultiply>::Type_t \
+operator*(const PScalar<PColorMatrix<RComplexDouble,3> >& l,		\
+	  const PVector<PColorVector<RComplexDouble,3>,N,PSpinVector>& r) \
+{									\
+  BinaryReturn<PScalar<PColorMatrix<RComplexDouble,3> >,		\
+    PVector<PColorVector<RComplexDouble,3>,N,PSpinVector>, OpMultiply>::Type_t  d; \
+									\
+  AVX::mult_su3_mat_vec(&(d.elem(0).elem(0).real()), &(l.elem().elem(0,0).real()), \
+			&(r.elem(0).elem(0).real()), N);		\
+  return d;								\
+}									\
+									\
+template<>								\
+inline BinaryReturn<PScalar<PColorMatrix<RComplexDouble,3> >,		\
+  PVector<PColorVector<RComplexDouble,3>,N,PSpinVector>, OpAdjMultiply>::Type_t \
+adjMultiply(const PScalar<PColorMatrix<RComplexDouble,3> >& l,		\
+	    const PVector<PColorVector<RComplexDouble,3>,N,PSpinVector>& r) \
+{									\
+  BinaryReturn<PScalar<PColorMatrix<RComplexDouble,3> >,		\
+    PVector<PColorVector<RComplexDouble,3>,N,PSpinVector>, OpAdjMultiply>::Type_t  d; \
+									\
+  AVX::mult_adj_su3_mat_vec(&(d.elem(0).elem(0).real()), &(l.elem().elem(0,0).real()), \
+			    &(r.elem(0).elem(0).real()), N);		\
+  return d;								\
+}
+
+QDP_AVX_MAT_SPINVEC(1)
+QDP_AVX_MAT_SPINVEC(2)
+QDP_AVX_MAT_SPINVEC(4)
+
+#undef QDP_AVX_MAT_SPINVEC
+
+} // namespace QDP
+
+#endif
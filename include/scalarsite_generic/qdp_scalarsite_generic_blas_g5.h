@@ -10,12 +10,16 @@
 #ifndef QDP_SCALARSITE_GENERIC_BLAS_G5_H
 #define QDP_SCALARSITE_GENERIC_BLAS_G5_H
 
+#if QDP_USE_AVX == 1
+#include "scalarsite_avx/qdp_scalarsite_avx_blas_g5.h"
+#else
 #include "scalarsite_generic/generic_blas_vaxpy3_g5.h"
 #include "scalarsite_generic/generic_blas_vaypx3_g5.h"
 #include "scalarsite_generic/generic_blas_vadd3_g5.h"
 #include "scalarsite_generic/generic_blas_vscal_g5.h"
 #include "scalarsite_generic/generic_blas_vaxpby3_g5.h"
 #include "scalarsite_generic/generic_blas_g5.h"
+#endif
 
 using namespace QDP;
 
@@ -0,0 +1,412 @@
+#include "qdp_async_io.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace QDP {
+
+  namespace {
+    //! Alignment of the chunks, their offsets and lengths for O_DIRECT
+    const size_t io_align = 4096;
+
+    AsyncIOOptions options;
+  }
+
+
+  void asyncIOSetOptions( const AsyncIOOptions& opt )
+  {
+    options = opt;
+  }
+
+  const AsyncIOOptions& asyncIOGetOptions()
+  {
+    return options;
+  }
+
+
+  AsyncFileBuf::AsyncFileBuf()
+    : fd(-1), fd_direct(-1), writing(false), chunk(0), cur(-1), put_base(0),
+      next_read(0), skip(0), eof_seen(false), stop(false), error(0)
+  {
+  }
+
+  AsyncFileBuf::~AsyncFileBuf()
+  {
+    close();
+  }
+
+
+  bool AsyncFileBuf::open( const std::string& path , std::ios_base::openmode mode , const AsyncIOOptions& opt )
+  {
+    if (is_open())
+      return false;
+
+    writing = (mode & std::ios_base::out) != 0;
+    int flags = writing ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY;
+
+    fd = ::open( path.c_str() , flags , 0666 );
+    if (fd < 0)
+      return false;
+
+#ifdef O_DIRECT
+    if (opt.direct)
+      fd_direct = ::open( path.c_str() , (flags & ~O_TRUNC) | O_DIRECT , 0666 );
+#endif
+
+    chunk = std::max( opt.chunk , io_align );
+    chunk = (chunk + io_align - 1) / io_align * io_align;
+
+    chunks.assign( std::max( opt.buffers , 1 ) , Chunk() );
+    for (Chunk& c : chunks)
+      if (posix_memalign( (void**)&c.data , io_align , chunk ))
+      {
+	c.data = nullptr;
+	close();
+	return false;
+      }
+
+    stop = false;
+    error = 0;
+    queue.clear();
+    io = std::thread( [this] { run(); } );
+
+    cur = -1;
+    if (writing)
+    {
+      cur = 0;
+      put_base = 0;
+      setp( chunks[0].data , chunks[0].data + chunk );
+      setg( nullptr , nullptr , nullptr );
+    }
+    else
+    {
+      setp( nullptr , nullptr );
+      startRead( 0 );
+    }
+    return true;
+  }
+
+
+  bool AsyncFileBuf::close()
+  {
+    if (!is_open())
+      return true;
+
+    if (writing)
+      flushPut();
+    drain();
+
+    {
+      std::lock_guard<std::mutex> lock( mtx );
+      stop = true;
+    }
+    cv_io.notify_one();
+    if (io.joinable())
+      io.join();
+
+    bool ok = error == 0;
+    if (fd_direct >= 0)
+      ::close( fd_direct );
+    if (::close( fd ) != 0)
+      ok = false;
+    fd = fd_direct = -1;
+
+    for (Chunk& c : chunks)
+      free( c.data );
+    chunks.clear();
+    cur = -1;
+    setp( nullptr , nullptr );
+    setg( nullptr , nullptr , nullptr );
+    return ok;
+  }
+
+
+  //-----------------------------------------------------------------------------
+  // The I/O thread
+
+  void AsyncFileBuf::run()
+  {
+    std::unique_lock<std::mutex> lock( mtx );
+    for (;;)
+    {
+      cv_io.wait( lock , [this] { return stop || !queue.empty(); } );
+      if (queue.empty())
+	return;
+
+      int i = queue.front();
+      queue.pop_front();
+      Chunk c = chunks[i];   // fixed while busy
+
+      lock.unlock();
+      errno = 0;
+      long long r = transfer( c );
+      int err = errno;
+      lock.lock();
+
+      chunks[i].result = r;
+      chunks[i].busy = false;
+      if (r < 0 && error == 0)
+	error = err ? err : EIO;
+      cv_done.notify_all();
+    }
+  }
+
+
+  //! The whole chunk, or up to the end of the file when reading
+  long long AsyncFileBuf::transfer( const Chunk& c )
+  {
+    bool aligned = c.offset % io_align == 0 && c.len % io_align == 0;
+    int f = fd_direct >= 0 && aligned ? fd_direct : fd;
+
+    size_t done = 0;
+    while (done < c.len)
+    {
+      ssize_t n = writing
+	? ::pwrite( f , c.data + done , c.len - done , c.offset + done )
+	: ::pread( f , c.data + done , c.len - done , c.offset + done );
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n < 0)
+	return -1;
+      if (n == 0)
+      {
+	if (writing)
+	  return -1;
+	break;        // end of file
+      }
+      done += n;
+
+      // A short direct transfer leaves an unaligned rest
+      if (done % io_align != 0)
+	f = fd;
+    }
+    return done;
+  }
+
+
+  void AsyncFileBuf::submit( int i )
+  {
+    {
+      std::lock_guard<std::mutex> lock( mtx );
+      chunks[i].busy = true;
+      queue.push_back( i );
+    }
+    cv_io.notify_one();
+  }
+
+  void AsyncFileBuf::wait( int i )
+  {
+    std::unique_lock<std::mutex> lock( mtx );
+    cv_done.wait( lock , [this,i] { return !chunks[i].busy; } );
+  }
+
+  void AsyncFileBuf::drain()
+  {
+    for (size_t i = 0; i < chunks.size(); ++i)
+      wait( i );
+  }
+
+  long long AsyncFileBuf::fileSize()
+  {
+    struct stat st;
+    return fstat( fd , &st ) == 0 ? (long long)st.st_size : -1;
+  }
+
+
+  //-----------------------------------------------------------------------------
+  // Writing
+
+  //! Hand the put area to the I/O thread and continue in the next chunk
+  void AsyncFileBuf::flushPut()
+  {
+    size_t len = pptr() - pbase();
+    if (cur < 0 || len == 0)
+      return;
+
+    chunks[cur].offset = put_base;
+    chunks[cur].len = len;
+    submit( cur );
+    put_base += len;
+
+    cur = (cur + 1) % chunks.size();
+    wait( cur );
+    setp( chunks[cur].data , chunks[cur].data + chunk );
+  }
+
+  AsyncFileBuf::int_type AsyncFileBuf::overflow( int_type c )
+  {
+    if (!writing || !is_open())
+      return traits_type::eof();
+
+    flushPut();
+    if (error)
+      return traits_type::eof();
+
+    if (!traits_type::eq_int_type( c , traits_type::eof() ))
+    {
+      *pptr() = traits_type::to_char_type( c );
+      pbump( 1 );
+    }
+    return traits_type::not_eof( c );
+  }
+
+  std::streamsize AsyncFileBuf::xsputn( const char* s , std::streamsize n )
+  {
+    if (!writing || !is_open())
+      return 0;
+
+    std::streamsize done = 0;
+    while (done < n)
+    {
+      if (pptr() == epptr())
+      {
+	flushPut();
+	if (error)
+	  break;
+      }
+      std::streamsize k = std::min( n - done , (std::streamsize)(epptr() - pptr()) );
+      memcpy( pptr() , s + done , k );
+      pbump( (int)k );
+      done += k;
+    }
+    return done;
+  }
+
+  //! Writing: every byte so far is handed to the OS
+  int AsyncFileBuf::sync()
+  {
+    if (!is_open())
+      return 0;
+    if (writing)
+    {
+      flushPut();
+      drain();
+    }
+    return error ? -1 : 0;
+  }
+
+
+  //-----------------------------------------------------------------------------
+  // Reading
+
+  //! Read ahead from pos on, starting at the aligned offset below it
+  void AsyncFileBuf::startRead( long long pos )
+  {
+    drain();
+
+    long long base = pos / io_align * io_align;
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+      chunks[i].offset = base + (long long)(i * chunk);
+      chunks[i].len = chunk;
+      submit( i );
+    }
+    next_read = base + (long long)(chunks.size() * chunk);
+    skip = pos - base;
+    eof_seen = false;
+    cur = -1;
+    setg( nullptr , nullptr , nullptr );
+  }
+
+  AsyncFileBuf::int_type AsyncFileBuf::underflow()
+  {
+    if (writing || !is_open())
+      return traits_type::eof();
+    if (gptr() < egptr())
+      return traits_type::to_int_type( *gptr() );
+
+    // The consumed chunk reads further ahead, unless it held the end of the file
+    if (cur >= 0)
+    {
+      if (eof_seen)
+	return traits_type::eof();
+      chunks[cur].offset = next_read;
+      chunks[cur].len = chunk;
+      submit( cur );
+      next_read += chunk;
+    }
+
+    int next = (cur + 1) % chunks.size();
+    wait( next );
+    cur = next;
+
+    const Chunk& c = chunks[cur];
+    if (c.result < 0)
+      return traits_type::eof();
+    size_t n = c.result;
+    if (n < chunk)
+      eof_seen = true;
+
+    size_t start = std::min( skip , n );
+    skip = 0;
+    setg( c.data , c.data + start , c.data + n );
+    if (start == n)
+      return traits_type::eof();
+    return traits_type::to_int_type( *gptr() );
+  }
+
+
+  //-----------------------------------------------------------------------------
+  // Positioning
+
+  long long AsyncFileBuf::position()
+  {
+    if (writing)
+      return put_base + (pptr() - pbase());
+    if (cur < 0)
+      return chunks.empty() ? 0 : chunks[0].offset + skip;
+    return chunks[cur].offset + (gptr() - eback());
+  }
+
+  AsyncFileBuf::pos_type AsyncFileBuf::seekoff( off_type off , std::ios_base::seekdir dir ,
+						std::ios_base::openmode which )
+  {
+    if (!is_open())
+      return pos_type(off_type(-1));
+
+    // tellp and tellg must not drain
+    if (off == 0 && dir == std::ios_base::cur)
+      return pos_type(off_type(position()));
+
+    long long target = off;
+    if (dir == std::ios_base::cur)
+      target += position();
+    else if (dir == std::ios_base::end)
+    {
+      if (writing && sync() != 0)
+	return pos_type(off_type(-1));
+      long long size = fileSize();
+      if (size < 0)
+	return pos_type(off_type(-1));
+      target += size;
+    }
+    if (target < 0)
+      return pos_type(off_type(-1));
+
+    if (writing)
+    {
+      if (sync() != 0)
+	return pos_type(off_type(-1));
+      put_base = target;
+      setp( chunks[cur].data , chunks[cur].data + chunk );
+    }
+    else if (cur >= 0 && target >= chunks[cur].offset && target <= chunks[cur].offset + (egptr() - eback()))
+      setg( eback() , eback() + (target - chunks[cur].offset) , egptr() );
+    else
+      startRead( target );
+
+    return pos_type(off_type(target));
+  }
+
+  AsyncFileBuf::pos_type AsyncFileBuf::seekpos( pos_type pos , std::ios_base::openmode which )
+  {
+    return seekoff( off_type(pos) , std::ios_base::beg , which );
+  }
+
+} // namespace QDP
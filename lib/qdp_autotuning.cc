@@ -2,15 +2,37 @@
 
 namespace QDP {
 
-  struct tune_t {
-    tune_t(): cfg(0),best(0),best_time(0.0) {}
-    tune_t(int cfg,int best,double best_time): cfg(cfg),best(best),best_time(best_time) {}
-    int    cfg;
-    int    best;
-    double best_time;
-  };
+  namespace {
+    //! Block sizes are tuned per kernel and thread count
+    typedef std::pair< CUfunction , int > tune_key_t;
+
+    std::map< tune_key_t , BlockSizeTuner > mapTune;
+    std::map< tune_key_t , BlockSizeTuner > mapTuneTiled;
+    std::map< CUfunction , int >            mapLastCount;
+
+    int tune_samples = 5;
+
+    BlockSizeTuner& get_tuner( std::map< tune_key_t , BlockSizeTuner >& m , CUfunction function , int th_count , int max_block )
+    {
+      mapLastCount[function] = th_count;
+      tune_key_t key( function , th_count );
+      std::map< tune_key_t , BlockSizeTuner >::iterator it = m.find( key );
+      if (it == m.end())
+	it = m.insert( std::make_pair( key , BlockSizeTuner( max_block , th_count , tune_samples ) ) ).first;
+      return it->second;
+    }
+
+    const BlockSizeTuner* find_tuner( const std::map< tune_key_t , BlockSizeTuner >& m , CUfunction function )
+    {
+      std::map< CUfunction , int >::const_iterator c = mapLastCount.find( function );
+      if (c == mapLastCount.end())
+	return NULL;
+      std::map< tune_key_t , BlockSizeTuner >::const_iterator it = m.find( tune_key_t( function , c->second ) );
+      return it == m.end() ? NULL : &it->second;
+    }
+  }
 
-  std::map< CUfunction , tune_t > mapTune;
+  JitTiling tiling = JitTiling::off;
 
 
   void LaunchPrintArgs( std::vector<void*>& args )
@@ -25,115 +47,244 @@ namespace QDP {
   }
 
 
-  void jit_launch(CUfunction function,int th_count,std::vector<void*>& args)
+  void jit_launch(CUfunction function,int th_count,std::vector<void*>& args,size_t bytes_per_thread)
   {
     // Check for thread count equals zero
     // This can happen, when inner count is zero
     if ( th_count == 0 )
       return;
 
-    if (mapTune.count(function) == 0) {
-      mapTune[function] = tune_t( DeviceParams::Instance().getMaxBlockX() , 0 , 0.0 );
-    }
+    BlockSizeTuner& tune = get_tuner( mapTune , function , th_count , DeviceParams::Instance().getMaxBlockX() );
+
+    CUresult result = CUDA_ERROR_LAUNCH_OUT_OF_RESOURCES;
+
+    while (result != CUDA_SUCCESS) {
+      bool settled = tune.settled();
+      int  block   = tune.next();
+
+      if (block == 0) {
+	CudaCheckResult(result);
+	QDP_error_exit("Kernel launch failed even for block size 1. Giving up.");
+      }
 
+      kernel_geom_t now = getGeom( th_count , block );
+      StopWatch w;
 
-    tune_t& tune = mapTune[function];
+      //QDP_info("CUDA launch: grid=(%u,%u,%u), block=(%d,%u,%u) ",now.Nblock_x,now.Nblock_y,1,    block,1,1 );
 
+      KernelProfile::Instance().launchBegin( 0 );
 
-    if (tune.cfg == -1) {
-      kernel_geom_t now = getGeom( th_count , tune.best );
+      w.start();
 
-      //QDP_info("CUDA launch (settled): grid=(%u,%u,%u), block=(%d,%u,%u) ",now.Nblock_x,now.Nblock_y,1,    tune.best,1,1 );
-	
-      CUresult result = cuLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    tune.best,1,1,    0, 0, &args[0] , 0);
+      result = cuLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    block,1,1,    0, 0, &args[0] , 0);
 
-      if (result != CUDA_SUCCESS) {
+      if (result != CUDA_SUCCESS && (result != CUDA_ERROR_LAUNCH_OUT_OF_RESOURCES || settled)) {
 	CudaCheckResult(result);
 	LaunchPrintArgs(args);
 	QDPIO::cout << getPTXfromCUFunc(function);
 	QDP_error_exit("CUDA launch error: grid=(%u,%u,%u), block=(%d,%u,%u) ",
-		       now.Nblock_x,now.Nblock_y,1,    tune.cfg,1,1 );
+		       now.Nblock_x,now.Nblock_y,1,    block,1,1 );
+      }
+
+      if (result != CUDA_SUCCESS) {
+	tune.failed();
+	continue;
       }
 
       QDPCache::Instance().releasePrevLockSet();
       QDPCache::Instance().beginNewLockSet();
 
-      result = cuCtxSynchronize();
-      if (result != CUDA_SUCCESS) {
-	CudaCheckResult(result);
+      CUresult result_sync = cuCtxSynchronize();
+      w.stop();
+      if (result_sync != CUDA_SUCCESS) {
+	CudaCheckResult(result_sync);
 	LaunchPrintArgs(args);
 	QDPIO::cout << getPTXfromCUFunc(function);
 	QDP_error_exit("CUDA launch error (on sync): grid=(%u,%u,%u), block=(%d,%u,%u) ",
-		       now.Nblock_x,now.Nblock_y,1,    tune.cfg,1,1 );
+		       now.Nblock_x,now.Nblock_y,1,    block,1,1 );
       }
-    } else {
 
-      CUresult result = CUDA_ERROR_LAUNCH_OUT_OF_RESOURCES;
-      CUresult result_sync;
-      double time;
+      KernelProfile::Instance().launchEnd( function , 0 , th_count , bytes_per_thread );
+
+      if (!settled)
+	tune.report( w.getTimeInMicroseconds() );
+    }
+  }
 
-      while (result != CUDA_SUCCESS && tune.cfg > 0) {
-	kernel_geom_t now = getGeom( th_count , tune.cfg );
-	StopWatch w;
 
-	w.start();
 
-	//QDP_info("CUDA launch (trying): grid=(%u,%u,%u), block=(%d,%u,%u) ",now.Nblock_x,now.Nblock_y,1,    tune.cfg,1,1 );
 
-	result = cuLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    tune.cfg,1,1,    0, 0, &args[0] , 0);
+  void jit_set_tiling( JitTiling mode ) { tiling = mode; }
 
-	if (result != CUDA_SUCCESS && result != CUDA_ERROR_LAUNCH_OUT_OF_RESOURCES) {
-	  CudaCheckResult(result);
-	  LaunchPrintArgs(args);
-	  QDPIO::cout << getPTXfromCUFunc(function);
-	  QDP_error_exit("CUDA launch error: grid=(%u,%u,%u), block=(%d,%u,%u) ",
-			 now.Nblock_x,now.Nblock_y,1,    tune.cfg,1,1 );
-  	}
+  JitTiling jit_get_tiling() { return tiling; }
 
-	if (result == CUDA_SUCCESS) {
+  bool jit_parse_tiling( const char* str , JitTiling& mode )
+  {
+    std::string s(str);
+    if      (s == "off")  mode = JitTiling::off;
+    else if (s == "on")   mode = JitTiling::on;
+    else if (s == "auto") mode = JitTiling::autotune;
+    else return false;
+    return true;
+  }
 
-	  QDPCache::Instance().releasePrevLockSet();
-	  QDPCache::Instance().beginNewLockSet();
 
-	  result_sync = cuCtxSynchronize();
-	  if (result_sync != CUDA_SUCCESS) {
-	    CudaCheckResult(result_sync);
-	    LaunchPrintArgs(args);
-	    QDPIO::cout << getPTXfromCUFunc(function);
-	    QDP_error_exit("CUDA launch error (on sync): grid=(%u,%u,%u), block=(%d,%u,%u) ",
-			   now.Nblock_x,now.Nblock_y,1,    tune.cfg,1,1 );
-	  }
-	}
+  bool jit_tune_settled( CUfunction function )
+  {
+    const BlockSizeTuner* t = find_tuner( mapTune , function );
+    if (!t)
+      t = find_tuner( mapTuneTiled , function );
+    return t && t->settled();
+  }
 
-	w.stop();
 
-	time = w.getTimeInMicroseconds();
-	if (result != CUDA_SUCCESS)
-	  tune.cfg >>= 1;
+  double jit_tune_best_time( CUfunction function )
+  {
+    const BlockSizeTuner* t = find_tuner( mapTune , function );
+    if (!t)
+      t = find_tuner( mapTuneTiled , function );
+    return t ? t->bestTime() : 0.0;
+  }
+
+
+  void jit_set_tune_samples( int n )
+  {
+    if (n < 1)
+      QDP_error_exit("-tunesamples expects a positive number, got %d",n);
+    tune_samples = n;
+  }
+
+
+  void jit_tune_reset()
+  {
+    mapTune.clear();
+    mapTuneTiled.clear();
+    mapLastCount.clear();
+  }
+
+
+  bool jit_tile_enabled( const JitTileChoice& choice )
+  {
+    if (tiling == JitTiling::off || !Layout::policy().blocked())
+      return false;
+    return !choice.decided || choice.tiled;
+  }
+
+
+  bool jit_tile_select( JitTileChoice& choice , CUfunction plain , CUfunction tiled )
+  {
+    if (tiling == JitTiling::off)
+      return false;
+    if (choice.decided)
+      return choice.tiled;
+    if (tiling == JitTiling::on)
+      return true;
+
+    // Let both variants finish their block size search, then compare
+    if (!jit_tune_settled(plain))
+      return false;
+    if (!jit_tune_settled(tiled))
+      return true;
+
+    choice.decided = true;
+    choice.tiled = jit_tune_best_time(tiled) < jit_tune_best_time(plain);
+    QDP_info_primary("Tiling %s (plain %f, tiled %f micro secs)",
+		     choice.tiled ? "selected" : "rejected",
+		     jit_tune_best_time(plain),jit_tune_best_time(tiled));
+    return choice.tiled;
+  }
+
+
+  void jit_tile_reject( JitTileChoice& choice )
+  {
+    choice.decided = true;
+    choice.tiled = false;
+  }
+
+
+  void jit_launch_tiled( CUfunction function , int th_count , int shared_per_thread ,
+			 const std::function< std::vector<void*>& (int) >& args ,
+			 const size_t& shared_bytes ,
+			 const size_t& bytes_per_thread )
+  {
+    if ( th_count == 0 )
+      return;
+
+    int max_block = DeviceParams::Instance().getMaxBlockX();
+    if (shared_per_thread > 0)
+      max_block = std::min( max_block , DeviceParams::Instance().getMaxSMem() / shared_per_thread );
+    if (max_block < 1)
+      QDP_error_exit("Tiled kernel needs %d bytes of shared memory per thread, more than available",shared_per_thread);
+
+    // Same search as jit_launch, but the shared memory size and the
+    // arguments follow the block size
+    BlockSizeTuner& tune = get_tuner( mapTuneTiled , function , th_count , max_block );
+
+    CUresult result = CUDA_ERROR_LAUNCH_OUT_OF_RESOURCES;
+
+    while (result != CUDA_SUCCESS) {
+      bool settled = tune.settled();
+      int  block   = tune.next();
+
+      if (block == 0) {
+	CudaCheckResult(result);
+	QDP_error_exit("Tiled kernel launch failed even for block size 1. Giving up.");
+      }
+
+      kernel_geom_t now = getGeom( th_count , block );
+      std::vector<void*>& a = args( block );
+      StopWatch w;
+
+      // The halo makes the stage larger than shared_per_thread per thread
+      if (shared_bytes > (size_t)DeviceParams::Instance().getMaxSMem()) {
+	if (settled)
+	  QDP_error_exit("Tiled kernel needs %d bytes of shared memory for block size %d, more than available",
+			 (int)shared_bytes,block);
+	tune.failed();
+	continue;
       }
 
-      if (tune.cfg == 0) {
+      KernelProfile::Instance().launchBegin( 0 );
+
+      w.start();
+
+      result = cuLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    block,1,1,    shared_bytes, 0, &a[0] , 0);
+
+      if (result != CUDA_SUCCESS && (result != CUDA_ERROR_LAUNCH_OUT_OF_RESOURCES || settled)) {
 	CudaCheckResult(result);
-	QDP_error_exit("Kernel launch failed even for block size 1. Giving up.");
+	LaunchPrintArgs(a);
+	QDPIO::cout << getPTXfromCUFunc(function);
+	QDP_error_exit("CUDA launch error (tiled): grid=(%u,%u,%u), block=(%d,%u,%u), shared=%d ",
+		       now.Nblock_x,now.Nblock_y,1,    block,1,1,    (int)shared_bytes );
       }
 
-      if (time < tune.best_time || tune.best_time == 0.0) {
-	tune.best_time = time;
-	tune.best = tune.cfg;
+      if (result != CUDA_SUCCESS) {
+	tune.failed();
+	continue;
       }
 
-      // If time is much greater than our best time
-      // we are in the rising part of the performance 
-      // profile and stop searching any further
-      tune.cfg = time > 1.33 * tune.best_time || tune.cfg == 1 ? -1 : tune.cfg >> 1;
+      QDPCache::Instance().releasePrevLockSet();
+      QDPCache::Instance().beginNewLockSet();
 
-      //QDP_info("time = %f,  cfg = %d,  best = %d,  best_time = %f ", time,tune.cfg,tune.best,tune.best_time );
+      CUresult result_sync = cuCtxSynchronize();
+      w.stop();
+      if (result_sync != CUDA_SUCCESS) {
+	CudaCheckResult(result_sync);
+	LaunchPrintArgs(a);
+	QDPIO::cout << getPTXfromCUFunc(function);
+	QDP_error_exit("CUDA launch error (tiled, on sync): grid=(%u,%u,%u), block=(%d,%u,%u) ",
+		       now.Nblock_x,now.Nblock_y,1,    block,1,1 );
+      }
+
+      KernelProfile::Instance().launchEnd( function , 0 , th_count , bytes_per_thread );
+
+      if (!settled)
+	tune.report( w.getTimeInMicroseconds() );
     }
   }
 
 
 
-
   int jit_autotuning(CUfunction function,int lo,int hi,void ** param)
   {
     // Check for thread count equals zero
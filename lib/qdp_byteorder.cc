@@ -7,8 +7,12 @@
 //     2  = little-endian (sun, ibm, hp, etc)
 //
 
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
+#include <vector>
 #include "qdp_byteorder.h"
+#include "qdp_host_threads.h"
 
 namespace QDPUtil
 {
@@ -27,151 +31,149 @@ namespace QDPUtil
   }
 
 
-  //! Byte-swap an array of data each of size nmemb
-  void byte_swap(void *ptr, size_t size, size_t nmemb)
+  namespace
   {
-    unsigned int j;
-
-    char char_in[16];		/* characters used in byte swapping */
-
-    char *in_ptr;
-    double *double_ptr;		/* Pointer used in the double routines */
-
-    switch (size)
+    typedef unsigned long long n_uint64_t;
+
+#if defined(__GNUC__)
+    inline n_uint16_t bswap(n_uint16_t x) { return __builtin_bswap16(x); }
+    inline n_uint32_t bswap(n_uint32_t x) { return __builtin_bswap32(x); }
+    inline n_uint64_t bswap(n_uint64_t x) { return __builtin_bswap64(x); }
+#else
+    inline n_uint16_t bswap(n_uint16_t x) { return (x >> 8) | (x << 8); }
+    inline n_uint32_t bswap(n_uint32_t x)
     {
-    case 4:  /* n_uint32_t */
+      return (x >> 24) | (x >> 8 & 0x0000ff00) | (x << 8 & 0x00ff0000) | (x << 24);
+    }
+    inline n_uint64_t bswap(n_uint64_t x)
     {
-      n_uint32_t *w = (n_uint32_t *)ptr;
-      register n_uint32_t old, recent;
-
-      for(j=0; j<nmemb; j++)
-      {
-	old = w[j];
-	recent = old >> 24 & 0x000000ff;
-	recent |= old >> 8 & 0x0000ff00;
-	recent |= old << 8 & 0x00ff0000;
-	recent |= old << 24 & 0xff000000;
-	w[j] = recent;
-      }
+      return (n_uint64_t)bswap((n_uint32_t)x) << 32 | bswap((n_uint32_t)(x >> 32));
     }
-    break;
+#endif
 
-    case 1:  /* n_uint8_t: byte - do nothing */
-      break;
-
-    case 8:  /* n_uint64_t */
+    //! Words go through memcpy, so neither pointer needs to be aligned
+    template<class W>
+    void swap_words(char *dst, const char *src, size_t nmemb)
     {
-      for(j = 0, double_ptr = (double *) ptr;
-	  j < nmemb;
-	  j++, double_ptr++)
+      for(size_t j=0; j < nmemb; j++)
       {
-	in_ptr = (char *) double_ptr; /* Set the character pointer to
-					 point to the start of the double */
-
-	/*
-	 *  Assign all the byte variables to a character
-	 */
-	char_in[0] = in_ptr[0];
-	char_in[1] = in_ptr[1];
-	char_in[2] = in_ptr[2];
-	char_in[3] = in_ptr[3];
-	char_in[4] = in_ptr[4];
-	char_in[5] = in_ptr[5];
-	char_in[6] = in_ptr[6];
-	char_in[7] = in_ptr[7];
-
-	/*
-	 *  Now just swap the order
-	 */
-	in_ptr[0] = char_in[7];
-	in_ptr[1] = char_in[6];
-	in_ptr[2] = char_in[5];
-	in_ptr[3] = char_in[4];
-	in_ptr[4] = char_in[3];
-	in_ptr[5] = char_in[2];
-	in_ptr[6] = char_in[1];
-	in_ptr[7] = char_in[0];
+	W w;
+	memcpy(&w, src + j*sizeof(W), sizeof(W));
+	w = bswap(w);
+	memcpy(dst + j*sizeof(W), &w, sizeof(W));
       }
     }
-    break;
 
-    case 16:  /* Long Long */
+    void swap_words16(char *dst, const char *src, size_t nmemb)
     {
-      for(j = 0, double_ptr = (double *) ptr;
-	  j < nmemb;
-	  j++, double_ptr+=2)
+      for(size_t j=0; j < nmemb; j++)
       {
-
-	in_ptr = (char *) double_ptr; /* Set the character pointer to
-					 point to the start of the double */
-
-	/*
-	 *  Assign all the byte variables to a character
-	 */
-	char_in[0] = in_ptr[0];
-	char_in[1] = in_ptr[1];
-	char_in[2] = in_ptr[2];
-	char_in[3] = in_ptr[3];
-	char_in[4] = in_ptr[4];
-	char_in[5] = in_ptr[5];
-	char_in[6] = in_ptr[6];
-	char_in[7] = in_ptr[7];
-	char_in[8] = in_ptr[8];
-	char_in[9] = in_ptr[9];
-	char_in[10] = in_ptr[10];
-	char_in[11] = in_ptr[11];
-	char_in[12] = in_ptr[12];
-	char_in[13] = in_ptr[13];
-	char_in[14] = in_ptr[14];
-	char_in[15] = in_ptr[15];
-
-	/*
-	 *  Now just swap the order
-	 */
-	in_ptr[0] = char_in[15];
-	in_ptr[1] = char_in[14];
-	in_ptr[2] = char_in[13];
-	in_ptr[3] = char_in[12];
-	in_ptr[4] = char_in[11];
-	in_ptr[5] = char_in[10];
-	in_ptr[6] = char_in[9];
-	in_ptr[7] = char_in[8];
-
-	in_ptr[8] = char_in[7];
-	in_ptr[9] = char_in[6];
-	in_ptr[10] = char_in[5];
-	in_ptr[11] = char_in[4];
-	in_ptr[12] = char_in[3];
-	in_ptr[13] = char_in[2];
-	in_ptr[14] = char_in[1];
-	in_ptr[15] = char_in[0];
-
+	n_uint64_t lo, hi;
+	memcpy(&lo, src + 16*j, 8);
+	memcpy(&hi, src + 16*j + 8, 8);
+	lo = bswap(lo);
+	hi = bswap(hi);
+	memcpy(dst + 16*j, &hi, 8);
+	memcpy(dst + 16*j + 8, &lo, 8);
       }
     }
-    break;
 
-    case 2:  /* n_uint16_t */
+    //! Bytes per block of byte_swap_crc32, small enough to stay in L1
+    const size_t swap_block_bytes = 16384;
+
+    n_uint32_t swap_crc32_serial(n_uint32_t crc, char *dst, const char *src, size_t size, size_t nmemb,
+				 bool crc_of_dst)
     {
-      n_uint16_t *w = (n_uint16_t *)ptr;
-      register n_uint16_t old, recent;
+      size_t block = swap_block_bytes / size;
+      if (block == 0)
+	block = 1;
 
-      for(j=0; j<nmemb; j++)
+      for(size_t j=0; j < nmemb; j += block)
       {
-	old = w[j];
-	recent = old >> 8 & 0x00ff;
-	recent |= old << 8 & 0xff00;
-	w[j] = recent;
+	size_t n = std::min(block, nmemb - j);
+	const char *s = src + j*size;
+	char *d = dst + j*size;
+
+	if (! crc_of_dst)
+	  crc = crc32(crc, s, n*size);
+	byte_swap_copy(d, s, size, n);
+	if (crc_of_dst)
+	  crc = crc32(crc, d, n*size);
       }
+      return crc;
     }
-    break;
+  }
+
+
+  //! Byte-swap an array of data each of size nmemb
+  void byte_swap(void *ptr, size_t size, size_t nmemb)
+  {
+    byte_swap_copy(ptr, ptr, size, nmemb);
+  }
+
+
+  //! Byte-swap nmemb words of size bytes from src into dst, which may be src
+  void byte_swap_copy(void *dst, const void *src, size_t size, size_t nmemb)
+  {
+    char *d = (char *)dst;
+    const char *s = (const char *)src;
+
+    switch (size)
+    {
+    case 1:  /* n_uint8_t: byte - only copy */
+      if (d != s)
+	memmove(d, s, nmemb);
+      break;
+
+    case 2:  /* n_uint16_t */
+      swap_words<n_uint16_t>(d, s, nmemb);
+      break;
+
+    case 4:  /* n_uint32_t */
+      swap_words<n_uint32_t>(d, s, nmemb);
+      break;
+
+    case 8:  /* n_uint64_t */
+      swap_words<n_uint64_t>(d, s, nmemb);
+      break;
+
+    case 16:  /* Long Long */
+      swap_words16(d, s, nmemb);
+      break;
 
     default:
-      fprintf(stderr,"%s: unsupported word size = %d\n",__func__,size);
+      fprintf(stderr,"%s: unsupported word size = %d\n",__func__,(int)size);
       exit(1);
     }
   }
 
 
+  //! Byte-swap from src into dst and update the crc32 in the same pass
+  n_uint32_t byte_swap_crc32(n_uint32_t crc, void *dst, const void *src, size_t size, size_t nmemb,
+			     bool crc_of_dst)
+  {
+    char *d = (char *)dst;
+    const char *s = (const char *)src;
+
+    // Large arrays: one piece per host worker, checksums merged in order
+    int nw = QDP::hostThreadsGetCount();
+    if (size*nmemb >= crc32_parallel_bytes && nw > 1)
+    {
+      std::vector<n_uint32_t> part(nw, 0);
+      std::vector<size_t> plen(nw, 0);
+      QDP::hostParallelFor(nmemb, nmemb, false, [&](size_t lo, size_t hi, int w) {
+	  part[w] = swap_crc32_serial(0, d + lo*size, s + lo*size, size, hi - lo, crc_of_dst);
+	  plen[w] = (hi - lo)*size;
+	});
+      for(int w=0; w < nw; w++)
+	crc = crc32_combine(crc, part[w], plen[w]);
+      return crc;
+    }
+
+    return swap_crc32_serial(crc, d, s, size, nmemb, crc_of_dst);
+  }
+
+
   //! fread on a binary file written in big-endian order
   size_t bfread(void *ptr, size_t size, size_t nmemb, FILE *stream)
   {
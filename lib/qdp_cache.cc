@@ -6,10 +6,28 @@
 
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
 
 namespace QDP
 {
 
+  namespace {
+    const size_t trace_max_events = 1 << 22;
+    const size_t retired_pulls_max = 64;
+
+    //! Seconds since the first call, the time base of the trace
+    double cache_clock() {
+      static const uint64_t t0 = getClockNanoseconds();
+      return 1.0e-9 * ( getClockNanoseconds() - t0 );
+    }
+
+    bool morePulls( const QDPCache::HostPulls& a , const QDPCache::HostPulls& b ) {
+      return a.pulls > b.pulls;
+    }
+  }
+
 
   struct QDPCache::Entry {
     int    Id;
@@ -20,6 +38,19 @@ namespace QDP
     int    lockCount;
     list<int>::iterator iterTrack;
     LayoutFptr fptr;
+    bool   slab;    // host memory came from the slab allocator
+    size_t hostPulls;  // device copies pulled back by getHostPtr
+  };
+
+
+  struct QDPCache::TraceEvent {
+    char        ph;     // X: transfer, i: transition, C: residency counter
+    const char* name;
+    int         id;
+    double      ts;
+    double      dur;
+    size_t      a;      // bytes, or device bytes for C
+    size_t      b;      // host bytes for C
   };
 
 
@@ -78,18 +109,22 @@ namespace QDP
 	QDP_error_exit("cache allocate_device_static: can't spill LRU object");
       }
     }
-    lstStatic.push_back(*ptr);
+    lstStatic.push_back( std::make_pair( *ptr , n_bytes ) );
+    addDevice( n_bytes );
     return true;
   }
 
   void QDPCache::free_device_static( void* ptr ) {
     CUDADevicePoolAllocator::Instance().free( ptr );
 
-    list<void*>::iterator i = find( lstStatic.begin() , lstStatic.end() , ptr );
+    list< pair<void*,size_t> >::iterator i = lstStatic.begin();
+    while ( i != lstStatic.end() && i->first != ptr )
+      ++i;
 
     if (i == lstStatic.end())
       QDP_error_exit("Cache static free: Pointer not found in record");
 
+    addDevice( -(long)i->second );
     lstStatic.erase(i);
   }
 
@@ -161,6 +196,8 @@ namespace QDP
     e.lockCount = 0;
     e.iterTrack = lstTracker.insert( lstTracker.end() , Id );
     e.fptr      = func;
+    e.slab      = false;
+    e.hostPulls = 0;
       
     stackFree.pop();
 
@@ -200,6 +237,8 @@ namespace QDP
     e.devPtr    = NULL;
     e.lockCount = 0;
     e.iterTrack = lstTracker.insert( lstTracker.end() , Id );
+    e.slab      = false;
+    e.hostPulls = 0;
       
     stackFree.pop();
 
@@ -311,8 +350,13 @@ namespace QDP
 #ifdef GPU_DEBUG_DEEP
       QDP_debug_deep("cache delete obj host memory flag=0");
 #endif
-      CUDAHostPoolAllocator::Instance().free( e.hstPtr );
+      if (e.slab)
+	QDPSlabAllocator::Instance().free( e.hstPtr , e.size );
+      else
+	CUDAHostPoolAllocator::Instance().free( e.hstPtr );
       e.hstPtr=NULL;
+      e.slab=false;
+      addHost( -(long)e.size );
       break;
     case 1:
 #ifdef GPU_DEBUG_DEEP
@@ -320,6 +364,7 @@ namespace QDP
 #endif
       QDP::Allocator::theQDPAllocator::Instance().free( e.hstPtr );
       e.hstPtr=NULL;
+      addHost( -(long)e.size );
       break;
     case 2:
       // Do nothing, this object deallocates its own host memory
@@ -348,6 +393,12 @@ namespace QDP
     switch(e.flags) {
     case 0:
 
+      // Small objects (mostly OScalar) go to the slab allocator
+      if ( QDPSlabAllocator::Instance().allocate( &e.hstPtr , e.size ) ) {
+	e.slab = true;
+	break;
+      }
+
       if ( !CUDAHostPoolAllocator::Instance().allocate( &e.hstPtr , e.size ) )
 	QDP_error_exit("cache allocateHostMemory: host memory allocator flags=0 failed");
 
@@ -377,6 +428,8 @@ namespace QDP
       QDP_error_exit("cache allocateHostMemory: not allocated, but should");
 #endif
 
+    addHost( e.size );
+
   }
 
 
@@ -393,8 +446,10 @@ namespace QDP
 	  QDP_error_exit("cache assureDevice: can't spill LRU object. Out of GPU memory!");
 	}
       }
+      addDevice( e.size );
       if (e.hstPtr) {
 	//	CudaMemcpyAsync( e.devPtr , e.hstPtr , e.size );
+	double t0;
 	if (e.fptr) {
 	  
 	  int tmp = registrate( e.size , 1 , NULL );
@@ -403,19 +458,41 @@ namespace QDP
 	  lockId(tmp);
 
 	  //std::cout << "call layout changer\n";
+	  t0 = cache_clock();
 	  e.fptr(true,hstptr,e.hstPtr);
+	  double t1 = cache_clock();
+	  stats.layout_count++;
+	  stats.layout_bytes += e.size;
+	  stats.layout_time  += t1 - t0;
+	  trace( 'X' , "layout" , e.Id , t0 , t1 - t0 , e.size );
+
 	  //std::cout << "copy data to device\n";
+	  t0 = t1;
 	  CudaMemcpyH2D( e.devPtr , hstptr , e.size );
+	  CudaSyncTransferStream();
 	  signoff(tmp);
 
 	} else {
 	  //std::cout << "copy data to device (no layout change)\n";
+	  t0 = cache_clock();
 	  CudaMemcpyH2D( e.devPtr , e.hstPtr , e.size );
+	  CudaSyncTransferStream();
 	}
-	CudaSyncTransferStream();
+	double t1 = cache_clock();
+	stats.h2d_count++;
+	stats.h2d_bytes += e.size;
+	stats.h2d_time  += t1 - t0;
+	trace( 'X' , "H2D" , e.Id , t0 , t1 - t0 , e.size );
 	if (e.flags != 2)
 	  freeHostMemory(e);
       }
+#ifdef QDP_USE_PTX_EMULATOR
+      else {
+	// Nothing to upload: let the first kernel writing the object place
+	// its pages, on the NUMA nodes of the host workers that own the sites
+	hostReleasePages( e.devPtr , e.size );
+      }
+#endif
     }
 
     // This might be a stupid sanity check
@@ -446,7 +523,7 @@ namespace QDP
 
 
 
-  bool QDPCache::assureHost(Entry& e) {
+  bool QDPCache::assureHost(Entry& e, bool evict) {
       
 #ifdef SANITY_CHECKS_CACHE
     // SANITY
@@ -460,6 +537,8 @@ namespace QDP
 #ifdef GPU_DEBUG_DEEP
       QDP_debug_deep("cache assure on host. obj in current calculation. will sync device");
 #endif
+      stats.sync_host++;
+      trace( 'i' , "sync" , e.Id , cache_clock() , 0 , e.size );
       CudaDeviceSynchronize();
       //CudaSyncKernelStream();
       releasePrevLockSet();
@@ -476,29 +555,54 @@ namespace QDP
       if (e.devPtr) {
 	CUDADevicePoolAllocator::Instance().free( e.devPtr );
 	e.devPtr = NULL;
+	addDevice( -(long)e.size );
       }
     } else {
       if (!e.hstPtr) {
 	allocateHostMemory(e);
 	if (e.devPtr) {
+	  if (!evict) {
+	    stats.spill_host++;
+	    e.hostPulls++;
+	    trace( 'i' , "host access" , e.Id , cache_clock() , 0 , e.size );
+	  }
 	  // CudaMemcpyAsync( e.hstPtr , e.devPtr , e.size );
 	  //CudaMemcpyD2HAsync( e.hstPtr , e.devPtr , e.size );
+	  double t0 = cache_clock();
 	  if (e.fptr) {
 	    //std::cout << "allocating host memory to store data in device format " << e.size << "\n";
 	    char * tmp = new char[e.size];
 	    //std::cout << "copy data to host\n";
 	    CudaMemcpyD2H( tmp , e.devPtr , e.size );
+	    CudaSyncTransferStream();
+	    double t1 = cache_clock();
+	    stats.d2h_count++;
+	    stats.d2h_bytes += e.size;
+	    stats.d2h_time  += t1 - t0;
+	    trace( 'X' , "D2H" , e.Id , t0 , t1 - t0 , e.size );
+
 	    //std::cout << "call layout changer\n";
 	    e.fptr(false,e.hstPtr,tmp);
+	    double t2 = cache_clock();
+	    stats.layout_count++;
+	    stats.layout_bytes += e.size;
+	    stats.layout_time  += t2 - t1;
+	    trace( 'X' , "layout" , e.Id , t1 , t2 - t1 , e.size );
 	    delete[] tmp;
 	  } else {
 	    //std::cout << "copy data to host (no layout change)\n";
 	    CudaMemcpyD2H( e.hstPtr , e.devPtr , e.size );
+	    CudaSyncTransferStream();
+	    double t1 = cache_clock();
+	    stats.d2h_count++;
+	    stats.d2h_bytes += e.size;
+	    stats.d2h_time  += t1 - t0;
+	    trace( 'X' , "D2H" , e.Id , t0 , t1 - t0 , e.size );
 	  }
 
-	  CudaSyncTransferStream();
 	  CUDADevicePoolAllocator::Instance().free( e.devPtr );
 	  e.devPtr = NULL;
+	  addDevice( -(long)e.size );
 	}
       }
     }
@@ -534,7 +638,9 @@ namespace QDP
 #ifdef GPU_DEBUG_DEEP
       QDP_debug_deep("cache: spill_lru: not locked obj found, will spill now. size=%u devPtr=%p *it_key=%d id=%d",e->size,e->devPtr,*it_key,e->Id);
 #endif
-      assureHost( *e );
+      stats.spill_alloc++;
+      trace( 'i' , "evict" , e->Id , cache_clock() , 0 , e->size );
+      assureHost( *e , true );
       return true;
     } else {
 #ifdef GPU_DEBUG_DEEP
@@ -597,11 +703,16 @@ namespace QDP
 	  
 	if (e.devPtr) {
 	  CUDADevicePoolAllocator::Instance().free( e.devPtr );
+	  e.devPtr = NULL;
+	  addDevice( -(long)e.size );
 	}
 
 	if (e.hstPtr)
 	  freeHostMemory(e);
 
+	retirePulls( e );
+	trace( 'i' , "free" , e.Id , cache_clock() , 0 , e.size );
+
 	stackFree.push( *i );
 	lstDel.erase( i++ );
 
@@ -613,7 +724,8 @@ namespace QDP
 
 
 
-  QDPCache::QDPCache() : currLS(0) , prevLS(-1), vecEntry(1024) {
+  QDPCache::QDPCache() : currLS(0) , prevLS(-1), vecEntry(1024), print_stats(false), trace_dropped(0) {
+    memset( &stats , 0 , sizeof(Stats) );
 #ifdef GPU_DEBUG_DEEP
     QDP_info_primary("Constructing cache ..");
     QDP_info_primary("cache: pushing %u elements into stack",(unsigned)vecEntry.size());
@@ -632,6 +744,165 @@ namespace QDP
 
 
 
+  void QDPCache::addDevice( long n ) {
+    stats.device_bytes += n;
+    stats.device_peak = std::max( stats.device_peak , stats.device_bytes );
+    trace( 'C' , "residency" , -1 , cache_clock() , 0 , 0 );
+  }
+
+  void QDPCache::addHost( long n ) {
+    stats.host_bytes += n;
+    stats.host_peak = std::max( stats.host_peak , stats.host_bytes );
+    trace( 'C' , "residency" , -1 , cache_clock() , 0 , 0 );
+  }
+
+
+  void QDPCache::trace( char ph , const char* name , int id , double ts , double dur , size_t size ) {
+    if (trace_file.empty())
+      return;
+    if (vecTrace.size() >= trace_max_events) {
+      trace_dropped++;
+      return;
+    }
+    TraceEvent ev;
+    ev.ph   = ph;
+    ev.name = name;
+    ev.id   = id;
+    ev.ts   = ts;
+    ev.dur  = dur;
+    ev.a    = ph == 'C' ? stats.device_bytes : size;
+    ev.b    = stats.host_bytes;
+    vecTrace.push_back( ev );
+  }
+
+
+  void QDPCache::retirePulls( const Entry& e ) {
+    if (e.hostPulls == 0)
+      return;
+    HostPulls p = { e.Id , e.size , e.hostPulls };
+    retiredPulls.push_back( p );
+    if (retiredPulls.size() > 2 * retired_pulls_max) {
+      std::sort( retiredPulls.begin() , retiredPulls.end() , morePulls );
+      retiredPulls.resize( retired_pulls_max );
+    }
+  }
+
+
+  std::vector<QDPCache::HostPulls> QDPCache::topHostPulls( size_t n ) const {
+    std::vector<HostPulls> ret( retiredPulls );
+    for ( list<int>::const_iterator i = lstTracker.begin() ; i != lstTracker.end() ; ++i ) {
+      const Entry& e = vecEntry[*i];
+      if (e.hostPulls > 0) {
+	HostPulls p = { e.Id , e.size , e.hostPulls };
+	ret.push_back( p );
+      }
+    }
+    std::sort( ret.begin() , ret.end() , morePulls );
+    if (ret.size() > n)
+      ret.resize( n );
+    return ret;
+  }
+
+
+  void QDPCache::resetStats() {
+    size_t device_bytes = stats.device_bytes;
+    size_t host_bytes   = stats.host_bytes;
+    memset( &stats , 0 , sizeof(Stats) );
+    stats.device_bytes = stats.device_peak = device_bytes;
+    stats.host_bytes   = stats.host_peak   = host_bytes;
+    retiredPulls.clear();
+  }
+
+
+  void QDPCache::printStats() {
+    if (!print_stats)
+      return;
+
+    const double GB = 1.0e9;
+    QDP_info_primary("Cache statistics:");
+    QDP_info_primary("  H2D     %8lu copies %12.3f GB %10.4f s %8.2f GB/s",
+		     (unsigned long)stats.h2d_count , stats.h2d_bytes / GB , stats.h2d_time ,
+		     stats.h2d_time > 0 ? stats.h2d_bytes / GB / stats.h2d_time : 0.0 );
+    QDP_info_primary("  D2H     %8lu copies %12.3f GB %10.4f s %8.2f GB/s",
+		     (unsigned long)stats.d2h_count , stats.d2h_bytes / GB , stats.d2h_time ,
+		     stats.d2h_time > 0 ? stats.d2h_bytes / GB / stats.d2h_time : 0.0 );
+    QDP_info_primary("  layout  %8lu calls  %12.3f GB %10.4f s",
+		     (unsigned long)stats.layout_count , stats.layout_bytes / GB , stats.layout_time );
+    QDP_info_primary("  spills: %lu to make room on the device, %lu by host access, %lu host accesses forced a device sync",
+		     (unsigned long)stats.spill_alloc , (unsigned long)stats.spill_host , (unsigned long)stats.sync_host );
+    QDP_info_primary("  peak resident: device %lu bytes, host %lu bytes",
+		     (unsigned long)stats.device_peak , (unsigned long)stats.host_peak );
+    QDP_info_primary("  pool high-water marks: device %lu of %lu bytes, host %lu of %lu bytes",
+		     (unsigned long)CUDADevicePoolAllocator::Instance().getBytesPeak() ,
+		     (unsigned long)CUDADevicePoolAllocator::Instance().getPoolSize() ,
+		     (unsigned long)CUDAHostPoolAllocator::Instance().getBytesPeak() ,
+		     (unsigned long)CUDAHostPoolAllocator::Instance().getPoolSize() );
+
+    // Objects bouncing between device and host usually come from
+    // element access (e.g. OLattice::elem) inside a user loop
+    std::vector<HostPulls> top = topHostPulls( 5 );
+    for ( size_t i = 0 ; i < top.size() ; ++i )
+      QDP_info_primary("  pulled to host %lu times: id=%d size=%lu",
+		       (unsigned long)top[i].pulls , top[i].id , (unsigned long)top[i].size );
+  }
+
+
+  void QDPCache::setTraceFile( const std::string& file ) {
+    trace_file = file;
+    vecTrace.reserve( 1 << 16 );
+    cache_clock();
+    QDP_info_primary("Cache trace will be written to %s",file.c_str());
+  }
+
+
+  void QDPCache::writeTrace() {
+    if (trace_file.empty())
+      return;
+
+    // One file per node, Chrome's trace viewer can load several
+    std::string name = trace_file;
+    if (Layout::numNodes() > 1) {
+      std::ostringstream n;
+      n << trace_file << "." << Layout::nodeNumber();
+      name = n.str();
+    }
+
+    std::ofstream out( name.c_str() );
+    if (!out) {
+      QDP_info("Cache trace: cannot open %s",name.c_str());
+      return;
+    }
+
+    int pid = Layout::nodeNumber();
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << pid
+	<< ", \"args\": {\"name\": \"QDPCache node " << pid << "\"}}";
+    for ( size_t i = 0 ; i < vecTrace.size() ; ++i ) {
+      const TraceEvent& ev = vecTrace[i];
+      out << ",\n{\"name\": \"" << ev.name << "\", \"ph\": \"" << ev.ph << "\", \"ts\": " << 1.0e6 * ev.ts
+	  << ", \"pid\": " << pid;
+      switch (ev.ph) {
+      case 'C':
+	out << ", \"args\": {\"device\": " << ev.a << ", \"host\": " << ev.b << "}}";
+	break;
+      case 'X':
+	out << ", \"tid\": " << ev.id << ", \"dur\": " << 1.0e6 * ev.dur
+	    << ", \"args\": {\"bytes\": " << ev.a << "}}";
+	break;
+      default:
+	out << ", \"tid\": " << ev.id << ", \"s\": \"t\", \"args\": {\"bytes\": " << ev.a << "}}";
+      }
+    }
+    out << "\n]}\n";
+
+    if (trace_dropped)
+      QDP_info("Cache trace: %lu events dropped after %lu",(unsigned long)trace_dropped,(unsigned long)trace_max_events);
+    QDP_info_primary("Cache trace of %lu events written to %s",(unsigned long)vecTrace.size(),name.c_str());
+  }
+
+
+
 
 
 }
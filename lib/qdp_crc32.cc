@@ -38,7 +38,9 @@ Comments) 1950 to 1952 in the files ftp://ds.internic.net/rfc/rfc1950.txt
 */
 
 #include <cstdlib>
+#include <vector>
 #include "qdp_byteorder.h"
+#include "qdp_host_threads.h"
 
 namespace QDPUtil
 {
@@ -174,33 +176,129 @@ namespace QDPUtil
     return (uLongf *)crc_table;
   }
 
-/* ========================================================================= */
-#define DO1(buf) crc = crc_table[((int)crc ^ (*buf++)) & 0xff] ^ (crc >> 8);
-#define DO2(buf)  DO1(buf); DO1(buf);
-#define DO4(buf)  DO2(buf); DO2(buf);
-#define DO8(buf)  DO4(buf); DO4(buf);
+/* =========================================================================
+ * Slicing-by-16: crc_slice[k][b] is the CRC of the byte b followed by k
+ * zero bytes, so 16 bytes cost 16 independent table lookups. The words are
+ * composed from bytes, which keeps it independent of the host byte order.
+ */
+  namespace
+  {
+    struct SliceTables
+    {
+      uLong t[16][256];
+
+      SliceTables()
+      {
+	const uLongf* crc_table = get_crc_table();
+	for (int n = 0; n < 256; n++)
+	{
+	  t[0][n] = crc_table[n];
+	  for (int k = 1; k < 16; k++)
+	    t[k][n] = crc_table[t[k-1][n] & 0xff] ^ (t[k-1][n] >> 8);
+	}
+      }
+    };
+
+    const SliceTables& slice_tables()
+    {
+      static const SliceTables tables;
+      return tables;
+    }
+
+    //! The CRC register (not inverted) after buf
+    uLong crc32_update(uLong crc, const Byte *buf, size_t len)
+    {
+      const uLong (*t)[256] = slice_tables().t;
+
+      while (len >= 16)
+      {
+	uLong one = crc ^ ((uLong)buf[0] | (uLong)buf[1] << 8 | (uLong)buf[2] << 16 | (uLong)buf[3] << 24);
+	crc = t[15][one & 0xff] ^ t[14][(one >> 8) & 0xff] ^ t[13][(one >> 16) & 0xff] ^ t[12][one >> 24]
+	  ^ t[11][buf[4]]  ^ t[10][buf[5]]  ^ t[9][buf[6]]  ^ t[8][buf[7]]
+	  ^ t[7][buf[8]]   ^ t[6][buf[9]]   ^ t[5][buf[10]] ^ t[4][buf[11]]
+	  ^ t[3][buf[12]]  ^ t[2][buf[13]]  ^ t[1][buf[14]] ^ t[0][buf[15]];
+	buf += 16;
+	len -= 16;
+      }
+      while (len--)
+	crc = t[0][(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+
+      return crc;
+    }
+
+    /* Arithmetic modulo the polynomial for crc32_combine, as in zlib 1.2.12:
+       the lowest power is in the most significant bit */
+    const uLong POLY = 0xedb88320L;
+
+    //! a*b modulo p
+    uLong multmodp(uLong a, uLong b)
+    {
+      uLong m = (uLong)1 << 31;
+      uLong p = 0;
+      for (;;)
+      {
+	if (a & m)
+	{
+	  p ^= b;
+	  if ((a & (m - 1)) == 0)
+	    break;
+	}
+	m >>= 1;
+	b = b & 1 ? (b >> 1) ^ POLY : b >> 1;
+      }
+      return p;
+    }
+
+    //! x^(n*2^k) modulo p
+    uLong x2nmodp(size_t n, unsigned k)
+    {
+      static const struct X2n
+      {
+	uLong t[32];
+	X2n()
+	{
+	  uLong p = (uLong)1 << 30;   // x^1
+	  for (int n = 0; n < 32; n++)
+	  {
+	    t[n] = p;
+	    p = multmodp(p, p);
+	  }
+	}
+      } x2n;
+
+      uLong p = (uLong)1 << 31;     // x^0 == 1
+      while (n)
+      {
+	if (n & 1)
+	  p = multmodp(x2n.t[k & 31], p);
+	n >>= 1;
+	k++;
+      }
+      return p;
+    }
+  }
 
 /* ========================================================================= */
   n_uint32_t crc32(n_uint32_t crc, const unsigned char *buf, size_t len)
   {
     if (buf == Z_NULL) return 0L;
-#ifdef DYNAMIC_CRC_TABLE
-    if (crc_table_empty)
-      make_crc_table();
-#endif
-    crc = crc ^ 0xffffffffL;
-    while (len >= 8)
-    {
-      DO8(buf);
-      len -= 8;
-    }
-    if (len) 
+
+    // Large buffers: one piece per host worker, merged in order
+    int nw = QDP::hostThreadsGetCount();
+    if (len >= crc32_parallel_bytes && nw > 1)
     {
-      do {
-	DO1(buf);
-      } while (--len);
+      std::vector<uLong> part(nw, 0);
+      std::vector<size_t> plen(nw, 0);
+      QDP::hostParallelFor(len, len, false, [&](size_t lo, size_t hi, int w) {
+	  part[w] = crc32_update(0xffffffffL, buf + lo, hi - lo) ^ 0xffffffffL;
+	  plen[w] = hi - lo;
+	});
+      for (int w = 0; w < nw; w++)
+	crc = crc32_combine(crc, part[w], plen[w]);
+      return crc;
     }
-    return crc ^ 0xffffffffL;
+
+    return crc32_update(crc ^ 0xffffffffL, buf, len) ^ 0xffffffffL;
   }
 
 
@@ -211,4 +309,11 @@ namespace QDPUtil
     return crc32(crc, (const unsigned char*)(buf), len);
   }
 
+
+/* ========================================================================= */
+  n_uint32_t crc32_combine(n_uint32_t crc1, n_uint32_t crc2, size_t len2)
+  {
+    return multmodp(x2nmodp(len2, 3), crc1) ^ crc2;
+  }
+
 } // namespace QDPUtil
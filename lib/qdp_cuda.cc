@@ -13,7 +13,9 @@
 
 #include <string>
 
+#ifndef QDP_USE_PTX_EMULATOR
 #include "cudaProfiler.h"
+#endif
 
 using namespace std;
 
@@ -83,7 +85,8 @@ namespace QDP {
   void CudaLaunchKernel( CUfunction f, 
 			 unsigned int  gridDimX, unsigned int  gridDimY, unsigned int  gridDimZ, 
 			 unsigned int  blockDimX, unsigned int  blockDimY, unsigned int  blockDimZ, 
-			 unsigned int  sharedMemBytes, CUstream hStream, void** kernelParams, void** extra )
+			 unsigned int  sharedMemBytes, CUstream hStream, void** kernelParams, void** extra,
+			 size_t bytes_per_thread )
   {
 #ifdef GPU_DEBUG_DEEP
     QDP_debug_deep("CudaLaunchKernel ... ");
@@ -95,7 +98,9 @@ namespace QDP {
     // CudaSyncKernelStream();
 
     // This call is async
-    if ( blockDimX * blockDimY * blockDimZ > 0  &&  gridDimX * gridDimY * gridDimZ > 0 ) {
+    bool launched = blockDimX * blockDimY * blockDimZ > 0  &&  gridDimX * gridDimY * gridDimZ > 0;
+    if ( launched ) {
+      KernelProfile::Instance().launchBegin( QDPcudastreams[KERNEL] );
       CUresult result = cuLaunchKernel(f, gridDimX, gridDimY, gridDimZ, 
 				       blockDimX, blockDimY, blockDimZ, 
 				       sharedMemBytes, QDPcudastreams[KERNEL], kernelParams, extra);
@@ -124,6 +129,11 @@ namespace QDP {
     }
     //CudaDeviceSynchronize();
 
+    if ( launched )
+      KernelProfile::Instance().launchEnd( f , QDPcudastreams[KERNEL] ,
+					   (size_t)gridDimX * gridDimY * gridDimZ * blockDimX * blockDimY * blockDimZ ,
+					   bytes_per_thread );
+
     if (DeviceParams::Instance().getSyncDevice()) {  
       QDP_info_primary("Pulling the brakes: device sync after kernel launch!");
       //CudaDeviceSynchronize();
@@ -209,6 +219,16 @@ namespace QDP {
     return data;
   }
 
+  double CudaPeakBandwidth()
+  {
+    int clock_khz, bus_bits;
+    if ( cuDeviceGetAttribute( &clock_khz , CU_DEVICE_ATTRIBUTE_MEMORY_CLOCK_RATE , cuDevice ) != CUDA_SUCCESS ||
+	 cuDeviceGetAttribute( &bus_bits , CU_DEVICE_ATTRIBUTE_GLOBAL_MEMORY_BUS_WIDTH , cuDevice ) != CUDA_SUCCESS )
+      return 0.0;
+    // Double data rate
+    return 2.0 * 1.0e3 * clock_khz * bus_bits / 8;
+  }
+
   void CudaGetSM(int* maj,int* min) {
     CUresult ret;
     ret = cuDeviceComputeCapability( maj , min , cuDevice );
@@ -278,6 +298,16 @@ namespace QDP {
   }
 
 
+  // Bind the QDP context to the calling thread (needed by worker
+  // threads that call into the driver API)
+  void CudaSetCurrentContext()
+  {
+    CUresult ret;
+    ret = cuCtxSetCurrent(cuContext);
+    CudaRes("cuCtxSetCurrent",ret);
+  }
+
+
 
   void CudaGetDeviceProps()
   {
@@ -0,0 +1,163 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Host conversions for the 16-bit floating point storage words
+ *
+ * The JIT emits the equivalent PTX sequences, see jit_ins_load and
+ * jit_ins_store. Both sides must agree bit for bit.
+ */
+
+#include "qdp_half.h"
+
+#include <cstring>
+#include <string>
+
+namespace QDP {
+
+  namespace {
+    HalfRounding half_rounding = HalfRounding::rn;
+
+    inline unsigned int float_bits( float f ) {
+      unsigned int u;
+      std::memcpy( &u , &f , sizeof(u) );
+      return u;
+    }
+
+    inline float bits_float( unsigned int u ) {
+      float f;
+      std::memcpy( &f , &u , sizeof(f) );
+      return f;
+    }
+
+    // Whether the magnitude must be incremented after truncating 'rem' (out of 2*half)
+    inline bool round_up( bool neg , unsigned int rem , unsigned int half , bool lsb , HalfRounding mode ) {
+      switch (mode) {
+      case HalfRounding::rn: return rem > half || ( rem == half && lsb );
+      case HalfRounding::rz: return false;
+      case HalfRounding::rm: return neg && rem != 0;
+      case HalfRounding::rp: return !neg && rem != 0;
+      }
+      return false;
+    }
+  }
+
+
+  void setHalfRounding( HalfRounding mode ) { half_rounding = mode; }
+
+  HalfRounding getHalfRounding() { return half_rounding; }
+
+  bool parseHalfRounding( const char* str , HalfRounding& mode )
+  {
+    std::string s(str);
+    if      (s == "rn") mode = HalfRounding::rn;
+    else if (s == "rz") mode = HalfRounding::rz;
+    else if (s == "rm") mode = HalfRounding::rm;
+    else if (s == "rp") mode = HalfRounding::rp;
+    else return false;
+    return true;
+  }
+
+
+  unsigned short floatToHalfBits( float f , HalfRounding mode )
+  {
+    unsigned int u    = float_bits(f);
+    bool         neg  = u >> 31;
+    unsigned int sign = neg ? 0x8000 : 0;
+    int          exp  = (u >> 23) & 0xff;
+    unsigned int man  = u & 0x7fffff;
+
+    // Inf and NaN (NaNs stay quiet and keep the top payload bits)
+    if (exp == 0xff)
+      return sign | 0x7c00 | ( man ? 0x200 | (man >> 13) : 0 );
+
+    // Finite values too large for binary16 go to inf or the largest finite value
+    int e = exp - 127 + 15;
+    if (e >= 31) {
+      bool to_inf = mode == HalfRounding::rn || ( mode == HalfRounding::rp && !neg ) || ( mode == HalfRounding::rm && neg );
+      return sign | ( to_inf ? 0x7c00 : 0x7bff );
+    }
+
+    if (e >= 1) {
+      // Normal result: drop 13 mantissa bits, a carry may bump the exponent (up to inf)
+      unsigned int h   = ( (unsigned int)e << 10 ) | ( man >> 13 );
+      unsigned int rem = man & 0x1fff;
+      if (round_up( neg , rem , 0x1000 , h & 1 , mode ))
+	h++;
+      return sign | h;
+    }
+
+    // Subnormal (or zero) result in units of 2^-24
+    if (exp == 0 && man == 0)
+      return sign;
+
+    unsigned int mant  = exp ? ( man | 0x800000 ) : man;
+    int          shift = 14 - e;
+    if (exp == 0)
+      shift = 25;  // binary32 subnormals are far below the binary16 range
+
+    if (shift > 24) {
+      // |f| < 2^-25: only directed rounding can produce the smallest subnormal
+      return sign | ( round_up( neg , 1 , 2 , false , mode ) ? 1 : 0 );
+    }
+
+    unsigned int h    = mant >> shift;
+    unsigned int rem  = mant & ( (1u << shift) - 1 );
+    unsigned int half = 1u << (shift - 1);
+    if (round_up( neg , rem , half , h & 1 , mode ))
+      h++;
+    return sign | h;
+  }
+
+
+  float halfBitsToFloat( unsigned short h )
+  {
+    unsigned int sign = (unsigned int)(h & 0x8000) << 16;
+    unsigned int exp  = (h >> 10) & 0x1f;
+    unsigned int man  = h & 0x3ff;
+
+    if (exp == 0x1f)
+      return bits_float( sign | 0x7f800000 | (man << 13) );
+
+    if (exp == 0) {
+      if (man == 0)
+	return bits_float( sign );
+      // Renormalize the subnormal
+      int e = -1;
+      do {
+	man <<= 1;
+	e++;
+      } while ( !(man & 0x400) );
+      man &= 0x3ff;
+      return bits_float( sign | ( (unsigned int)(127 - 15 - e) << 23 ) | (man << 13) );
+    }
+
+    return bits_float( sign | ( (exp + 127 - 15) << 23 ) | (man << 13) );
+  }
+
+
+  unsigned short floatToBFloat16Bits( float f , HalfRounding mode )
+  {
+    unsigned int u = float_bits(f);
+
+    // Keep NaNs quiet, rounding could otherwise turn them into inf
+    if ( (u & 0x7fffffff) > 0x7f800000 )
+      return (u >> 16) | 0x40;
+
+    bool neg = u >> 31;
+    unsigned int add = 0;
+    switch (mode) {
+    case HalfRounding::rn: add = 0x7fff + ( (u >> 16) & 1 ); break;
+    case HalfRounding::rz: add = 0; break;
+    case HalfRounding::rm: add = neg ? 0xffff : 0; break;
+    case HalfRounding::rp: add = neg ? 0 : 0xffff; break;
+    }
+    return (u + add) >> 16;
+  }
+
+
+  float bfloat16BitsToFloat( unsigned short b )
+  {
+    return bits_float( (unsigned int)b << 16 );
+  }
+
+} // namespace QDP
@@ -0,0 +1,453 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Persistent, NUMA aware host worker threads, see qdp_host_threads.h
+ *
+ * The workers sleep on a condition variable between loops. A loop hands
+ * them a job and a generation number; the caller runs its own share as
+ * worker 0 and then waits for the others. Each worker's remaining chunk
+ * is one 64-bit word (first and end piece) so the owner and the thieves
+ * can take pieces with a compare and swap from opposite ends.
+ */
+
+#include "qdp_host_threads.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace QDP {
+
+  namespace {
+
+    //
+    // Topology
+    //
+
+    struct Topology {
+      std::vector<int> cpus;    // allowed CPUs ordered by NUMA node
+      std::vector<int> node;    // node of cpus[i]
+      int              nodes = 1;
+    };
+
+#if defined(__linux__)
+    //! Parse a sysfs cpulist such as "0-3,8-11"
+    std::vector<int> parse_cpulist( const std::string& s ) {
+      std::vector<int> cpus;
+      std::stringstream ss( s );
+      std::string item;
+      while (std::getline( ss , item , ',' )) {
+	if (item.empty() || item[0] == '\n')
+	  continue;
+	int a , b;
+	if (sscanf( item.c_str() , "%d-%d" , &a , &b ) == 2)
+	  for (int c = a ; c <= b ; ++c) cpus.push_back( c );
+	else if (sscanf( item.c_str() , "%d" , &a ) == 1)
+	  cpus.push_back( a );
+      }
+      return cpus;
+    }
+#endif
+
+    Topology read_topology() {
+      Topology t;
+      std::vector<int> allowed;
+#if defined(__linux__)
+      cpu_set_t set;
+      CPU_ZERO( &set );
+      if (sched_getaffinity( 0 , sizeof(set) , &set ) == 0)
+	for (int c = 0 ; c < CPU_SETSIZE ; ++c)
+	  if (CPU_ISSET( c , &set ))
+	    allowed.push_back( c );
+
+      // CPU -> node from /sys/devices/system/node/node<N>/cpulist
+      std::vector<int> node_of;
+      if (DIR* d = opendir( "/sys/devices/system/node" )) {
+	while (dirent* e = readdir( d )) {
+	  int n;
+	  if (strncmp( e->d_name , "node" , 4 ) || sscanf( e->d_name + 4 , "%d" , &n ) != 1)
+	    continue;
+	  std::ifstream f( std::string("/sys/devices/system/node/") + e->d_name + "/cpulist" );
+	  std::string line;
+	  std::getline( f , line );
+	  for (int c: parse_cpulist( line )) {
+	    if (c >= (int)node_of.size()) node_of.resize( c + 1 , 0 );
+	    node_of[c] = n;
+	  }
+	}
+	closedir( d );
+      }
+
+      std::vector<std::pair<int,int> > by_node;
+      for (int c: allowed)
+	by_node.push_back( std::make_pair( c < (int)node_of.size() ? node_of[c] : 0 , c ) );
+      std::sort( by_node.begin() , by_node.end() );
+      for (auto& p: by_node) {
+	t.cpus.push_back( p.second );
+	t.node.push_back( p.first );
+      }
+#endif
+      if (t.cpus.empty()) {
+	unsigned n = std::max( 1u , std::thread::hardware_concurrency() );
+	for (unsigned c = 0 ; c < n ; ++c) {
+	  t.cpus.push_back( c );
+	  t.node.push_back( 0 );
+	}
+      }
+      std::vector<int> nodes( t.node );
+      std::sort( nodes.begin() , nodes.end() );
+      t.nodes = std::unique( nodes.begin() , nodes.end() ) - nodes.begin();
+      return t;
+    }
+
+    const Topology& topology() {
+      static Topology t = read_topology();
+      return t;
+    }
+
+
+    //
+    // Settings
+    //
+
+    std::atomic<int>         requested_count(0);
+    std::atomic<HostPinning> pinning_mode(HostPinning::automatic);
+
+    bool want_pinning() {
+      HostPinning p = pinning_mode;
+      return p == HostPinning::on || (p == HostPinning::automatic && topology().nodes > 1);
+    }
+
+    //! Position of worker w in Topology::cpus
+    int cpu_slot( int w , int nw ) {
+      return (int)( (long long)w * topology().cpus.size() / nw );
+    }
+
+    bool pin_self( int w , int nw ) {
+#if defined(__linux__)
+      cpu_set_t set;
+      CPU_ZERO( &set );
+      CPU_SET( topology().cpus[ cpu_slot( w , nw ) ] , &set );
+      return pthread_setaffinity_np( pthread_self() , sizeof(set) , &set ) == 0;
+#else
+      return false;
+#endif
+    }
+
+
+    //
+    // The pool
+    //
+
+    thread_local bool in_loop = false;
+
+    struct Pool {
+      std::mutex                    run_mtx;     // one loop at a time
+      std::mutex                    mtx;
+      std::condition_variable       cv_work;
+      std::condition_variable       cv_done;
+      std::vector<std::thread>      threads;     // workers 1 .. size-1
+      unsigned long                 generation = 0;
+      int                           pending    = 0;
+      bool                          stop       = false;
+      const std::function<void(int)>* job      = nullptr;
+      int                           size       = 1;
+      bool                          pinned     = false;
+
+      ~Pool() { shutdown(); }
+
+      void worker( int w , unsigned long seen ) {
+	if (pinned)
+	  pin_self( w , size );
+	for (;;) {
+	  std::unique_lock<std::mutex> lock( mtx );
+	  cv_work.wait( lock , [&]{ return stop || generation != seen; } );
+	  if (stop)
+	    return;
+	  seen = generation;
+	  const std::function<void(int)>* j = job;
+	  lock.unlock();
+
+	  in_loop = true;
+	  (*j)( w );
+	  in_loop = false;
+
+	  lock.lock();
+	  if (--pending == 0)
+	    cv_done.notify_one();
+	}
+      }
+
+      void shutdown() {
+	{
+	  std::lock_guard<std::mutex> lock( mtx );
+	  stop = true;
+	}
+	cv_work.notify_all();
+	for (auto& t: threads)
+	  t.join();
+	threads.clear();
+	stop = false;
+	size = 1;
+      }
+
+      //! Match the pool to the settings, called with run_mtx held
+      void ensure() {
+	int  want = hostThreadsGetCount();
+	bool pin  = want_pinning();
+	if (want == size && pin == pinned)
+	  return;
+	shutdown();
+	size   = want;
+	pinned = pin;
+	for (int w = 1 ; w < size ; ++w)
+	  threads.push_back( std::thread( &Pool::worker , this , w , generation ) );
+      }
+
+      //! Run job(w) on every worker, the caller being worker 0
+      void run( const std::function<void(int)>& j ) {
+	{
+	  std::lock_guard<std::mutex> lock( mtx );
+	  job     = &j;
+	  pending = size - 1;
+	  generation++;
+	}
+	cv_work.notify_all();
+
+#if defined(__linux__)
+	// Worker 0 is pinned for the loop only: threads the caller starts
+	// later inherit its mask
+	cpu_set_t saved;
+	bool restore = pinned && sched_getaffinity( 0 , sizeof(saved) , &saved ) == 0 && pin_self( 0 , size );
+#endif
+	in_loop = true;
+	j( 0 );
+	in_loop = false;
+#if defined(__linux__)
+	if (restore)
+	  sched_setaffinity( 0 , sizeof(saved) , &saved );
+#endif
+
+	std::unique_lock<std::mutex> lock( mtx );
+	cv_done.wait( lock , [&]{ return pending == 0; } );
+      }
+    };
+
+    Pool& pool() {
+      static Pool p;
+      return p;
+    }
+
+
+    //! Remaining pieces [first,end) of one worker's chunk, packed in one word
+    struct Chunk {
+      std::atomic<unsigned long long> range;
+      char pad[64 - sizeof(std::atomic<unsigned long long>)];   // own cache line
+
+      static unsigned long long pack( unsigned long long first , unsigned long long end ) {
+	return (first << 32) | end;
+      }
+
+      //! Take the first piece (owner), false when empty
+      bool take_front( unsigned long long& piece ) {
+	unsigned long long v = range.load();
+	for (;;) {
+	  unsigned long long first = v >> 32 , end = v & 0xffffffffull;
+	  if (first >= end)
+	    return false;
+	  if (range.compare_exchange_weak( v , pack( first + 1 , end ) )) {
+	    piece = first;
+	    return true;
+	  }
+	}
+      }
+
+      //! Take the last piece (thief), false when empty
+      bool take_back( unsigned long long& piece ) {
+	unsigned long long v = range.load();
+	for (;;) {
+	  unsigned long long first = v >> 32 , end = v & 0xffffffffull;
+	  if (first >= end)
+	    return false;
+	  if (range.compare_exchange_weak( v , pack( first , end - 1 ) )) {
+	    piece = end - 1;
+	    return true;
+	  }
+	}
+      }
+    };
+
+  } // namespace
+
+
+
+  void hostThreadsSetCount( int n ) { requested_count = std::max( 0 , n ); }
+
+  int hostThreadsGetCount() {
+    int n = requested_count;
+    return n > 0 ? n : (int)topology().cpus.size();
+  }
+
+  void hostThreadsSetPinning( HostPinning p ) { pinning_mode = p; }
+
+  bool hostThreadsParsePinning( const char* s , HostPinning& p ) {
+    if      (!strcmp( s , "on" ))   p = HostPinning::on;
+    else if (!strcmp( s , "off" ))  p = HostPinning::off;
+    else if (!strcmp( s , "auto" )) p = HostPinning::automatic;
+    else return false;
+    return true;
+  }
+
+  bool hostThreadsPinned() { return want_pinning(); }
+
+  int hostNumaNodes() { return topology().nodes; }
+
+  int hostThreadsNode( int w ) {
+    int nw = hostThreadsGetCount();
+    if (!want_pinning() || w < 0 || w >= nw)
+      return -1;
+    return topology().node[ cpu_slot( w , nw ) ];
+  }
+
+
+  void hostParallelFor( size_t n , size_t grain , bool steal ,
+			const std::function<void(size_t,size_t,int)>& f )
+  {
+    if (n == 0)
+      return;
+    grain = std::max( (size_t)1 , grain );
+
+    Pool& P = pool();
+    std::unique_lock<std::mutex> running( P.run_mtx , std::defer_lock );
+    if (in_loop || !running.try_lock()) {
+      f( 0 , n , 0 );
+      return;
+    }
+    P.ensure();
+    const int nw = P.size;
+
+    if (nw == 1) {
+      in_loop = true;
+      try { f( 0 , n , 0 ); } catch (...) { in_loop = false; throw; }
+      in_loop = false;
+      return;
+    }
+
+    std::exception_ptr error;
+    std::mutex         error_mtx;
+    std::atomic<bool>  failed(false);
+
+    auto call = [&]( size_t lo , size_t hi , int w ) {
+      try {
+	f( lo , hi , w );
+      } catch (...) {
+	std::lock_guard<std::mutex> lock( error_mtx );
+	if (!error) error = std::current_exception();
+	failed = true;
+      }
+    };
+
+    if (!steal) {
+      std::function<void(int)> job = [&]( int w ) {
+	call( hostPartitionBegin( n , w , nw ) , hostPartitionBegin( n , w + 1 , nw ) , w );
+      };
+      P.run( job );
+    } else {
+      // Pieces are counted from the start of each chunk so the static
+      // partition of the indices is kept exactly
+      size_t max_chunk = n / nw + 1;
+      if (max_chunk / grain >= 0xffffffffull)
+	grain = max_chunk / 0xfffffffeull + 1;
+
+      std::unique_ptr<Chunk[]> chunks( new Chunk[nw] );
+      for (int w = 0 ; w < nw ; ++w) {
+	size_t len = hostPartitionBegin( n , w + 1 , nw ) - hostPartitionBegin( n , w , nw );
+	chunks[w].range = Chunk::pack( 0 , (len + grain - 1) / grain );
+      }
+
+      // Victims of each worker: its own NUMA node first, then the nearest workers
+      std::vector<int> node( nw , 0 );
+      if (P.pinned)
+	for (int w = 0 ; w < nw ; ++w)
+	  node[w] = topology().node[ cpu_slot( w , nw ) ];
+
+      std::function<void(int)> job = [&]( int w ) {
+	auto piece = [&]( int v , unsigned long long p ) {
+	  size_t b  = hostPartitionBegin( n , v , nw );
+	  size_t e  = hostPartitionBegin( n , v + 1 , nw );
+	  size_t lo = b + p * grain;
+	  call( lo , std::min( e , lo + grain ) , w );
+	};
+
+	unsigned long long p;
+	while (!failed && chunks[w].take_front( p ))
+	  piece( w , p );
+
+	for (int pass = 0 ; pass < 2 ; ++pass)
+	  for (int d = 1 ; d < nw ; ++d) {
+	    int v = (w + d) % nw;
+	    if ((node[v] == node[w]) != (pass == 0))
+	      continue;
+	    while (!failed && chunks[v].take_back( p ))
+	      piece( v , p );
+	  }
+      };
+      P.run( job );
+    }
+
+    if (error)
+      std::rethrow_exception( error );
+  }
+
+
+  void hostReleasePages( void* p , size_t bytes ) {
+#if defined(__linux__)
+    const uintptr_t page = (uintptr_t)sysconf( _SC_PAGESIZE );
+#else
+    const uintptr_t page = 4096;
+#endif
+    uintptr_t begin = ((uintptr_t)p + page - 1) & ~(page - 1);
+    uintptr_t end   = ((uintptr_t)p + bytes) & ~(page - 1);
+    if (end <= begin)
+      return;
+#if defined(__linux__)
+    if (madvise( (void*)begin , end - begin , MADV_DONTNEED ) == 0)
+      return;
+#endif
+    std::memset( (void*)begin , 0 , end - begin );
+  }
+
+
+  void hostParallelCopy( void* dst , const void* src , size_t bytes ) {
+    // Below this the wake up costs more than the copy
+    const size_t serial = (size_t)1 << 20;
+    if (bytes < serial || hostThreadsGetCount() == 1) {
+      std::memcpy( dst , src , bytes );
+      return;
+    }
+    hostParallelFor( bytes , bytes , false , [&]( size_t lo , size_t hi , int ) {
+	std::memcpy( (char*)dst + lo , (const char*)src + lo , hi - lo );
+      } );
+  }
+
+} // namespace QDP
@@ -719,14 +719,15 @@ namespace QDP
       // Read
       // By default, we expect all data to be in big-endian
       getIstream().read(input, size*nmemb);
-      internalChecksum() = QDPUtil::crc32(internalChecksum(), input, size*nmemb);
 
       if (! QDPUtil::big_endian())
       {
 	// little-endian
-	// Swap
-	QDPUtil::byte_swap(input, size, nmemb);
+	// Checksum the file's bytes and swap in the same pass
+	internalChecksum() = QDPUtil::byte_swap_crc32(internalChecksum(), input, input, size, nmemb, false);
       }
+      else
+	internalChecksum() = QDPUtil::crc32(internalChecksum(), input, size*nmemb);
     }
   }
 
@@ -961,17 +962,70 @@ namespace QDP
 
 
 
+  //--------------------------------------------------------------------------------
+  // Binary memory reader support
+  void BinaryMemoryReader::MemBuf::set(const char* data, size_t len)
+  {
+    char* p = const_cast<char*>(data);
+    setg(p, p, p + len);
+  }
+
+  std::streambuf::pos_type
+  BinaryMemoryReader::MemBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+  {
+    off_type base = 0;
+    if (dir == std::ios_base::cur)
+      base = gptr() - eback();
+    else if (dir == std::ios_base::end)
+      base = egptr() - eback();
+
+    off_type pos = base + off;
+    if (!(which & std::ios_base::in) || pos < 0 || pos > egptr() - eback())
+      return pos_type(off_type(-1));
+
+    setg(eback(), eback() + pos, egptr());
+    return pos_type(pos);
+  }
+
+  std::streambuf::pos_type
+  BinaryMemoryReader::MemBuf::seekpos(pos_type pos, std::ios_base::openmode which)
+  {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+  }
+
+  BinaryMemoryReader::BinaryMemoryReader() : checksum(0), f(&buf) {}
+
+  BinaryMemoryReader::BinaryMemoryReader(const char* data, size_t len) : checksum(0), f(&buf) {open(data, len);}
+
+  BinaryMemoryReader::~BinaryMemoryReader() {}
+
+  void BinaryMemoryReader::open(const char* data, size_t len)
+  {
+    if (Layout::primaryNode())
+    {
+      buf.set(data, len);
+      f.clear();
+    }
+
+    checksum = 0;
+  }
+
+
+
   //--------------------------------------------------------------------------------
   // Binary reader support
-  BinaryFileReader::BinaryFileReader() {checksum=0;}
+  BinaryFileReader::BinaryFileReader() : checksum(0), f(&buf) {}
 
-  BinaryFileReader::BinaryFileReader(const std::string& p) {checksum=0;open(p);}
+  BinaryFileReader::BinaryFileReader(const std::string& p) : checksum(0), f(&buf) {open(p);}
 
   void BinaryFileReader::open(const std::string& p) 
   {
     checksum = 0;
     if (Layout::primaryNode()) 
-      f.open(p.c_str(),std::ifstream::in | std::ifstream::binary);
+    {
+      buf.open(p, std::ios_base::in);
+      f.clear();
+    }
 
     if (! is_open())
       QDP_error_exit("BinaryFileReader: error opening file %s",p.c_str());
@@ -983,7 +1037,7 @@ namespace QDP
     if (is_open())
     {
       if (Layout::primaryNode()) 
-	f.close();
+	buf.close();
     }
   }
 
@@ -995,7 +1049,7 @@ namespace QDP
     if (s)
     {
       if (Layout::primaryNode())
-	s = f.is_open();
+	s = buf.is_open();
 
       QDPInternal::broadcast(s);
     }
@@ -1156,6 +1210,9 @@ namespace QDP
     writeArray((const char*)&output, sizeof(T), 1);
   }
 
+  //! Largest piece of an array BinaryWriter byte-swaps at once
+  static const size_t staging_bytes = 16 << 20;
+
   void BinaryWriter::writeArrayPrimaryNode(const char* output, size_t size, size_t nmemb)
   {
     if (Layout::primaryNode())
@@ -1170,11 +1227,21 @@ namespace QDP
       else
       {
 	/* little-endian */
-	/* Swap and write and swap */
-	QDPUtil::byte_swap(const_cast<char *>(output), size, nmemb);
-	internalChecksum() = QDPUtil::crc32(internalChecksum(), output, size*nmemb);
-	getOstream().write(output, size*nmemb);
-	QDPUtil::byte_swap(const_cast<char *>(output), size, nmemb);
+	/* Swap into a staging buffer while checksumming, and write that.
+	   Large arrays go in pieces, so the buffer stays bounded */
+	static thread_local std::vector<char> staging;
+	const size_t piece = std::max((size_t)1, staging_bytes / size);
+
+	for(size_t j=0; j < nmemb; j += piece)
+	{
+	  size_t n = std::min(piece, nmemb - j);
+	  if (staging.size() < n*size)
+	    staging.resize(n*size);
+
+	  internalChecksum() = QDPUtil::byte_swap_crc32(internalChecksum(), staging.data(), output + j*size,
+							size, n, true);
+	  getOstream().write(staging.data(), n*size);
+	}
       }
     }
   }
@@ -1392,15 +1459,18 @@ namespace QDP
 
   //--------------------------------------------------------------------------------
   // Binary writer support
-  BinaryFileWriter::BinaryFileWriter() {checksum = 0;}
+  BinaryFileWriter::BinaryFileWriter() : checksum(0), f(&buf) {}
 
-  BinaryFileWriter::BinaryFileWriter(const std::string& p) {checksum = 0; open(p);}
+  BinaryFileWriter::BinaryFileWriter(const std::string& p) : checksum(0), f(&buf) {open(p);}
 
   void BinaryFileWriter::open(const std::string& p) 
   {
     checksum = 0;
     if (Layout::primaryNode()) 
-      f.open(p.c_str(),std::ofstream::out | std::ofstream::trunc | std::ofstream::binary);
+    {
+      buf.open(p, std::ios_base::out);
+      f.clear();
+    }
 
     if (! is_open())
       QDP_error_exit("BinaryFileWriter: error opening file %s",p.c_str());
@@ -1412,7 +1482,9 @@ namespace QDP
     {
       if (Layout::primaryNode()) 
       {
-	f.close();
+	// Waits for the background writes; a failed one leaves the stream bad
+	if (! buf.close())
+	  f.setstate(std::ios_base::badbit);
       }
     }
   }
@@ -1426,7 +1498,7 @@ namespace QDP
     if (s)
     {
       if (Layout::primaryNode())
-	s = f.is_open();
+	s = buf.is_open();
 
       QDPInternal::broadcast(s);
     }
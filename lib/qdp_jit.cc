@@ -1,5 +1,9 @@
 #include "qdp.h"
 
+#include <thread>
+#include <mutex>
+#include <atomic>
+
 // Unary single precision
 #include "../lib/func_sin_f32.inc"
 #include "../lib/func_acos_f32.inc"
@@ -36,13 +40,17 @@
 
 namespace QDP {
 
-  int jit_label::count = 0;
+  // Functions under construction, one stack per thread
+  static thread_local std::vector<jit_function_t> jit_internal_functions;
 
-  jit_function_t jit_internal_function;
+  // Number of threads used by jit_build_concurrent (0 = hardware concurrency)
+  static int jit_build_threads = 0;
 
   std::map<CUfunction,std::string> mapCUFuncPTX;
+  std::mutex mapCUFuncPTX_mutex;
 
   std::string getPTXfromCUFunc(CUfunction f) {
+    std::lock_guard<std::mutex> lock(mapCUFuncPTX_mutex);
     return mapCUFuncPTX[f];
   }
 
@@ -148,7 +156,9 @@ namespace QDP {
 			    {jit_ptx_type::b16 ,{{"b16" ,"x" ,""   ,""}}},
 			      {jit_ptx_type::b32 ,{{"b32" ,"y" ,""   ,""}}},
 				{jit_ptx_type::b64 ,{{"b64" ,"z" ,""   ,""}}},
-				  {jit_ptx_type::pred,{{"pred","p" ,""   ,""}}} };
+				  {jit_ptx_type::pred,{{"pred","p" ,""   ,""}}},
+				    {jit_ptx_type::f16 ,{{"f16" ,"hf",""   ,""}}},
+				      {jit_ptx_type::bf16,{{"bf16","hb",""   ,""}}} };
 	return ptx_type_matrix;
       } else {
 	QDP_info_primary("Using ptx_type_matrix for sm_1x");
@@ -165,7 +175,9 @@ namespace QDP {
 			    {jit_ptx_type::b16 ,{{"b16" ,"x" ,""   ,""}}},
 			      {jit_ptx_type::b32 ,{{"b32" ,"y" ,""   ,""}}},
 				{jit_ptx_type::b64 ,{{"b64" ,"z" ,""   ,""}}},
-				  {jit_ptx_type::pred,{{"pred","p" ,""   ,""}}} };
+				  {jit_ptx_type::pred,{{"pred","p" ,""   ,""}}},
+				    {jit_ptx_type::f16 ,{{"f16" ,"hf",""   ,""}}},
+				      {jit_ptx_type::bf16,{{"bf16","hb",""   ,""}}} };
 	return ptx_type_matrix;
       }
     }
@@ -251,6 +263,8 @@ namespace QDP {
       map_bit_type[ jit_ptx_type::u16 ] = jit_ptx_type::b16;
       map_bit_type[ jit_ptx_type::s16 ] = jit_ptx_type::b16;
       map_bit_type[ jit_ptx_type::pred ] = jit_ptx_type::pred;
+      map_bit_type[ jit_ptx_type::f16 ] = jit_ptx_type::b16;
+      map_bit_type[ jit_ptx_type::bf16 ] = jit_ptx_type::b16;
       return map_bit_type;
     }
     std::map< jit_state_space , 
@@ -345,6 +359,21 @@ namespace QDP {
   }
 
 
+  bool jit_type_is_half(jit_ptx_type type) {
+    return type == jit_ptx_type::f16 || type == jit_ptx_type::bf16;
+  }
+
+
+  const char * jit_get_half_rounding_str() {
+    switch ( getHalfRounding() ) {
+    case HalfRounding::rz: return "rz.";
+    case HalfRounding::rm: return "rm.";
+    case HalfRounding::rp: return "rp.";
+    default:               return "rn.";
+    }
+  }
+
+
   jit_ptx_type jit_type_promote(jit_ptx_type t0,jit_ptx_type t1) {
     //std::cout << "type promote: " << t0 << " " << t1 << "\n";
     if (t0==t1) return t0;
@@ -440,12 +469,21 @@ namespace QDP {
 
   jit_function::jit_function(): param_count(0), 
 				local_count(0),
+				label_count(0),
 				m_shared(false),
 				m_include_math_ptx_unary(PTX::map_ptx_math_functions_unary.size(),false),
-				m_include_math_ptx_binary(PTX::map_ptx_math_functions_binary.size(),false)
+				m_include_math_ptx_binary(PTX::map_ptx_math_functions_binary.size(),false),
+				m_start(getClockNanoseconds()),
+				m_param_row_slots(0)
   {}
 
 
+  double jit_function::get_build_seconds() const
+  {
+    return 1.0e-9 * ( getClockNanoseconds() - m_start );
+  }
+
+
   void jit_function::emitShared() {
     m_shared=true;
   }
@@ -455,6 +493,10 @@ namespace QDP {
     return reg_count[type]++;
   }
 
+  int jit_function::label_alloc() {
+    return label_count++;
+  }
+
   std::ostringstream& jit_function::get_prg() { return oss_prg; }
   std::ostringstream& jit_function::get_signature() { return oss_signature; }
 
@@ -496,6 +538,8 @@ namespace QDP {
       {
 	jit_ptx_type type = vec_local_count.at(i).first;
 	int count = vec_local_count.at(i).second;
+	if ( jit_type_is_half( type ) )
+	  type = jit_bit_type( type );
 	oss_reg_defs << ".local ." 
 		     << jit_get_ptx_type( type ) << " " 
 		     << jit_get_identifier_local_memory() << i 
@@ -554,6 +598,15 @@ namespace QDP {
   jit_value jit_add_param( jit_ptx_type type ) {
     assert( type != jit_ptx_type::u8 );
     jit_function_t func = jit_get_function();
+
+    if (func->get_param_row()) {
+      jit_value ret = jit_ins_load( *func->get_param_row() , 8 * func->next_param_row_slot() , type );
+      if (type != jit_ptx_type::pred)
+	ret.set_state_space( jit_state_space::state_global );
+      ret.set_ever_assigned();
+      return ret;
+    }
+
     if (func->get_param_count() > 0)
       func->get_signature() << ",\n";
 
@@ -608,6 +661,22 @@ namespace QDP {
   }
 
 
+  void jit_param_table_begin( const jit_value& row ) {
+    jit_function_t func = jit_get_function();
+    assert( !func->get_param_row() );
+    func->set_param_row( std::make_shared<jit_value>( row ) );
+  }
+
+
+  int jit_param_table_end() {
+    jit_function_t func = jit_get_function();
+    assert( func->get_param_row() );
+    int slots = func->get_param_row_slots();
+    func->set_param_row( std::shared_ptr<jit_value>() );
+    return slots;
+  }
+
+
   int jit_function::local_alloc( jit_ptx_type type, int count ) {
     assert(count>0);
     int ret =  vec_local_count.size();
@@ -646,36 +715,44 @@ namespace QDP {
   std::string jit_get_kernel_as_string() {
     std::string ret = jit_get_function()->get_kernel_as_string();
     //QDP_info_primary("Resetting jit function");
-    jit_internal_function.reset();
+    jit_internal_functions.pop_back();
     return ret;
   }
 
 
   void jit_start_new_function() {
-    if (jit_internal_function) {
-      QDP_error_exit("New jit function requested, but previous one not finished yet!");
-      //QDP_info_primary("Resetting old jit function (use_count = %d) ...",(int)jit_internal_function.use_count());
-      //jit_internal_function.reset();
-    }
     //QDP_info_primary("Starting new jit function");
-    jit_internal_function = make_shared<jit_function>();
+    jit_internal_functions.push_back( make_shared<jit_function>() );
   }
 
 
   jit_function_t jit_get_function() {
-    assert( jit_internal_function );
-    return jit_internal_function;
+    assert( !jit_internal_functions.empty() );
+    return jit_internal_functions.back();
+  }
+
+
+  void jit_describe_function(const std::string& description) {
+    jit_get_function()->set_description( description );
   }
 
 
   CUfunction jit_get_cufunction(const char* fname)
+  {
+    jit_function_t func = jit_get_function();
+    std::string ptx_kernel = jit_get_kernel_as_string();
+    CUfunction f = jit_load_module( ptx_kernel , fname );
+    KernelProfile::Instance().registerKernel( f , fname , func->get_description() , func->get_build_seconds() );
+    return f;
+  }
+
+
+  CUfunction jit_load_module(const std::string& ptx_kernel, const char* fname)
   {
     CUfunction func;
     CUresult ret;
     CUmodule cuModule;
 
-    std::string ptx_kernel = jit_get_kernel_as_string();
-
 #if 0
     // Write kernel to file ?
     if (Layout::primaryNode()) {
@@ -700,12 +777,59 @@ namespace QDP {
     if (ret)
       QDP_error_exit("Error returned from cuModuleGetFunction. Abort.");
 
+    std::lock_guard<std::mutex> lock(mapCUFuncPTX_mutex);
     mapCUFuncPTX[func]=ptx_kernel;
 
     return func;
   }
 
 
+  void jit_set_build_threads(int n) {
+    QDP_info_primary("Setting number of JIT build threads = %d",n);
+    jit_build_threads = n;
+  }
+
+  int jit_get_build_threads() {
+    if (jit_build_threads > 0)
+      return jit_build_threads;
+    int n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+  }
+
+
+  std::vector<CUfunction> jit_build_concurrent(const std::vector<jit_builder_t>& builders)
+  {
+    std::vector<CUfunction> functions( builders.size() );
+
+    int n = builders.size();
+    int num_threads = std::min( jit_get_build_threads() , n );
+
+    if (num_threads <= 1) {
+      for (int i = 0 ; i < n ; ++i )
+	functions[i] = builders[i]();
+      return functions;
+    }
+
+    // Work is handed out one builder at a time, so that a few large
+    // kernels don't leave the other threads idle.
+    std::atomic<int> next(0);
+
+    auto worker = [&]() {
+      CudaSetCurrentContext();
+      for ( int i = next++ ; i < n ; i = next++ )
+	functions[i] = builders[i]();
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 0 ; t < num_threads ; ++t )
+      threads.push_back( std::thread( worker ) );
+    for (auto& th: threads)
+      th.join();
+
+    return functions;
+  }
+
+
 
 
   jit_label_t jit_label_create() {
@@ -1063,6 +1187,9 @@ namespace QDP {
   jit_value jit_ins_mul_wide( const jit_value& lhs , const jit_value& rhs , const jit_value& pred) {
     return jit_ins_op( lhs , rhs , JitOpMulWide( lhs , rhs ) , pred );
   }
+  jit_value jit_ins_mul_hi( const jit_value& lhs , const jit_value& rhs , const jit_value& pred) {
+    return jit_ins_op( lhs , rhs , JitOpMulHi( lhs , rhs ) , pred );
+  }
   jit_value jit_ins_and( const jit_value& lhs , const jit_value& rhs , const jit_value& pred ) {
     return jit_ins_op( lhs , rhs , JitOpAnd( lhs , rhs ) , pred );
   }
@@ -1316,6 +1443,39 @@ namespace QDP {
 				    << ";\n";
       return jit_ins_ne( s32 , jit_value(0) );
     }
+    if ( type == jit_ptx_type::f16 ) {
+      jit_value raw( jit_ptx_type::b16 );
+      jit_get_function()->get_prg() << jit_predicate(pred)
+				    << "ld." << get_state_space_str(base.get_state_space()) << ".b16 "
+				    << jit_get_reg_name( raw ) << ",["
+				    << jit_get_reg_name( base ) << " + "
+				    << offset << "];\n";
+      jit_value loaded( jit_ptx_type::f32 );
+      jit_get_function()->get_prg() << "cvt.f32.f16 "
+				    << jit_get_reg_name( loaded ) << ","
+				    << jit_get_reg_name( raw ) << ";\n";
+      loaded.set_state_space( jit_state_space::state_default );
+      loaded.set_ever_assigned();
+      return loaded;
+    }
+    if ( type == jit_ptx_type::bf16 ) {
+      // bf16 is the upper half of an f32, no cvt needed (nor available before sm_80)
+      jit_value raw( jit_ptx_type::u16 );
+      jit_get_function()->get_prg() << jit_predicate(pred)
+				    << "ld." << get_state_space_str(base.get_state_space()) << ".u16 "
+				    << jit_get_reg_name( raw ) << ",["
+				    << jit_get_reg_name( base ) << " + "
+				    << offset << "];\n";
+      raw.set_ever_assigned();
+      jit_value wide = jit_ins_shl( jit_val_convert( jit_ptx_type::u32 , raw ) , jit_value(16) );
+      jit_value loaded( jit_ptx_type::f32 );
+      jit_get_function()->get_prg() << "mov.b32 "
+				    << jit_get_reg_name( loaded ) << ","
+				    << jit_get_reg_name( wide ) << ";\n";
+      loaded.set_state_space( jit_state_space::state_default );
+      loaded.set_ever_assigned();
+      return loaded;
+    }
     jit_value loaded( type );
     jit_get_function()->get_prg() << jit_predicate(pred)
 				  << "ld." << get_state_space_str(base.get_state_space()) << "."
@@ -1366,6 +1526,47 @@ namespace QDP {
 				      << offset << "],"
 				      << jit_get_ptx_letter( jit_ptx_type::u8 ) << num << ";\n";
       }
+    } else if ( jit_type_is_half( type ) ) {
+      // Round to 16 bits with the mode selected by setHalfRounding().
+      // Must match floatToHalfBits/floatToBFloat16Bits on the host.
+      jit_value f32 = reg.get_type() == jit_ptx_type::f32 ? reg : jit_val_convert( jit_ptx_type::f32 , reg );
+      jit_value raw( type == jit_ptx_type::f16 ? jit_ptx_type::b16 : jit_ptx_type::u16 );
+      if ( type == jit_ptx_type::f16 ) {
+	jit_get_function()->get_prg() << "cvt." << jit_get_half_rounding_str() << "f16.f32 "
+				      << jit_get_reg_name( raw ) << ","
+				      << jit_get_reg_name( f32 ) << ";\n";
+      } else {
+	jit_value u( jit_ptx_type::u32 );
+	jit_get_function()->get_prg() << "mov.b32 "
+				      << jit_get_reg_name( u ) << ","
+				      << jit_get_reg_name( f32 ) << ";\n";
+	u.set_ever_assigned();
+
+	jit_value add( jit_ptx_type::u32 );
+	jit_value neg = jit_ins_ne( jit_ins_shr( u , jit_value(31) ) , jit_value(0) );
+	switch ( getHalfRounding() ) {
+	case HalfRounding::rz: add = jit_value(0); break;
+	case HalfRounding::rm: add = jit_ins_selp( jit_value(0xffff) , jit_value(0) , neg ); break;
+	case HalfRounding::rp: add = jit_ins_selp( jit_value(0) , jit_value(0xffff) , neg ); break;
+	default:
+	  add = jit_ins_add( jit_ins_and( jit_ins_shr( u , jit_value(16) ) , jit_value(1) , jit_value(jit_ptx_type::pred) ) , jit_value(0x7fff) );
+	}
+	jit_value rounded = jit_ins_shr( jit_ins_add( u , add ) , jit_value(16) );
+
+	// Keep NaNs quiet, rounding could otherwise turn them into inf
+	jit_value is_nan = jit_ins_gt( jit_ins_and( u , jit_value(0x7fffffff) , jit_value(jit_ptx_type::pred) ) , jit_value(0x7f800000) );
+	jit_value nan    = jit_ins_or( jit_ins_shr( u , jit_value(16) ) , jit_value(0x40) , jit_value(jit_ptx_type::pred) );
+	rounded = jit_ins_selp( nan , rounded , is_nan );
+
+	jit_get_function()->get_prg() << "cvt.u16.u32 "
+				      << jit_get_reg_name( raw ) << ","
+				      << jit_get_reg_name( rounded ) << ";\n";
+      }
+      jit_get_function()->get_prg() << jit_predicate(pred)
+				    << "st." << get_state_space_str(base.get_state_space()) << ".b16 ["
+				    << jit_get_reg_name( base ) << " + "
+				    << offset << "],"
+				    << jit_get_reg_name( raw ) << ";\n";
     } else {
       if ( reg.get_type() != type ) {
 	jit_value reg_type = jit_val_convert( type , reg );
@@ -1395,6 +1596,94 @@ namespace QDP {
   }
 
 
+  namespace {
+    //! Constants above 2^31 do not fit the int constructor of jit_value
+    jit_value jit_const_u32( uint32_t v ) {
+      jit_value ret( jit_ptx_type::u32 );
+      std::ostringstream oss; oss << v;
+      jit_ins_mov( ret , oss.str() );
+      return ret;
+    }
+  }
+
+
+  void jit_philox4x32_10( std::vector<jit_value>& ctr , const jit_value& key0_in , const jit_value& key1_in )
+  {
+    assert( ctr.size() == 4 );
+    jit_value m0 = jit_const_u32( Philox::mult0 );
+    jit_value m1 = jit_const_u32( Philox::mult1 );
+    jit_value w0 = jit_const_u32( Philox::weyl0 );
+    jit_value w1 = jit_const_u32( Philox::weyl1 );
+    jit_value key0( key0_in );
+    jit_value key1( key1_in );
+    jit_value no_pred( jit_ptx_type::pred );   // the two argument xor is not implemented
+
+    for ( int r = 0 ; r < Philox::rounds ; ++r ) {
+      if ( r > 0 ) {
+	key0 = jit_ins_add( key0 , w0 );
+	key1 = jit_ins_add( key1 , w1 );
+      }
+      jit_value hi0 = jit_ins_mul_hi( m0 , ctr[0] );
+      jit_value lo0 = jit_ins_mul   ( m0 , ctr[0] );
+      jit_value hi1 = jit_ins_mul_hi( m1 , ctr[2] );
+      jit_value lo1 = jit_ins_mul   ( m1 , ctr[2] );
+      ctr[0] = jit_ins_xor( jit_ins_xor( hi1 , ctr[1] , no_pred ) , key0 , no_pred );
+      ctr[1] = lo1;
+      ctr[2] = jit_ins_xor( jit_ins_xor( hi0 , ctr[3] , no_pred ) , key1 , no_pred );
+      ctr[3] = lo0;
+    }
+  }
+
+
+  PhiloxJIT::PhiloxJIT( const jit_value& key0_ , const jit_value& key1_ ,
+			const jit_value& site_lo_ , const jit_value& site_hi_ , const jit_value& call_ ):
+    key0( jit_val_convert( jit_ptx_type::u32 , key0_ ) ),
+    key1( jit_val_convert( jit_ptx_type::u32 , key1_ ) ),
+    site_lo( jit_val_convert( jit_ptx_type::u32 , site_lo_ ) ),
+    site_hi( jit_val_convert( jit_ptx_type::u32 , site_hi_ ) ),
+    call( jit_val_convert( jit_ptx_type::u32 , call_ ) ),
+    word(0)
+  {
+    block.reserve(4);
+    for ( int i = 0 ; i < 4 ; ++i )
+      block.emplace_back( jit_ptx_type::u32 );
+  }
+
+
+  //! Same counter as Philox::Stream::next
+  jit_value PhiloxJIT::nextWord()
+  {
+    if ( word % 4 == 0 ) {
+      block[0] = site_lo;
+      block[1] = site_hi;
+      block[2] = jit_val_convert( jit_ptx_type::u32 , jit_value( word / 4 ) );
+      block[3] = call;
+      jit_philox4x32_10( block , key0 , key1 );
+    }
+    return block[ word++ % 4 ];
+  }
+
+
+  //! Same conversion as Philox::uniformFloat and Philox::uniformDouble
+  jit_value PhiloxJIT::nextUniform( jit_ptx_type type )
+  {
+    jit_value no_pred( jit_ptx_type::pred );
+
+    if ( type == jit_ptx_type::f64 ) {
+      jit_value hi = nextWord();
+      jit_value lo = nextWord();
+      jit_value hd = jit_val_convert( jit_ptx_type::f64 , jit_ins_shr( hi , jit_value(6) ) );
+      jit_value ld = jit_val_convert( jit_ptx_type::f64 , jit_ins_or( jit_ins_shr( lo , jit_value(5) ) , jit_value(1) , no_pred ) );
+      jit_value m  = jit_ins_add( jit_ins_mul( hd , jit_val_convert( jit_ptx_type::f64 , jit_value( 134217728.0 ) ) ) , ld );
+      return jit_ins_mul( m , jit_val_convert( jit_ptx_type::f64 , jit_value( 1.0 / 9007199254740992.0 ) ) );
+    }
+    jit_value x   = nextWord();
+    jit_value odd = jit_ins_or( jit_ins_shr( x , jit_value(8) ) , jit_value(1) , no_pred );
+    jit_value xf  = jit_val_convert( jit_ptx_type::f32 , odd );
+    return jit_ins_mul( xf , jit_val_convert( jit_ptx_type::f32 , jit_value( 1.0 / 16777216.0 ) ) );
+  }
+
+
   std::string jit_predicate( const jit_value& pred ) {
     if (!pred.get_ever_assigned())
       return "";
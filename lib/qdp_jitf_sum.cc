@@ -6,7 +6,8 @@ namespace QDP {
   void
   function_sum_ind_exec( CUfunction function, 
 			 int size, int threads, int blocks, int shared_mem_usage,
-			 void *d_idata, void *d_odata, void *siteTable)
+			 void *d_idata, void *d_odata, void *siteTable,
+			 size_t in_size, size_t out_size )
   {
     // lo <= idx < hi
     int lo = 0;
@@ -38,7 +39,10 @@ namespace QDP {
 
     //QDP_info("launing block=(%d,1,1)  grid=(%d,%d,1)",threads,now.Nblock_x,now.Nblock_y);
 
-    CudaLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    threads,1,1,    shared_mem_usage, 0, &addr[0] , 0);
+    // One input element (and its site table entry) per thread, one output element per block
+    size_t bytes_per_thread = in_size + ( siteTable ? sizeof(int) : 0 ) + ( out_size + threads - 1 ) / threads;
+
+    CudaLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    threads,1,1,    shared_mem_usage, 0, &addr[0] , 0, bytes_per_thread);
 
   }
 
@@ -47,7 +51,8 @@ namespace QDP {
   void
   function_sum_exec( CUfunction function, 
 		     int size, int threads, int blocks, int shared_mem_usage,
-		     void *d_idata, void *d_odata)
+		     void *d_idata, void *d_odata,
+		     size_t in_size, size_t out_size )
   {
     //  QDP_info("function_sum_ind_coal_exec size=%d threads=%d blocks=%d shared_mem=%d idata=%p odata=%p ",	   size,threads,blocks,shared_mem_usage,d_idata,d_odata);
 
@@ -81,7 +86,9 @@ namespace QDP {
 
     //QDP_info("launing block=(%d,1,1)  grid=(%d,%d,1)",threads,now.Nblock_x,now.Nblock_y);
 
-    CudaLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    threads,1,1,    shared_mem_usage, 0, &addr[0] , 0);
+    size_t bytes_per_thread = in_size + ( out_size + threads - 1 ) / threads;
+
+    CudaLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    threads,1,1,    shared_mem_usage, 0, &addr[0] , 0, bytes_per_thread);
 
   }
 
@@ -89,7 +96,7 @@ namespace QDP {
 
   void function_global_max_exec( CUfunction function, 
 				 int size, int threads, int blocks, int shared_mem_usage,
-				 void *d_idata, void *d_odata)
+				 void *d_idata, void *d_odata, size_t elem_size )
   {
     //QDP_info("function_global_max_exec size=%d threads=%d blocks=%d shared_mem=%d idata=%p odata=%p ",	   size,threads,blocks,shared_mem_usage,d_idata,d_odata);
 
@@ -112,7 +119,9 @@ namespace QDP {
 
     //QDP_info("launing block=(%d,1,1)  grid=(%d,%d,1)",threads,now.Nblock_x,now.Nblock_y);
 
-    CudaLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    threads,1,1,    shared_mem_usage, 0, &addr[0] , 0);
+    size_t bytes_per_thread = elem_size + ( elem_size + threads - 1 ) / threads;
+
+    CudaLaunchKernel(function,   now.Nblock_x,now.Nblock_y,1,    threads,1,1,    shared_mem_usage, 0, &addr[0] , 0, bytes_per_thread);
   }
 
 }
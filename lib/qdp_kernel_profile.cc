@@ -0,0 +1,300 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Per-kernel launch statistics
+ */
+
+#include "qdp.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+namespace QDP {
+
+  namespace {
+    //! Minimal JSON string escaping, descriptions are C++ signatures
+    std::string json_escape( const std::string& s )
+    {
+      std::string r;
+      for (char c: s) {
+	switch (c) {
+	case '"':  r += "\\\""; break;
+	case '\\': r += "\\\\"; break;
+	case '\n': r += "\\n"; break;
+	case '\t': r += "\\t"; break;
+	default:   r += c;
+	}
+      }
+      return r;
+    }
+
+    std::string csv_quote( const std::string& s )
+    {
+      std::string r = "\"";
+      for (char c: s) {
+	if (c == '"') r += '"';
+	r += c;
+      }
+      return r + "\"";
+    }
+
+    double bandwidth( const KernelProfile::Entry& e ) {
+      return e.device_time > 0 ? e.bytes / e.device_time : 0.0;
+    }
+
+    void sortByTime( std::vector<KernelProfile::Entry>& v )
+    {
+      std::sort( v.begin() , v.end() , []( const KernelProfile::Entry& a , const KernelProfile::Entry& b ) {
+	  return a.device_time > b.device_time || ( a.device_time == b.device_time && a.id < b.id );
+	});
+    }
+
+    //! Kernel handles differ between nodes, kind and description do not
+    std::string entryKey( const KernelProfile::Entry& e ) {
+      return e.kind + "\t" + e.description;
+    }
+  }
+
+
+  KernelProfile& KernelProfile::Instance()
+  {
+    static KernelProfile singleton;
+    return singleton;
+  }
+
+
+  KernelProfile::KernelProfile(): events(false) {}
+
+
+  void KernelProfile::setOutput( const std::string& file_ )
+  {
+    file = file_;
+    QDP_info_primary("Kernel profile will be written to %s",file.c_str());
+  }
+
+
+  void KernelProfile::registerKernel( CUfunction f , const std::string& kind , const std::string& description , double build_time )
+  {
+    Entry e;
+    e.kind        = kind;
+    e.description = description.empty() ? kind : description;
+    e.build_time  = build_time;
+    e.num_regs    = CudaAttributeNumRegs( f );
+    e.local_size  = CudaAttributeLocalSize( f );
+    e.launches    = 0;
+    e.threads     = 0;
+    e.bytes       = 0;
+    e.device_time = 0.0;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    e.id = entries.size();
+    entries[f] = e;
+  }
+
+
+  void KernelProfile::launchBegin( CUstream s )
+  {
+    if (!enabled())
+      return;
+
+    if (!events) {
+      CUresult ret = cuEventCreate( &ev_start , 0 );
+      if (ret == CUDA_SUCCESS)
+	ret = cuEventCreate( &ev_stop , 0 );
+      if (ret != CUDA_SUCCESS)
+	QDP_error_exit("KernelProfile: cannot create events (%s)", mapCuErrorString[ret].c_str());
+      events = true;
+    }
+
+    cuEventRecord( ev_start , s );
+  }
+
+
+  void KernelProfile::launchEnd( CUfunction f , CUstream s , size_t threads , size_t bytes_per_thread )
+  {
+    if (!enabled())
+      return;
+
+    // Launches are synchronous at this point, so the stop event completes right away
+    float ms = 0.0f;
+    cuEventRecord( ev_stop , s );
+    cuEventSynchronize( ev_stop );
+    cuEventElapsedTime( &ms , ev_start , ev_stop );
+
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = entries.find(f);
+    if (it == entries.end())
+      return;
+    Entry& e = it->second;
+    e.launches++;
+    e.threads     += threads;
+    e.bytes       += threads * bytes_per_thread;
+    e.device_time += 1.0e-3 * ms;
+  }
+
+
+  std::vector<KernelProfile::Entry> KernelProfile::sorted() const
+  {
+    std::vector<Entry> ret;
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      for (auto& e: entries)
+	ret.push_back( e.second );
+    }
+    sortByTime( ret );
+    return ret;
+  }
+
+
+  std::vector<KernelProfile::Entry> KernelProfile::reduce() const
+  {
+    // Merge kernels built more than once with the same description
+    std::map<std::string,Entry> mine;
+    for (auto& e: sorted()) {
+      std::map<std::string,Entry>::iterator it = mine.find( entryKey(e) );
+      if (it == mine.end()) {
+	mine[ entryKey(e) ] = e;
+	continue;
+      }
+      Entry& m = it->second;
+      m.id          = std::min( m.id , e.id );
+      m.build_time  = std::max( m.build_time , e.build_time );
+      m.num_regs    = std::max( m.num_regs , e.num_regs );
+      m.local_size  = std::max( m.local_size , e.local_size );
+      m.launches    += e.launches;
+      m.threads     += e.threads;
+      m.bytes       += e.bytes;
+      m.device_time += e.device_time;
+    }
+
+    std::vector<Entry> ret;
+    if (Layout::numNodes() == 1) {
+      for (auto& m: mine)
+	ret.push_back( m.second );
+      sortByTime( ret );
+      return ret;
+    }
+
+    // Nodes may have built different kernels, agree on the union first
+    std::vector<std::string> names;
+    for (auto& m: mine)
+      names.push_back( m.first );
+    std::vector<std::string> keys = QDPInternal::unionOverNodes( names );
+
+    int num = keys.size();
+    if (num == 0)
+      return ret;
+
+    std::vector<double> id( num ), launches( num ), threads( num ), bytes( num ), device_time( num );
+    std::vector<double> build_time( num ), num_regs( num ), local_size( num );
+    for (int i = 0 ; i < num ; ++i) {
+      std::map<std::string,Entry>::const_iterator it = mine.find( keys[i] );
+      bool have = it != mine.end();
+      id[i]          = have ? it->second.id : 1.0e300;
+      launches[i]    = have ? it->second.launches : 0;
+      threads[i]     = have ? it->second.threads : 0;
+      bytes[i]       = have ? it->second.bytes : 0;
+      device_time[i] = have ? it->second.device_time : 0;
+      build_time[i]  = have ? it->second.build_time : 0;
+      num_regs[i]    = have ? it->second.num_regs : 0;
+      local_size[i]  = have ? it->second.local_size : 0;
+    }
+
+    QDPInternal::globalSumArray( &launches[0] , num );
+    QDPInternal::globalSumArray( &threads[0] , num );
+    QDPInternal::globalSumArray( &bytes[0] , num );
+    QDPInternal::globalSumArray( &device_time[0] , num );
+    for (int i = 0 ; i < num ; ++i) {
+      QMP_min_double( &id[i] );
+      QMP_max_double( &build_time[i] );
+      QMP_max_double( &num_regs[i] );
+      QMP_max_double( &local_size[i] );
+    }
+
+    for (int i = 0 ; i < num ; ++i) {
+      Entry e;
+      size_t tab = keys[i].find('\t');
+      e.kind        = keys[i].substr( 0 , tab );
+      e.description = keys[i].substr( tab + 1 );
+      e.id          = (int)id[i];
+      e.launches    = (size_t)launches[i];
+      e.threads     = (size_t)threads[i];
+      e.bytes       = (size_t)bytes[i];
+      e.device_time = device_time[i];
+      e.build_time  = build_time[i];
+      e.num_regs    = (int)num_regs[i];
+      e.local_size  = (int)local_size[i];
+      ret.push_back( e );
+    }
+    sortByTime( ret );
+    return ret;
+  }
+
+
+  void KernelProfile::write()
+  {
+    if (!enabled())
+      return;
+
+    std::vector<Entry> e = reduce();
+    if (!Layout::primaryNode())
+      return;
+
+    double peak = CudaPeakBandwidth();
+
+    std::ofstream out( file.c_str() );
+    if (!out) {
+      QDP_info_primary("KernelProfile: cannot open %s",file.c_str());
+      return;
+    }
+
+    bool csv = file.size() >= 4 && file.compare( file.size() - 4 , 4 , ".csv" ) == 0;
+    if (csv)
+      writeCSV( out , e , peak );
+    else
+      writeJSON( out , e , peak );
+
+    QDP_info_primary("Kernel profile of %d kernels written to %s",(int)e.size(),file.c_str());
+  }
+
+
+  void KernelProfile::writeJSON( std::ostream& os , const std::vector<Entry>& e , double peak ) const
+  {
+    os << std::setprecision(9);
+    os << "{\n";
+    os << "  \"peak_bandwidth\": " << peak << ",\n";
+    os << "  \"kernels\": [";
+    for (size_t i = 0 ; i < e.size() ; ++i) {
+      double bw = bandwidth( e[i] );
+      os << ( i ? ",\n" : "\n" );
+      os << "    {\"id\": " << e[i].id
+	 << ", \"kind\": \"" << json_escape( e[i].kind ) << "\""
+	 << ", \"launches\": " << e[i].launches
+	 << ", \"threads\": " << e[i].threads
+	 << ", \"device_time\": " << e[i].device_time
+	 << ", \"bytes\": " << e[i].bytes
+	 << ", \"bandwidth\": " << bw
+	 << ", \"peak_fraction\": " << ( peak > 0 ? bw / peak : 0.0 )
+	 << ", \"num_regs\": " << e[i].num_regs
+	 << ", \"local_size\": " << e[i].local_size
+	 << ", \"build_time\": " << e[i].build_time
+	 << ", \"description\": \"" << json_escape( e[i].description ) << "\"}";
+    }
+    os << "\n  ]\n}\n";
+  }
+
+
+  void KernelProfile::writeCSV( std::ostream& os , const std::vector<Entry>& e , double peak ) const
+  {
+    os << std::setprecision(9);
+    os << "id,kind,launches,threads,device_time,bytes,bandwidth,peak_fraction,num_regs,local_size,build_time,description\n";
+    for (auto& k: e) {
+      double bw = bandwidth( k );
+      os << k.id << "," << csv_quote( k.kind ) << "," << k.launches << "," << k.threads << ","
+	 << k.device_time << "," << k.bytes << "," << bw << "," << ( peak > 0 ? bw / peak : 0.0 ) << ","
+	 << k.num_regs << "," << k.local_size << "," << k.build_time << "," << csv_quote( k.description ) << "\n";
+    }
+  }
+
+}
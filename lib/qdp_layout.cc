@@ -56,30 +56,27 @@ namespace Layout
 
 #if QDP_USE_CB3D_LAYOUT == 1
 
-  multi1d<int> crtesn(int ipos, const multi1d<int>& latt_size)
-  {
-    multi1d<int> coord(latt_size.size());
-    int Ndim=latt_size.size() - 1; // Last elem latt size
+void crtesn(int ipos, const int latt_size[], int n, int coord[])
+{
+  int Ndim=n - 1; // Last elem latt size
     
-    /* Calculate the Cartesian coordinates of the VALUE of IPOS where the 
-     * value is defined by
-     *
-     *     for i = 0 to NDIM-1  {
-     *        X_i  <- mod( IPOS, L(i) )
-     *        IPOS <- int( IPOS / L(i) )
-     *     }
-     *
-     * NOTE: here the coord(i) and IPOS have their origin at 0. 
-     */
-    for(int i = Ndim; i < Ndim+latt_size.size(); ++i)
-      {
-	int ix=i%latt_size.size();
-
-	coord[ix] = ipos % latt_size[ix];
-	ipos = ipos / latt_size[ix];
-      }
+  /* Calculate the Cartesian coordinates of the VALUE of IPOS where the 
+   * value is defined by
+   *
+   *     for i = 0 to NDIM-1  {
+   *        X_i  <- mod( IPOS, L(i) )
+   *        IPOS <- int( IPOS / L(i) )
+   *     }
+   *
+   * NOTE: here the coord(i) and IPOS have their origin at 0. 
+   */
+  for(int i = Ndim; i < Ndim+n; ++i)
+  {
+    int ix=i%n;
 
-  return coord;
+    coord[ix] = ipos % latt_size[ix];
+    ipos = ipos / latt_size[ix];
+  }
 }
   
 //! Calculates the lexicographic site index from the coordinate of a site
@@ -87,7 +84,7 @@ namespace Layout
  * Nothing specific about the actual lattice size, can be used for 
  * any kind of latt size 
  */
-int local_site(const multi1d<int>& coord, const multi1d<int>& latt_size)
+int local_site(const int coord[], const int latt_size[], int n)
 {
   int order = 0;
 
@@ -95,13 +92,13 @@ int local_site(const multi1d<int>& coord, const multi1d<int>& latt_size)
   // essentially  starting from i = dim[Nd-2]
   //  order =  latt_size[i-1]*(coord[i])
   //   and need to wrap i-1 around to Nd-1 when it gets below 0
-  for(int mmu=latt_size.size()-2; mmu >= 0; --mmu) {
-    int wrapmu = (mmu-1) % latt_size.size();
-    if ( wrapmu < 0 ) wrapmu += latt_size.size();
+  for(int mmu=n-2; mmu >= 0; --mmu) {
+    int wrapmu = (mmu-1) % n;
+    if ( wrapmu < 0 ) wrapmu += n;
     order = latt_size[wrapmu]*(coord[mmu] + order);
   }
 
-  order += coord[ latt_size.size()-1 ];
+  order += coord[ n-1 ];
 
   return order;
 }
@@ -110,10 +107,8 @@ int local_site(const multi1d<int>& coord, const multi1d<int>& latt_size)
 #else
   // Usual lattice decomposition -- x fastest, t slowest
   //! Decompose a lexicographic site into coordinates
-multi1d<int> crtesn(int ipos, const multi1d<int>& latt_size)
+void crtesn(int ipos, const int latt_size[], int n, int coord[])
 {
-  multi1d<int> coord(latt_size.size());
-
   /* Calculate the Cartesian coordinates of the VALUE of IPOS where the 
    * value is defined by
    *
@@ -124,13 +119,11 @@ multi1d<int> crtesn(int ipos, const multi1d<int>& latt_size)
    *
    * NOTE: here the coord(i) and IPOS have their origin at 0. 
    */
-  for(int i=0; i < latt_size.size(); ++i)
+  for(int i=0; i < n; ++i)
   {
     coord[i] = ipos % latt_size[i];
     ipos = ipos / latt_size[i];
   }
-
-  return coord;
 }
   
 //! Calculates the lexicographic site index from the coordinate of a site
@@ -138,11 +131,11 @@ multi1d<int> crtesn(int ipos, const multi1d<int>& latt_size)
  * Nothing specific about the actual lattice size, can be used for 
  * any kind of latt size 
  */
-int local_site(const multi1d<int>& coord, const multi1d<int>& latt_size)
+int local_site(const int coord[], const int latt_size[], int n)
 {
   int order = 0;
 
-  for(int mmu=latt_size.size()-1; mmu >= 1; --mmu)
+  for(int mmu=n-1; mmu >= 1; --mmu)
     order = latt_size[mmu-1]*(coord[mmu] + order);
 
   order += coord[0];
@@ -153,5 +146,20 @@ int local_site(const multi1d<int>& coord, const multi1d<int>& latt_size)
 #endif
 
 
+//! Decompose a lexicographic site into coordinates
+multi1d<int> crtesn(int ipos, const multi1d<int>& latt_size)
+{
+  multi1d<int> coord(latt_size.size());
+  crtesn(ipos, latt_size.slice(), latt_size.size(), &coord[0]);
+  return coord;
+}
+
+//! Calculates the lexicographic site index from the coordinate of a site
+int local_site(const multi1d<int>& coord, const multi1d<int>& latt_size)
+{
+  return local_site(coord.slice(), latt_size.slice(), latt_size.size());
+}
+
+
 
 } // namespace QDP;
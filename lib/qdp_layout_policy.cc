@@ -0,0 +1,256 @@
+#include "qdp_layout_policy.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <utility>
+
+namespace QDP {
+
+  namespace {
+
+    int volume(int nd, const int sub[])
+    {
+      int vol = 1;
+      for(int i=0; i < nd; ++i)
+	vol *= sub[i];
+      return vol;
+    }
+
+    //! Local lexicographic site, x fastest
+    int lexSite(int nd, const int x[], const int sub[])
+    {
+      int lex = 0;
+      for(int i=nd-1; i >= 0; --i)
+	lex = lex * sub[i] + x[i];
+      return lex;
+    }
+
+    void lexCoords(int nd, int lex, const int sub[], int x[])
+    {
+      for(int i=0; i < nd; ++i) {
+	x[i] = lex % sub[i];
+	lex /= sub[i];
+      }
+    }
+
+
+    class LexicoPolicy : public LayoutPolicy
+    {
+    public:
+      std::string name() const { return "lexico"; }
+
+      void tabulate(int nd, const int sub[], int cls, int index[]) const
+      {
+	int vol = volume(nd, sub);
+	for(int lex=0; lex < vol; ++lex)
+	  index[lex] = lex;
+      }
+    };
+
+
+    //! Even and odd sites in two halves
+    /*! The 3d checkerboard takes the parity of all directions but the last
+        and orders each half with the last direction fastest */
+    class CheckerboardPolicy : public LayoutPolicy
+    {
+    public:
+      CheckerboardPolicy(bool cb3d_) : cb3d(cb3d_) {}
+
+      std::string name() const { return cb3d ? "cb3d" : "cb2"; }
+
+      void minimalMapping(int nd, int dim[]) const
+      {
+	LayoutPolicy::minimalMapping(nd, dim);
+	dim[0] = 2;       // must have multiple length 2 for cb
+      }
+
+      int numClasses() const { return 2; }
+
+      int nodeClass(int nd, const int origin[]) const { return parity(nd, origin); }
+
+      void tabulate(int nd, const int sub[], int cls, int index[]) const
+      {
+	int vol = volume(nd, sub);
+	std::vector<int> cb_sub(sub, sub + nd);
+	cb_sub[0] /= 2;
+
+	std::vector<int> x(nd);
+	for(int lex=0; lex < vol; ++lex)
+	{
+	  lexCoords(nd, lex, sub, &x[0]);
+	  int cb = (cls + parity(nd, &x[0])) & 1;
+	  x[0] /= 2;
+	  index[lex] = order(nd, &x[0], &cb_sub[0]) + cb*(vol/2);
+	}
+      }
+
+    private:
+      int parity(int nd, const int x[]) const
+      {
+	int n = cb3d ? nd-1 : nd;
+	int cb = 0;
+	for(int m=0; m < n; ++m)
+	  cb += x[m];
+	return cb & 1;
+      }
+
+      int order(int nd, const int x[], const int l[]) const
+      {
+	if (!cb3d)
+	  return lexSite(nd, x, l);
+
+	// t + Lt*(x + Lx*(y + Ly*z)) in 4D
+	int order = 0;
+	for(int mmu=nd-2; mmu >= 0; --mmu) {
+	  int wrapmu = (mmu + nd - 1) % nd;
+	  order = l[wrapmu]*(x[mmu] + order);
+	}
+	return order + x[nd-1];
+      }
+
+      bool cb3d;
+    };
+
+
+    //! Blocks of sites, lexicographic inside and between the blocks
+    class TiledPolicy : public LayoutPolicy
+    {
+    public:
+      TiledPolicy(int tile_) : tile(tile_) {}
+
+      std::string name() const { return "tiled:" + std::to_string(tile); }
+
+      bool blocked() const { return true; }
+
+      void tabulate(int nd, const int sub[], int cls, int index[]) const
+      {
+	std::vector<int> b(nd), nt(nd), x(nd), t(nd), y(nd);
+	for(int i=0; i < nd; ++i) {
+	  b[i] = std::min(tile, sub[i]);
+	  while (sub[i] % b[i] != 0)
+	    --b[i];
+	  nt[i] = sub[i] / b[i];
+	}
+
+	int vol = volume(nd, sub);
+	int tile_vol = volume(nd, &b[0]);
+	for(int lex=0; lex < vol; ++lex)
+	{
+	  lexCoords(nd, lex, sub, &x[0]);
+	  for(int i=0; i < nd; ++i) {
+	    t[i] = x[i] / b[i];
+	    y[i] = x[i] % b[i];
+	  }
+	  index[lex] = lexSite(nd, &t[0], &nt[0])*tile_vol + lexSite(nd, &y[0], &b[0]);
+	}
+      }
+
+    private:
+      int tile;
+    };
+
+
+    //! Z-order: sites sorted by their interleaved coordinate bits
+    class MortonPolicy : public LayoutPolicy
+    {
+    public:
+      std::string name() const { return "morton"; }
+
+      bool blocked() const { return true; }
+
+      void tabulate(int nd, const int sub[], int cls, int index[]) const
+      {
+	int bits = 0;
+	for(int i=0; i < nd; ++i)
+	  while ((1 << bits) < sub[i])
+	    ++bits;
+
+	int vol = volume(nd, sub);
+	std::vector< std::pair<uint64_t,int> > code(vol);
+	std::vector<int> x(nd);
+	for(int lex=0; lex < vol; ++lex)
+	{
+	  lexCoords(nd, lex, sub, &x[0]);
+	  uint64_t c = 0;
+	  for(int k=0; k < bits; ++k)
+	    for(int i=0; i < nd; ++i)
+	      c |= uint64_t((x[i] >> k) & 1) << (k*nd + i);
+	  code[lex] = std::make_pair(c, lex);
+	}
+
+	// Subgrids that are not a power of two in every direction leave
+	// holes in the curve; ranking closes them
+	std::sort(code.begin(), code.end());
+	for(int l=0; l < vol; ++l)
+	  index[ code[l].second ] = l;
+      }
+    };
+  }
+
+
+  void LayoutPolicy::minimalMapping(int nd, int dim[]) const
+  {
+    for(int i=0; i < nd; ++i)
+      dim[i] = 1;
+  }
+
+
+  std::shared_ptr<LayoutPolicy> layoutPolicyMake(const std::string& name)
+  {
+    if (name == "lexico")
+      return std::make_shared<LexicoPolicy>();
+    if (name == "cb2")
+      return std::make_shared<CheckerboardPolicy>(false);
+    if (name == "cb3d")
+      return std::make_shared<CheckerboardPolicy>(true);
+    if (name == "morton")
+      return std::make_shared<MortonPolicy>();
+    if (name == "tiled")
+      return std::make_shared<TiledPolicy>(4);
+    if (name.compare(0, 6, "tiled:") == 0)
+    {
+      int tile = std::atoi(name.c_str() + 6);
+      if (tile > 0)
+	return std::make_shared<TiledPolicy>(tile);
+    }
+    return std::shared_ptr<LayoutPolicy>();
+  }
+
+
+  std::string LayoutTables::make(const LayoutPolicy& policy, int nd_, const int sub_[])
+  {
+    nd = nd_;
+    sub.assign(sub_, sub_ + nd);
+    vol = volume(nd, sub_);
+
+    int ncls = policy.numClasses();
+    index.assign(ncls*vol, 0);
+    local.assign(ncls*vol, -1);
+
+    for(int cls=0; cls < ncls; ++cls)
+    {
+      int* idx = &index[cls*vol];
+      int* loc = &local[cls*vol];
+      policy.tabulate(nd, sub_, cls, idx);
+
+      for(int lex=0; lex < vol; ++lex)
+      {
+	int l = idx[lex];
+	if (l < 0 || l >= vol || loc[l] >= 0)
+	{
+	  std::ostringstream err;
+	  err << "layout " << policy.name() << " does not order the subgrid";
+	  for(int i=0; i < nd; ++i)
+	    err << " " << sub[i];
+	  err << " as a permutation";
+	  return err.str();
+	}
+	loc[l] = lex;
+      }
+    }
+    return std::string();
+  }
+
+} // namespace QDP
@@ -8,16 +8,100 @@
 #include "qdp.h"
 #include "qdp_util.h"
 
+#include <algorithm>
+
 namespace QDP {
 
-  FnMap::FnMap(const Map& m): map(m), pRsrc(new RsrcWrapper( m.destnodes , m.srcenodes )) {}
+  FnMap::FnMap(const Map& m): map(m), pRsrc(new RsrcWrapper( m.tab->destnodes , m.tab->destnodes_num , m.tab->srcenodes , m.tab->srcenodes_num )) {}
   FnMap::FnMap(const FnMap& f) : map(f.map) , pRsrc(f.pRsrc) {}
 
 
 
+  const MapTile& mapTile(const std::vector<const Map*>& maps, int start, int count, int block)
+  {
+    if (maps.empty())
+      QDP_error_exit("mapTile: no maps");
+
+    std::vector<int> key = { start , count , block };
+    for(const Map* m : maps)
+      key.push_back( m->getId() );
+
+    auto& tiles = maps[0]->tab->tiles;
+    auto it = tiles.find( key );
+    if (it != tiles.end())
+      return *it->second;
+
+    for(const Map* m : maps) {
+      if (m->hasOffnode())
+	QDP_error_exit("mapTile: map has off-node sites");
+      if (block <= 0 || start < 0 || start + count > m->goffset().size())
+	QDP_error_exit("mapTile: bad range start=%d count=%d block=%d", start, count, block);
+    }
+
+    int nmaps = maps.size();
+    int nblocks = ( count + block - 1 ) / block;
+
+    std::shared_ptr<MapTile> tile = std::make_shared<MapTile>();
+    tile->offsets.resize( nblocks + 1 );
+    tile->slots.resize( nmaps * count );
+    tile->max_stage = 0;
+
+    std::vector<int> src;
+    for(int b=0; b < nblocks; ++b)
+    {
+      int lo = b * block;
+      int hi = std::min( lo + block , count );
+
+      // The sources of the block under all maps, each once
+      src.clear();
+      for(int m=0; m < nmaps; ++m)
+	for(int t=lo; t < hi; ++t)
+	  src.push_back( maps[m]->goffset()[ start + t ] );
+      std::sort( src.begin() , src.end() );
+      src.erase( std::unique( src.begin() , src.end() ) , src.end() );
+
+      tile->offsets[b] = tile->sites.size();
+      tile->sites.insert( tile->sites.end() , src.begin() , src.end() );
+      tile->max_stage = std::max( tile->max_stage , (int)src.size() );
+
+      for(int m=0; m < nmaps; ++m)
+	for(int t=lo; t < hi; ++t)
+	  tile->slots[ m * count + t ] = std::lower_bound( src.begin() , src.end() , maps[m]->goffset()[ start + t ] ) - src.begin();
+    }
+    tile->offsets[nblocks] = tile->sites.size();
+
+    tile->offsetsId = QDPCache::Instance().registrateOwnHostMem( sizeof(int)*tile->offsets.size() , (void*)tile->offsets.data() , NULL );
+    tile->sitesId   = QDPCache::Instance().registrateOwnHostMem( sizeof(int)*tile->sites.size() , (void*)tile->sites.data() , NULL );
+    tile->slotsId   = QDPCache::Instance().registrateOwnHostMem( sizeof(int)*tile->slots.size() , (void*)tile->slots.data() , NULL );
+
+    tiles[key] = tile;
+    return *tile;
+  }
+
+
+
 //! Definition of shift function object
 ArrayBiDirectionalMap  shift;
 
+
+//----------------------------------------------------------------------------
+// OffsetMapFunc
+
+multi1d<int> OffsetMapFunc::operator() (const multi1d<int>& coord, int sign) const
+{
+  multi1d<int> lc = coord;
+
+  const multi1d<int>& nrow = Layout::lattSize();
+  for(int mu=0; mu < coord.size(); ++mu)
+  {
+    int d = (sign > 0 ? disp[mu] : -disp[mu]) % nrow[mu];
+    lc[mu] = (coord[mu] + d + nrow[mu]) % nrow[mu];
+  }
+
+  return lc;
+}
+
+
 //! Function object used for constructing the default nearest neighbor map
 struct NearestNeighborMapFunc : public ArrayMapFunc
 {
@@ -38,6 +122,14 @@ struct NearestNeighborMapFunc : public ArrayMapFunc
 
   virtual int numArray() const {return Nd;}
 
+  virtual bool offset(multi1d<int>& disp, int dir) const
+    {
+      disp.resize(Nd);
+      disp = 0;
+      disp[dir] = 1;
+      return true;
+    }
+
 private:
   int sgnum(int x) const {return (x > 0) ? 1 : -1;}
 }; 
@@ -69,6 +161,11 @@ struct PackageArrayMapFunc : public MapFunc
       return pmap(coord, isign, dir);
     }
 
+  virtual bool offset(multi1d<int>& disp) const
+    {
+      return pmap.offset(disp, dir);
+    }
+
 private:
   const ArrayMapFunc& pmap;
   const int dir;
@@ -109,6 +206,14 @@ struct PackageBiDirectionalMapFunc : public MapFunc
       return pmap(coord, mult*isign);
     }
 
+  virtual bool offset(multi1d<int>& disp) const
+    {
+      if (!pmap.offset(disp))
+	return false;
+      disp *= mult;
+      return true;
+    }
+
 private:
   const MapFunc& pmap;
   const int mult;
@@ -147,6 +252,14 @@ struct PackageArrayBiDirectionalMapFunc : public MapFunc
       return pmap(coord, mult*isign, dir);
     }
 
+  virtual bool offset(multi1d<int>& disp) const
+    {
+      if (!pmap.offset(disp, dir))
+	return false;
+      disp *= mult;
+      return true;
+    }
+
 private:
   const ArrayMapFunc& pmap;
   const int mult;
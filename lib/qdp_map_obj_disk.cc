@@ -5,7 +5,11 @@
 #include "qdp_map_obj_disk.h"
 
 #include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 namespace QDP 
 { 
@@ -65,6 +69,50 @@ namespace QDP
 
       return new_file;
     }
+
+
+    // Map the file, keep the old mapping if it is large enough
+    void MappedFile::map(const std::string& filename, size_t nbytes)
+    {
+      if (addr && len >= nbytes)
+	return;
+
+      unmap();
+
+      int fd = ::open(filename.c_str(), O_RDONLY);
+      if (fd < 0)
+	QDP_error_exit("MapObjectDisk: cannot open %s for mapping: %s", filename.c_str(), strerror(errno));
+
+      struct stat statbuf;
+      if (fstat(fd, &statbuf) != 0)
+	QDP_error_exit("MapObjectDisk: cannot stat %s: %s", filename.c_str(), strerror(errno));
+
+      size_t file_len = statbuf.st_size;
+      if (file_len < nbytes)
+	QDP_error_exit("MapObjectDisk: %s has %lu bytes, expected at least %lu",
+		       filename.c_str(), (unsigned long)file_len, (unsigned long)nbytes);
+
+      if (file_len > 0)
+      {
+	void* p = mmap(0, file_len, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+	  QDP_error_exit("MapObjectDisk: mmap of %s failed: %s", filename.c_str(), strerror(errno));
+	addr = p;
+	len  = file_len;
+      }
+
+      ::close(fd);
+    }
+
+
+    // Release the mapping
+    void MappedFile::unmap()
+    {
+      if (addr)
+	munmap(addr, len);
+      addr = 0;
+      len  = 0;
+    }
   }
     
 }
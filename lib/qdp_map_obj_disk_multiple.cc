@@ -0,0 +1,202 @@
+/*! \file
+ *  \brief Merged key index for MapObjectDiskMultiple
+ */
+
+#include "qdp_map_obj_disk_multiple.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace QDP 
+{ 
+  // Anonymous namespace
+  namespace {
+    const std::string index_magic="XXXXQDPLazyDiskMapObjIndexXXXX";
+    const MapObjDiskEnv::file_version_t index_version = 1;
+
+    //! Size and modification time, identify a data file version
+    struct FileStamp
+    {
+      uint64_t size;
+      uint64_t mtime;   // nanoseconds
+    };
+
+    //! Stat on the primary node. Zero if the file is missing
+    FileStamp getFileStamp(const std::string& file)
+    {
+      FileStamp st;
+      st.size  = 0;
+      st.mtime = 0;
+
+      if (Layout::primaryNode()) 
+      {
+	struct stat statbuf;
+	if (stat(file.c_str(), &statbuf) == 0)
+	{
+	  st.size  = statbuf.st_size;
+	  st.mtime = (uint64_t)statbuf.st_mtim.tv_sec * 1000000000ull + statbuf.st_mtim.tv_nsec;
+	}
+      }
+
+      QDPInternal::broadcast(st.size);
+      QDPInternal::broadcast(st.mtime);
+      return st;
+    }
+
+    void writeUint64(BinaryWriter& bin, const uint64_t& x)
+    {
+      bin.writeArray((const char*)&x, sizeof(uint64_t), 1);
+    }
+
+    void readUint64(BinaryReader& bin, uint64_t& x)
+    {
+      bin.readArray((char*)&x, sizeof(uint64_t), 1);
+    }
+  }
+
+
+  // Add the keys of one file
+  void MapObjectDiskIndex::add(int file, const std::vector< std::pair<std::string,uint64_t> >& keys)
+  {
+    index.reserve(index.size() + keys.size());
+
+    for(std::vector< std::pair<std::string,uint64_t> >::const_iterator k=keys.begin(); k != keys.end(); ++k)
+    {
+      Location loc;
+      loc.file = file;
+      loc.pos  = k->second;
+      index.insert(std::make_pair(k->first, loc));
+    }
+  }
+
+
+  // Read the sidecar file
+  bool MapObjectDiskIndex::read(const std::string& index_file, const std::vector<std::string>& files)
+  {
+    index.clear();
+
+    if (MapObjDiskEnv::checkForNewFile(index_file, std::ios_base::in))
+      return false;
+
+    BinaryFileReader bin(index_file);
+
+    std::string magic;
+    readDesc(bin, magic);
+    if (magic != index_magic)
+    {
+      QDPIO::cout << "MapObjectDiskIndex: " << index_file << " is not an index file, ignored" << std::endl;
+      return false;
+    }
+
+    MapObjDiskEnv::file_version_t version;
+    QDP::read(bin, version);
+    if (version != index_version)
+      return false;
+
+    // The data files must be the same and unchanged
+    int num_files;
+    QDP::read(bin, num_files);
+    if (num_files != (int)files.size())
+      return false;
+
+    for(int i=0; i < num_files; ++i)
+    {
+      std::string name;
+      FileStamp   st;
+      readDesc(bin, name);
+      readUint64(bin, st.size);
+      readUint64(bin, st.mtime);
+
+      FileStamp now = getFileStamp(files[i]);
+      if (name != files[i] || st.size != now.size || st.mtime != now.mtime)
+      {
+	QDPIO::cout << "MapObjectDiskIndex: " << index_file << " is out of date, rebuilding it" << std::endl;
+	return false;
+      }
+    }
+
+    unsigned int num_keys;
+    QDP::read(bin, num_keys);
+    index.reserve(num_keys);
+
+    for(unsigned int i=0; i < num_keys; ++i)
+    {
+      std::string key;
+      Location    loc;
+      readDesc(bin, key);
+      QDP::read(bin, loc.file);
+      readUint64(bin, loc.pos);
+      index.insert(std::make_pair(key, loc));
+    }
+
+    QDPUtil::n_uint32_t calc_checksum = bin.getChecksum();
+    QDPUtil::n_uint32_t read_checksum;
+    QDP::read(bin, read_checksum);
+    bin.close();
+
+    if (read_checksum != calc_checksum || index.size() != num_keys)
+    {
+      QDPIO::cout << "MapObjectDiskIndex: " << index_file << " is damaged, rebuilding it" << std::endl;
+      index.clear();
+      return false;
+    }
+
+    QDPIO::cout << "MapObjectDiskIndex: read " << num_keys << " keys from " << index_file << std::endl;
+    return true;
+  }
+
+
+  // Write the sidecar file
+  void MapObjectDiskIndex::write(const std::string& index_file, const std::vector<std::string>& files) const
+  {
+    // Readers opening concurrently must never see a partial file
+    int pid = getpid();
+    QDPInternal::broadcast(pid);
+    std::ostringstream tmp;
+    tmp << index_file << ".tmp." << pid;
+
+    BinaryFileWriter bin(tmp.str());
+
+    writeDesc(bin, index_magic);
+    QDP::write(bin, index_version);
+
+    int num_files = files.size();
+    QDP::write(bin, num_files);
+    for(int i=0; i < num_files; ++i)
+    {
+      FileStamp st = getFileStamp(files[i]);
+      writeDesc(bin, files[i]);
+      writeUint64(bin, st.size);
+      writeUint64(bin, st.mtime);
+    }
+
+    unsigned int num_keys = index.size();
+    QDP::write(bin, num_keys);
+    for(MapType_t::const_iterator k=index.begin(); k != index.end(); ++k)
+    {
+      writeDesc(bin, k->first);
+      QDP::write(bin, k->second.file);
+      writeUint64(bin, k->second.pos);
+    }
+
+    QDP::write(bin, bin.getChecksum());
+    bin.close();
+
+    if (Layout::primaryNode())
+    {
+      if (rename(tmp.str().c_str(), index_file.c_str()) != 0)
+      {
+	QDPIO::cerr << "MapObjectDiskIndex: cannot rename " << tmp.str() << " to " << index_file 
+		    << ": " << strerror(errno) << std::endl;
+	unlink(tmp.str().c_str());
+	return;
+      }
+    }
+
+    QDPIO::cout << "MapObjectDiskIndex: wrote " << num_keys << " keys to " << index_file << std::endl;
+  }
+    
+}
@@ -0,0 +1,108 @@
+#include "qdp_map_route.h"
+#include "qdp_host_threads.h"
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
+namespace QDP {
+
+  namespace {
+
+    //! Sorted distinct nodes other than my_node with their counts and prefix offsets
+    void peers( const std::vector<int>& node , int my_node ,
+		std::vector<int>& list , std::vector<int>& num , std::vector<int>& off )
+    {
+      list.clear();
+      for (int n: node)
+	if (n != my_node)
+	  list.push_back( n );
+      std::sort( list.begin() , list.end() );
+      list.erase( std::unique( list.begin() , list.end() ) , list.end() );
+
+      num.assign( list.size() , 0 );
+      for (int n: node)
+	if (n != my_node)
+	  num[ std::lower_bound( list.begin() , list.end() , n ) - list.begin() ]++;
+
+      off.assign( list.size() , 0 );
+      for (size_t k = 1; k < list.size(); ++k)
+	off[k] = off[k-1] + num[k-1];
+    }
+
+    int peerIndex( const std::vector<int>& list , int n )
+    {
+      return std::lower_bound( list.begin() , list.end() , n ) - list.begin();
+    }
+  }
+
+
+  std::string mapRouteMake( MapRoute& r , int my_node , int nodeSites , const MapSiteFunc& f ,
+			    bool threads )
+  {
+    std::vector<MapSite> src( nodeSites ), dst( nodeSites );
+    std::vector<int> srcnode( nodeSites ), dstnode( nodeSites );
+
+    auto apply = [&](size_t lo, size_t hi, int) {
+      for (size_t linear = lo; linear < hi; ++linear) {
+	src[linear] = f( linear , +1 );
+	dst[linear] = f( linear , -1 );
+	srcnode[linear] = src[linear].node;
+	dstnode[linear] = dst[linear].node;
+      }
+    };
+    if (threads)
+      hostParallelFor( nodeSites , 1024 , true , apply );
+    else
+      apply( 0 , nodeSites , 0 );
+
+    peers( srcnode , my_node , r.srcenodes , r.srcenodes_num , r.srcenodes_off );
+    peers( dstnode , my_node , r.destnodes , r.destnodes_num , r.destnodes_off );
+
+    if (r.srcenodes.empty() != r.destnodes.empty()) {
+      std::ostringstream oss;
+      oss << "node " << my_node << " receives from " << r.srcenodes.size()
+	  << " nodes but sends to " << r.destnodes.size();
+      return oss.str();
+    }
+
+    // Receive side: a segment per source node, destination sites ascending in each
+    r.goffsets.resize( nodeSites );
+    r.roffsets.clear();
+    std::vector<int> fill( r.srcenodes_off );
+    for (int linear = 0; linear < nodeSites; ++linear) {
+      if (srcnode[linear] == my_node) {
+	r.goffsets[linear] = src[linear].linear;
+      } else {
+	int k = peerIndex( r.srcenodes , srcnode[linear] );
+	r.goffsets[linear] = -( fill[k]++ ) - 1;
+	r.roffsets.push_back( linear );
+      }
+    }
+
+    // Send side: the same order as the receiver's segment, i.e. by peer
+    // and then by the receiver's destination site
+    std::vector< std::pair< std::pair<int,int> , int > > order;
+    for (int linear = 0; linear < nodeSites; ++linear) {
+      if (dstnode[linear] == my_node) {
+	if (r.goffsets[ dst[linear].linear ] != linear) {
+	  std::ostringstream oss;
+	  oss << "node " << my_node << ": site " << linear << " maps to " << dst[linear].linear
+	      << " but that site's source is " << r.goffsets[ dst[linear].linear ];
+	  return oss.str();
+	}
+      } else {
+	int k = peerIndex( r.destnodes , dstnode[linear] );
+	order.push_back( std::make_pair( std::make_pair( k , dst[linear].linear ) , linear ) );
+      }
+    }
+    std::sort( order.begin() , order.end() );
+
+    r.soffsets.resize( order.size() );
+    for (size_t i = 0; i < order.size(); ++i)
+      r.soffsets[i] = order[i].second;
+
+    return std::string();
+  }
+
+} // namespace QDP
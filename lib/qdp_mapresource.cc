@@ -3,40 +3,25 @@
 namespace QDP {
 
 
-  void FnMapRsrc::setup(int _destNode,int _srcNode,int _sendMsgSize,int _rcvMsgSize) {
+  void FnMapRsrc::setup(const multi1d<int>& destnodes, const multi1d<int>& destnodes_num,
+			const multi1d<int>& srcenodes, const multi1d<int>& srcenodes_num, int siteBytes) {
 
     bSet=true;
 
-    srcnum=_rcvMsgSize;
-    dstnum=_sendMsgSize;
+    srcnum=0;
+    for (int i=0;i<srcenodes_num.size();i++)
+      srcnum += srcenodes_num[i]*siteBytes;
 
-    int srcnode = _srcNode;
-    int dstnode = _destNode;
+    dstnum=0;
+    for (int i=0;i<destnodes_num.size();i++)
+      dstnum += destnodes_num[i]*siteBytes;
 
     // QDPIO::cout << 
-    //   "FnMapRsrc destNode=" << _destNode << 
-    //   " srcNode=" << _srcNode << 
-    //   " sendMsgSize=" << _sendMsgSize << 
-    //   " rcvMsgSize=" << _rcvMsgSize << "\n";
-
-#if 0
-    send_buf_mem = QMP_allocate_aligned_memory(dstnum,QDP_ALIGNMENT_SIZE, (QMP_MEM_COMMS|QMP_MEM_FAST) ); // packed data to send
-    if( send_buf_mem == 0x0 ) { 
-      send_buf_mem = QMP_allocate_aligned_memory(dstnum, QDP_ALIGNMENT_SIZE, QMP_MEM_COMMS);
-      if( send_buf_mem == 0x0 ) { 
-	QDP_error_exit("Unable to allocate send_buf_mem\n");
-      }
-    }
-    recv_buf_mem = QMP_allocate_aligned_memory(srcnum,QDP_ALIGNMENT_SIZE, (QMP_MEM_COMMS|QMP_MEM_FAST)); // packed receive data
-    if( recv_buf_mem == 0x0 ) { 
-      recv_buf_mem = QMP_allocate_aligned_memory(srcnum, QDP_ALIGNMENT_SIZE, QMP_MEM_COMMS); 
-      if( recv_buf_mem == 0x0 ) { 
-	QDP_error_exit("Unable to allocate recv_buf_mem\n");
-      }
-    }
-    send_buf=QMP_get_memory_pointer(send_buf_mem);
-    recv_buf=QMP_get_memory_pointer(recv_buf_mem);
-#endif
+    //   "FnMapRsrc destnodes=" << destnodes.size() << 
+    //   " srcenodes=" << srcenodes.size() << 
+    //   " sendMsgSize=" << dstnum << 
+    //   " rcvMsgSize=" << srcnum << "\n";
+
     if (!DeviceParams::Instance().getGPUDirect()) {
       CudaHostAlloc(&send_buf,dstnum,0);
       CudaHostAlloc(&recv_buf,srcnum,0);
@@ -50,38 +35,42 @@ namespace QDP {
     if (!QDPCache::Instance().allocate_device_static( &send_buf_dev , dstnum))
       QDP_error_exit("Error allocating GPU memory for send buffer");
 
-    if (!DeviceParams::Instance().getGPUDirect()) {
-      msg[0] = QMP_declare_msgmem( recv_buf , srcnum );
-    } else {
-      msg[0] = QMP_declare_msgmem( recv_buf_dev , srcnum );
-    }
+    unsigned char* recv_base = (unsigned char*)( DeviceParams::Instance().getGPUDirect() ? recv_buf_dev : recv_buf );
+    unsigned char* send_base = (unsigned char*)( DeviceParams::Instance().getGPUDirect() ? send_buf_dev : send_buf );
 
-    if( msg[0] == (QMP_msgmem_t)NULL ) { 
-      QDP_error_exit("QMP_declare_msgmem for msg[0] failed in Map::operator()\n");
-    }
-
-    if (!DeviceParams::Instance().getGPUDirect()) {
-      msg[1] = QMP_declare_msgmem( send_buf , dstnum );
-    } else {
-      msg[1] = QMP_declare_msgmem( send_buf_dev , dstnum );
-    }
+    // One message per segment, the receives are declared first
+    msg.clear();
+    mh_a.clear();
 
+    for (int i=0, off=0; i<srcenodes.size(); off += srcenodes_num[i++]*siteBytes) {
+      QMP_msgmem_t m = QMP_declare_msgmem( recv_base + off , srcenodes_num[i]*siteBytes );
+      if( m == (QMP_msgmem_t)NULL ) { 
+	QDP_error_exit("QMP_declare_msgmem for receive from %d failed in Map::operator()\n",srcenodes[i]);
+      }
+      msg.push_back(m);
 
-    if( msg[1] == (QMP_msgmem_t)NULL ) {
-      QDP_error_exit("QMP_declare_msgmem for msg[1] failed in Map::operator()\n");
+      QMP_msghandle_t h = QMP_declare_receive_from(m, srcenodes[i], 0);
+      if( h == (QMP_msghandle_t)NULL ) { 
+	QDP_error_exit("QMP_declare_receive_from %d failed in Map::operator()\n",srcenodes[i]);
+      }
+      mh_a.push_back(h);
     }
 
-    mh_a[0] = QMP_declare_receive_from(msg[0], srcnode, 0);
-    if( mh_a[0] == (QMP_msghandle_t)NULL ) { 
-      QDP_error_exit("QMP_declare_receive_from for mh_a[0] failed in Map::operator()\n");
-    }
+    for (int i=0, off=0; i<destnodes.size(); off += destnodes_num[i++]*siteBytes) {
+      QMP_msgmem_t m = QMP_declare_msgmem( send_base + off , destnodes_num[i]*siteBytes );
+      if( m == (QMP_msgmem_t)NULL ) {
+	QDP_error_exit("QMP_declare_msgmem for send to %d failed in Map::operator()\n",destnodes[i]);
+      }
+      msg.push_back(m);
 
-    mh_a[1] = QMP_declare_send_to(msg[1], dstnode , 0);
-    if( mh_a[1] == (QMP_msghandle_t)NULL ) {
-      QDP_error_exit("QMP_declare_send_to for mh_a[1] failed in Map::operator()\n");
+      QMP_msghandle_t h = QMP_declare_send_to(m, destnodes[i] , 0);
+      if( h == (QMP_msghandle_t)NULL ) {
+	QDP_error_exit("QMP_declare_send_to %d failed in Map::operator()\n",destnodes[i]);
+      }
+      mh_a.push_back(h);
     }
 
-    mh = QMP_declare_multiple(mh_a, 2);
+    mh = QMP_declare_multiple(mh_a.data(), mh_a.size());
     if( mh == (QMP_msghandle_t)NULL ) { 
       QDP_error_exit("QMP_declare_multiple for mh failed in Map::operator()\n");
     }
@@ -93,12 +82,8 @@ namespace QDP {
       QMP_free_msghandle(mh);
       // QMP_free_msghandle(mh_a[1]);
       // QMP_free_msghandle(mh_a[0]);
-      QMP_free_msgmem(msg[1]);
-      QMP_free_msgmem(msg[0]);
-#if 0
-      QMP_free_memory(recv_buf_mem);
-      QMP_free_memory(send_buf_mem);
-#endif
+      for (int i=0;i<msg.size();i++)
+	QMP_free_msgmem(msg[i]);
       QDPCache::Instance().free_device_static( send_buf_dev );
       QDPCache::Instance().free_device_static( recv_buf_dev );
       CudaHostFree(send_buf);
@@ -132,20 +117,7 @@ namespace QDP {
     QMP_status_t err;
 #if QDP_DEBUG >= 3
     QDP_info("Map: send = 0x%x  recv = 0x%x",send_buf,recv_buf);
-    QDP_info("Map: establish send=%d recv=%d",destnodes[0],srcenodes[0]);
-    {
-      const multi1d<int>& me = Layout::nodeCoord();
-      multi1d<int> scrd = Layout::getLogicalCoordFrom(destnodes[0]);
-      multi1d<int> rcrd = Layout::getLogicalCoordFrom(srcenodes[0]);
-
-      QDP_info("Map: establish-info   my_crds=[%d,%d,%d,%d]",me[0],me[1],me[2],me[3]);
-      QDP_info("Map: establish-info send_crds=[%d,%d,%d,%d]",scrd[0],scrd[1],scrd[2],scrd[3]);
-      QDP_info("Map: establish-info recv_crds=[%d,%d,%d,%d]",rcrd[0],rcrd[1],rcrd[2],rcrd[3]);
-    }
-#endif
-
-#if QDP_DEBUG >= 3
-    QDP_info("Map: calling start send=%d recv=%d",destnodes[0],srcenodes[0]);
+    QDP_info("Map: calling start on %d messages",(int)mh_a.size());
 #endif
 
 #ifdef GPU_DEBUG_DEEP
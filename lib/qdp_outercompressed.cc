@@ -0,0 +1,258 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief SU(3) compression and reconstruction for OLatticeCompressed
+ *
+ * The host and the JIT versions follow the same sequence of operations.
+ * Matrices are passed as 18 reals, m[2*(3*row+col)+reim]. Rows are named
+ * a, b, c.
+ */
+
+#include "qdp.h"
+
+#include <cmath>
+#include <complex>
+
+namespace QDP {
+
+  namespace {
+    typedef std::complex<double> dcmplx;
+
+    inline dcmplx get( const double* m , int row , int col ) {
+      return dcmplx( m[ 2*(3*row+col) ] , m[ 2*(3*row+col) + 1 ] );
+    }
+
+    inline void put( double* m , int row , int col , const dcmplx& z ) {
+      m[ 2*(3*row+col)     ] = z.real();
+      m[ 2*(3*row+col) + 1 ] = z.imag();
+    }
+
+
+    //! Complex number held in two registers
+    struct jit_cmplx {
+      jit_value r;
+      jit_value i;
+      jit_cmplx( const jit_value& r_ , const jit_value& i_ ): r(r_), i(i_) {}
+    };
+
+    inline jit_cmplx operator*( const jit_cmplx& x , const jit_cmplx& y ) {
+      return jit_cmplx( jit_ins_sub( jit_ins_mul( x.r , y.r ) , jit_ins_mul( x.i , y.i ) ) ,
+			jit_ins_add( jit_ins_mul( x.r , y.i ) , jit_ins_mul( x.i , y.r ) ) );
+    }
+
+    inline jit_cmplx operator+( const jit_cmplx& x , const jit_cmplx& y ) {
+      return jit_cmplx( jit_ins_add( x.r , y.r ) , jit_ins_add( x.i , y.i ) );
+    }
+
+    inline jit_cmplx operator-( const jit_cmplx& x , const jit_cmplx& y ) {
+      return jit_cmplx( jit_ins_sub( x.r , y.r ) , jit_ins_sub( x.i , y.i ) );
+    }
+
+    inline jit_cmplx scale( const jit_cmplx& x , const jit_value& s ) {
+      return jit_cmplx( jit_ins_mul( x.r , s ) , jit_ins_mul( x.i , s ) );
+    }
+
+    inline jit_cmplx conj( const jit_cmplx& x ) {
+      return jit_cmplx( x.r , jit_ins_neg( x.i ) );
+    }
+
+    inline jit_value norm( const jit_cmplx& x ) {
+      return jit_ins_add( jit_ins_mul( x.r , x.r ) , jit_ins_mul( x.i , x.i ) );
+    }
+
+    //! r * exp(i theta), sin/cos in the precision of theta
+    jit_cmplx polar( const jit_value& r , const jit_value& theta ) {
+      if (theta.get_type() == jit_ptx_type::f64)
+	return jit_cmplx( jit_ins_mul( r , jit_ins_cos_f64( theta ) ) , jit_ins_mul( r , jit_ins_sin_f64( theta ) ) );
+      else
+	return jit_cmplx( jit_ins_mul( r , jit_ins_cos_f32( theta ) ) , jit_ins_mul( r , jit_ins_sin_f32( theta ) ) );
+    }
+
+    //! packed[7] of a block diagonal matrix, outside the range of a phase
+    const double su3_block_diagonal = 8.0;
+
+    //! packed[7] above this marks a block diagonal matrix
+    const double su3_block_diagonal_test = 4.0;
+
+    //! sqrt(|1 - x|), the fabs guards against rounding just above 1
+    jit_value sqrt_one_minus( const jit_value& x ) {
+      jit_value one = jit_val_convert( x.get_type() , jit_value( 1.0 ) );
+      return jit_ins_sqrt( jit_ins_fabs( jit_ins_sub( one , x ) ) );
+    }
+  }
+
+
+
+  void su3Compress( const double* m , int reals , double* packed , double eps )
+  {
+    if (reals == 12) {
+      for ( int k = 0 ; k < 12 ; ++k )
+	packed[k] = m[k];
+      return;
+    }
+
+    if (reals != 8)
+      QDP_error_exit("su3Compress: %d reals per matrix not supported", reals);
+
+    // Reconstruction divides by |a1|^2+|a2|^2, with a relative error of
+    // about eps/row_sum. Below eps^(2/3) dropping a1, a2, b0 and c0
+    // (an error of sqrt(row_sum)) is the smaller error: the matrix is
+    // then diag(a0) times a 2x2 unitary block with determinant conj(a0),
+    // given by its first row b1, b2.
+    double row_sum = std::norm( get( m , 0 , 1 ) ) + std::norm( get( m , 0 , 2 ) );
+    if (row_sum < std::pow( eps , 2.0/3.0 )) {
+      packed[0] = m[8];    // b1
+      packed[1] = m[9];
+      packed[2] = m[10];   // b2
+      packed[3] = m[11];
+      packed[4] = 0.0;
+      packed[5] = 0.0;
+      packed[6] = std::arg( get( m , 0 , 0 ) );
+      packed[7] = su3_block_diagonal;
+      return;
+    }
+
+    packed[0] = m[2];    // a1
+    packed[1] = m[3];
+    packed[2] = m[4];    // a2
+    packed[3] = m[5];
+    packed[4] = m[6];    // b0
+    packed[5] = m[7];
+    packed[6] = std::arg( get( m , 0 , 0 ) );
+    packed[7] = std::arg( get( m , 2 , 0 ) );
+  }
+
+
+
+  void su3Reconstruct( const double* packed , int reals , double* m )
+  {
+    if (reals == 12) {
+      for ( int k = 0 ; k < 12 ; ++k )
+	m[k] = packed[k];
+      // c_k = conj( a_i b_j - a_j b_i ), (i,j,k) cyclic
+      for ( int k = 0 ; k < 3 ; ++k ) {
+	int i = (k+1) % 3;
+	int j = (k+2) % 3;
+	put( m , 2 , k , std::conj( get( m , 0 , i ) * get( m , 1 , j ) - get( m , 0 , j ) * get( m , 1 , i ) ) );
+      }
+      return;
+    }
+
+    if (reals != 8)
+      QDP_error_exit("su3Reconstruct: %d reals per matrix not supported", reals);
+
+    if (packed[7] > su3_block_diagonal_test) {
+      // diag(a0) and the block [[b1,b2],[c1,c2]], unitary with determinant conj(a0)
+      dcmplx a0 = std::polar( 1.0 , packed[6] );
+      dcmplx b1( packed[0] , packed[1] );
+      dcmplx b2( packed[2] , packed[3] );
+      dcmplx d  = std::conj(a0);
+      dcmplx c1 = -std::conj(b2) * d;
+      dcmplx c2 = std::conj(b1) * d;
+
+      put( m , 0 , 0 , a0 ); put( m , 0 , 1 , 0.0 ); put( m , 0 , 2 , 0.0 );
+      put( m , 1 , 0 , 0.0 ); put( m , 1 , 1 , b1 ); put( m , 1 , 2 , b2 );
+      put( m , 2 , 0 , 0.0 ); put( m , 2 , 1 , c1 ); put( m , 2 , 2 , c2 );
+      return;
+    }
+
+    dcmplx a1( packed[0] , packed[1] );
+    dcmplx a2( packed[2] , packed[3] );
+    dcmplx b0( packed[4] , packed[5] );
+
+    // First row and column have unit length
+    double row_sum = std::norm(a1) + std::norm(a2);
+    dcmplx  a0      = std::polar( std::sqrt( std::fabs( 1.0 - row_sum ) ) , packed[6] );
+    double col_sum = std::norm(a0) + std::norm(b0);
+    dcmplx  c0      = std::polar( std::sqrt( std::fabs( 1.0 - col_sum ) ) , packed[7] );
+
+    // Remaining 2x2 block from orthogonality and unit determinant
+    double r_inv2 = 1.0 / row_sum;
+
+    dcmplx A  = std::conj(a0) * b0;
+    dcmplx b1 = ( std::conj(c0) * std::conj(a2) + A * a1 ) * (-r_inv2);
+    dcmplx b2 = ( std::conj(c0) * std::conj(a1) - A * a2 ) * r_inv2;
+
+    A = std::conj(a0) * c0;
+    dcmplx c1 = ( std::conj(b0) * std::conj(a2) - A * a1 ) * r_inv2;
+    dcmplx c2 = ( std::conj(b0) * std::conj(a1) + A * a2 ) * (-r_inv2);
+
+    put( m , 0 , 0 , a0 ); put( m , 0 , 1 , a1 ); put( m , 0 , 2 , a2 );
+    put( m , 1 , 0 , b0 ); put( m , 1 , 1 , b1 ); put( m , 1 , 2 , b2 );
+    put( m , 2 , 0 , c0 ); put( m , 2 , 1 , c1 ); put( m , 2 , 2 , c2 );
+  }
+
+
+
+  std::vector<jit_value> jit_su3_reconstruct( const std::vector<jit_value>& packed , int reals )
+  {
+    if ((int)packed.size() != reals)
+      QDP_error_exit("jit_su3_reconstruct: got %d registers for %d reals", (int)packed.size(), reals);
+
+    std::vector<jit_value> m;
+
+    if (reals == 12) {
+      std::vector<jit_cmplx> a, b;
+      for ( int c = 0 ; c < 3 ; ++c ) {
+	a.push_back( jit_cmplx( packed[ 2*c     ] , packed[ 2*c + 1 ] ) );
+	b.push_back( jit_cmplx( packed[ 6 + 2*c ] , packed[ 7 + 2*c ] ) );
+      }
+      m = packed;
+      for ( int k = 0 ; k < 3 ; ++k ) {
+	int i = (k+1) % 3;
+	int j = (k+2) % 3;
+	jit_cmplx c = conj( a[i] * b[j] - a[j] * b[i] );
+	m.push_back( c.r );
+	m.push_back( c.i );
+      }
+      return m;
+    }
+
+    if (reals != 8)
+      QDP_error_exit("jit_su3_reconstruct: %d reals per matrix not supported", reals);
+
+    jit_cmplx a1( packed[0] , packed[1] );
+    jit_cmplx a2( packed[2] , packed[3] );
+    jit_cmplx b0( packed[4] , packed[5] );
+
+    jit_value row_sum = jit_ins_add( norm(a1) , norm(a2) );
+    jit_cmplx a0      = polar( sqrt_one_minus( row_sum ) , packed[6] );
+    jit_value col_sum = jit_ins_add( norm(a0) , norm(b0) );
+    jit_cmplx c0      = polar( sqrt_one_minus( col_sum ) , packed[7] );
+
+    jit_value r_inv2     = jit_ins_div( jit_val_convert( row_sum.get_type() , jit_value( 1.0 ) ) , row_sum );
+    jit_value neg_r_inv2 = jit_ins_neg( r_inv2 );
+
+    jit_cmplx A  = conj(a0) * b0;
+    jit_cmplx b1 = scale( conj(c0) * conj(a2) + A * a1 , neg_r_inv2 );
+    jit_cmplx b2 = scale( conj(c0) * conj(a1) - A * a2 , r_inv2 );
+
+    A = conj(a0) * c0;
+    jit_cmplx c1 = scale( conj(b0) * conj(a2) - A * a1 , r_inv2 );
+    jit_cmplx c2 = scale( conj(b0) * conj(a1) + A * a2 , neg_r_inv2 );
+
+    // Block diagonal matrices (see su3Reconstruct), both forms are computed
+    // and the flag selects, the general one may be inf or NaN then
+    jit_value zero = jit_val_convert( packed[7].get_type() , jit_value( 0.0 ) );
+    jit_value one  = jit_val_convert( packed[7].get_type() , jit_value( 1.0 ) );
+    jit_value diag = jit_ins_gt( packed[7] , jit_val_convert( packed[7].get_type() , jit_value( su3_block_diagonal_test ) ) );
+
+    jit_cmplx d_zero( zero , zero );
+    jit_cmplx d_a0  = polar( one , packed[6] );
+    jit_cmplx d_b1( packed[0] , packed[1] );
+    jit_cmplx d_b2( packed[2] , packed[3] );
+    jit_cmplx d     = conj( d_a0 );
+    jit_cmplx d_c1  = conj( d_b2 ) * d;
+    d_c1 = jit_cmplx( jit_ins_neg( d_c1.r ) , jit_ins_neg( d_c1.i ) );
+    jit_cmplx d_c2  = conj( d_b1 ) * d;
+
+    const jit_cmplx* rows[9]   = { &a0 , &a1 , &a2 , &b0 , &b1 , &b2 , &c0 , &c1 , &c2 };
+    const jit_cmplx* d_rows[9] = { &d_a0 , &d_zero , &d_zero , &d_zero , &d_b1 , &d_b2 , &d_zero , &d_c1 , &d_c2 };
+    for ( int k = 0 ; k < 9 ; ++k ) {
+      m.push_back( jit_ins_selp( d_rows[k]->r , rows[k]->r , diag ) );
+      m.push_back( jit_ins_selp( d_rows[k]->i , rows[k]->i , diag ) );
+    }
+    return m;
+  }
+
+} // namespace QDP
@@ -91,6 +91,7 @@ namespace QDP {
     
     CudaCreateStreams();
     CUDAHostPoolAllocator::Instance().registerMemory();
+    QDPSlabAllocator::Instance().registerMemory();
   }
 
 
@@ -238,6 +239,10 @@ namespace QDP {
 				for(int i=1; i < Nd; i++) 
 					fprintf(stderr,",-1");
 				fprintf(stderr,"] logical machine geometry\n");
+				fprintf(stderr,"    -layout   %%s [%s] site ordering: lexico, cb2, cb3d, tiled[:N], morton\n",
+						Layout::policy().name().c_str());
+				fprintf(stderr,"    -rng      %%s [%s] lattice random numbers: lcg, philox\n",
+						RNG::getGenerator() == RNG::Generator::philox ? "philox" : "lcg");
 				
 #ifdef USE_REMOTE_QIO
 				fprintf(stderr,"    -cd       %%s [.] set working dir for QIO interface\n");
@@ -279,6 +284,149 @@ namespace QDP {
 			    sscanf((*argv)[++i],"%s",&buffer);
 			    DeviceParams::Instance().setENVVAR(buffer);
 			  }
+			else if (strcmp((*argv)[i], "-jitthreads")==0) 
+			  {
+			    int n;
+			    sscanf((*argv)[++i],"%d",&n);
+			    jit_set_build_threads(n);
+			  }
+			else if (strcmp((*argv)[i], "-halfround")==0) 
+			  {
+			    char buffer[1024];
+			    sscanf((*argv)[++i],"%s",&buffer);
+			    HalfRounding mode;
+			    if (!parseHalfRounding(buffer,mode))
+			      QDP_error_exit("-halfround expects rn, rz, rm or rp, got %s",buffer);
+			    setHalfRounding(mode);
+			  }
+			else if (strcmp((*argv)[i], "-slab")==0) 
+			  {
+			    char buffer[1024];
+			    sscanf((*argv)[++i],"%s",&buffer);
+			    if (strcmp(buffer,"on")==0)
+			      QDPSlabAllocator::Instance().setEnabled(true);
+			    else if (strcmp(buffer,"off")==0)
+			      QDPSlabAllocator::Instance().setEnabled(false);
+			    else
+			      QDP_error_exit("-slab expects on or off, got %s",buffer);
+			  }
+#ifdef QDP_USE_PTX_EMULATOR
+			else if (strcmp((*argv)[i], "-emucount")==0) 
+			  {
+			    char buffer[1024];
+			    sscanf((*argv)[++i],"%s",&buffer);
+			    if (strcmp(buffer,"on")==0)
+			      ptxEmuSetCounting(true);
+			    else if (strcmp(buffer,"off")==0)
+			      ptxEmuSetCounting(false);
+			    else
+			      QDP_error_exit("-emucount expects on or off, got %s",buffer);
+			  }
+			else if (strcmp((*argv)[i], "-emuthreads")==0) 
+			  {
+			    int n;
+			    sscanf((*argv)[++i],"%d",&n);
+			    ptxEmuSetThreads(n);
+			  }
+#endif
+			else if (strcmp((*argv)[i], "-hostthreads")==0)
+			  {
+			    int n;
+			    sscanf((*argv)[++i],"%d",&n);
+			    hostThreadsSetCount(n);
+			  }
+			else if (strcmp((*argv)[i], "-hostpin")==0)
+			  {
+			    char buffer[1024];
+			    sscanf((*argv)[++i],"%s",&buffer);
+			    HostPinning pin;
+			    if (!hostThreadsParsePinning(buffer,pin))
+			      QDP_error_exit("-hostpin expects on, off or auto, got %s",buffer);
+			    hostThreadsSetPinning(pin);
+			  }
+			else if (strcmp((*argv)[i], "-iochunk")==0)
+			  {
+			    int mb;
+			    sscanf((*argv)[++i],"%d",&mb);
+			    AsyncIOOptions opt = asyncIOGetOptions();
+			    opt.chunk = (size_t)mb << 20;
+			    asyncIOSetOptions(opt);
+			  }
+			else if (strcmp((*argv)[i], "-iobuffers")==0)
+			  {
+			    AsyncIOOptions opt = asyncIOGetOptions();
+			    sscanf((*argv)[++i],"%d",&opt.buffers);
+			    asyncIOSetOptions(opt);
+			  }
+			else if (strcmp((*argv)[i], "-iodirect")==0)
+			  {
+			    AsyncIOOptions opt = asyncIOGetOptions();
+			    opt.direct = true;
+			    asyncIOSetOptions(opt);
+			  }
+			else if (strcmp((*argv)[i], "-rng")==0)
+			  {
+			    char buffer[1024];
+			    sscanf((*argv)[++i],"%s",&buffer);
+			    RNG::Generator g;
+			    if (!RNG::parseGenerator(buffer,g))
+			      QDP_error_exit("-rng expects lcg or philox, got %s",buffer);
+			    RNG::setGenerator(g);
+			  }
+			else if (strcmp((*argv)[i], "-layout")==0)
+			  {
+			    char buffer[1024];
+			    sscanf((*argv)[++i],"%s",&buffer);
+			    std::shared_ptr<LayoutPolicy> policy = layoutPolicyMake(buffer);
+			    if (!policy)
+			      QDP_error_exit("-layout expects lexico, cb2, cb3d, tiled, tiled:N or morton, got %s",buffer);
+			    Layout::setPolicy(policy);
+			  }
+			else if (strcmp((*argv)[i], "-tiling")==0)
+			  {
+			    char buffer[1024];
+			    sscanf((*argv)[++i],"%s",&buffer);
+			    JitTiling mode;
+			    if (!jit_parse_tiling(buffer,mode))
+			      QDP_error_exit("-tiling expects off, on or auto, got %s",buffer);
+			    jit_set_tiling(mode);
+			  }
+#if QDP_USE_AVX == 1
+			else if (strcmp((*argv)[i], "-avx-isa")==0)
+			  {
+			    char buffer[1024];
+			    sscanf((*argv)[++i],"%s",&buffer);
+			    AVX::Isa isa;
+			    if (!AVX::parseIsa(buffer,isa))
+			      QDP_error_exit("-avx-isa expects generic, avx2 or avx512, got %s",buffer);
+			    AVX::setIsa(isa);
+			    if (AVX::currentIsa() != isa)
+			      QDPIO::cout << "-avx-isa " << buffer << " not supported by this CPU, using "
+					  << AVX::isaName(AVX::currentIsa()) << "\n";
+			  }
+#endif
+			else if (strcmp((*argv)[i], "-tunesamples")==0)
+			  {
+			    int n;
+			    sscanf((*argv)[++i],"%d",&n);
+			    jit_set_tune_samples(n);
+			  }
+			else if (strcmp((*argv)[i], "-kernelprofile")==0) 
+			  {
+			    char buffer[1024];
+			    sscanf((*argv)[++i],"%s",&buffer);
+			    KernelProfile::Instance().setOutput(std::string(buffer));
+			  }
+			else if (strcmp((*argv)[i], "-cachestats")==0) 
+			  {
+			    QDPCache::Instance().setPrintStats(true);
+			  }
+			else if (strcmp((*argv)[i], "-cachetrace")==0) 
+			  {
+			    char buffer[1024];
+			    sscanf((*argv)[++i],"%s",&buffer);
+			    QDPCache::Instance().setTraceFile(std::string(buffer));
+			  }
 			else if (strcmp((*argv)[i], "-ptx")==0) 
 			  {
 			    char buffer[1024];
@@ -518,6 +666,7 @@ namespace QDP {
 
 
 		CUDAHostPoolAllocator::Instance().unregisterMemory();
+		QDPSlabAllocator::Instance().unregisterMemory();
 
 	
 		//
@@ -532,6 +681,15 @@ namespace QDP {
 #endif 
 		
 		printProfile();
+		KernelProfile::Instance().write();
+		TimingRegions::Instance().print();
+		QDPCache::Instance().printStats();
+		QDPCache::Instance().writeTrace();
+
+#ifdef QDP_USE_PTX_EMULATOR
+		if (ptxEmuGetCounting() && Layout::primaryNode())
+		  ptxEmuPrintCounters(std::cout);
+#endif
 		
 		QMP_finalize_msg_passing();
 		
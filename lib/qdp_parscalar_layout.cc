@@ -7,10 +7,14 @@
  *
  * Layout
  *
- * This routine provides various layouts, including
+ * The order of the sites within a node is a LayoutPolicy chosen at run
+ * time (qdp_layout_policy.h):
  *    lexicographic
  *    2-checkerboard  (even/odd-checkerboarding of sites)
- *    32-style checkerboard (even/odd-checkerboarding of hypercubes)
+ *    3d checkerboard (even/odd in space, time fastest)
+ *    4d tiles
+ *    Morton (Z-order) curve
+ * The layout chosen at configure time is the default.
  */
 
 #include "qdp.h"
@@ -74,6 +78,19 @@ namespace QDP
       int  num_iogrid;
 	  multi1d<int> iogrid;
 
+      //! Node number by lexicographic logical node coordinate
+      multi1d<int> node_number;
+
+      //! Logical node coordinates of every node, Nd per node
+      multi1d<int> node_coord;
+
+      //! Site ordering within a node and its tables
+      std::shared_ptr<LayoutPolicy> policy;
+      LayoutTables tables;
+
+      //! Class of every node for the tables
+      multi1d<int> node_class;
+
 	} _layout;
 
 
@@ -94,6 +111,31 @@ namespace QDP
     /*! For now, this is ignored */
     void setNumProc(int N) {}
 
+    //! The layout chosen at configure time
+    static std::shared_ptr<LayoutPolicy> defaultPolicy()
+    {
+#if QDP_USE_CB2_LAYOUT == 1
+      return layoutPolicyMake("cb2");
+#elif QDP_USE_CB3D_LAYOUT == 1
+      return layoutPolicyMake("cb3d");
+#elif QDP_USE_CB32_LAYOUT == 1
+#error "THIS BIT STILL UNDER CONSTRUCTION"
+#else
+      return layoutPolicyMake("lexico");
+#endif
+    }
+
+    //! Set the ordering of the sites within a node, used by the next create()
+    void setPolicy(const std::shared_ptr<LayoutPolicy>& policy) {_layout.policy = policy;}
+
+    //! The ordering of the sites within a node
+    const LayoutPolicy& policy() 
+    {
+      if (!_layout.policy)
+	_layout.policy = defaultPolicy();
+      return *_layout.policy;
+    }
+
     //! Virtual grid (problem grid) lattice size
     const multi1d<int>& lattSize() {return _layout.nrow;}
 
@@ -146,7 +188,35 @@ namespace QDP
     }
 
     //! Return the smallest lattice size per node allowed
-    multi1d<int> minimalLayoutMapping();
+    multi1d<int> minimalLayoutMapping()
+    {
+      multi1d<int> dim(Nd);
+      policy().minimalMapping(Nd, &dim[0]);
+      return dim;
+    }
+
+    //! The node number for the corresponding lattice coordinate
+    /*! All layouts split the lattice into the same blocks of sites */
+    int nodeNumber(const int coord[])
+    {
+      int lex = 0;
+      for(int i=Nd-1; i >= 0; --i)
+	lex = lex * _layout.logical_size[i] + coord[i] / _layout.subgrid_nrow[i];
+
+      return _layout.node_number[lex];
+    }
+
+    int nodeNumber(const multi1d<int>& coord)
+    {
+      return nodeNumber(coord.slice());
+    }
+
+    //! Origin of the sites of a node
+    static void nodeOrigin(int node, int coord[])
+    {
+      for(int i=0; i < Nd; ++i)
+	coord[i] = _layout.node_coord[node*Nd + i] * _layout.subgrid_nrow[i];
+    }
 
     //! Initializer for layout
     void init()
@@ -320,6 +390,7 @@ namespace QDP
       QDPIO::cout << "  total number of nodes = " << Layout::numNodes() << endl;
       QDPIO::cout << "  total volume = " << _layout.vol << endl;
       QDPIO::cout << "  subgrid volume = " << _layout.subgrid_vol << endl;
+      QDPIO::cout << "  site layout = " << policy().name() << endl;
       if ( _layout.iogrid_defined ) { 
         QDPIO::cout << "  Number of IO nodes = " << _layout.num_iogrid << endl;
         QDPIO::cout << "  IO grid size =";
@@ -329,6 +400,10 @@ namespace QDP
       } 
 
       // Sanity check - check the QMP node number functions
+      // and keep both directions for the allocation-free site functions
+      _layout.node_number.resize(Layout::numNodes());
+      _layout.node_coord.resize(Layout::numNodes()*Nd);
+
       for(int node=0; node < Layout::numNodes(); ++node)
       { 
 	multi1d<int> coord = Layout::getLogicalCoordFrom(node);
@@ -336,6 +411,29 @@ namespace QDP
 
 	if (node != node2)
 	  QDP_error_exit("Layout::create - Layout problems, the QMP logical to physical node map functions do not work correctly with this lattice size");
+
+	int lex = 0;
+	for(int i=Nd-1; i >= 0; --i)
+	  lex = lex * _layout.logical_size[i] + coord[i];
+
+	_layout.node_number[lex] = node;
+	for(int i=0; i < Nd; ++i)
+	  _layout.node_coord[node*Nd + i] = coord[i];
+      }
+
+      // Tabulate the site ordering, once per class of nodes
+      std::string err = _layout.tables.make(policy(), Nd, _layout.subgrid_nrow.slice());
+      if (!err.empty())
+	QDP_error_exit("Layout::create - %s", err.c_str());
+
+      _layout.node_class.resize(Layout::numNodes());
+      for(int node=0; node < Layout::numNodes(); ++node)
+      {
+	int origin[Nd];
+	nodeOrigin(node, origin);
+	_layout.node_class[node] = policy().nodeClass(Nd, origin);
+	if (_layout.node_class[node] < 0 || _layout.node_class[node] >= policy().numClasses())
+	  QDP_error_exit("Layout::create - layout %s gives node %d no valid class", policy().name().c_str(), node);
       }
 
       // Sanity check - check the layout functions make sense
@@ -376,204 +474,23 @@ namespace QDP
 
 
 //-----------------------------------------------------------------------------
-#if QDP_USE_LEXICO_LAYOUT == 1
-
-#warning "Using a lexicographic layout"
-
   namespace Layout
   {
     //! The linearized site index for the corresponding coordinate
-    /*! This layout is a simple lexicographic lattice ordering */
-    int linearSiteIndex(const multi1d<int>& coord)
-    {
-      multi1d<int> tmp_coord(Nd);
-
-      for(int i=0; i < coord.size(); ++i)
-	tmp_coord[i] = coord[i] % Layout::subgridLattSize()[i];
-    
-      return local_site(tmp_coord, Layout::subgridLattSize());
-    }
-
-
-    //! The node number for the corresponding lattice coordinate
-    /*! This layout is a simple lexicographic lattice ordering */
-    int nodeNumber(const multi1d<int>& coord)
+    int linearSiteIndex(const int coord[])
     {
-      multi1d<int> tmp_coord(Nd);
-
-      for(int i=0; i < coord.size(); ++i)
-	tmp_coord[i] = coord[i] / Layout::subgridLattSize()[i];
-    
-      return Layout::getNodeNumberFrom(tmp_coord);
-    }
-
-
-    //! Returns the lattice site for some input node and linear index
-    /*! This layout is a simple lexicographic lattice ordering */
-    multi1d<int> siteCoords(int node, int linear)
-    {
-      multi1d<int> coord = getLogicalCoordFrom(node);
-
-      // Get the base (origins) of the absolute lattice coord
-      coord *= Layout::subgridLattSize();
-    
-      // Find the coordinate within a node and accumulate
-      // This is a lexicographic ordering
-      coord += crtesn(linear, Layout::subgridLattSize());
-
-      return coord;
-    }
-
-
-    //! Return the smallest lattice size per node allowed
-    /*! This layout is a simple lexicographic lattice ordering */
-    multi1d<int> minimalLayoutMapping()
-    {
-      multi1d<int> dim(Nd);
-      dim = 1;
-
-      return dim;
-    }
-  }
-
-//-----------------------------------------------------------------------------
-
-#elif QDP_USE_CB2_LAYOUT == 1
-
-#warning "Using a 2 checkerboard (red/black) layout"
-
-  namespace Layout
-  {
-    //! The linearized site index for the corresponding coordinate
-    /*! This layout is appropriate for a 2 checkerboard (red/black) lattice */
-    int linearSiteIndex(const multi1d<int>& coord)
-    {
-      int subgrid_vol_cb = Layout::sitesOnNode() >> 1;
-      multi1d<int> subgrid_cb_nrow = Layout::subgridLattSize();
-      subgrid_cb_nrow[0] >>= 1;
-
-      int cb = 0;
-      for(int m=0; m < Nd; ++m)
-	cb += coord[m];
-      cb &= 1;
-
-      multi1d<int> subgrid_cb_coord(Nd);
-      subgrid_cb_coord[0] = (coord[0] >> 1) % subgrid_cb_nrow[0];
-      for(int i=1; i < Nd; ++i)
-	subgrid_cb_coord[i] = coord[i] % subgrid_cb_nrow[i];
-    
-      return local_site(subgrid_cb_coord, subgrid_cb_nrow) + cb*subgrid_vol_cb;
-    }
-
-
-    //! The node number for the corresponding lattice coordinate
-    /*! 
-     * This layout is appropriate for a 2 checkerboard (red/black) lattice,
-     * but to find the nodeNumber this function resembles a simple lexicographic 
-     * layout
-     */
-    int nodeNumber(const multi1d<int>& coord)
-    {
-      multi1d<int> tmp_coord(Nd);
-
-      for(int i=0; i < coord.size(); ++i)
-	tmp_coord[i] = coord[i] / Layout::subgridLattSize()[i];
-    
-      return Layout::getNodeNumberFrom(tmp_coord);
-    }
-
-
-    //! Reconstruct the lattice coordinate from the node and site number
-    /*! 
-     * This is the inverse of the nodeNumber and linearSiteIndex functions.
-     * The API requires this function to be here.
-     */
-    multi1d<int> siteCoords(int node, int linearsite) // ignore node
-    {
-      int subgrid_vol_cb = Layout::sitesOnNode() >> 1;
-      multi1d<int> subgrid_cb_nrow = Layout::subgridLattSize();
-      subgrid_cb_nrow[0] >>= 1;
-
-      // Get the base (origins) of the absolute lattice coord
-      multi1d<int> coord = getLogicalCoordFrom(node);
-      coord *= Layout::subgridLattSize();
-    
-      int cb = linearsite / subgrid_vol_cb;
-      multi1d<int> tmp_coord = crtesn(linearsite % subgrid_vol_cb, subgrid_cb_nrow);
-
-      // Add on position within the node
-      // NOTE: the cb for the x-coord is not yet determined
-      coord[0] += 2*tmp_coord[0];
-      for(int m=1; m < Nd; ++m)
-	coord[m] += tmp_coord[m];
-
-      // Determine cb including global node cb
-      int cbb = cb;
-      for(int m=1; m < Nd; ++m)
-	cbb += coord[m];
-      coord[0] += (cbb & 1);
-
-      return coord;
-    }
-
+      const int* subgrid_nrow = _layout.subgrid_nrow.slice();
+      int tmp_coord[Nd];
 
-    //! Return the smallest lattice size per node allowed
-    /*! This layout is appropriate for a 2 checkerboard (red/black) lattice */
-    multi1d<int> minimalLayoutMapping()
-    {
-      multi1d<int> dim(Nd);
-      dim = 1;
-      dim[0] = 2;       // must have multiple length 2 for cb
+      for(int i=0; i < Nd; ++i)
+	tmp_coord[i] = coord[i] % subgrid_nrow[i];
 
-      return dim;
+      return _layout.tables.linear(_layout.node_class[nodeNumber(coord)], tmp_coord);
     }
-  }
-
-//-----------------------------------------------------------------------------
-
-#elif QDP_USE_CB3D_LAYOUT == 1
-
-#warning "Using a 3D checkerboard (red/black) layout"
 
-  namespace Layout
-  {
-    //! The linearized site index for the corresponding coordinate
-    /*! This layout is appropriate for a 2 checkerboard (red/black) lattice */
     int linearSiteIndex(const multi1d<int>& coord)
     {
-      int subgrid_vol_cb = Layout::sitesOnNode() / 2;
-      multi1d<int> subgrid_cb_nrow = Layout::subgridLattSize();
-      subgrid_cb_nrow[0] /= 2;
-
-      int cb = 0;
-      for(int m=0; m < Nd-1; ++m) { // Nd-1 checkerboard
-	cb += coord[m];
-      }
-      cb &= 1;
-
-      multi1d<int> subgrid_cb_coord(Nd);
-      subgrid_cb_coord[0] = (coord[0] / 2) % subgrid_cb_nrow[0];
-      for(int i=1; i < Nd; ++i)
-	subgrid_cb_coord[i] = coord[i] % subgrid_cb_nrow[i];
-    
-      return local_site(subgrid_cb_coord, subgrid_cb_nrow) + cb*subgrid_vol_cb;
-    }
-
-
-    //! The node number for the corresponding lattice coordinate
-    /*! 
-     * This layout is appropriate for a 2 checkerboard (red/black) lattice,
-     * but to find the nodeNumber this function resembles a simple lexicographic 
-     * layout
-     */
-    int nodeNumber(const multi1d<int>& coord)
-    {
-      multi1d<int> tmp_coord(Nd);
-
-      for(int i=0; i < coord.size(); ++i)
-	tmp_coord[i] = coord[i] / Layout::subgridLattSize()[i];
-    
-      return Layout::getNodeNumberFrom(tmp_coord);
+      return linearSiteIndex(coord.slice());
     }
 
 
@@ -582,174 +499,26 @@ namespace QDP
      * This is the inverse of the nodeNumber and linearSiteIndex functions.
      * The API requires this function to be here.
      */
-    multi1d<int> siteCoords(int node, int linearsite) // ignore node
-    {
-      int subgrid_vol_cb = Layout::sitesOnNode() / 2;
-      multi1d<int> subgrid_cb_nrow = Layout::subgridLattSize();
-      subgrid_cb_nrow[0] /= 2;
-
-
-      // Get the base (origins) of the absolute lattice coord
-      multi1d<int> coord = getLogicalCoordFrom(node);
-      coord *= Layout::subgridLattSize();
-    
-      int cb = linearsite / subgrid_vol_cb;
-      multi1d<int> tmp_coord = crtesn(linearsite % subgrid_vol_cb, subgrid_cb_nrow);
-
-      
-
-      // Add on position within the node
-      // NOTE: the cb for the x-coord is not yet determined
-      coord[0] += 2*tmp_coord[0];
-      for(int m=1; m < Nd; ++m)
-	coord[m] += tmp_coord[m];
-
-
-
-      // Determine cb including global node cb
-      int cbb = cb;
-      for(int m=1; m < Nd-1; ++m)
-	cbb += coord[m];
-
-   
-      coord[0] += (cbb & 1);
-
-      return coord;
-    }
-
-
-    //! Return the smallest lattice size per node allowed
-    /*! This layout is appropriate for a 2 checkerboard (red/black) lattice */
-    multi1d<int> minimalLayoutMapping()
+    void siteCoords(int node, int linear, int coord[])
     {
-      multi1d<int> dim(Nd);
-      multi1d<int> lsize=Layout::lattSize(); // Full lattice size;
-      dim = 1;
-      dim[0] = 2;       // must have multiple length 2 for cb
+      // Find the coordinate within a node
+      int tmp_coord[Nd];
+      _layout.tables.coords(_layout.node_class[node], linear, tmp_coord);
 
-      return dim;
-    }
-  }
-
-
-//-----------------------------------------------------------------------------
-
-#elif QDP_USE_CB32_LAYOUT == 1
-
-#warning "Using a 32 checkerboard layout"
-
-#error "THIS BIT STILL UNDER CONSTRUCTION"
-
-  namespace Layout
-  {
-    //! The linearized site index for the corresponding coordinate
-    /*! This layout is appropriate for a 32-style checkerboard lattice */
-    int linearSiteIndex(const multi1d<int>& coord)
-    {
-      int subgrid_vol_cb = Layout::sitesOnNode() >> (Nd+1);
-      multi1d<int> subgrid_cb_nrow = Layout::subgridLattSize();
-      subgrid_cb_nrow[0] >>= 2;
-      for(int i=1; i < Nd; ++i) 
-	subgrid_cb_nrow[i] >>= 1;
-
-      int subl = coord[Nd-1] & 1;
-      for(int m=Nd-2; m >= 0; --m)
-	subl = (subl << 1) + (coord[m] & 1);
-
-      int cb = 0;
-      for(int m=0; m < Nd; ++m)
-	cb += coord[m] >> 1;
-
-      subl += (cb & 1) << Nd;   // Final color or checkerboard
-
-      // Construct the checkerboard lattice coord
-      multi1d<int> subgrid_cb_coord(Nd);
-
-      subgrid_cb_coord[0] = (coord[0] >> 2) % subgrid_cb_nrow[0];
-      for(int i=1; i < Nd; ++i)
-	subgrid_cb_coord[i] = (coord[i] >> 1) % subgrid_cb_nrow[i];
-    
-      return local_site(subgrid_cb_coord, subgrid_cb_nrow) + subl*subgrid_vol_cb;
-    }
-
-
-    //! The node number for the corresponding lattice coordinate
-    /*! 
-     * This layout is appropriate for a 32 checkerboard (red/black) lattice,
-     * but to find the nodeNumber this function resembles a simple lexicographic 
-     * layout
-     */
-    int nodeNumber(const multi1d<int>& coord)
-    {
-      multi1d<int> tmp_coord(Nd);
-
-      for(int i=0; i < coord.size(); ++i)
-	tmp_coord[i] = coord[i] / Layout::subgridLattSize()[i];
-    
-      return Layout::getNodeNumberFrom(tmp_coord);
+      // Add the base (origin) of the absolute lattice coord
+      nodeOrigin(node, coord);
+      for(int i=0; i < Nd; ++i)
+	coord[i] += tmp_coord[i];
     }
 
-
-    //! Reconstruct the lattice coordinate from the node and site number
-    /*! 
-     * This is the inverse of the nodeNumber and linearSiteIndex functions.
-     * The API requires this function to be here.
-     */
-    multi1d<int> siteCoords(int node, int linearsite) // ignore node
+    multi1d<int> siteCoords(int node, int linear)
     {
-      int subgrid_vol_cb = Layout::sitesOnNode() >> (Nd+1);
-      multi1d<int> subgrid_cb_nrow = Layout::subgridLattSize();
-      subgrid_cb_nrow[0] >>= 2;
-      for(int i=1; i < Nd; ++i) 
-	subgrid_cb_nrow[i] >>= 1;
-
-      // Get the base (origins) of the absolute lattice coord
-      multi1d<int> coord = Layout::getLogicalCoordFrom(node);
-      coord *= Layout::subgridLattSize();
-    
-      int subl = linearsite / subgrid_vol_cb;
-      multi1d<int> tmp_coord = crtesn(linearsite % subgrid_vol_cb, subgrid_cb_nrow);
-
-      // Add on position within the node
-      // NOTE: the cb for the x-coord is not yet determined
-      coord[0] += tmp_coord[0] << 2;
-      for(int m=1; m < Nd; ++m)
-	coord[m] += tmp_coord[m] << 1;
-
-      int cb = 0;
-      for(int m=1; m<Nd; ++m)
-	cb += coord[m];
-      cb &= 1;
-
-      subl ^= (cb << Nd);
-      for(int m=0; m<Nd; ++m)
-	coord[m] ^= (subl & (1 << m)) >> m;
-      coord[0] ^= (subl & (1 << Nd)) >> (Nd-1);   // this gets the hypercube cb
-
+      multi1d<int> coord(Nd);
+      siteCoords(node, linear, &coord[0]);
       return coord;
     }
-
-
-    //! Return the smallest lattice size per node allowed
-    /*! This layout is appropriate for a 32-style checkerboard lattice */
-    multi1d<int> minimalLayoutMapping()
-    {
-      multi1d<int> dim(Nd);
-
-      dim[0] = 4;       // must have multiple length 2 for cb and hypercube
-      for(int m=1; m < Nd; ++m)
-	dim[m] = 2;     //  must have multiple length 2 for hypercube
-
-      return dim;
-    }
   }
 
-#else
-
-#error "no appropriate layout defined"
-
-#endif
-
 //-----------------------------------------------------------------------------
 
 
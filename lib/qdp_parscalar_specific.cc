@@ -41,116 +41,176 @@ namespace QDP {
 
 
 //-----------------------------------------------------------------------------
-//! Initializer for generic map constructor
-  void Map::make(const MapFunc& func)
-  {
-#if QDP_DEBUG >= 3
-    QDP_info("Map::make");
-#endif
-    const int nodeSites = Layout::sitesOnNode();
-
-    //--------------------------------------
-    // Setup the communication index arrays
-    goffsets.resize(nodeSites);
-    srcnode.resize(nodeSites);
-    dstnode.resize(nodeSites);
-
-    const int my_node = Layout::nodeNumber();
+  namespace {
+    void assignList(multi1d<int>& d, const std::vector<int>& s)
+    {
+      d.resize(s.size());
+      for(int i=0; i < s.size(); ++i)
+	d[i] = s[i];
+    }
 
-    // Loop over the sites on this node
-    for(int linear=0, ri=0; linear < nodeSites; ++linear)
+    bool sameList(const multi1d<int>& d, const std::vector<int>& s)
     {
-      // Get the true lattice coord of this linear site index
-      multi1d<int> coord = Layout::siteCoords(my_node, linear);
+      if (d.size() != s.size())
+	return false;
+      for(int i=0; i < s.size(); ++i)
+	if (d[i] != s[i])
+	  return false;
+      return true;
+    }
 
-      // Source neighbor for this destination site
-      multi1d<int> fcoord = func(coord,+1);
+    //! Tables of the maps made so far. Offset maps are keyed by their
+    //! displacement, all others by a hash of their tables
+    std::map< std::vector<int> , std::vector< std::shared_ptr<MapTables> > > interned;
 
-      // Destination neighbor receiving data from this site
-      // This functions as the inverse map
-      multi1d<int> bcoord = func(coord,-1);
+    std::vector<int> offsetKey(const multi1d<int>& disp)
+    {
+      const multi1d<int>& nrow = Layout::lattSize();
+      const multi1d<int>& logical = Layout::logicalSize();
 
-      int fnode = Layout::nodeNumber(fcoord);
-      int bnode = Layout::nodeNumber(bcoord);
+      if (disp.size() != Nd)
+	QDP_error_exit("Map: offset has %d directions instead of %d", disp.size(), Nd);
 
-      // Source linear site and node
-      srcnode[linear]  = fnode;
-      // Destination node
-      dstnode[linear]  = bnode;
+      std::vector<int> key(1, 0);
+      for(int mu=0; mu < Nd; ++mu) {
+	key.push_back( nrow[mu] );
+	key.push_back( logical[mu] );
+	key.push_back( ( disp[mu] % nrow[mu] + nrow[mu] ) % nrow[mu] );
+      }
+      // The tables depend on the site ordering too
+      for(char c : Layout::policy().name())
+	key.push_back( c );
+      return key;
+    }
 
-      if (srcnode[linear] == my_node)
-	{
-	  goffsets[linear] = Layout::linearSiteIndex(fcoord);
-	}
-      else
-	{
-	  // if destptr < 0 it contains the receive_buffer index
-	  // additional '-1' to make sure its negative,
-	  // not the best style, but higher performance
-	  // than using another buffer
-	  goffsets[linear] = -(ri++)-1;
+    std::vector<int> routeKey(const MapRoute& r)
+    {
+      unsigned long long h = 14695981039346656037ULL;   // FNV-1a
+      auto add = [&h](const std::vector<int>& v) {
+	for(int x : v) {
+	  h ^= (unsigned int)x;
+	  h *= 1099511628211ULL;
 	}
+	h ^= v.size();
+	h *= 1099511628211ULL;
+      };
+      add(r.goffsets);
+      add(r.soffsets);
+      add(r.srcenodes);
+      add(r.srcenodes_num);
+      add(r.destnodes);
+      add(r.destnodes_num);
+
+      std::vector<int> key(1, 1);
+      key.push_back( (int)(h >> 32) );
+      key.push_back( (int)h );
+      key.push_back( r.goffsets.size() );
+      return key;
+    }
 
+    bool sameTables(const MapTables& t, const MapRoute& r)
+    {
+      return sameList(t.goffsets, r.goffsets)
+	&& ( !t.offnodeP || ( sameList(t.soffsets, r.soffsets)
+			      && sameList(t.srcenodes, r.srcenodes) && sameList(t.srcenodes_num, r.srcenodes_num)
+			      && sameList(t.destnodes, r.destnodes) && sameList(t.destnodes_num, r.destnodes_num) ) );
+    }
+  }
 
+
+//! Initializer for generic map constructor
+  /*! Any number of source and destination nodes. The tables are built by
+      mapRouteMake: one receive buffer segment per source node and one
+      send buffer segment per destination node, see qdp_map_route.h.
+
+      Maps with equal tables share them (MapTables), so every distinct map
+      is registered with QDPCache and MasterMap once. Offset maps are
+      looked up before anything is computed and are otherwise computed
+      with integer arithmetic on the host worker threads; all other maps
+      call func twice per site. */
+  void Map::make(const MapFunc& func)
+  {
 #if QDP_DEBUG >= 3
-      QDP_info("linear=%d  coord=%d %d %d %d   fcoord=%d %d %d %d   bcoord=%d %d %d %d   goffsets=%d", 
-	       linear, 
-	       coord[0], coord[1], coord[2], coord[3],
-	       fcoord[0], fcoord[1], fcoord[2], fcoord[3],
-	       bcoord[0], bcoord[1], bcoord[2], bcoord[3],
-	       goffsets[linear]);
+    QDP_info("Map::make");
 #endif
-    }
+    const int nodeSites = Layout::sitesOnNode();
+    const int my_node = Layout::nodeNumber();
 
-    // Return a list of the unique nodes in the list
-    // NOTE: my_node may be included as a unique node, so one extra
-    multi1d<int> srcenodes_tmp = uniquify_list(srcnode);
-    multi1d<int> destnodes_tmp = uniquify_list(dstnode);
+    multi1d<int> disp;
+    const bool offsetP = func.offset(disp);
 
-    // To simplify life, remove a possible occurance of my_node
-    // This may mean that the list could be empty afterwards, so that
-    // means mark offnodeP as false
-    int cnt_srcenodes = 0;
-    for(int i=0; i < srcenodes_tmp.size(); ++i)
-      if (srcenodes_tmp[i] != my_node)
-	++cnt_srcenodes;
+    std::vector<int> key;
+    MapRoute route;
+    std::string err;
 
-    int cnt_destnodes = 0;
-    for(int i=0; i < destnodes_tmp.size(); ++i)
-      if (destnodes_tmp[i] != my_node)
-	++cnt_destnodes;
+    if (offsetP)
+    {
+      key = offsetKey(disp);
+      auto it = interned.find(key);
+      if (it != interned.end()) {
+	tab = it->second.front();
+	return;
+      }
 
-#if QDP_DEBUG >= 3
-    // Debugging
-    for(int i=0; i < srcenodes_tmp.size(); ++i)
-      QDP_info("srcenodes_tmp(%d) = %d",i,srcenodes_tmp[i]);
+      const int* nrow = Layout::lattSize().slice();
+      int fwd[Nd], bwd[Nd];
+      for(int mu=0; mu < Nd; ++mu) {
+	fwd[mu] = key[3*mu+3];
+	bwd[mu] = ( nrow[mu] - fwd[mu] ) % nrow[mu];
+      }
 
-    for(int i=0; i < destnodes_tmp.size(); ++i)
-      QDP_info("destnodes_tmp(%d) = %d",i,destnodes_tmp[i]);
+      MapSiteFunc site = [&](int linear, int sign) {
+	int coord[Nd];
+	Layout::siteCoords(my_node, linear, coord);
+	const int* d = sign > 0 ? fwd : bwd;
+	for(int mu=0; mu < Nd; ++mu)
+	  coord[mu] = ( coord[mu] + d[mu] ) % nrow[mu];
+	return MapSite{ Layout::nodeNumber(coord) , Layout::linearSiteIndex(coord) };
+      };
+      err = mapRouteMake(route, my_node, nodeSites, site, true);
+    }
+    else
+    {
+      // Source (sign > 0) and destination (sign < 0) of a site on this node
+      MapSiteFunc site = [&](int linear, int sign) {
+	multi1d<int> coord = func(Layout::siteCoords(my_node, linear), sign);
+	return MapSite{ Layout::nodeNumber(coord) , Layout::linearSiteIndex(coord) };
+      };
+      err = mapRouteMake(route, my_node, nodeSites, site);
+    }
 
-    QDP_info("cnt_srcenodes = %d", cnt_srcenodes);
-    QDP_info("cnt_destnodes = %d", cnt_destnodes);
-#endif
+    if (!err.empty())
+      QDP_error_exit("Map: %s", err.c_str());
 
+    if (!offsetP)
+    {
+      key = routeKey(route);
+      for(const std::shared_ptr<MapTables>& t : interned[key])
+	if (sameTables(*t, route)) {
+	  tab = t;
+	  return;
+	}
+    }
 
-    // A sanity check - both counts must be either 0 or non-zero
-    if (cnt_srcenodes > 0 && cnt_destnodes == 0)
-      QDP_error_exit("Map: some bizarre error - no dest nodes but have srce nodes");
+    // Offset maps are found by their tables too
+    tab = std::make_shared<MapTables>();
+    interned[key].push_back(tab);
+    if (offsetP)
+      interned[routeKey(route)].push_back(tab);
 
-    if (cnt_srcenodes == 0 && cnt_destnodes > 0)
-      QDP_error_exit("Map: some bizarre error - no srce nodes but have dest nodes");
+    assignList(tab->goffsets, route.goffsets);
 
     // If no srce/dest nodes, then we know no off-node communications
-    offnodeP = (cnt_srcenodes > 0) ? true : false;
+    tab->offnodeP = route.offnode();
 
-    goffsetsId = QDPCache::Instance().registrateOwnHostMem( sizeof(int)*goffsets.size() , (void*)goffsets.slice() , NULL );
-    QDP_info_primary("Map::make goffsetsId=%d",goffsetsId);
+    tab->goffsetsId = QDPCache::Instance().registrateOwnHostMem( sizeof(int)*tab->goffsets.size() , (void*)tab->goffsets.slice() , NULL );
+    QDP_info_primary("Map::make goffsetsId=%d",tab->goffsetsId);
 
     //
     // The rest of the routine is devoted to supporting off-node communications
     // If there is not any communications, then return
     //
-    if (! offnodeP)
+    if (! tab->offnodeP)
     {
 #if QDP_DEBUG >= 3
       QDP_info("no off-node communications: exiting Map::make");
@@ -158,123 +218,25 @@ namespace QDP {
       return;
     }
 
-    // Finally setup the srce and dest nodes now without my_node
-    srcenodes.resize(cnt_srcenodes);
-    destnodes.resize(cnt_destnodes);
-  
-    for(int i=0, j=0; i < srcenodes_tmp.size(); ++i)
-      if (srcenodes_tmp[i] != my_node)
-	srcenodes[j++] = srcenodes_tmp[i];
-
-    for(int i=0, j=0; i < destnodes_tmp.size(); ++i)
-      if (destnodes_tmp[i] != my_node)
-	destnodes[j++] = destnodes_tmp[i];
-
-#if QDP_DEBUG >= 3
-    // Debugging
-    for(int i=0; i < srcenodes.size(); ++i)
-      QDP_info("srcenodes(%d) = %d",i,srcenodes(i));
-
-    for(int i=0; i < destnodes.size(); ++i)
-      QDP_info("destnodes(%d) = %d",i,destnodes(i));
-#endif
-
-
-    // Run through the lists and find the number of each unique node
-    srcenodes_num.resize(srcenodes.size());
-    destnodes_num.resize(destnodes.size());
-
-    srcenodes_num = 0;
-    destnodes_num = 0;
-
-    for(int linear=0; linear < nodeSites; ++linear)
-    {
-      int this_node = srcnode[linear];
-      if (this_node != my_node)
-	for(int i=0; i < srcenodes_num.size(); ++i)
-	{
-	  if (srcenodes[i] == this_node)
-	  {
-	    srcenodes_num[i]++;
-	    break;
-	  }
-	}
-
-      int that_node = dstnode[linear];
-      if (that_node != my_node)
-	for(int i=0; i < destnodes_num.size(); ++i)
-	{
-	  if (destnodes[i] == that_node)
-	  {
-	    destnodes_num[i]++;
-	    break;
-	  }
-	}
-    }
-  
+    assignList(tab->srcenodes, route.srcenodes);
+    assignList(tab->destnodes, route.destnodes);
+    assignList(tab->srcenodes_num, route.srcenodes_num);
+    assignList(tab->destnodes_num, route.destnodes_num);
 
 #if QDP_DEBUG >= 3
-    for(int i=0; i < destnodes.size(); ++i)
-    {
-      QDP_info("srcenodes(%d) = %d",i,srcenodes(i));
-      QDP_info("destnodes(%d) = %d",i,destnodes(i));
-    }
+    for(int i=0; i < tab->srcenodes.size(); ++i)
+      QDP_info("srcenodes(%d) = %d  num = %d",i,tab->srcenodes[i],tab->srcenodes_num[i]);
 
-    for(int i=0; i < destnodes_num.size(); ++i)
-    {
-      QDP_info("srcenodes_num(%d) = %d",i,srcenodes_num(i));
-      QDP_info("destnodes_num(%d) = %d",i,destnodes_num(i));
-    }
+    for(int i=0; i < tab->destnodes.size(); ++i)
+      QDP_info("destnodes(%d) = %d  num = %d",i,tab->destnodes[i],tab->destnodes_num[i]);
 #endif
 
-    // Implementation limitation in the Map::operator(). Only support
-    // a node sending data all to one node or no sending at all (offNodeP == false).
-    if (srcenodes.size() != 1)
-      QDP_error_exit("Map: for now only allow 1 destination node");
-      
-    if (destnodes.size() != 1)
-      QDP_error_exit("Map: for now only allow receives from 1 node");
-
-
-    // Now make a small scatter array for the dest_buf so that when data
-    // is sent, it is put in an order the gather can pick it up
-    // If we allow multiple dest nodes, then soffsets here needs to be
-    // an array of arrays
-    soffsets.resize(destnodes_num[0]);
-
-    roffsets.resize(srcenodes_num[0]);
-  
-    // Loop through sites on my *destination* node - here I assume all nodes have
-    // the same number of sites. Mimic the gather pattern needed on that node and
-    // set my scatter array to scatter into the correct site order
-    int ri=0;
-    for(int i=0, si=0; i < nodeSites; ++i) 
-    {
-      // Get the true lattice coord of this linear site index
-      multi1d<int> coord = Layout::siteCoords(destnodes[0], i);
-      multi1d<int> fcoord = func(coord,+1);
-      int fnode = Layout::nodeNumber(fcoord);
-      int fline = Layout::linearSiteIndex(fcoord);
-
-      if (fnode == my_node)
-	soffsets[si++] = fline;
-
-      if (srcnode[i] != my_node)
-	roffsets[ri++] = i;
-    }
-
-    if ( ri != srcenodes_num[0] )
-      QDP_error_exit("internal error: ri != srcenodes_num[0]");
-
-    if (roffsets.size()==0)
-      QDP_error_exit("rsoffsets empty");
-    if (soffsets.size()==0)
-      QDP_error_exit("ssoffsets empty");
-    if (goffsets.size()==0)
-      QDP_error_exit("gsoffsets empty");
+    // The gather into the send buffer and the sites waiting for the receive buffer
+    assignList(tab->soffsets, route.soffsets);
+    assignList(tab->roffsets, route.roffsets);
 
-    roffsetsId = QDPCache::Instance().registrateOwnHostMem( sizeof(int)*roffsets.size() , (void*)roffsets.slice() , NULL );
-    soffsetsId = QDPCache::Instance().registrateOwnHostMem( sizeof(int)*soffsets.size() , (void*)soffsets.slice() , NULL );
+    tab->roffsetsId = QDPCache::Instance().registrateOwnHostMem( sizeof(int)*tab->roffsets.size() , (void*)tab->roffsets.slice() , NULL );
+    tab->soffsetsId = QDPCache::Instance().registrateOwnHostMem( sizeof(int)*tab->soffsets.size() , (void*)tab->soffsets.slice() , NULL );
 
 
 #if QDP_DEBUG >= 3
@@ -283,7 +245,7 @@ namespace QDP {
 
     StopWatch t;
     t.start();
-    myId = MasterMap::Instance().registrate(*this);
+    tab->myId = MasterMap::Instance().registrate(*this);
     t.stop();
     QDP_info_primary("Face and inner compute time = %f secs", t.getTimeInSeconds() );
   }
@@ -28,9 +28,7 @@ int getProgramProfileLevel() {return prog_prof_level;}
 QDPTime_t
 getClockTime()
 {
-  struct timeval tp;
-  gettimeofday(&tp,NULL);
-  return((unsigned long)tp.tv_sec * 1000000 + (unsigned long)tp.tv_usec);
+  return getClockNanoseconds() / 1000;
   //struct tms buf;
   //times(&buf);
   //return buf.tms_utime + buf.tms_stime;
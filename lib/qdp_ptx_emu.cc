@@ -0,0 +1,1899 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Host PTX emulator behind the driver API subset of qdp_ptx_emu.h
+ *
+ * A module is parsed once into a flat instruction list. Every operand is
+ * resolved to a slot of the thread's register file: the declared
+ * registers come first, followed by the special registers (%tid.x ...),
+ * the addresses of the symbols (parameters, shared and local variables)
+ * and finally the immediates, so the interpreter never looks at an
+ * operand kind. Values are kept as raw bits in 64-bit slots.
+ *
+ * Kernels without bar.sync run one thread after the other on a single
+ * register file. Kernels with a barrier keep one register file per thread
+ * and run each thread up to the next barrier before moving on.
+ */
+
+#include "qdp_ptx_emu.h"
+#include "qdp_half.h"
+#include "qdp_host_threads.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace QDP {
+
+  namespace {
+
+    //
+    // Types, operations and the decoded instruction
+    //
+
+    enum class Ty : unsigned char { none, pred, b8, b16, b32, b64, u8, u16, u32, u64,
+				    s8, s16, s32, s64, f16, bf16, f32, f64 };
+
+    enum class Op : unsigned char { mov, ld, st, cvt, selp, setp, add, sub, mul, mul_hi, mul_wide,
+				    mad, fma, div, rem, min, max, shl, shr, and_, or_, xor_, not_,
+				    neg, abs, sqrt, bar, exit, bra, call, nop };
+
+    enum class Space : unsigned char { generic, global, shared, local, param };
+
+    enum class Cmp : unsigned char { eq, ne, lt, le, gt, ge, equ, neu, ltu, leu, gtu, geu, num, nan };
+
+    enum class Rnd : unsigned char { none, rn, rz, rm, rp, rni, rzi, rmi, rpi };
+
+    enum class Math : unsigned char { sin, acos, asin, atan, cos, cosh, exp, log, log10, sinh, tan, tanh,
+				      pow, atan2 };
+
+    struct Ins {
+      Op    op;
+      Ty    t;         // instruction type
+      Ty    t2;        // cvt source type
+      Space space;
+      Cmp   cmp;
+      Rnd   rnd;
+      Math  math;
+      bool  sat;
+      bool  pred_neg;
+      int   pred;      // predicate slot or -1
+      int   d, a, b, c;
+      long long off;   // ld/st address offset
+      int   target;    // bra
+      int   stmt;      // index into Kernel::text
+    };
+
+    int ty_bytes( Ty t ) {
+      switch (t) {
+      case Ty::pred: case Ty::b8: case Ty::u8: case Ty::s8:                     return 1;
+      case Ty::b16: case Ty::u16: case Ty::s16: case Ty::f16: case Ty::bf16:    return 2;
+      case Ty::b32: case Ty::u32: case Ty::s32: case Ty::f32:                   return 4;
+      case Ty::b64: case Ty::u64: case Ty::s64: case Ty::f64:                   return 8;
+      default:                                                                  return 0;
+      }
+    }
+
+    bool ty_signed( Ty t ) { return t == Ty::s8 || t == Ty::s16 || t == Ty::s32 || t == Ty::s64; }
+    bool ty_float( Ty t )  { return t == Ty::f32 || t == Ty::f64; }
+    bool ty_half( Ty t )   { return t == Ty::f16 || t == Ty::bf16; }
+
+    Ty parse_ty( const std::string& s ) {
+      static const std::map<std::string,Ty> m = {
+	{"pred",Ty::pred},{"b8",Ty::b8},{"b16",Ty::b16},{"b32",Ty::b32},{"b64",Ty::b64},
+	{"u8",Ty::u8},{"u16",Ty::u16},{"u32",Ty::u32},{"u64",Ty::u64},
+	{"s8",Ty::s8},{"s16",Ty::s16},{"s32",Ty::s32},{"s64",Ty::s64},
+	{"f16",Ty::f16},{"bf16",Ty::bf16},{"f32",Ty::f32},{"f64",Ty::f64} };
+      auto it = m.find(s);
+      return it == m.end() ? Ty::none : it->second;
+    }
+
+
+    //
+    // Raw bit helpers
+    //
+
+    inline uint64_t trunc_bits( Ty t , uint64_t v ) {
+      switch (ty_bytes(t)) {
+      case 1:  return v & 0xffull;
+      case 2:  return v & 0xffffull;
+      case 4:  return v & 0xffffffffull;
+      default: return v;
+      }
+    }
+
+    inline int64_t sext( Ty t , uint64_t v ) {
+      switch (ty_bytes(t)) {
+      case 1:  return (int8_t)v;
+      case 2:  return (int16_t)v;
+      case 4:  return (int32_t)v;
+      default: return (int64_t)v;
+      }
+    }
+
+    inline float as_f32( uint64_t v ) { uint32_t u = (uint32_t)v; float f; std::memcpy( &f , &u , 4 ); return f; }
+    inline double as_f64( uint64_t v ) { double d; std::memcpy( &d , &v , 8 ); return d; }
+    inline uint64_t f32_bits( float f ) { uint32_t u; std::memcpy( &u , &f , 4 ); return u; }
+    inline uint64_t f64_bits( double d ) { uint64_t u; std::memcpy( &u , &d , 8 ); return u; }
+
+    //! Value of a float register widened to double
+    inline double fval( Ty t , uint64_t v ) { return t == Ty::f32 ? (double)as_f32(v) : as_f64(v); }
+
+    //! Round x to float/double with a PTX rounding modifier
+    float round_f32( long double x , Rnd r ) {
+      float f = (float)x;
+      if ( std::isnan(f) ) return f;
+      switch (r) {
+      case Rnd::rz: if ( std::fabs((long double)f) > std::fabs(x) ) f = std::nextafter( f , 0.0f ); break;
+      case Rnd::rm: if ( (long double)f > x ) f = std::nextafter( f , -INFINITY ); break;
+      case Rnd::rp: if ( (long double)f < x ) f = std::nextafter( f , INFINITY ); break;
+      default: break;
+      }
+      return f;
+    }
+
+    double round_f64( long double x , Rnd r ) {
+      double d = (double)x;
+      if ( std::isnan(d) ) return d;
+      switch (r) {
+      case Rnd::rz: if ( std::fabs((long double)d) > std::fabs(x) ) d = std::nextafter( d , 0.0 ); break;
+      case Rnd::rm: if ( (long double)d > x ) d = std::nextafter( d , -INFINITY ); break;
+      case Rnd::rp: if ( (long double)d < x ) d = std::nextafter( d , INFINITY ); break;
+      default: break;
+      }
+      return d;
+    }
+
+    HalfRounding half_mode( Rnd r ) {
+      switch (r) {
+      case Rnd::rz: return HalfRounding::rz;
+      case Rnd::rm: return HalfRounding::rm;
+      case Rnd::rp: return HalfRounding::rp;
+      default:      return HalfRounding::rn;
+      }
+    }
+
+    //! cvt with the semantics of the PTX manual (float to int saturates, NaN gives 0)
+    uint64_t convert( Ty dt , Ty st , Rnd r , bool sat , uint64_t v )
+    {
+      // Source as long double (exact for every source type on x86)
+      bool        src_int = !ty_float(st) && !ty_half(st);
+      long double x = 0;
+      if      (st == Ty::f32)  x = as_f32(v);
+      else if (st == Ty::f64)  x = as_f64(v);
+      else if (st == Ty::f16)  x = halfBitsToFloat( (unsigned short)v );
+      else if (st == Ty::bf16) x = bfloat16BitsToFloat( (unsigned short)v );
+      else if (ty_signed(st))  x = (long double)sext( st , v );
+      else                     x = (long double)trunc_bits( st , v );
+
+      if ( dt == Ty::f16 )  return floatToHalfBits( round_f32( x , r ) , half_mode(r) );
+      if ( dt == Ty::bf16 ) return floatToBFloat16Bits( round_f32( x , r ) , half_mode(r) );
+
+      if ( ty_float(dt) ) {
+	// Integer rounding within floating point (cvt.rmi.f32.f32 and friends)
+	switch (r) {
+	case Rnd::rni: x = std::nearbyint(x); break;
+	case Rnd::rzi: x = std::trunc(x); break;
+	case Rnd::rmi: x = std::floor(x); break;
+	case Rnd::rpi: x = std::ceil(x); break;
+	default: break;
+	}
+	if (sat && !std::isnan(x)) x = std::min( std::max( x , (long double)0 ) , (long double)1 );
+	return dt == Ty::f32 ? f32_bits( round_f32( x , r ) ) : f64_bits( round_f64( x , r ) );
+      }
+
+      int bits = 8 * ty_bytes(dt);
+
+      if ( src_int ) {
+	if (!sat)
+	  return trunc_bits( dt , ty_signed(st) ? (uint64_t)sext( st , v ) : trunc_bits( st , v ) );
+      } else {
+	if (std::isnan(x)) return 0;
+	switch (r) {
+	case Rnd::rni: x = std::nearbyint(x); break;
+	case Rnd::rmi: x = std::floor(x); break;
+	case Rnd::rpi: x = std::ceil(x); break;
+	default:       x = std::trunc(x); break;
+	}
+      }
+
+      // Clamp to the destination range
+      if ( ty_signed(dt) ) {
+	long double lo = -std::ldexp( 1.0L , bits - 1 );
+	long double hi =  std::ldexp( 1.0L , bits - 1 ) - 1;
+	x = std::min( std::max( x , lo ) , hi );
+	return trunc_bits( dt , (uint64_t)(int64_t)x );
+      }
+      long double hi = std::ldexp( 1.0L , bits ) - 1;
+      x = std::min( std::max( x , (long double)0 ) , hi );
+      return trunc_bits( dt , (uint64_t)x );
+    }
+
+
+    //
+    // Module representation
+    //
+
+    struct Param {
+      Ty     t;
+      size_t offset;
+      size_t size;
+    };
+
+    struct Kernel {
+      std::string              name;
+      int                      id;
+      std::vector<Param>       params;
+      size_t                   param_bytes;
+      std::vector<Ins>         code;
+      std::vector<std::string> text;          // statements, for diagnostics
+      int                      nregs;         // declared registers
+      int                      nslots;        // registers, specials, symbols and constants
+      std::vector<uint64_t>    constants;     // slots nslots - constants.size() ...
+      size_t                   local_bytes;
+      std::vector<size_t>      local_sym;     // offset in the local frame per symbol slot
+      std::vector<size_t>      shared_sym;    // offset in shared memory per symbol slot
+      std::vector<size_t>      param_sym;     // offset in the parameter buffer per symbol slot
+      size_t                   static_shared; // before the dynamic (extern) part
+      bool                     barrier;
+      PTXEmuCounters           counters;
+    };
+
+    // Slots of the special registers, right after the declared registers
+    enum { SREG_TID_X , SREG_TID_Y , SREG_TID_Z ,
+	   SREG_NTID_X , SREG_NTID_Y , SREG_NTID_Z ,
+	   SREG_CTAID_X , SREG_CTAID_Y , SREG_CTAID_Z ,
+	   SREG_NCTAID_X , SREG_NCTAID_Y , SREG_NCTAID_Z ,
+	   SREG_LANEID , SREG_WARPID , SREG_ZERO , NUM_SREG };
+
+    const std::map<std::string,int>& sreg_names() {
+      static const std::map<std::string,int> m = {
+	{"%tid.x",SREG_TID_X},{"%tid.y",SREG_TID_Y},{"%tid.z",SREG_TID_Z},
+	{"%ntid.x",SREG_NTID_X},{"%ntid.y",SREG_NTID_Y},{"%ntid.z",SREG_NTID_Z},
+	{"%ctaid.x",SREG_CTAID_X},{"%ctaid.y",SREG_CTAID_Y},{"%ctaid.z",SREG_CTAID_Z},
+	{"%nctaid.x",SREG_NCTAID_X},{"%nctaid.y",SREG_NCTAID_Y},{"%nctaid.z",SREG_NCTAID_Z},
+	{"%laneid",SREG_LANEID},{"%warpid",SREG_WARPID} };
+      return m;
+    }
+
+    const std::map<std::string,std::pair<Math,Ty> >& math_names() {
+      static const std::map<std::string,std::pair<Math,Ty> > m = {
+	{"func_sin_f32",{Math::sin,Ty::f32}},     {"func_sin_f64",{Math::sin,Ty::f64}},
+	{"func_acos_f32",{Math::acos,Ty::f32}},   {"func_acos_f64",{Math::acos,Ty::f64}},
+	{"func_asin_f32",{Math::asin,Ty::f32}},   {"func_asin_f64",{Math::asin,Ty::f64}},
+	{"func_atan_f32",{Math::atan,Ty::f32}},   {"func_atan_f64",{Math::atan,Ty::f64}},
+	{"func_cos_f32",{Math::cos,Ty::f32}},     {"func_cos_f64",{Math::cos,Ty::f64}},
+	{"func_cosh_f32",{Math::cosh,Ty::f32}},   {"func_cosh_f64",{Math::cosh,Ty::f64}},
+	{"func_exp_f32",{Math::exp,Ty::f32}},     {"func_exp_f64",{Math::exp,Ty::f64}},
+	{"func_log_f32",{Math::log,Ty::f32}},     {"func_log_f64",{Math::log,Ty::f64}},
+	{"func_log10_f32",{Math::log10,Ty::f32}}, {"func_log10_f64",{Math::log10,Ty::f64}},
+	{"func_sinh_f32",{Math::sinh,Ty::f32}},   {"func_sinh_f64",{Math::sinh,Ty::f64}},
+	{"func_tan_f32",{Math::tan,Ty::f32}},     {"func_tan_f64",{Math::tan,Ty::f64}},
+	{"func_tanh_f32",{Math::tanh,Ty::f32}},   {"func_tanh_f64",{Math::tanh,Ty::f64}},
+	{"func_pow_f32",{Math::pow,Ty::f32}},     {"func_pow_f64",{Math::pow,Ty::f64}},
+	{"func_atan2_f32",{Math::atan2,Ty::f32}}, {"func_atan2_f64",{Math::atan2,Ty::f64}} };
+      return m;
+    }
+
+    struct Module {
+      std::vector<std::unique_ptr<Kernel> > kernels;
+    };
+
+
+    //
+    // Global emulator state
+    //
+
+    struct Region {
+      size_t size;
+      bool   device;   // from cuMemAlloc, freed by cuMemFree
+    };
+
+    struct Emu {
+      std::mutex                               mtx;
+      std::vector<std::unique_ptr<Module> >    modules;
+      std::vector<Kernel*>                     kernels;     // load order
+      std::map<uintptr_t,Region>               regions;
+      size_t                                   memory    = (size_t)1 << 30;
+      size_t                                   allocated = 0;
+      bool                                     counting  = false;
+      std::string                              last_error;
+      CUresult                                 sticky    = CUDA_SUCCESS;
+      std::atomic<unsigned long>               handles{1};
+      std::map<CUevent,double>                 event_time;  // seconds, host clock
+    };
+
+    Emu& emu() {
+      static Emu e;
+      return e;
+    }
+
+    void set_error( const std::string& msg ) {
+      std::lock_guard<std::mutex> lock( emu().mtx );
+      emu().last_error = msg;
+      std::cerr << "PTX emulator: " << msg << std::endl;
+    }
+
+    //! Range of the allocation holding [p,p+n), false if there is none
+    bool find_region( uintptr_t p , size_t n , uintptr_t& lo , uintptr_t& hi ) {
+      std::lock_guard<std::mutex> lock( emu().mtx );
+      auto it = emu().regions.upper_bound( p );
+      if (it == emu().regions.begin())
+	return false;
+      --it;
+      if ( p + n > it->first + it->second.size )
+	return false;
+      lo = it->first;
+      hi = it->first + it->second.size;
+      return true;
+    }
+
+
+    //
+    // Tokenizer and parser
+    //
+
+    struct Tok {
+      std::string s;
+      int         line;
+    };
+
+    bool word_char( char c ) {
+      return std::isalnum((unsigned char)c) || c == '_' || c == '.' || c == '$' || c == '%';
+    }
+
+    std::vector<Tok> tokenize( const std::string& src )
+    {
+      std::vector<Tok> toks;
+      size_t n = src.size();
+      size_t i = 0;
+      int line = 1;
+      while (i < n) {
+	char c = src[i];
+	if (c == '\n') { line++; i++; continue; }
+	if (std::isspace((unsigned char)c) || c == '\0') { i++; continue; }
+	if (c == '/' && i+1 < n && src[i+1] == '/') {
+	  while (i < n && src[i] != '\n') i++;
+	  continue;
+	}
+	if (c == '/' && i+1 < n && src[i+1] == '*') {
+	  i += 2;
+	  while (i+1 < n && !(src[i] == '*' && src[i+1] == '/')) { if (src[i] == '\n') line++; i++; }
+	  i += 2;
+	  continue;
+	}
+	if (c == '"') {
+	  size_t j = i + 1;
+	  while (j < n && src[j] != '"') j++;
+	  toks.push_back( Tok{ src.substr( i , j + 1 - i ) , line } );
+	  i = j + 1;
+	  continue;
+	}
+	if (word_char(c)) {
+	  // Decimal literals may carry an exponent sign (1.5e+00), hex ones (0f3F800000) may not
+	  bool numeric = std::isdigit((unsigned char)c);
+	  bool hexlike = numeric && c == '0' && i+1 < n && std::strchr( "xXfFdD" , src[i+1] ) && src[i+1] != '\0';
+	  size_t j = i;
+	  while ( j < n && ( word_char(src[j]) ||
+			     ( numeric && !hexlike && j > i && (src[j] == '+' || src[j] == '-') &&
+			       (src[j-1] == 'e' || src[j-1] == 'E') ) ) )
+	    j++;
+	  toks.push_back( Tok{ src.substr( i , j - i ) , line } );
+	  i = j;
+	  continue;
+	}
+	toks.push_back( Tok{ std::string( 1 , c ) , line } );
+	i++;
+      }
+      return toks;
+    }
+
+
+    struct ParseError {
+      std::string msg;
+    };
+
+
+    //! Literal as written, converted to a slot value once the operand type is known
+    struct Literal {
+      enum { integer , real , f32hex , f64hex } kind;
+      long long   i;
+      long double r;
+      uint64_t    bits;
+    };
+
+    bool parse_literal( const std::string& s , bool neg , Literal& lit )
+    {
+      if (s.empty() || !std::isdigit((unsigned char)s[0]))
+	return false;
+      char* end = NULL;
+      if ( s.size() > 2 && s[0] == '0' && (s[1] == 'f' || s[1] == 'F') ) {
+	lit.kind = Literal::f32hex;
+	lit.bits = std::strtoull( s.c_str() + 2 , &end , 16 );
+	if (neg) lit.bits ^= 0x80000000ull;
+      } else if ( s.size() > 2 && s[0] == '0' && (s[1] == 'd' || s[1] == 'D') ) {
+	lit.kind = Literal::f64hex;
+	lit.bits = std::strtoull( s.c_str() + 2 , &end , 16 );
+	if (neg) lit.bits ^= 0x8000000000000000ull;
+      } else if ( s.find_first_of( ".eE" ) != std::string::npos && s.find_first_of( "xX" ) == std::string::npos ) {
+	lit.kind = Literal::real;
+	lit.r = std::strtold( s.c_str() , &end );
+	if (neg) lit.r = -lit.r;
+      } else {
+	lit.kind = Literal::integer;
+	unsigned long long u = std::strtoull( s.c_str() , &end , 0 );
+	lit.i = neg ? -(long long)u : (long long)u;
+      }
+      return end && ( *end == '\0' || *end == 'U' || *end == 'u' );
+    }
+
+    uint64_t literal_bits( const Literal& lit , Ty t )
+    {
+      if (t == Ty::f32 || t == Ty::f64) {
+	long double x;
+	switch (lit.kind) {
+	case Literal::f32hex:  x = as_f32( lit.bits ); break;
+	case Literal::f64hex:  x = as_f64( lit.bits ); break;
+	case Literal::real:    x = lit.r; break;
+	default:               x = (long double)lit.i; break;
+	}
+	return t == Ty::f32 ? f32_bits( (float)x ) : f64_bits( (double)x );
+      }
+      if (t == Ty::pred)
+	return lit.kind == Literal::integer ? lit.i != 0 : lit.bits != 0;
+      switch (lit.kind) {
+      case Literal::real:    return trunc_bits( t , (uint64_t)(long long)lit.r );
+      case Literal::integer: return trunc_bits( t , (uint64_t)lit.i );
+      default:               return trunc_bits( t , lit.bits );
+      }
+    }
+
+
+    class Parser {
+    public:
+      Parser( const std::string& src ): toks( tokenize( src ) ), pos(0) {}
+
+      void parse( Module& mod )
+      {
+	while (pos < toks.size()) {
+	  std::string w = next();
+	  if (w == ".version" || w == ".address_size") {
+	    next();
+	  } else if (w == ".target") {
+	    next();
+	    while (peek() == ",") { next(); next(); }
+	  } else if (w == ".entry") {
+	    mod.kernels.push_back( parse_entry() );
+	  } else if (w == ".func") {
+	    skip_function();
+	  } else if (w == ".visible" || w == ".weak" || w == ".extern" || w == ".global" ||
+		     w == ".shared" || w == ".const" || w == ".file" || w == ".section" ) {
+	    std::vector<Tok> decl;
+	    decl.push_back( toks[pos-1] );
+	    // Modifiers in front of .entry or .func
+	    while (pos < toks.size() && peek() != ";" && peek() != ".entry" && peek() != ".func")
+	      decl.push_back( toks[pos++] );
+	    if (peek() == ";") {
+	      next();
+	      global_decl( decl );
+	    }
+	  } else {
+	    fail( "unexpected '" + w + "' at module scope" );
+	  }
+	}
+      }
+
+    private:
+      std::vector<Tok> toks;
+      size_t           pos;
+
+      // Shared variables declared at module scope, offset or -1 for the extern one
+      std::map<std::string,long long> shared_vars;
+      size_t                          module_shared = 0;
+
+      // Per kernel while parsing it
+      Kernel*                                  k;
+      std::map<std::string,int>                regs;
+      std::map<std::string,int>                syms;     // symbol name -> slot
+      std::map<std::string,Space>              sym_space;
+      std::map<std::string,size_t>             sym_offset;
+      std::map<std::string,int>                labels;
+      std::vector<std::pair<int,std::string> > branches; // instruction, label
+      std::vector<std::pair<Literal,int> >     pending;  // constants: literal, instruction
+      std::map<uint64_t,int>                   constant_slot;
+
+      const std::string& peek() const {
+	static const std::string eof;
+	return pos < toks.size() ? toks[pos].s : eof;
+      }
+
+      std::string next() {
+	if (pos >= toks.size())
+	  fail( "unexpected end of module" );
+	return toks[pos++].s;
+      }
+
+      void expect( const std::string& s ) {
+	std::string w = next();
+	if (w != s)
+	  fail( "expected '" + s + "', got '" + w + "'" );
+      }
+
+      [[noreturn]] void fail( const std::string& msg ) const {
+	std::ostringstream oss;
+	oss << "line " << ( pos > 0 && pos <= toks.size() ? toks[pos-1].line : 0 ) << ": " << msg;
+	throw ParseError{ oss.str() };
+      }
+
+      void skip_function() {
+	int depth = 0;
+	while (pos < toks.size()) {
+	  std::string w = next();
+	  if (w == ";" && depth == 0) return;
+	  if (w == "{") depth++;
+	  if (w == "}" && --depth == 0) return;
+	}
+      }
+
+      //! ".extern .shared .align 4 .b8 sdata[];" or a static one with a size
+      void global_decl( const std::vector<Tok>& decl ) {
+	bool shared = false;
+	for (auto& t: decl)
+	  if (t.s == ".shared") shared = true;
+	if (!shared)
+	  return;
+	Ty   t = Ty::b8;
+	int  align = 1;
+	for (size_t i = 0 ; i < decl.size() ; ++i ) {
+	  if (decl[i].s == ".align" && i+1 < decl.size()) align = std::atoi( decl[i+1].s.c_str() );
+	  if (decl[i].s.size() > 1 && decl[i].s[0] == '.' && parse_ty( decl[i].s.substr(1) ) != Ty::none)
+	    t = parse_ty( decl[i].s.substr(1) );
+	}
+	for (size_t i = 0 ; i < decl.size() ; ++i ) {
+	  if (decl[i].s[0] == '.' || !word_char(decl[i].s[0]) || std::isdigit((unsigned char)decl[i].s[0]))
+	    continue;
+	  size_t count = 1;
+	  bool   ext   = false;
+	  if (i+1 < decl.size() && decl[i+1].s == "[") {
+	    if (i+2 < decl.size() && decl[i+2].s == "]") ext = true;
+	    else count = std::strtoull( decl[i+2].s.c_str() , NULL , 0 );
+	  }
+	  if (ext) {
+	    shared_vars[ decl[i].s ] = -1;
+	  } else {
+	    module_shared = ( module_shared + align - 1 ) / align * align;
+	    shared_vars[ decl[i].s ] = module_shared;
+	    module_shared += count * ty_bytes(t);
+	  }
+	  return;
+	}
+      }
+
+      int add_symbol( const std::string& name , Space sp , size_t offset ) {
+	int slot = (int)syms.size();
+	syms[name] = slot;
+	sym_space[name] = sp;
+	sym_offset[name] = offset;
+	return slot;
+      }
+
+      std::unique_ptr<Kernel> parse_entry()
+      {
+	std::unique_ptr<Kernel> kern( new Kernel() );
+	k = kern.get();
+	regs.clear(); syms.clear(); sym_space.clear(); sym_offset.clear();
+	labels.clear(); branches.clear(); pending.clear(); constant_slot.clear();
+
+	k->name          = next();
+	k->param_bytes   = 0;
+	k->nregs         = 0;
+	k->local_bytes   = 0;
+	k->static_shared = module_shared;
+	k->barrier       = false;
+	std::memset( &k->counters , 0 , sizeof(k->counters) );
+
+	for (auto& v: shared_vars)
+	  add_symbol( v.first , Space::shared , v.second < 0 ? (size_t)-1 : (size_t)v.second );
+
+	// Parameters
+	if (peek() == "(") {
+	  next();
+	  while (peek() != ")") {
+	    expect( ".param" );
+	    Ty     t = Ty::none;
+	    size_t count = 1;
+	    std::string name;
+	    while (peek() != "," && peek() != ")") {
+	      std::string w = next();
+	      if (w[0] == '.') {
+		if (parse_ty( w.substr(1) ) != Ty::none) t = parse_ty( w.substr(1) );
+		if (w == ".align") next();
+	      } else if (w == "[") {
+		count = std::strtoull( next().c_str() , NULL , 0 );
+		expect( "]" );
+	      } else {
+		name = w;
+	      }
+	    }
+	    if (t == Ty::none || name.empty())
+	      fail( "bad parameter declaration" );
+	    size_t size  = ty_bytes(t) * count;
+	    size_t align = std::min( (size_t)8 , (size_t)ty_bytes(t) );
+	    k->param_bytes = ( k->param_bytes + align - 1 ) / align * align;
+	    k->params.push_back( Param{ t , k->param_bytes , size } );
+	    add_symbol( name , Space::param , k->param_bytes );
+	    k->param_bytes += size;
+	    if (peek() == ",") next();
+	  }
+	  next();
+	}
+
+	// Performance directives (.maxntid etc.)
+	while (peek() != "{")
+	  next();
+	next();
+
+	std::vector<std::vector<Tok> > stmts;
+	int depth = 1;
+	while (depth > 0) {
+	  if (peek() == "{") { next(); depth++; continue; }
+	  if (peek() == "}") { next(); depth--; continue; }
+	  // Labels
+	  if (pos + 1 < toks.size() && toks[pos+1].s == ":" && word_char( peek()[0] )) {
+	    stmts.push_back( std::vector<Tok>( 1 , toks[pos] ) );
+	    pos += 2;
+	    continue;
+	  }
+	  std::vector<Tok> st;
+	  while (peek() != ";")
+	    st.push_back( toks[pos++] );
+	  next();
+	  stmts.push_back( st );
+	}
+
+	// Declarations first so that the register count is known
+	for (auto& st: stmts)
+	  if (!st.empty() && st[0].s == ".reg")
+	    declare_regs( st );
+	for (auto& st: stmts)
+	  if (!st.empty() && (st[0].s == ".local" || st[0].s == ".shared"))
+	    declare_var( st );
+
+	k->nregs = (int)regs.size();
+
+	for (auto& st: stmts) {
+	  if (st.empty() || st[0].s[0] == '.')
+	    continue;
+	  if (st.size() == 1 && !std::isdigit((unsigned char)st[0].s[0]) && st[0].s != "exit" && st[0].s != "ret") {
+	    labels[ st[0].s ] = (int)k->code.size();
+	    continue;
+	  }
+	  instruction( st );
+	}
+
+	for (auto& b: branches) {
+	  auto it = labels.find( b.second );
+	  if (it == labels.end())
+	    fail( "undefined label " + b.second );
+	  k->code[ b.first ].target = it->second;
+	}
+
+	// Final slot layout: registers, special registers, symbols, constants
+	int sym_base   = k->nregs + NUM_SREG;
+	int const_base = sym_base + (int)syms.size();
+	k->nslots      = const_base + (int)k->constants.size();
+
+	k->local_sym.assign( syms.size() , (size_t)-1 );
+	k->shared_sym.assign( syms.size() , (size_t)-1 );
+	k->param_sym.assign( syms.size() , (size_t)-1 );
+	for (auto& s: syms) {
+	  size_t off = sym_offset[s.first];
+	  switch (sym_space[s.first]) {
+	  case Space::local:  k->local_sym[s.second]  = off; break;
+	  case Space::shared: k->shared_sym[s.second] = off == (size_t)-1 ? k->static_shared : off; break;
+	  case Space::param:  k->param_sym[s.second]  = off; break;
+	  default: break;
+	  }
+	}
+
+	// Operands were encoded as -(2+n) for special register n, -(1000000+n) for symbol n,
+	// -(2000000+n) for constant n. Rebase them now.
+	auto fix = [&]( int& s ) {
+	  if (s >= -1) return;
+	  if (s <= -2000000)      s = const_base + ( -s - 2000000 );
+	  else if (s <= -1000000) s = sym_base + ( -s - 1000000 );
+	  else                    s = k->nregs + ( -s - 2 );
+	};
+	for (auto& ins: k->code) {
+	  fix( ins.d ); fix( ins.a ); fix( ins.b ); fix( ins.c ); fix( ins.pred );
+	}
+
+	return kern;
+      }
+
+      void declare_regs( const std::vector<Tok>& st ) {
+	size_t i = 1;
+	while (i < st.size() && st[i].s[0] == '.') i++;   // type (and .v2 etc.)
+	while (i < st.size()) {
+	  std::string name = st[i++].s;
+	  if (i < st.size() && st[i].s == "<") {
+	    int n = std::atoi( st[i+1].s.c_str() );
+	    for (int r = 0 ; r < n ; ++r) {
+	      std::string rn = name + std::to_string(r);
+	      if (!regs.count(rn)) { int slot = (int)regs.size(); regs[rn] = slot; }
+	    }
+	    i += 3;
+	  } else if (!regs.count(name)) {
+	    int slot = (int)regs.size();
+	    regs[name] = slot;
+	  }
+	  if (i < st.size() && st[i].s == ",") i++;
+	}
+      }
+
+      //! ".local .f32 loc0[12]" or ".shared .align 8 .b8 buf[256]"
+      void declare_var( const std::vector<Tok>& st ) {
+	Space  sp    = st[0].s == ".local" ? Space::local : Space::shared;
+	Ty     t     = Ty::b8;
+	size_t align = 0;
+	size_t i = 1;
+	for ( ; i < st.size() && st[i].s[0] == '.' ; ++i ) {
+	  if (st[i].s == ".align") { align = std::strtoull( st[i+1].s.c_str() , NULL , 0 ); ++i; continue; }
+	  if (parse_ty( st[i].s.substr(1) ) != Ty::none) t = parse_ty( st[i].s.substr(1) );
+	}
+	if (i >= st.size())
+	  fail( "bad variable declaration" );
+	std::string name = st[i].s;
+	size_t count = 1;
+	if (i+2 < st.size() && st[i+1].s == "[")
+	  count = std::strtoull( st[i+2].s.c_str() , NULL , 0 );
+	if (align == 0)
+	  align = std::max( 1 , ty_bytes(t) );
+	size_t& top = sp == Space::local ? k->local_bytes : k->static_shared;
+	top = ( top + align - 1 ) / align * align;
+	add_symbol( name , sp , top );
+	top += count * ty_bytes(t);
+      }
+
+      // Operand slots before rebasing (see parse_entry)
+      int sreg_slot( int n )  { return -(2 + n); }
+      int sym_slot( int n )   { return -(1000000 + n); }
+
+      int const_slot( const Literal& lit , Ty t ) {
+	uint64_t bits = literal_bits( lit , t );
+	auto it = constant_slot.find( bits );
+	if (it != constant_slot.end())
+	  return -(2000000 + it->second);
+	int n = (int)k->constants.size();
+	k->constants.push_back( bits );
+	constant_slot[bits] = n;
+	return -(2000000 + n);
+      }
+
+      //! Value operand: register, special register, symbol address or literal of type t
+      int value( const std::vector<Tok>& ops , size_t& i , Ty t ) {
+	if (i >= ops.size())
+	  fail( "missing operand" );
+	bool neg = false;
+	if (ops[i].s == "-") { neg = true; i++; }
+	const std::string& w = ops[i++].s;
+	auto r = regs.find( w );
+	if (r != regs.end() && !neg) return r->second;
+	auto s = sreg_names().find( w );
+	if (s != sreg_names().end() && !neg) return sreg_slot( s->second );
+	auto y = syms.find( w );
+	if (y != syms.end() && !neg) return sym_slot( y->second );
+	Literal lit;
+	if (parse_literal( w , neg , lit ))
+	  return const_slot( lit , t );
+	fail( "unknown operand '" + w + "'" );
+      }
+
+      int reg( const std::vector<Tok>& ops , size_t& i ) {
+	if (i >= ops.size())
+	  fail( "missing operand" );
+	auto r = regs.find( ops[i].s );
+	if (r == regs.end())
+	  fail( "not a register '" + ops[i].s + "'" );
+	i++;
+	return r->second;
+      }
+
+      //! [base], [base+off], [base + -off], [off]
+      void address( const std::vector<Tok>& ops , size_t& i , Ins& ins , int& slot ) {
+	if (i >= ops.size() || ops[i].s != "[")
+	  fail( "expected an address" );
+	i++;
+	slot = sreg_slot( SREG_ZERO );
+	ins.off = 0;
+	bool neg = false;
+	while (i < ops.size() && ops[i].s != "]") {
+	  const std::string& w = ops[i].s;
+	  if (w == "+") { neg = false; i++; continue; }
+	  if (w == "-") { neg = true; i++; continue; }
+	  Literal lit;
+	  if (regs.count(w)) slot = regs[w];
+	  else if (syms.count(w)) slot = sym_slot( syms[w] );
+	  else if (parse_literal( w , neg , lit ) && lit.kind == Literal::integer) ins.off += lit.i;
+	  else fail( "bad address component '" + w + "'" );
+	  i++;
+	}
+	if (i >= ops.size())
+	  fail( "unterminated address" );
+	i++;
+      }
+
+      void comma( const std::vector<Tok>& ops , size_t& i ) {
+	if (i >= ops.size() || ops[i].s != ",")
+	  fail( "expected ','" );
+	i++;
+      }
+
+      void instruction( const std::vector<Tok>& st )
+      {
+	Ins ins;
+	ins.t = ins.t2 = Ty::none;
+	ins.space = Space::generic;
+	ins.cmp = Cmp::eq;
+	ins.rnd = Rnd::none;
+	ins.math = Math::sin;
+	ins.sat = false;
+	ins.pred_neg = false;
+	ins.pred = -1;
+	ins.d = ins.a = ins.b = ins.c = -1;
+	ins.off = 0;
+	ins.target = -1;
+
+	std::ostringstream text;
+	size_t opcode = st[0].s == "@" ? ( st[1].s == "!" ? 3 : 2 ) : 0;
+	for (size_t j = 0 ; j < st.size() ; ++j)
+	  text << st[j].s << ( st[j].s == "," || j == opcode || j + 1 == opcode ? " " : "" );
+	ins.stmt = (int)k->text.size();
+	k->text.push_back( text.str() );
+
+	size_t i = 0;
+	if (st[i].s == "@") {
+	  i++;
+	  if (st[i].s == "!") { ins.pred_neg = true; i++; }
+	  ins.pred = reg( st , i );
+	}
+
+	// Split the opcode at the dots
+	std::vector<std::string> parts;
+	{
+	  std::string opc = st[i++].s;
+	  size_t b = 0, e;
+	  while ((e = opc.find( '.' , b )) != std::string::npos) { parts.push_back( opc.substr( b , e - b ) ); b = e + 1; }
+	  parts.push_back( opc.substr( b ) );
+	}
+	const std::string& base = parts[0];
+
+	// Modifiers and types
+	std::vector<Ty> types;
+	bool lo = false, hi = false, wide = false;
+	for (size_t p = 1 ; p < parts.size() ; ++p) {
+	  const std::string& m = parts[p];
+	  Ty t = parse_ty( m );
+	  if (t != Ty::none) { types.push_back( t ); continue; }
+	  if      (m == "global") ins.space = Space::global;
+	  else if (m == "shared") ins.space = Space::shared;
+	  else if (m == "local")  ins.space = Space::local;
+	  else if (m == "param")  ins.space = Space::param;
+	  else if (m == "const")  fail( "constant memory is not supported" );
+	  else if (m == "rn")  ins.rnd = Rnd::rn;
+	  else if (m == "rz")  ins.rnd = Rnd::rz;
+	  else if (m == "rm")  ins.rnd = Rnd::rm;
+	  else if (m == "rp")  ins.rnd = Rnd::rp;
+	  else if (m == "rni") ins.rnd = Rnd::rni;
+	  else if (m == "rzi") ins.rnd = Rnd::rzi;
+	  else if (m == "rmi") ins.rnd = Rnd::rmi;
+	  else if (m == "rpi") ins.rnd = Rnd::rpi;
+	  else if (m == "sat") ins.sat = true;
+	  else if (m == "lo")   lo = true;
+	  else if (m == "hi")   hi = true;
+	  else if (m == "wide") wide = true;
+	  else if (m == "eq")  ins.cmp = Cmp::eq;
+	  else if (m == "ne")  ins.cmp = Cmp::ne;
+	  else if (m == "lt" || m == "lo_") ins.cmp = Cmp::lt;
+	  else if (m == "le")  ins.cmp = Cmp::le;
+	  else if (m == "gt")  ins.cmp = Cmp::gt;
+	  else if (m == "ge")  ins.cmp = Cmp::ge;
+	  else if (m == "ls")  ins.cmp = Cmp::le;
+	  else if (m == "hs")  ins.cmp = Cmp::ge;
+	  else if (m == "equ") ins.cmp = Cmp::equ;
+	  else if (m == "neu") ins.cmp = Cmp::neu;
+	  else if (m == "ltu") ins.cmp = Cmp::ltu;
+	  else if (m == "leu") ins.cmp = Cmp::leu;
+	  else if (m == "gtu") ins.cmp = Cmp::gtu;
+	  else if (m == "geu") ins.cmp = Cmp::geu;
+	  else if (m == "num") ins.cmp = Cmp::num;
+	  else if (m == "nan") ins.cmp = Cmp::nan;
+	  else if (m == "v2" || m == "v4") fail( "vector loads and stores are not supported" );
+	  // everything else (ftz, approx, full, uni, sync, cache operators) does not change the result
+	}
+	// setp.lo.u32 means "lower", not mul.lo
+	if (base == "setp" && lo) ins.cmp = Cmp::lt;
+	if (base == "setp" && hi) ins.cmp = Cmp::gt;
+
+	ins.t = types.empty() ? Ty::none : types.back();
+
+	auto one_type = [&]() {
+	  if (types.size() != 1) fail( "expected one type in '" + k->text.back() + "'" );
+	};
+
+	if (base == "mov") {
+	  one_type();
+	  ins.op = Op::mov;
+	  ins.d = reg( st , i ); comma( st , i ); ins.a = value( st , i , ins.t );
+	} else if (base == "ld" || base == "st") {
+	  one_type();
+	  ins.op = base == "ld" ? Op::ld : Op::st;
+	  if (ins.op == Op::ld) {
+	    ins.d = reg( st , i ); comma( st , i ); address( st , i , ins , ins.a );
+	  } else {
+	    address( st , i , ins , ins.a ); comma( st , i ); ins.b = value( st , i , ins.t );
+	  }
+	} else if (base == "cvt") {
+	  if (types.size() != 2) fail( "cvt needs two types" );
+	  ins.op = Op::cvt;
+	  ins.t  = types[0];
+	  ins.t2 = types[1];
+	  ins.d = reg( st , i ); comma( st , i ); ins.a = value( st , i , ins.t2 );
+	} else if (base == "selp") {
+	  one_type();
+	  ins.op = Op::selp;
+	  ins.d = reg( st , i ); comma( st , i );
+	  ins.a = value( st , i , ins.t ); comma( st , i );
+	  ins.b = value( st , i , ins.t ); comma( st , i );
+	  ins.c = value( st , i , Ty::pred );
+	} else if (base == "setp") {
+	  one_type();
+	  ins.op = Op::setp;
+	  ins.d = reg( st , i ); comma( st , i );
+	  ins.a = value( st , i , ins.t ); comma( st , i );
+	  ins.b = value( st , i , ins.t );
+	} else if (base == "add" || base == "sub" || base == "mul" || base == "div" || base == "rem" ||
+		   base == "min" || base == "max" || base == "and" || base == "or" || base == "xor") {
+	  one_type();
+	  static const std::map<std::string,Op> ops = {
+	    {"add",Op::add},{"sub",Op::sub},{"mul",Op::mul},{"div",Op::div},{"rem",Op::rem},
+	    {"min",Op::min},{"max",Op::max},{"and",Op::and_},{"or",Op::or_},{"xor",Op::xor_} };
+	  ins.op = ops.at( base );
+	  if (ins.op == Op::mul && wide) ins.op = Op::mul_wide;
+	  if (ins.op == Op::mul && hi)   ins.op = Op::mul_hi;
+	  ins.d = reg( st , i ); comma( st , i );
+	  ins.a = value( st , i , ins.t ); comma( st , i );
+	  ins.b = value( st , i , ins.t );
+	} else if (base == "shl" || base == "shr") {
+	  one_type();
+	  ins.op = base == "shl" ? Op::shl : Op::shr;
+	  ins.d = reg( st , i ); comma( st , i );
+	  ins.a = value( st , i , ins.t ); comma( st , i );
+	  ins.b = value( st , i , Ty::u32 );
+	} else if (base == "mad" || base == "fma") {
+	  one_type();
+	  if (wide || hi) fail( "mad.wide/mad.hi are not supported" );
+	  ins.op = ty_float(ins.t) ? Op::fma : Op::mad;
+	  ins.d = reg( st , i ); comma( st , i );
+	  ins.a = value( st , i , ins.t ); comma( st , i );
+	  ins.b = value( st , i , ins.t ); comma( st , i );
+	  ins.c = value( st , i , ins.t );
+	} else if (base == "not" || base == "neg" || base == "abs" || base == "sqrt") {
+	  one_type();
+	  static const std::map<std::string,Op> ops = {
+	    {"not",Op::not_},{"neg",Op::neg},{"abs",Op::abs},{"sqrt",Op::sqrt} };
+	  ins.op = ops.at( base );
+	  ins.d = reg( st , i ); comma( st , i ); ins.a = value( st , i , ins.t );
+	} else if (base == "bar" || base == "barrier") {
+	  ins.op = Op::bar;
+	  k->barrier = true;
+	  i = st.size();
+	} else if (base == "membar" || base == "fence") {
+	  ins.op = Op::nop;
+	  i = st.size();
+	} else if (base == "exit" || base == "ret") {
+	  ins.op = Op::exit;
+	} else if (base == "bra") {
+	  ins.op = Op::bra;
+	  branches.push_back( std::make_pair( (int)k->code.size() , st[i++].s ) );
+	} else if (base == "call") {
+	  // call (ret),name,(a[,b]);
+	  ins.op = Op::call;
+	  if (st[i].s != "(") fail( "call without a return value" );
+	  i++; ins.d = reg( st , i );
+	  if (st[i++].s != ")") fail( "expected ')'" );
+	  comma( st , i );
+	  auto m = math_names().find( st[i].s );
+	  if (m == math_names().end()) fail( "call to unsupported function " + st[i].s );
+	  ins.math = m->second.first;
+	  ins.t    = m->second.second;
+	  i++;
+	  comma( st , i );
+	  if (st[i++].s != "(") fail( "expected '('" );
+	  ins.a = value( st , i , ins.t );
+	  if (st[i].s == ",") { i++; ins.b = value( st , i , ins.t ); }
+	  if (st[i++].s != ")") fail( "expected ')'" );
+	} else {
+	  fail( "unsupported instruction '" + base + "'" );
+	}
+
+	if (i != st.size())
+	  fail( "trailing operands in '" + k->text.back() + "'" );
+
+	k->code.push_back( ins );
+      }
+    };
+
+
+    //
+    // Interpreter
+    //
+
+    struct LaunchError {
+      std::string msg;
+    };
+
+    //! What a host thread needs to run blocks of one launch
+    struct Worker {
+      const Kernel&          k;
+      const unsigned char*   params;
+      unsigned int           grid[3];
+      unsigned int           block[3];
+      size_t                 shared_size;
+      std::vector<unsigned char> shared;
+      std::vector<unsigned char> local;       // one frame per thread (barrier kernels) or one
+      std::vector<uint64_t>  R;                // register files, nslots per thread
+      PTXEmuCounters         cnt;
+      bool                   counting;
+      // Last global region hit, saves the lookup for streaming access
+      uintptr_t              region_lo = 1, region_hi = 0;
+
+      Worker( const Kernel& k_ ): k(k_) { std::memset( &cnt , 0 , sizeof(cnt) ); }
+
+      [[noreturn]] void error( const Ins& ins , const uint64_t* r , const std::string& what ) {
+	std::ostringstream oss;
+	oss << what << " in kernel " << k.id << " (" << k.name << ") at '" << k.text[ins.stmt] << "'"
+	    << ", block (" << r[k.nregs + SREG_CTAID_X] << "," << r[k.nregs + SREG_CTAID_Y] << "," << r[k.nregs + SREG_CTAID_Z] << ")"
+	    << " thread (" << r[k.nregs + SREG_TID_X] << "," << r[k.nregs + SREG_TID_Y] << "," << r[k.nregs + SREG_TID_Z] << ")";
+	throw LaunchError{ oss.str() };
+      }
+
+      //! Checked host address of an access of n bytes
+      unsigned char* access( const Ins& ins , const uint64_t* r , const unsigned char* local_frame ,
+			     uintptr_t addr , size_t n ) {
+	uintptr_t sh_lo = (uintptr_t)shared.data();
+	uintptr_t lo_lo = (uintptr_t)local_frame;
+	bool in_shared = addr >= sh_lo && addr + n <= sh_lo + shared_size;
+	bool in_local  = addr >= lo_lo && addr + n <= lo_lo + k.local_bytes;
+	bool ok = false;
+	switch (ins.space) {
+	case Space::shared: ok = in_shared; break;
+	case Space::local:  ok = in_local; break;
+	case Space::param:  ok = addr >= (uintptr_t)params && addr + n <= (uintptr_t)params + k.param_bytes; break;
+	case Space::global:
+	case Space::generic:
+	  ok = ins.space == Space::generic && (in_shared || in_local);
+	  if (!ok) {
+	    ok = addr >= region_lo && addr + n <= region_hi;
+	    if (!ok && find_region( addr , n , region_lo , region_hi ))
+	      ok = true;
+	  }
+	  break;
+	}
+	if (!ok) {
+	  std::ostringstream oss;
+	  oss << "out of bounds access of " << n << " bytes at 0x" << std::hex << addr;
+	  error( ins , r , oss.str() );
+	}
+	if (addr % n)
+	  error( ins , r , "misaligned access" );
+	return (unsigned char*)addr;
+      }
+
+      void set_thread( uint64_t* r , unsigned int t , unsigned char* local_frame ) {
+	uint64_t* s = r + k.nregs;
+	s[SREG_TID_X] = t % block[0];
+	s[SREG_TID_Y] = ( t / block[0] ) % block[1];
+	s[SREG_TID_Z] = t / ( block[0] * block[1] );
+	s[SREG_LANEID] = t % 32;
+	s[SREG_WARPID] = t / 32;
+	uint64_t* y = s + NUM_SREG;
+	for (size_t n = 0 ; n < k.local_sym.size() ; ++n)
+	  if (k.local_sym[n] != (size_t)-1)
+	    y[n] = (uint64_t)(uintptr_t)( local_frame + k.local_sym[n] );
+      }
+
+      void set_block( uint64_t* r , unsigned long b ) {
+	uint64_t* s = r + k.nregs;
+	s[SREG_CTAID_X]  = b % grid[0];
+	s[SREG_CTAID_Y]  = ( b / grid[0] ) % grid[1];
+	s[SREG_CTAID_Z]  = b / ( (unsigned long)grid[0] * grid[1] );
+      }
+
+      //! Fill the launch invariant slots of one register file
+      void init_file( uint64_t* r ) {
+	uint64_t* s = r + k.nregs;
+	s[SREG_NTID_X]   = block[0];
+	s[SREG_NTID_Y]   = block[1];
+	s[SREG_NTID_Z]   = block[2];
+	s[SREG_NCTAID_X] = grid[0];
+	s[SREG_NCTAID_Y] = grid[1];
+	s[SREG_NCTAID_Z] = grid[2];
+	s[SREG_ZERO]     = 0;
+	uint64_t* y = s + NUM_SREG;
+	for (size_t n = 0 ; n < k.param_sym.size() ; ++n) {
+	  if (k.param_sym[n] != (size_t)-1)  y[n] = (uint64_t)(uintptr_t)( params + k.param_sym[n] );
+	  if (k.shared_sym[n] != (size_t)-1) y[n] = (uint64_t)(uintptr_t)( shared.data() + k.shared_sym[n] );
+	}
+	std::copy( k.constants.begin() , k.constants.end() , y + k.param_sym.size() );
+      }
+
+      enum Status { exited , barrier };
+
+      //! Run one thread from pc until it exits or reaches a barrier
+      Status run( uint64_t* r , unsigned char* local_frame , size_t& pc )
+      {
+	const Ins* code = k.code.data();
+	const size_t ncode = k.code.size();
+
+	while (pc < ncode) {
+	  const Ins& ins = code[pc++];
+	  if (counting) cnt.instructions++;
+	  if (ins.pred >= 0 && ( r[ins.pred] != 0 ) == ins.pred_neg)
+	    continue;
+
+	  const Ty t = ins.t;
+	  uint64_t a = ins.a >= 0 ? r[ins.a] : 0;
+	  uint64_t b = ins.b >= 0 ? r[ins.b] : 0;
+
+	  switch (ins.op) {
+	  case Op::mov:
+	    r[ins.d] = trunc_bits( t , a );
+	    break;
+
+	  case Op::ld: {
+	    size_t n = ty_bytes(t);
+	    unsigned char* p = access( ins , r , local_frame , (uintptr_t)( a + ins.off ) , n );
+	    uint64_t v = 0;
+	    std::memcpy( &v , p , n );
+	    r[ins.d] = v;
+	    if (counting) {
+	      if (ins.space == Space::shared) cnt.shared_loaded += n;
+	      else if (ins.space == Space::global || ins.space == Space::generic) cnt.bytes_loaded += n;
+	    }
+	    break;
+	  }
+
+	  case Op::st: {
+	    size_t n = ty_bytes(t);
+	    unsigned char* p = access( ins , r , local_frame , (uintptr_t)( a + ins.off ) , n );
+	    std::memcpy( p , &b , n );
+	    if (counting) {
+	      if (ins.space == Space::shared) cnt.shared_stored += n;
+	      else if (ins.space == Space::global || ins.space == Space::generic) cnt.bytes_stored += n;
+	    }
+	    break;
+	  }
+
+	  case Op::cvt:
+	    r[ins.d] = convert( t , ins.t2 , ins.rnd , ins.sat , a );
+	    break;
+
+	  case Op::selp:
+	    r[ins.d] = r[ins.c] ? a : b;
+	    break;
+
+	  case Op::setp: {
+	    bool res;
+	    if (ty_float(t)) {
+	      double x = fval( t , a ), y = fval( t , b );
+	      bool un = std::isnan(x) || std::isnan(y);
+	      switch (ins.cmp) {
+	      case Cmp::eq:  res = !un && x == y; break;
+	      case Cmp::ne:  res = !un && x != y; break;
+	      case Cmp::lt:  res = !un && x <  y; break;
+	      case Cmp::le:  res = !un && x <= y; break;
+	      case Cmp::gt:  res = !un && x >  y; break;
+	      case Cmp::ge:  res = !un && x >= y; break;
+	      case Cmp::equ: res = un || x == y; break;
+	      case Cmp::neu: res = un || x != y; break;
+	      case Cmp::ltu: res = un || x <  y; break;
+	      case Cmp::leu: res = un || x <= y; break;
+	      case Cmp::gtu: res = un || x >  y; break;
+	      case Cmp::geu: res = un || x >= y; break;
+	      case Cmp::num: res = !un; break;
+	      default:       res = un; break;
+	      }
+	    } else if (ty_signed(t)) {
+	      int64_t x = sext( t , a ), y = sext( t , b );
+	      switch (ins.cmp) {
+	      case Cmp::eq: res = x == y; break;
+	      case Cmp::ne: res = x != y; break;
+	      case Cmp::lt: res = x <  y; break;
+	      case Cmp::le: res = x <= y; break;
+	      case Cmp::gt: res = x >  y; break;
+	      default:      res = x >= y; break;
+	      }
+	    } else {
+	      uint64_t x = trunc_bits( t , a ), y = trunc_bits( t , b );
+	      switch (ins.cmp) {
+	      case Cmp::eq: res = x == y; break;
+	      case Cmp::ne: res = x != y; break;
+	      case Cmp::lt: res = x <  y; break;
+	      case Cmp::le: res = x <= y; break;
+	      case Cmp::gt: res = x >  y; break;
+	      default:      res = x >= y; break;
+	      }
+	    }
+	    r[ins.d] = res;
+	    break;
+	  }
+
+	  case Op::add: case Op::sub: case Op::mul: case Op::div: case Op::min: case Op::max:
+	    if (t == Ty::f32) {
+	      float x = as_f32(a), y = as_f32(b), z;
+	      switch (ins.op) {
+	      case Op::add: z = x + y; break;
+	      case Op::sub: z = x - y; break;
+	      case Op::mul: z = x * y; break;
+	      case Op::div: z = x / y; break;
+	      case Op::min: z = std::fmin( x , y ); break;
+	      default:      z = std::fmax( x , y ); break;
+	      }
+	      r[ins.d] = f32_bits(z);
+	      if (counting && ins.op != Op::min && ins.op != Op::max) cnt.flops++;
+	    } else if (t == Ty::f64) {
+	      double x = as_f64(a), y = as_f64(b), z;
+	      switch (ins.op) {
+	      case Op::add: z = x + y; break;
+	      case Op::sub: z = x - y; break;
+	      case Op::mul: z = x * y; break;
+	      case Op::div: z = x / y; break;
+	      case Op::min: z = std::fmin( x , y ); break;
+	      default:      z = std::fmax( x , y ); break;
+	      }
+	      r[ins.d] = f64_bits(z);
+	      if (counting && ins.op != Op::min && ins.op != Op::max) cnt.flops++;
+	    } else {
+	      uint64_t z;
+	      switch (ins.op) {
+	      case Op::add: z = a + b; break;
+	      case Op::sub: z = a - b; break;
+	      case Op::mul: z = a * b; break;
+	      case Op::div:
+		if (trunc_bits( t , b ) == 0) z = ~0ull;
+		else if (ty_signed(t)) z = (uint64_t)( sext( t , a ) / sext( t , b ) );
+		else z = trunc_bits( t , a ) / trunc_bits( t , b );
+		break;
+	      case Op::min:
+		z = ty_signed(t) ? ( sext( t , a ) < sext( t , b ) ? a : b ) : ( trunc_bits( t , a ) < trunc_bits( t , b ) ? a : b );
+		break;
+	      default:
+		z = ty_signed(t) ? ( sext( t , a ) > sext( t , b ) ? a : b ) : ( trunc_bits( t , a ) > trunc_bits( t , b ) ? a : b );
+		break;
+	      }
+	      r[ins.d] = trunc_bits( t , z );
+	    }
+	    break;
+
+	  case Op::rem: {
+	    uint64_t z;
+	    if (trunc_bits( t , b ) == 0) z = a;
+	    else if (ty_signed(t)) z = (uint64_t)( sext( t , a ) % sext( t , b ) );
+	    else z = trunc_bits( t , a ) % trunc_bits( t , b );
+	    r[ins.d] = trunc_bits( t , z );
+	    break;
+	  }
+
+	  case Op::mul_hi: {
+	    int bits = 8 * ty_bytes(t);
+	    uint64_t z;
+	    if (ty_signed(t)) z = (uint64_t)( ( (__int128)sext( t , a ) * sext( t , b ) ) >> bits );
+	    else              z = (uint64_t)( ( (unsigned __int128)trunc_bits( t , a ) * trunc_bits( t , b ) ) >> bits );
+	    r[ins.d] = trunc_bits( t , z );
+	    break;
+	  }
+
+	  case Op::mul_wide:
+	    if (ty_signed(t)) r[ins.d] = (uint64_t)( sext( t , a ) * sext( t , b ) );
+	    else              r[ins.d] = trunc_bits( t , a ) * trunc_bits( t , b );
+	    if (ty_bytes(t) == 2) r[ins.d] &= 0xffffffffull;
+	    break;
+
+	  case Op::mad:
+	    r[ins.d] = trunc_bits( t , a * b + r[ins.c] );
+	    break;
+
+	  case Op::fma:
+	    if (t == Ty::f32) r[ins.d] = f32_bits( std::fma( as_f32(a) , as_f32(b) , as_f32(r[ins.c]) ) );
+	    else              r[ins.d] = f64_bits( std::fma( as_f64(a) , as_f64(b) , as_f64(r[ins.c]) ) );
+	    if (counting) cnt.flops += 2;
+	    break;
+
+	  case Op::shl: {
+	    unsigned s = (unsigned)trunc_bits( Ty::u32 , b );
+	    r[ins.d] = s >= 8u * ty_bytes(t) ? 0 : trunc_bits( t , a << s );
+	    break;
+	  }
+
+	  case Op::shr: {
+	    unsigned s = (unsigned)trunc_bits( Ty::u32 , b );
+	    unsigned w = 8u * ty_bytes(t);
+	    if (ty_signed(t)) r[ins.d] = trunc_bits( t , (uint64_t)( sext( t , a ) >> std::min( s , w - 1 ) ) );
+	    else              r[ins.d] = s >= w ? 0 : trunc_bits( t , a ) >> s;
+	    break;
+	  }
+
+	  case Op::and_: r[ins.d] = a & b; break;
+	  case Op::or_:  r[ins.d] = a | b; break;
+	  case Op::xor_: r[ins.d] = a ^ b; break;
+	  case Op::not_: r[ins.d] = t == Ty::pred ? !a : trunc_bits( t , ~a ); break;
+
+	  case Op::neg:
+	    if (t == Ty::f32)      r[ins.d] = a ^ 0x80000000ull;
+	    else if (t == Ty::f64) r[ins.d] = a ^ 0x8000000000000000ull;
+	    else                   r[ins.d] = trunc_bits( t , 0 - a );
+	    break;
+
+	  case Op::abs:
+	    if (t == Ty::f32)      r[ins.d] = a & 0x7fffffffull;
+	    else if (t == Ty::f64) r[ins.d] = a & 0x7fffffffffffffffull;
+	    else                   r[ins.d] = trunc_bits( t , sext( t , a ) < 0 ? 0 - a : a );
+	    break;
+
+	  case Op::sqrt:
+	    if (t == Ty::f32) r[ins.d] = f32_bits( std::sqrt( as_f32(a) ) );
+	    else              r[ins.d] = f64_bits( std::sqrt( as_f64(a) ) );
+	    if (counting) cnt.flops++;
+	    break;
+
+	  case Op::call: {
+	    double x = fval( t , a ), y = ins.b >= 0 ? fval( t , b ) : 0, z;
+	    if (t == Ty::f32) {
+	      float xf = (float)x, yf = (float)y;
+	      switch (ins.math) {
+	      case Math::sin:   z = std::sin(xf); break;
+	      case Math::acos:  z = std::acos(xf); break;
+	      case Math::asin:  z = std::asin(xf); break;
+	      case Math::atan:  z = std::atan(xf); break;
+	      case Math::cos:   z = std::cos(xf); break;
+	      case Math::cosh:  z = std::cosh(xf); break;
+	      case Math::exp:   z = std::exp(xf); break;
+	      case Math::log:   z = std::log(xf); break;
+	      case Math::log10: z = std::log10(xf); break;
+	      case Math::sinh:  z = std::sinh(xf); break;
+	      case Math::tan:   z = std::tan(xf); break;
+	      case Math::tanh:  z = std::tanh(xf); break;
+	      case Math::pow:   z = std::pow(xf,yf); break;
+	      default:          z = std::atan2(xf,yf); break;
+	      }
+	      r[ins.d] = f32_bits( (float)z );
+	    } else {
+	      switch (ins.math) {
+	      case Math::sin:   z = std::sin(x); break;
+	      case Math::acos:  z = std::acos(x); break;
+	      case Math::asin:  z = std::asin(x); break;
+	      case Math::atan:  z = std::atan(x); break;
+	      case Math::cos:   z = std::cos(x); break;
+	      case Math::cosh:  z = std::cosh(x); break;
+	      case Math::exp:   z = std::exp(x); break;
+	      case Math::log:   z = std::log(x); break;
+	      case Math::log10: z = std::log10(x); break;
+	      case Math::sinh:  z = std::sinh(x); break;
+	      case Math::tan:   z = std::tan(x); break;
+	      case Math::tanh:  z = std::tanh(x); break;
+	      case Math::pow:   z = std::pow(x,y); break;
+	      default:          z = std::atan2(x,y); break;
+	      }
+	      r[ins.d] = f64_bits( z );
+	    }
+	    break;
+	  }
+
+	  case Op::bar:
+	    return barrier;
+
+	  case Op::exit:
+	    return exited;
+
+	  case Op::bra:
+	    pc = ins.target;
+	    break;
+
+	  case Op::nop:
+	    break;
+	  }
+	}
+	return exited;
+      }
+
+      void run_block( unsigned long blk )
+      {
+	unsigned int nthreads = block[0] * block[1] * block[2];
+
+	if (!k.barrier) {
+	  // One register file and one local frame, threads run to completion in turn
+	  set_block( R.data() , blk );
+	  for (unsigned int t = 0 ; t < nthreads ; ++t) {
+	    set_thread( R.data() , t , local.data() );
+	    size_t pc = 0;
+	    run( R.data() , local.data() , pc );
+	  }
+	  return;
+	}
+
+	// Barrier kernels: run every thread up to the next barrier, then start over
+	std::vector<size_t> pc( nthreads , 0 );
+	std::vector<bool>   done( nthreads , false );
+	for (unsigned int t = 0 ; t < nthreads ; ++t) {
+	  set_block( &R[ (size_t)t * k.nslots ] , blk );
+	  set_thread( &R[ (size_t)t * k.nslots ] , t , &local[ t * k.local_bytes ] );
+	}
+	unsigned int running = nthreads;
+	while (running > 0) {
+	  for (unsigned int t = 0 ; t < nthreads ; ++t) {
+	    if (done[t]) continue;
+	    if (run( &R[ (size_t)t * k.nslots ] , &local[ t * k.local_bytes ] , pc[t] ) == exited) {
+	      done[t] = true;
+	      running--;
+	    }
+	  }
+	}
+      }
+
+      void prepare()
+      {
+	unsigned int nthreads = block[0] * block[1] * block[2];
+	size_t files = k.barrier ? nthreads : 1;
+	shared.assign( shared_size + 16 , 0 );
+	local.assign( files * k.local_bytes + 16 , 0 );
+	R.assign( files * k.nslots , 0 );
+	for (size_t f = 0 ; f < files ; ++f)
+	  init_file( &R[ f * k.nslots ] );
+      }
+    };
+
+
+    CUresult launch( Kernel& k , const unsigned int grid[3] , const unsigned int block[3] ,
+		     unsigned int shared_bytes , void** kernelParams )
+    {
+      // Parameter buffer laid out as in the .entry signature
+      std::vector<unsigned char> params( k.param_bytes + 8 , 0 );
+      for (size_t p = 0 ; p < k.params.size() ; ++p) {
+	if (!kernelParams || !kernelParams[p]) {
+	  set_error( "missing kernel parameter " + std::to_string(p) + " for " + k.name );
+	  return CUDA_ERROR_INVALID_VALUE;
+	}
+	std::memcpy( &params[ k.params[p].offset ] , kernelParams[p] , k.params[p].size );
+      }
+
+      bool   counting = ptxEmuGetCounting();
+      unsigned long nblocks = (unsigned long)grid[0] * grid[1] * grid[2];
+
+      // One register file set per pool worker, made when it first gets a block
+      std::vector<std::unique_ptr<Worker> > workers( hostThreadsGetCount() );
+      auto worker = [&]( int w ) -> Worker& {
+	if (!workers[w]) {
+	  workers[w].reset( new Worker( k ) );
+	  Worker& wk = *workers[w];
+	  wk.params      = params.data();
+	  std::copy( grid , grid + 3 , wk.grid );
+	  std::copy( block , block + 3 , wk.block );
+	  wk.shared_size = k.static_shared + shared_bytes;
+	  wk.counting    = counting;
+	  wk.prepare();
+	}
+	return *workers[w];
+      };
+
+      std::atomic<bool>          failed(false);
+      std::string                failure;
+      std::mutex                 failure_mtx;
+
+      // Blocks follow the static partition of the host pool, so a field
+      // first written by a kernel sits on the NUMA nodes of the workers
+      // that run the same sites in later kernels. Idle workers steal.
+      hostParallelFor( nblocks , 1 , true , [&]( size_t lo , size_t hi , int w ) {
+	  if (failed)
+	    return;
+	  try {
+	    Worker& wk = worker( w );
+	    for (size_t b = lo ; b < hi ; ++b)
+	      wk.run_block( b );
+	  } catch (LaunchError& e) {
+	    std::lock_guard<std::mutex> lock( failure_mtx );
+	    if (!failed) failure = e.msg;
+	    failed = true;
+	  }
+	} );
+
+      if (failed) {
+	set_error( failure );
+	return CUDA_ERROR_LAUNCH_FAILED;
+      }
+
+      if (counting) {
+	std::lock_guard<std::mutex> lock( emu().mtx );
+	PTXEmuCounters& c = k.counters;
+	c.launches++;
+	c.threads += nblocks * block[0] * block[1] * block[2];
+	for (auto& w: workers) {
+	  if (!w)
+	    continue;
+	  c.instructions  += w->cnt.instructions;
+	  c.flops         += w->cnt.flops;
+	  c.bytes_loaded  += w->cnt.bytes_loaded;
+	  c.bytes_stored  += w->cnt.bytes_stored;
+	  c.shared_loaded += w->cnt.shared_loaded;
+	  c.shared_stored += w->cnt.shared_stored;
+	}
+      }
+      return CUDA_SUCCESS;
+    }
+
+
+    template<class T>
+    T new_handle() {
+      return reinterpret_cast<T>( (uintptr_t)( emu().handles++ ) );
+    }
+
+    void add_region( void* p , size_t size , bool device ) {
+      std::lock_guard<std::mutex> lock( emu().mtx );
+      emu().regions[ (uintptr_t)p ] = Region{ size , device };
+      if (device) emu().allocated += size;
+    }
+
+    bool remove_region( void* p , bool device ) {
+      std::lock_guard<std::mutex> lock( emu().mtx );
+      auto it = emu().regions.find( (uintptr_t)p );
+      if (it == emu().regions.end() || it->second.device != device)
+	return false;
+      if (device) emu().allocated -= it->second.size;
+      emu().regions.erase( it );
+      return true;
+    }
+
+  } // namespace
+
+
+
+  void ptxEmuSetCounting( bool on ) { emu().counting = on; }
+  bool ptxEmuGetCounting() { return emu().counting; }
+
+  void ptxEmuSetThreads( int n ) { hostThreadsSetCount( n ); }
+  int  ptxEmuGetThreads() { return hostThreadsGetCount(); }
+
+  void ptxEmuSetMemory( size_t bytes ) { emu().memory = bytes; }
+
+  bool ptxEmuGetCounters( CUfunction f , PTXEmuCounters& c )
+  {
+    std::lock_guard<std::mutex> lock( emu().mtx );
+    for (Kernel* k: emu().kernels) {
+      if ( (CUfunction)k == f ) {
+	c = k->counters;
+	return true;
+      }
+    }
+    return false;
+  }
+
+  void ptxEmuResetCounters()
+  {
+    std::lock_guard<std::mutex> lock( emu().mtx );
+    for (Kernel* k: emu().kernels)
+      std::memset( &k->counters , 0 , sizeof(k->counters) );
+  }
+
+  void ptxEmuPrintCounters( std::ostream& os )
+  {
+    std::lock_guard<std::mutex> lock( emu().mtx );
+    PTXEmuCounters tot;
+    std::memset( &tot , 0 , sizeof(tot) );
+
+    os << "PTX emulator counters (per thread averages)\n";
+    os << std::setw(8) << "kernel" << std::setw(10) << "launches" << std::setw(14) << "threads"
+       << std::setw(10) << "instr" << std::setw(10) << "flops" << std::setw(10) << "ld_bytes"
+       << std::setw(10) << "st_bytes" << std::setw(10) << "shm_bytes" << std::setw(10) << "flop/byte" << "\n";
+
+    for (Kernel* k: emu().kernels) {
+      const PTXEmuCounters& c = k->counters;
+      if (c.launches == 0)
+	continue;
+      double th = (double)c.threads;
+      unsigned long long bytes = c.bytes_loaded + c.bytes_stored;
+      os << std::setw(8) << k->id << std::setw(10) << c.launches << std::setw(14) << c.threads
+	 << std::fixed << std::setprecision(1)
+	 << std::setw(10) << c.instructions / th << std::setw(10) << c.flops / th
+	 << std::setw(10) << c.bytes_loaded / th << std::setw(10) << c.bytes_stored / th
+	 << std::setw(10) << ( c.shared_loaded + c.shared_stored ) / th
+	 << std::setprecision(3) << std::setw(10) << ( bytes ? (double)c.flops / bytes : 0.0 ) << "\n";
+      os.unsetf( std::ios::floatfield );
+      tot.launches      += c.launches;
+      tot.threads       += c.threads;
+      tot.instructions  += c.instructions;
+      tot.flops         += c.flops;
+      tot.bytes_loaded  += c.bytes_loaded;
+      tot.bytes_stored  += c.bytes_stored;
+      tot.shared_loaded += c.shared_loaded;
+      tot.shared_stored += c.shared_stored;
+    }
+
+    os << "total: launches = " << tot.launches << ", instructions = " << tot.instructions
+       << ", flops = " << tot.flops << ", bytes loaded = " << tot.bytes_loaded
+       << ", bytes stored = " << tot.bytes_stored << ", shared bytes = " << tot.shared_loaded + tot.shared_stored
+       << std::endl;
+  }
+
+  std::string ptxEmuLastError()
+  {
+    std::lock_guard<std::mutex> lock( emu().mtx );
+    return emu().last_error;
+  }
+
+} // namespace QDP
+
+
+
+using namespace QDP;
+
+extern "C" {
+
+  CUresult cuInit( unsigned int ) { return CUDA_SUCCESS; }
+
+  CUresult cuDeviceGetCount( int* count ) { *count = 1; return CUDA_SUCCESS; }
+
+  CUresult cuDeviceGet( CUdevice* device , int ordinal ) {
+    if (ordinal != 0) return CUDA_ERROR_INVALID_DEVICE;
+    *device = 0;
+    return CUDA_SUCCESS;
+  }
+
+  CUresult cuDeviceGetAttribute( int* pi , CUdevice_attribute attrib , CUdevice ) {
+    switch (attrib) {
+    case CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_BLOCK:       *pi = 1024; break;
+    case CU_DEVICE_ATTRIBUTE_MAX_BLOCK_DIM_X:             *pi = 1024; break;
+    case CU_DEVICE_ATTRIBUTE_MAX_BLOCK_DIM_Y:             *pi = 1024; break;
+    case CU_DEVICE_ATTRIBUTE_MAX_BLOCK_DIM_Z:             *pi = 64; break;
+    case CU_DEVICE_ATTRIBUTE_MAX_GRID_DIM_X:              *pi = 2147483647; break;
+    case CU_DEVICE_ATTRIBUTE_MAX_GRID_DIM_Y:              *pi = 65535; break;
+    case CU_DEVICE_ATTRIBUTE_MAX_GRID_DIM_Z:              *pi = 65535; break;
+    case CU_DEVICE_ATTRIBUTE_MAX_SHARED_MEMORY_PER_BLOCK: *pi = 48 * 1024; break;
+    case CU_DEVICE_ATTRIBUTE_WARP_SIZE:                   *pi = 32; break;
+    case CU_DEVICE_ATTRIBUTE_GPU_OVERLAP:                 *pi = 1; break;
+    case CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT:        *pi = 1; break;
+    case CU_DEVICE_ATTRIBUTE_UNIFIED_ADDRESSING:          *pi = 1; break;
+    case CU_DEVICE_ATTRIBUTE_MEMORY_CLOCK_RATE:           *pi = 0; break;    // no meaningful peak
+    case CU_DEVICE_ATTRIBUTE_GLOBAL_MEMORY_BUS_WIDTH:     *pi = 0; break;
+    default: return CUDA_ERROR_INVALID_VALUE;
+    }
+    return CUDA_SUCCESS;
+  }
+
+  // Matches the .target the JIT writes
+  CUresult cuDeviceComputeCapability( int* major , int* minor , CUdevice ) {
+    *major = 6;
+    *minor = 1;
+    return CUDA_SUCCESS;
+  }
+
+  CUresult cuCtxCreate( CUcontext* pctx , unsigned int , CUdevice ) {
+    *pctx = new_handle<CUcontext>();
+    return CUDA_SUCCESS;
+  }
+
+  CUresult cuCtxSetCurrent( CUcontext ) { return CUDA_SUCCESS; }
+  CUresult cuCtxSetCacheConfig( CUfunc_cache ) { return CUDA_SUCCESS; }
+
+  //! Launches complete synchronously, but a failed one is reported here as well
+  CUresult cuCtxSynchronize( void ) {
+    std::lock_guard<std::mutex> lock( emu().mtx );
+    CUresult ret = emu().sticky;
+    emu().sticky = CUDA_SUCCESS;
+    return ret;
+  }
+
+  CUresult cuModuleLoadDataEx( CUmodule* module , const void* image , unsigned int , CUjit_option* , void** )
+  {
+    std::unique_ptr<Module> mod( new Module );
+    try {
+      Parser parser( std::string( (const char*)image ) );
+      parser.parse( *mod );
+    } catch (ParseError& e) {
+      set_error( "PTX parse error: " + e.msg );
+      return CUDA_ERROR_INVALID_IMAGE;
+    }
+    std::lock_guard<std::mutex> lock( emu().mtx );
+    for (auto& k: mod->kernels) {
+      k->id = (int)emu().kernels.size();
+      emu().kernels.push_back( k.get() );
+    }
+    *module = reinterpret_cast<CUmodule>( mod.get() );
+    emu().modules.push_back( std::move( mod ) );
+    return CUDA_SUCCESS;
+  }
+
+  CUresult cuModuleGetFunction( CUfunction* hfunc , CUmodule hmod , const char* name ) {
+    Module* mod = reinterpret_cast<Module*>( hmod );
+    for (auto& k: mod->kernels) {
+      if (k->name == name) {
+	*hfunc = reinterpret_cast<CUfunction>( k.get() );
+	return CUDA_SUCCESS;
+      }
+    }
+    return CUDA_ERROR_NOT_FOUND;
+  }
+
+  CUresult cuFuncGetAttribute( int* pi , CUfunction_attribute attrib , CUfunction hfunc ) {
+    Kernel* k = reinterpret_cast<Kernel*>( hfunc );
+    switch (attrib) {
+    case CU_FUNC_ATTRIBUTE_MAX_THREADS_PER_BLOCK: *pi = 1024; break;
+    case CU_FUNC_ATTRIBUTE_SHARED_SIZE_BYTES:     *pi = (int)k->static_shared; break;
+    case CU_FUNC_ATTRIBUTE_CONST_SIZE_BYTES:      *pi = 0; break;
+    case CU_FUNC_ATTRIBUTE_LOCAL_SIZE_BYTES:      *pi = (int)k->local_bytes; break;
+    case CU_FUNC_ATTRIBUTE_NUM_REGS:              *pi = k->nregs; break;
+    default: return CUDA_ERROR_INVALID_VALUE;
+    }
+    return CUDA_SUCCESS;
+  }
+
+  CUresult cuLaunchKernel( CUfunction f ,
+			   unsigned int gridDimX , unsigned int gridDimY , unsigned int gridDimZ ,
+			   unsigned int blockDimX , unsigned int blockDimY , unsigned int blockDimZ ,
+			   unsigned int sharedMemBytes , CUstream ,
+			   void** kernelParams , void** extra )
+  {
+    Kernel* k = reinterpret_cast<Kernel*>( f );
+    if (!k || extra)
+      return CUDA_ERROR_INVALID_VALUE;
+
+    unsigned int grid[3]  = { gridDimX , gridDimY , gridDimZ };
+    unsigned int block[3] = { blockDimX , blockDimY , blockDimZ };
+    if ( blockDimX * blockDimY * blockDimZ > 1024 || blockDimZ > 64 || gridDimY > 65535 || gridDimZ > 65535 ||
+	 k->static_shared + sharedMemBytes > 48 * 1024 )
+      return CUDA_ERROR_LAUNCH_OUT_OF_RESOURCES;
+    if ( blockDimX * blockDimY * blockDimZ == 0 || gridDimX * gridDimY * gridDimZ == 0 )
+      return CUDA_ERROR_INVALID_VALUE;
+
+    CUresult ret = launch( *k , grid , block , sharedMemBytes , kernelParams );
+    if (ret != CUDA_SUCCESS) {
+      std::lock_guard<std::mutex> lock( emu().mtx );
+      emu().sticky = ret;
+    }
+    return ret;
+  }
+
+  CUresult cuMemGetInfo( size_t* free , size_t* total ) {
+    std::lock_guard<std::mutex> lock( emu().mtx );
+    *total = emu().memory;
+    *free  = emu().memory > emu().allocated ? emu().memory - emu().allocated : 0;
+    return CUDA_SUCCESS;
+  }
+
+  CUresult cuMemAlloc( CUdeviceptr* dptr , size_t bytesize ) {
+    {
+      std::lock_guard<std::mutex> lock( emu().mtx );
+      if (emu().allocated + bytesize > emu().memory)
+	return CUDA_ERROR_OUT_OF_MEMORY;
+    }
+    // Same alignment guarantee as the driver
+    void* p = NULL;
+    if (posix_memalign( &p , 256 , bytesize ? bytesize : 1 ))
+      return CUDA_ERROR_OUT_OF_MEMORY;
+    add_region( p , bytesize , true );
+    *dptr = (CUdeviceptr)(uintptr_t)p;
+    return CUDA_SUCCESS;
+  }
+
+  CUresult cuMemFree( CUdeviceptr dptr ) {
+    void* p = (void*)(uintptr_t)dptr;
+    if (!remove_region( p , true ))
+      return CUDA_ERROR_INVALID_VALUE;
+    std::free( p );
+    return CUDA_SUCCESS;
+  }
+
+  CUresult cuMemHostAlloc( void** pp , size_t bytesize , unsigned int ) {
+    if (posix_memalign( pp , 4096 , bytesize ? bytesize : 1 ))
+      return CUDA_ERROR_OUT_OF_MEMORY;
+    add_region( *pp , bytesize , false );
+    return CUDA_SUCCESS;
+  }
+
+  CUresult cuMemFreeHost( void* p ) {
+    if (!remove_region( p , false ))
+      return CUDA_ERROR_INVALID_VALUE;
+    std::free( p );
+    return CUDA_SUCCESS;
+  }
+
+  //! Registered host memory becomes addressable from kernels (mapped pinned memory)
+  CUresult cuMemHostRegister( void* p , size_t bytesize , unsigned int ) {
+    {
+      std::lock_guard<std::mutex> lock( emu().mtx );
+      if (emu().regions.count( (uintptr_t)p ))
+	return CUDA_ERROR_HOST_MEMORY_ALREADY_REGISTERED;
+    }
+    add_region( p , bytesize , false );
+    return CUDA_SUCCESS;
+  }
+
+  CUresult cuMemHostUnregister( void* p ) {
+    return remove_region( p , false ) ? CUDA_SUCCESS : CUDA_ERROR_HOST_MEMORY_NOT_REGISTERED;
+  }
+
+  CUresult cuMemcpy( CUdeviceptr dst , CUdeviceptr src , size_t bytes ) {
+    hostParallelCopy( (void*)(uintptr_t)dst , (const void*)(uintptr_t)src , bytes );
+    return CUDA_SUCCESS;
+  }
+
+  CUresult cuMemcpyAsync( CUdeviceptr dst , CUdeviceptr src , size_t bytes , CUstream ) {
+    return cuMemcpy( dst , src , bytes );
+  }
+
+  CUresult cuMemcpyHtoD( CUdeviceptr dst , const void* src , size_t bytes ) {
+    hostParallelCopy( (void*)(uintptr_t)dst , src , bytes );
+    return CUDA_SUCCESS;
+  }
+
+  CUresult cuMemcpyDtoH( void* dst , CUdeviceptr src , size_t bytes ) {
+    hostParallelCopy( dst , (const void*)(uintptr_t)src , bytes );
+    return CUDA_SUCCESS;
+  }
+
+  CUresult cuMemcpyHtoDAsync( CUdeviceptr dst , const void* src , size_t bytes , CUstream ) {
+    return cuMemcpyHtoD( dst , src , bytes );
+  }
+
+  CUresult cuMemcpyDtoHAsync( void* dst , CUdeviceptr src , size_t bytes , CUstream ) {
+    return cuMemcpyDtoH( dst , src , bytes );
+  }
+
+  CUresult cuStreamCreate( CUstream* phStream , unsigned int ) {
+    *phStream = new_handle<CUstream>();
+    return CUDA_SUCCESS;
+  }
+
+  CUresult cuStreamSynchronize( CUstream ) { return CUDA_SUCCESS; }
+  CUresult cuStreamWaitEvent( CUstream , CUevent , unsigned int ) { return CUDA_SUCCESS; }
+
+  CUresult cuEventCreate( CUevent* phEvent , unsigned int ) {
+    *phEvent = new_handle<CUevent>();
+    return CUDA_SUCCESS;
+  }
+
+  //! Launches are synchronous, so the host clock at record time is the device time
+  CUresult cuEventRecord( CUevent hEvent , CUstream ) {
+    double t = std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+    std::lock_guard<std::mutex> lock( emu().mtx );
+    emu().event_time[hEvent] = t;
+    return CUDA_SUCCESS;
+  }
+
+  CUresult cuEventSynchronize( CUevent ) { return CUDA_SUCCESS; }
+
+  CUresult cuEventElapsedTime( float* pMilliseconds , CUevent hStart , CUevent hEnd ) {
+    std::lock_guard<std::mutex> lock( emu().mtx );
+    auto s = emu().event_time.find( hStart );
+    auto e = emu().event_time.find( hEnd );
+    if (s == emu().event_time.end() || e == emu().event_time.end())
+      return CUDA_ERROR_INVALID_HANDLE;
+    *pMilliseconds = (float)( 1.0e3 * ( e->second - s->second ) );
+    return CUDA_SUCCESS;
+  }
+
+  CUresult cuProfilerInitialize( const char* , const char* , CUoutput_mode ) { return CUDA_SUCCESS; }
+  CUresult cuProfilerStart( void ) { return CUDA_SUCCESS; }
+  CUresult cuProfilerStop( void ) { return CUDA_SUCCESS; }
+
+}
@@ -30,6 +30,14 @@ namespace RNG
   LatticeSeed *lat_ran_mult_n;
   LatticeSeed *lat_ran_seed;
 
+  namespace {
+    Generator generator = Generator::lcg;
+    bool initialized = false;
+
+    //! Philox calls made on the current seed
+    uint64_t philox_calls = 0;
+  }
+
     //! Find the number of bits required to represent x.
   int numbits(int x)
   {
@@ -55,6 +63,94 @@ namespace RNG
   }
 
 
+  namespace {
+    //! The lattice of skewed multipliers a^(lexicographic site + 1) of the LCG
+    void initLatticeRNG()
+    {
+      int old_profile_level = setProfileLevel(0);
+
+      // Find the number of bits it takes to represent the total lattice volume.
+      // NOTE: there are no lattice size restrictions here.
+      int nbits = numbits(Layout::vol());
+
+      /* Get the lattice coordinate of each site (note the origin is 0) and
+       *   build up a lexicographic ordering for the lattice. The definition
+       *   here is totally arbitrary and only this routine needs to worry
+       *   about it.  The lexicographic value of site K is
+       *
+       *     lexoc(k) = sum_{i = 1, ndim} x(k,i)*L^i     +   1
+       */
+      LatticeInteger lexoc;
+      lexoc = Layout::latticeCoordinate(Nd-1);
+
+      for(int m=Nd-2; m>=0; --m)
+      {
+        lexoc *= Layout::lattSize()[m];
+        lexoc += Layout::latticeCoordinate(m);
+      }
+
+      lexoc += 1;
+
+      /*
+       * Setup single multiplier ( a^1 ) on each site 
+       */
+      LatticeSeed laa;
+      laa = ran_mult;
+
+      /*
+       * Calculate the multiplier  a^n  where n = lexicographic numbering of the site.
+       *   Put one into each an_f, then multiply them by  a^(2^i) under the context
+       *   flag where i is the bit number of the lexicographic numbering.
+       *   In other words, the very first site is multiplied by a.
+       */
+      LatticeSeed lattice_ran_mult_tmp;
+      lattice_ran_mult_tmp = 1;
+
+      LatticeSeed laamult;
+      LatticeBoolean lbit;
+
+      for(int i=0; i<nbits; ++i)
+      {
+        lbit = (lexoc & 1) > 0;
+
+        laamult = lattice_ran_mult_tmp * laa;
+
+        copymask(lattice_ran_mult_tmp,lbit,laamult);
+
+        lexoc >>= 1;
+        laamult = laa * laa;
+        laa = laamult;
+      }
+
+      lattice_ran_mult = new LatticeSeed;
+      if( lattice_ran_mult == 0x0 ) { 
+        QDP_error_exit("Unable to allocate lattice_ran_mult\n");
+      }
+
+      *lattice_ran_mult = lattice_ran_mult_tmp;
+      QDPIO::cout << "Finished init of RNG" << endl; 
+
+      lat_ran_seed = new LatticeSeed;
+      if( lat_ran_seed == 0x0 ) { 
+        QDP_error_exit("Unable to allocate lat_run_seed\n");
+      }
+
+      lat_ran_seed->elem(0) = ran_seed.elem();
+      for( int i = 1 ; i < Layout::sitesOnNode() ; i++ )    
+        lat_ran_seed->elem(i) = lat_ran_seed->elem(i-1) * ran_mult_n.elem();
+
+      lat_ran_mult_n = new LatticeSeed;
+      if( lat_ran_mult_n == 0x0 ) { 
+        QDP_error_exit("Unable to allocate lat_run_mult_n\n");
+      }
+
+      *lat_ran_mult_n = ran_mult_n;
+
+      setProfileLevel(old_profile_level);
+    }
+  }
+
+
   //! Initialize the internals of the random number generator
   void initRNG()
   {
@@ -77,55 +173,6 @@ namespace RNG
     // NOTE: there are no lattice size restrictions here.
     int nbits = numbits(Layout::vol());
 
-    /* Get the lattice coordinate of each site (note the origin is 0) and
-     *   build up a lexicographic ordering for the lattice. The definition
-     *   here is totally arbitrary and only this routine needs to worry
-     *   about it.  The lexicographic value of site K is
-     *
-     *     lexoc(k) = sum_{i = 1, ndim} x(k,i)*L^i     +   1
-     */
-    LatticeInteger lexoc;
-    lexoc = Layout::latticeCoordinate(Nd-1);
-
-    for(int m=Nd-2; m>=0; --m)
-    {
-      lexoc *= Layout::lattSize()[m];
-      lexoc += Layout::latticeCoordinate(m);
-    }
-
-    lexoc += 1;
-
-    /*
-     * Setup single multiplier ( a^1 ) on each site 
-     */
-    LatticeSeed laa;
-    laa = ran_mult;
-
-    /*
-     * Calculate the multiplier  a^n  where n = lexicographic numbering of the site.
-     *   Put one into each an_f, then multiply them by  a^(2^i) under the context
-     *   flag where i is the bit number of the lexicographic numbering.
-     *   In other words, the very first site is multiplied by a.
-     */
-    LatticeSeed lattice_ran_mult_tmp;
-    lattice_ran_mult_tmp = 1;
-
-    LatticeSeed laamult;
-    LatticeBoolean lbit;
-
-    for(int i=0; i<nbits; ++i)
-    {
-      lbit = (lexoc & 1) > 0;
-
-      laamult = lattice_ran_mult_tmp * laa;
-
-      copymask(lattice_ran_mult_tmp,lbit,laamult);
-
-      lexoc >>= 1;
-      laamult = laa * laa;
-      laa = laamult;
-    }
-
     // Calculate separately the multiplier for the highest lexicographically ordered site.
     // NOTE: I'm changing the meaning here slightly, but in an important way.
     // Technically, ran_mult_n = ran_mult^{vol} . Instead, I'm going to throw
@@ -155,29 +202,10 @@ namespace RNG
       aa = aamult;
     }
 
-    lattice_ran_mult = new LatticeSeed;
-    if( lattice_ran_mult == 0x0 ) { 
-      QDP_error_exit("Unable to allocate lattice_ran_mult\n");
-    }
-
-    *lattice_ran_mult = lattice_ran_mult_tmp;
-    QDPIO::cout << "Finished init of RNG" << endl; 
-
-    lat_ran_seed = new LatticeSeed;
-    if( lat_ran_seed == 0x0 ) { 
-      QDP_error_exit("Unable to allocate lat_run_seed\n");
-    }
-
-    lat_ran_seed->elem(0) = ran_seed.elem();
-    for( int i = 1 ; i < Layout::sitesOnNode() ; i++ )    
-      lat_ran_seed->elem(i) = lat_ran_seed->elem(i-1) * ran_mult_n.elem();
-
-    lat_ran_mult_n = new LatticeSeed;
-    if( lat_ran_mult_n == 0x0 ) { 
-      QDP_error_exit("Unable to allocate lat_run_mult_n\n");
-    }
-
-    *lat_ran_mult_n = ran_mult_n;
+    // The Philox generator needs none of the lattices
+    initialized = true;
+    if (generator == Generator::lcg)
+      initLatticeRNG();
 
     setProfileLevel(old_profile_level);
   }
@@ -187,6 +215,7 @@ namespace RNG
   void setrn(const Seed& seed)
   {
     ran_seed = seed;
+    philox_calls = 0;
   }
 
 
@@ -197,6 +226,98 @@ namespace RNG
   }
 
 
+  void setGenerator(Generator g)
+  {
+    generator = g;
+
+    // Switching to the LCG after the layout was created
+    if (generator == Generator::lcg && initialized && lattice_ran_mult == 0x0)
+      initLatticeRNG();
+  }
+
+
+  Generator getGenerator()
+  {
+    return generator;
+  }
+
+
+  bool parseGenerator(const std::string& name, Generator& g)
+  {
+    if (name == "lcg")
+      g = Generator::lcg;
+    else if (name == "philox")
+      g = Generator::philox;
+    else
+      return false;
+    return true;
+  }
+
+
+  //! The 47 bits of the global seed, lowest word first
+  void philoxKey(uint32_t key[2])
+  {
+    uint64_t k = 0;
+    for(int i=3; i >= 0; --i)
+      k = (k << 12) | (uint64_t)ran_seed.elem().elem().elem(i).elem().elem();
+
+    key[0] = (uint32_t)k;
+    key[1] = (uint32_t)(k >> 32);
+  }
+
+
+  void philoxAdvance()
+  {
+    if (++philox_calls >> 32)
+      QDP_error_exit("Philox: 2^32 calls on one seed, set a new seed with setrn");
+  }
+
+
+  uint64_t philoxCalls()
+  {
+    return philox_calls;
+  }
+
+
+  void setPhiloxCalls(uint64_t n)
+  {
+    philox_calls = n;
+  }
+
+
+  const LatticeInteger& latticeGlobalIndex(int half)
+  {
+    static LatticeInteger *index[2] = { 0x0 , 0x0 };
+
+    if (half < 0 || half > 1)
+      QDP_error_exit("latticeGlobalIndex: half %d, must be 0 or 1", half);
+
+    if (index[0] == 0x0) {
+      index[0] = new LatticeInteger;
+      index[1] = new LatticeInteger;
+
+      const int nodeSites = Layout::sitesOnNode();
+      const int nodeNumber = Layout::nodeNumber();
+      const multi1d<int>& size = Layout::lattSize();
+      for(int i=0; i < nodeSites; ++i)
+      {
+	multi1d<int> x = Layout::siteCoords(nodeNumber,i);
+	uint64_t lex = 0;
+	for(int m=Nd-1; m >= 0; --m)
+	  lex = lex * size[m] + x[m];
+
+	// The bit patterns of the two halves
+	Integer lo = (int)(uint32_t)lex;
+	Integer hi = (int)(uint32_t)(lex >> 32);
+	index[0]->elem(i) = lo.elem();
+	index[1]->elem(i) = hi.elem();
+      }
+    }
+
+    return *index[half];
+  }
+
+
   //! Scalar random number generator. Done on the front end. */
   /*! 
    * It is linear congruential with modulus m = 2**47, increment c = 0,
@@ -20,6 +20,10 @@ void Map::make(const MapFunc& func)
 
   //--------------------------------------
   // Setup the communication index arrays
+  tab = std::make_shared<MapTables>();
+  tab->offnodeP = false;
+
+  multi1d<int>& goffsets = tab->goffsets;
   goffsets.resize(Layout::vol());
 
   /* Get the offsets needed for neighbour comm.
@@ -0,0 +1,150 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Slab allocator for small host objects
+ */
+
+#include "qdp.h"
+
+namespace QDP
+{
+
+  QDPSlabAllocator& QDPSlabAllocator::Instance()
+  {
+    static QDPSlabAllocator singleton;
+    return singleton;
+  }
+
+
+  QDPSlabAllocator::QDPSlabAllocator(): enabled(true), registered(false)
+  {
+    for ( int cls = 0 ; cls < NUM_CLASSES ; ++cls ) {
+      freelist[cls]    = NULL;
+      info[cls].size   = (size_t)1 << (MIN_SHIFT + cls);
+      info[cls].live   = 0;
+      info[cls].peak   = 0;
+      info[cls].total  = 0;
+      info[cls].chunks = 0;
+    }
+  }
+
+
+  QDPSlabAllocator::~QDPSlabAllocator()
+  {
+    // Same as the pool: the driver may be gone already, keep the chunks
+  }
+
+
+  int QDPSlabAllocator::sizeClass( size_t n_bytes )
+  {
+    int cls = 0;
+    while ( ((size_t)1 << (MIN_SHIFT + cls)) < n_bytes )
+      cls++;
+    return cls;
+  }
+
+
+  void QDPSlabAllocator::newChunk( int cls )
+  {
+    Chunk c;
+    // Page aligned so that the chunk can be registered on its own
+    const unsigned long page = 4096;
+    if (!QDPCUDAHostAllocator::allocate( &c.unaligned , CHUNK_SIZE + page ))
+      QDP_error_exit("Slab allocator: Error allocating %lu bytes" , (unsigned long)CHUNK_SIZE );
+
+    c.ptr = (void*)( ( (unsigned long)c.unaligned + (page-1) ) & ~(page - 1) );
+
+    if (registered)
+      CudaHostRegister( c.ptr , CHUNK_SIZE );
+
+    chunks.push_back(c);
+    info[cls].chunks++;
+
+    // Thread the new objects onto the freelist, lowest address first
+    size_t size = info[cls].size;
+    unsigned char* base = (unsigned char*)c.ptr;
+    for ( size_t off = CHUNK_SIZE ; off >= size ; off -= size ) {
+      FreeObj* o = (FreeObj*)( base + off - size );
+      o->next = freelist[cls];
+      freelist[cls] = o;
+    }
+  }
+
+
+  bool QDPSlabAllocator::allocate( void** ptr , size_t n_bytes )
+  {
+    if (!enabled || n_bytes == 0 || n_bytes > maxSize())
+      return false;
+
+    int cls = sizeClass( n_bytes );
+
+    if (!freelist[cls])
+      newChunk( cls );
+
+    FreeObj* o = freelist[cls];
+    freelist[cls] = o->next;
+
+    ClassInfo& i = info[cls];
+    i.total++;
+    if (++i.live > i.peak)
+      i.peak = i.live;
+
+    *ptr = o;
+    return true;
+  }
+
+
+  void QDPSlabAllocator::free( void* ptr , size_t n_bytes )
+  {
+    int cls = sizeClass( n_bytes );
+
+    if (info[cls].live == 0)
+      QDP_error_exit("Slab allocator: free of %lu bytes, but no live objects in class %lu" ,
+		     (unsigned long)n_bytes , (unsigned long)info[cls].size );
+
+    FreeObj* o = (FreeObj*)ptr;
+    o->next = freelist[cls];
+    freelist[cls] = o;
+
+    info[cls].live--;
+  }
+
+
+  void QDPSlabAllocator::registerMemory()
+  {
+    QDP_info_primary("Slab allocator: Registering %d chunks with NVIDIA driver",(int)chunks.size());
+    for ( Chunk& c : chunks )
+      CudaHostRegister( c.ptr , CHUNK_SIZE );
+    registered = true;
+  }
+
+
+  void QDPSlabAllocator::unregisterMemory()
+  {
+    if (!registered)
+      return;
+    QDP_info_primary("Slab allocator: Unregistering memory with NVIDIA driver");
+    for ( Chunk& c : chunks )
+      CudaHostUnregister( c.ptr );
+    registered = false;
+  }
+
+
+  QDPSlabAllocator::ClassInfo QDPSlabAllocator::getClassInfo( int cls ) const
+  {
+    assert( cls >= 0 && cls < NUM_CLASSES );
+    return info[cls];
+  }
+
+
+  void QDPSlabAllocator::printInfo() const
+  {
+    QDP_info_primary("Slab allocator: %d chunks of %d bytes",(int)chunks.size(),(int)CHUNK_SIZE);
+    QDP_info_primary("%8s %12s %12s %14s %8s","size","live","peak","total","chunks");
+    for ( int cls = 0 ; cls < NUM_CLASSES ; ++cls )
+      QDP_info_primary("%8lu %12lu %12lu %14lu %8lu",
+		       (unsigned long)info[cls].size,(unsigned long)info[cls].live,(unsigned long)info[cls].peak,
+		       (unsigned long)info[cls].total,(unsigned long)info[cls].chunks);
+  }
+
+} // namespace QDP
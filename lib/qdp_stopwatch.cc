@@ -1,12 +1,11 @@
 /*! @file
  * @brief Timer support
  *
- * A stopwatch like timer.
+ * A stopwatch like timer on the monotonic clock.
  */
 
 
 #include "qdp.h"
-#include<sys/time.h>
 
 namespace QDP {
 
@@ -26,13 +25,7 @@ void StopWatch::reset()
 
 void StopWatch::start() 
 {
-  int ret_val;
-  ret_val = gettimeofday(&t_start, NULL);
-  if( ret_val != 0 ) 
-  {
-    QDPIO::cerr << __func__ << ": gettimeofday failed in StopWatch::start()" << endl;
-    QDP_abort(1);
-  }
+  t_start = getClockNanoseconds();
   startedP = true;
   stoppedP = false;
 }
@@ -45,82 +38,30 @@ void StopWatch::stop()
     QDP_abort(1);
   }
 
-  int ret_val;
-  ret_val = gettimeofday(&t_end, NULL);
-  if( ret_val != 0 ) 
-  {
-    QDPIO::cerr << __func__ << ": gettimeofday failed in StopWatch::end()" << endl;
-    QDP_abort(1);
-  }
+  t_end = getClockNanoseconds();
   stoppedP = true;
 }
 
-double StopWatch::getTimeInMicroseconds() 
+uint64_t StopWatch::getTimeInNanoseconds() 
 {
-  long usecs=0;
-  if( startedP && stoppedP ) 
-  { 
-    if( t_end.tv_sec < t_start.tv_sec ) 
-    { 
-      QDPIO::cerr << __func__ << ": critical timer rollover" << endl;
-//      QDP_abort(1);
-      usecs = 0.0;
-    }
-    else 
-    { 
-      usecs = (t_end.tv_sec - t_start.tv_sec)*1000000;
-
-      if( t_end.tv_usec < t_start.tv_usec ) 
-      {
-	usecs -= 1000000;
-	usecs += 1000000+t_end.tv_usec - t_start.tv_usec;
-      }
-      else 
-      {
-	usecs += t_end.tv_usec - t_start.tv_usec;
-      }
-    }
-  }
-  else 
+  if( !startedP || !stoppedP ) 
   {
     QDPIO::cerr << __func__ << ": either stopwatch not started, or not stopped" << endl;
     QDP_abort(1);
   }
 
-  return (double)usecs;
+  // The clock is monotonic, no rollover to take care of
+  return t_end - t_start;
+}
+    
+double StopWatch::getTimeInMicroseconds() 
+{
+  return 1.0e-3 * (double)getTimeInNanoseconds();
 }
     
 double StopWatch::getTimeInSeconds()  
 {
-  long secs=0;
-  long usecs=0;
-  if( startedP && stoppedP ) 
-  { 
-    if( t_end.tv_sec < t_start.tv_sec ) 
-    { 
-      QDPIO::cerr << __func__ << ": critical timer rollover" << endl;
-//      QDP_abort(1);
-      usecs = 0.0;
-    }
-    else 
-    { 
-      secs = t_end.tv_sec - t_start.tv_sec;
-
-      if( t_end.tv_usec < t_start.tv_usec ) 
-      {
-	secs -= 1;
-	usecs = 1000000;
-      }
-      usecs += t_end.tv_usec - t_start.tv_usec;
-    }
-  }
-  else 
-  {
-    QDPIO::cerr << __func__ << ": either stopwatch not started, or not stopped" << endl;
-    QDP_abort(1);
-  }
-
-  return (double)secs + ((double)usecs / 1e6);
+  return 1.0e-9 * (double)getTimeInNanoseconds();
 }
 
 
@@ -0,0 +1,202 @@
+// -*- C++ -*-
+/*! @file
+ * @brief Named timing regions
+ */
+
+#include "qdp.h"
+
+#include <algorithm>
+#include <set>
+#include <sstream>
+
+namespace QDP {
+
+  namespace {
+    //! Parents before children, siblings in name order
+    bool pathLess( const std::string& a , const std::string& b ) {
+      std::string x(a), y(b);
+      std::replace( x.begin() , x.end() , '/' , '\1' );
+      std::replace( y.begin() , y.end() , '/' , '\1' );
+      return x < y;
+    }
+  }
+
+
+  void TimingRegions::Stats::add( uint64_t t )
+  {
+    count++;
+    total += t;
+    min = std::min( min , t );
+    max = std::max( max , t );
+    node_max = total;
+  }
+
+
+  TimingRegions& TimingRegions::Instance()
+  {
+    static TimingRegions singleton;
+    return singleton;
+  }
+
+
+  std::vector<TimingRegions::Open>& TimingRegions::stack()
+  {
+    static thread_local std::vector<Open> s;
+    return s;
+  }
+
+
+  void TimingRegions::begin( const std::string& name )
+  {
+    std::vector<Open>& s = stack();
+    Open o;
+    o.path  = s.empty() ? name : s.back().path + "/" + name;
+    o.start = getClockNanoseconds();
+    s.push_back( o );
+  }
+
+
+  void TimingRegions::end()
+  {
+    uint64_t stop = getClockNanoseconds();
+    std::vector<Open>& s = stack();
+    if (s.empty())
+      QDP_error_exit("TimingRegions: end without a matching begin");
+    record( s.back().path , stop - s.back().start );
+    s.pop_back();
+  }
+
+
+  void TimingRegions::record( const std::string& path , uint64_t ns )
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    table[path].add( ns );
+  }
+
+
+  TimingRegions::Table TimingRegions::local() const
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    return table;
+  }
+
+
+  void TimingRegions::clear()
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    table.clear();
+  }
+
+
+  std::vector<std::string> QDPInternal::unionOverNodes( const std::vector<std::string>& mine )
+  {
+    std::set<std::string> all( mine.begin() , mine.end() );
+    if (Layout::numNodes() == 1)
+      return std::vector<std::string>( all.begin() , all.end() );
+
+    std::string names;
+    for (auto& n: mine)
+      names += n + "\n";
+
+    for (int node = 1 ; node < Layout::numNodes() ; ++node) {
+      int len = names.size();
+      QDPInternal::sendToPrimaryNode( len , node );
+      if (len == 0)
+	continue;
+      if (Layout::primaryNode()) {
+	std::vector<char> buf( len );
+	QDPInternal::recvFromWait( (void*)&buf[0] , node , len );
+	std::istringstream is( std::string( buf.begin() , buf.end() ) );
+	std::string n;
+	while (std::getline( is , n ))
+	  all.insert( n );
+      }
+      if (Layout::nodeNumber() == node)
+	QDPInternal::sendToWait( (void*)names.data() , 0 , len );
+    }
+
+    std::string union_names;
+    for (auto& n: all)
+      union_names += n + "\n";
+    QDPInternal::broadcast_str( union_names );
+
+    std::vector<std::string> ret;
+    std::istringstream is( union_names );
+    std::string n;
+    while (std::getline( is , n ))
+      ret.push_back( n );
+    return ret;
+  }
+
+
+  TimingRegions::Table TimingRegions::reduce() const
+  {
+    Table mine = local();
+    if (Layout::numNodes() == 1)
+      return mine;
+
+    // Nodes may have opened different regions, agree on the union first
+    std::vector<std::string> names;
+    for (auto& r: mine)
+      names.push_back( r.first );
+    std::vector<std::string> keys = QDPInternal::unionOverNodes( names );
+
+    int num = keys.size();
+    if (num == 0)
+      return Table();
+
+    std::vector<double> count( num ), total( num ), tmin( num ), tmax( num ), node_max( num );
+    for (int i = 0 ; i < num ; ++i) {
+      Table::const_iterator it = mine.find( keys[i] );
+      bool have = it != mine.end();
+      count[i]    = have ? it->second.count : 0;
+      total[i]    = have ? it->second.total : 0;
+      tmin[i]     = have ? it->second.min : 1.0e300;
+      tmax[i]     = have ? it->second.max : 0;
+      node_max[i] = total[i];
+    }
+
+    QDPInternal::globalSumArray( &count[0] , num );
+    QDPInternal::globalSumArray( &total[0] , num );
+    for (int i = 0 ; i < num ; ++i) {
+      QMP_min_double( &tmin[i] );
+      QMP_max_double( &tmax[i] );
+      QMP_max_double( &node_max[i] );
+    }
+
+    Table ret;
+    for (int i = 0 ; i < num ; ++i) {
+      Stats& s = ret[ keys[i] ];
+      s.count    = (uint64_t)count[i];
+      s.total    = (uint64_t)total[i];
+      s.min      = (uint64_t)tmin[i];
+      s.max      = (uint64_t)tmax[i];
+      s.node_max = (uint64_t)node_max[i];
+    }
+    return ret;
+  }
+
+
+  void TimingRegions::print() const
+  {
+    Table t = reduce();
+    if (t.empty())
+      return;
+
+    std::vector<std::string> keys;
+    for (auto& r: t)
+      keys.push_back( r.first );
+    std::sort( keys.begin() , keys.end() , pathLess );
+
+    QDP_info_primary("Timing regions (%d nodes, times in ms, node max is the largest per-node total):",Layout::numNodes());
+    QDP_info_primary("  %-40s %10s %12s %10s %10s %10s %12s","region","calls","total","mean","min","max","node max");
+    for (auto& k: keys) {
+      const Stats& s = t[k];
+      size_t depth = std::count( k.begin() , k.end() , '/' );
+      std::string label = std::string( 2*depth , ' ' ) + k.substr( k.find_last_of('/') + 1 );
+      QDP_info_primary("  %-40s %10lu %12.3f %10.4f %10.4f %10.4f %12.3f",label.c_str(),(unsigned long)s.count,
+		       1.0e-6 * s.total , 1.0e-6 * s.mean() , 1.0e-6 * s.min , 1.0e-6 * s.max , 1.0e-6 * s.node_max );
+    }
+  }
+
+}
@@ -0,0 +1,167 @@
+// -*- C++ -*-
+
+/*! \file
+ * \brief Block size search for one kernel and thread count
+ */
+
+#include "qdp_tuner.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace QDP {
+
+  namespace {
+    double median( std::vector<double>& v ) {
+      std::sort( v.begin() , v.end() );
+      size_t n = v.size();
+      return n % 2 ? v[n/2] : 0.5 * ( v[n/2-1] + v[n/2] );
+    }
+  }
+
+
+  double BlockSizeTuner::robustMean( std::vector<double> v , double k )
+  {
+    if (v.empty())
+      return 0.0;
+
+    double med = median( v );
+    std::vector<double> dev( v.size() );
+    for (size_t i = 0 ; i < v.size() ; ++i)
+      dev[i] = std::fabs( v[i] - med );
+    double sigma = 1.4826 * median( dev );
+
+    double sum = 0.0;
+    int    n   = 0;
+    for (double x: v) {
+      if (std::fabs( x - med ) <= k * sigma) {
+	sum += x;
+	n++;
+      }
+    }
+    return n ? sum / n : med;
+  }
+
+
+  BlockSizeTuner::BlockSizeTuner( int max_block_ , int th_count , int samples_ , int warp_ ):
+    max_block(max_block_), samples(std::max(samples_,1)), warp(warp_), phase(Coarse),
+    pos(0), warm(false), best_block(0), best_score(0.0), num_launches(0)
+  {
+    // Blocks larger than the thread count only add idle threads
+    int useful = 1;
+    while (useful < th_count && useful < warp)
+      useful <<= 1;
+    if (th_count > warp)
+      useful = ( th_count + warp - 1 ) / warp * warp;
+    max_block = std::max( 1 , std::min( max_block , useful ) );
+
+    int p = 1;
+    while (2*p <= max_block)
+      p <<= 1;
+    for ( ; p > 0 ; p >>= 1 )
+      cand.push_back( p );
+  }
+
+
+  int BlockSizeTuner::next() const
+  {
+    if (phase == Settled)
+      return best_block;
+    return cand[pos];
+  }
+
+
+  void BlockSizeTuner::report( double time )
+  {
+    if (phase == Settled)
+      return;
+
+    num_launches++;
+
+    // The very first launch also pays for loading the module
+    if (!warm) {
+      warm = true;
+      return;
+    }
+
+    times.push_back( time );
+    if ((int)times.size() >= samples)
+      finishCandidate();
+  }
+
+
+  void BlockSizeTuner::finishCandidate()
+  {
+    double score = robustMean( times );
+    measured.push_back( cand[pos] );
+
+    if (best_block == 0 || score < best_score) {
+      best_block = cand[pos];
+      best_score = score;
+    }
+
+    // Past the optimum, smaller blocks only get slower
+    if (phase == Coarse && score > 1.33 * best_score)
+      startFine();
+    else
+      advance();
+  }
+
+
+  void BlockSizeTuner::advance()
+  {
+    times.clear();
+    if (++pos < cand.size())
+      return;
+    if (phase == Coarse)
+      startFine();
+    else
+      phase = Settled;
+  }
+
+
+  void BlockSizeTuner::startFine()
+  {
+    phase = Fine;
+    cand.clear();
+    pos = 0;
+    times.clear();
+
+    if (best_block > 0) {
+      int lo = std::max( warp , best_block / 2 + 1 );
+      int hi = std::min( max_block , 2 * best_block );
+      for (int b = ( lo + warp - 1 ) / warp * warp ; b <= hi ; b += warp)
+	if (std::find( measured.begin() , measured.end() , b ) == measured.end())
+	  cand.push_back( b );
+    }
+
+    if (cand.empty())
+      phase = Settled;
+  }
+
+
+  void BlockSizeTuner::failed()
+  {
+    if (phase == Settled)
+      return;
+
+    int b = cand[pos];
+    max_block = b - 1;
+
+    std::vector<int> rest;
+    for (size_t i = pos + 1 ; i < cand.size() ; ++i)
+      if (cand[i] < b)
+	rest.push_back( cand[i] );
+    cand = rest;
+    pos = 0;
+    times.clear();
+
+    if (cand.empty()) {
+      if (phase == Coarse)
+	startFine();
+      else
+	phase = Settled;
+    }
+  }
+
+}
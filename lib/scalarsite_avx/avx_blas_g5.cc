@@ -0,0 +1,429 @@
+/*! @file
+ * @brief AVX2/AVX-512 versions of the gamma_5 BLAS kernels
+ *
+ * In the chiral basis every one of these kernels is, separately on the
+ * upper and lower two spin components, out = cx*x + cy*y with complex
+ * constants cx and cy. They all go through a single engine that takes
+ * those constants as per lane coefficients over one Dirac fermion
+ * (24 reals):
+ *
+ *    out = A x + B swap(x) + C y + D swap(y)
+ *
+ * where swap exchanges real and imaginary parts, A and C hold the real
+ * parts of cx and cy, and B and D their imaginary parts with the sign
+ * of the real lanes flipped. That is four FMAs per register whatever the
+ * projector or the factor of i.
+ */
+
+#include "qdp_precision.h"
+#include "scalarsite_avx/avx_blas_g5.h"
+
+#if defined(QDP_AVX_HAVE_TARGET)
+#include <immintrin.h>
+#endif
+
+namespace QDP {
+  namespace AVX {
+
+    namespace {
+
+      struct Cx {
+	double re, im;
+	Cx(double re_, double im_ = 0.0): re(re_), im(im_) {}
+      };
+
+      //! Per lane coefficients of one Dirac fermion
+      template<typename T>
+      struct G5Lanes {
+	T a[24], b[24], c[24], d[24];
+
+	G5Lanes(Cx xu, Cx yu, Cx xl, Cx yl) {
+	  for (int i = 0; i < 24; ++i) {
+	    const Cx& cx = i < 12 ? xu : xl;
+	    const Cx& cy = i < 12 ? yu : yl;
+	    double sign = (i & 1) ? 1.0 : -1.0;
+	    a[i] = cx.re;
+	    b[i] = sign * cx.im;
+	    c[i] = cy.re;
+	    d[i] = sign * cy.im;
+	  }
+	}
+      };
+
+
+      //-------------------------------------------------------------------
+      // Portable version. Out may alias x or y, so a complex number is
+      // read completely before it is written
+      template<typename T>
+      void apply_generic(T* out, const G5Lanes<T>& k, const T* x, const T* y, bool use_y, int n_4vec)
+      {
+	for (int n = 0; n < n_4vec; ++n, out += 24, x += 24, y += 24)
+	  for (int i = 0; i < 24; i += 2) {
+	    T re = k.a[i]   * x[i]   + k.b[i]   * x[i+1];
+	    T im = k.a[i+1] * x[i+1] + k.b[i+1] * x[i];
+	    if (use_y) {
+	      re += k.c[i]   * y[i]   + k.d[i]   * y[i+1];
+	      im += k.c[i+1] * y[i+1] + k.d[i+1] * y[i];
+	    }
+	    out[i]   = re;
+	    out[i+1] = im;
+	  }
+      }
+
+
+#if defined(QDP_AVX_HAVE_TARGET)
+      //-------------------------------------------------------------------
+      // AVX2 + FMA
+      QDP_AVX2_TARGET
+      void apply_avx2(double* out, const G5Lanes<double>& k, const double* x, const double* y, bool use_y, int n_4vec)
+      {
+	for (int n = 0; n < n_4vec; ++n, out += 24, x += 24, y += 24)
+	  for (int i = 0; i < 24; i += 4) {
+	    __m256d xv = _mm256_loadu_pd(x + i);
+	    __m256d r  = _mm256_mul_pd(_mm256_loadu_pd(k.b + i), _mm256_permute_pd(xv, 0x5));
+	    r = _mm256_fmadd_pd(_mm256_loadu_pd(k.a + i), xv, r);
+	    if (use_y) {
+	      __m256d yv = _mm256_loadu_pd(y + i);
+	      r = _mm256_fmadd_pd(_mm256_loadu_pd(k.c + i), yv, r);
+	      r = _mm256_fmadd_pd(_mm256_loadu_pd(k.d + i), _mm256_permute_pd(yv, 0x5), r);
+	    }
+	    _mm256_storeu_pd(out + i, r);
+	  }
+      }
+
+      QDP_AVX2_TARGET
+      void apply_avx2(float* out, const G5Lanes<float>& k, const float* x, const float* y, bool use_y, int n_4vec)
+      {
+	for (int n = 0; n < n_4vec; ++n, out += 24, x += 24, y += 24)
+	  for (int i = 0; i < 24; i += 8) {
+	    __m256 xv = _mm256_loadu_ps(x + i);
+	    __m256 r  = _mm256_mul_ps(_mm256_loadu_ps(k.b + i), _mm256_permute_ps(xv, 0xB1));
+	    r = _mm256_fmadd_ps(_mm256_loadu_ps(k.a + i), xv, r);
+	    if (use_y) {
+	      __m256 yv = _mm256_loadu_ps(y + i);
+	      r = _mm256_fmadd_ps(_mm256_loadu_ps(k.c + i), yv, r);
+	      r = _mm256_fmadd_ps(_mm256_loadu_ps(k.d + i), _mm256_permute_ps(yv, 0xB1), r);
+	    }
+	    _mm256_storeu_ps(out + i, r);
+	  }
+      }
+
+
+      //-------------------------------------------------------------------
+      // AVX-512F. A single precision fermion is one and a half registers,
+      // the second half goes through a mask
+      // The permutes take a full zero mask: the unmasked ones leave an
+      // operand undefined in GCC's headers, which trips -Wuninitialized
+      QDP_AVX512_TARGET
+      void apply_avx512(double* out, const G5Lanes<double>& k, const double* x, const double* y, bool use_y, int n_4vec)
+      {
+	for (int n = 0; n < n_4vec; ++n, out += 24, x += 24, y += 24)
+	  for (int i = 0; i < 24; i += 8) {
+	    __m512d xv = _mm512_loadu_pd(x + i);
+	    __m512d r  = _mm512_mul_pd(_mm512_loadu_pd(k.b + i), _mm512_maskz_permute_pd((__mmask8)0xFF, xv, 0x55));
+	    r = _mm512_fmadd_pd(_mm512_loadu_pd(k.a + i), xv, r);
+	    if (use_y) {
+	      __m512d yv = _mm512_loadu_pd(y + i);
+	      r = _mm512_fmadd_pd(_mm512_loadu_pd(k.c + i), yv, r);
+	      r = _mm512_fmadd_pd(_mm512_loadu_pd(k.d + i), _mm512_maskz_permute_pd((__mmask8)0xFF, yv, 0x55), r);
+	    }
+	    _mm512_storeu_pd(out + i, r);
+	  }
+      }
+
+      QDP_AVX512_TARGET
+      void apply_avx512(float* out, const G5Lanes<float>& k, const float* x, const float* y, bool use_y, int n_4vec)
+      {
+	for (int n = 0; n < n_4vec; ++n, out += 24, x += 24, y += 24)
+	  for (int i = 0; i < 24; i += 16) {
+	    __mmask16 m = i == 0 ? 0xFFFF : 0x00FF;
+	    __m512 xv = _mm512_maskz_loadu_ps(m, x + i);
+	    __m512 r  = _mm512_mul_ps(_mm512_maskz_loadu_ps(m, k.b + i), _mm512_maskz_permute_ps((__mmask16)0xFFFF, xv, 0xB1));
+	    r = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, k.a + i), xv, r);
+	    if (use_y) {
+	      __m512 yv = _mm512_maskz_loadu_ps(m, y + i);
+	      r = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, k.c + i), yv, r);
+	      r = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, k.d + i), _mm512_maskz_permute_ps((__mmask16)0xFFFF, yv, 0xB1), r);
+	    }
+	    _mm512_mask_storeu_ps(out + i, m, r);
+	  }
+      }
+#endif
+
+
+      //-------------------------------------------------------------------
+      template<typename T>
+      void apply(T* out, const G5Lanes<T>& k, const T* x, const T* y, bool use_y, int n_4vec)
+      {
+#if defined(QDP_AVX_HAVE_TARGET)
+	switch (currentIsa()) {
+	case AVX512: apply_avx512(out, k, x, y, use_y, n_4vec); return;
+	case AVX2:   apply_avx2(out, k, x, y, use_y, n_4vec);   return;
+	default: break;
+	}
+#endif
+	apply_generic(out, k, x, y, use_y, n_4vec);
+      }
+
+      //! out = cx*x + cy*y with cx, cy given for the upper and lower spins
+      template<typename T>
+      void g5(T* out, const T* x, const T* y, int n_4vec, Cx xu, Cx yu, Cx xl, Cx yl)
+      {
+	G5Lanes<T> k(xu, yu, xl, yl);
+	apply(out, k, x, y, true, n_4vec);
+      }
+
+      //! out = cx*x
+      template<typename T>
+      void g5(T* out, const T* x, int n_4vec, Cx xu, Cx xl)
+      {
+	G5Lanes<T> k(xu, 0.0, xl, 0.0);
+	apply(out, k, x, x, false, n_4vec);
+      }
+
+    } // anonymous namespace
+
+
+    template<typename T>
+    void axpyz_g5ProjPlus(T *Out, T *scalep, T *InScale, T *Add, int n_4vec)
+    {
+      const double a = *scalep;
+      g5(Out, InScale, Add, n_4vec, a, 1, a, 0);
+    }
+
+    template<typename T>
+    void axpyz_g5ProjMinus(T *Out, T *scalep, T *InScale, T *Add, int n_4vec)
+    {
+      const double a = *scalep;
+      g5(Out, InScale, Add, n_4vec, a, 0, a, 1);
+    }
+
+    template<typename T>
+    void axmyz_g5ProjPlus(T *Out, T *scalep, T *InScale, T *Add, int n_4vec)
+    {
+      const double a = *scalep;
+      g5(Out, InScale, Add, n_4vec, a, -1, a, 0);
+    }
+
+    template<typename T>
+    void axmyz_g5ProjMinus(T *Out, T *scalep, T *InScale, T *Add, int n_4vec)
+    {
+      const double a = *scalep;
+      g5(Out, InScale, Add, n_4vec, a, 0, a, -1);
+    }
+
+    template<typename T>
+    void xpayz_g5ProjPlus(T *Out, T *scalep, T *Add, T *InScale, int n_4vec)
+    {
+      const double a = *scalep;
+      g5(Out, Add, InScale, n_4vec, 1, a, 1, 0);
+    }
+
+    template<typename T>
+    void xpayz_g5ProjMinus(T *Out, T *scalep, T *Add, T *InScale, int n_4vec)
+    {
+      const double a = *scalep;
+      g5(Out, Add, InScale, n_4vec, 1, 0, 1, a);
+    }
+
+    template<typename T>
+    void xmayz_g5ProjPlus(T *Out, T *scalep, T *Add, T *InScale, int n_4vec)
+    {
+      const double a = *scalep;
+      g5(Out, Add, InScale, n_4vec, 1, -a, 1, 0);
+    }
+
+    template<typename T>
+    void xmayz_g5ProjMinus(T *Out, T *scalep, T *Add, T *InScale, int n_4vec)
+    {
+      const double a = *scalep;
+      g5(Out, Add, InScale, n_4vec, 1, 0, 1, -a);
+    }
+
+    template<typename T>
+    void add_g5ProjPlus(T *Out, T *X, T *Y, int n_4vec)
+    {
+      g5(Out, X, Y, n_4vec, 1, 1, 1, 0);
+    }
+
+    template<typename T>
+    void add_g5ProjMinus(T *Out, T *X, T *Y, int n_4vec)
+    {
+      g5(Out, X, Y, n_4vec, 1, 0, 1, 1);
+    }
+
+    template<typename T>
+    void sub_g5ProjPlus(T *Out, T *X, T *Y, int n_4vec)
+    {
+      g5(Out, X, Y, n_4vec, 1, -1, 1, 0);
+    }
+
+    template<typename T>
+    void sub_g5ProjMinus(T *Out, T *X, T *Y, int n_4vec)
+    {
+      g5(Out, X, Y, n_4vec, 1, 0, 1, -1);
+    }
+
+    template<typename T>
+    void scal_g5ProjPlus(T *Out, T *scalep, T *In, int n_4vec)
+    {
+      const double a = *scalep;
+      g5(Out, In, n_4vec, a, 0);
+    }
+
+    template<typename T>
+    void scal_g5ProjMinus(T *Out, T *scalep, T *In, int n_4vec)
+    {
+      const double a = *scalep;
+      g5(Out, In, n_4vec, 0, a);
+    }
+
+    template<typename T>
+    void axpbyz_g5ProjPlus(T *Out, T *scalep, T *InScale, T *scalep2, T *Add, int n_4vec)
+    {
+      const double a = *scalep;
+      const double b = *scalep2;
+      g5(Out, InScale, Add, n_4vec, a, b, a, 0);
+    }
+
+    template<typename T>
+    void axpbyz_g5ProjMinus(T *Out, T *scalep, T *InScale, T *scalep2, T *Add, int n_4vec)
+    {
+      const double a = *scalep;
+      const double b = *scalep2;
+      g5(Out, InScale, Add, n_4vec, a, 0, a, b);
+    }
+
+    template<typename T>
+    void axmbyz_g5ProjPlus(T *Out, T *scalep, T *InScale, T *scalep2, T *Add, int n_4vec)
+    {
+      const double a = *scalep;
+      const double b = *scalep2;
+      g5(Out, InScale, Add, n_4vec, a, -b, a, 0);
+    }
+
+    template<typename T>
+    void axmbyz_g5ProjMinus(T *Out, T *scalep, T *InScale, T *scalep2, T *Add, int n_4vec)
+    {
+      const double a = *scalep;
+      const double b = *scalep2;
+      g5(Out, InScale, Add, n_4vec, a, 0, a, -b);
+    }
+
+    template<typename T>
+    void scal_g5(T *Out, T *scalep, T *In, int n_4vec)
+    {
+      const double a = *scalep;
+      g5(Out, In, n_4vec, a, -a);
+    }
+
+    template<typename T>
+    void axpbyz_g5(T *Out, T *scalep, T *InScale, T *scalep2, T *Add, int n_4vec)
+    {
+      const double a = *scalep;
+      const double b = *scalep2;
+      g5(Out, InScale, Add, n_4vec, a, b, a, -b);
+    }
+
+    template<typename T>
+    void xmayz_g5(T *Out, T *scalep, T *Add, T *InScale, int n_4vec)
+    {
+      const double a = *scalep;
+      g5(Out, Add, InScale, n_4vec, 1, -a, 1, a);
+    }
+
+    template<typename T>
+    void g5_axmbyz(T *Out, T *scalep, T *InScale, T *scalep2, T *Add, int n_4vec)
+    {
+      const double a = *scalep;
+      const double b = *scalep2;
+      g5(Out, InScale, Add, n_4vec, a, -b, -a, b);
+    }
+
+    template<typename T>
+    void axpbyz_ig5(T *Out, T *scalep, T *InScale, T *scalep2, T *Add, int n_4vec)
+    {
+      const double a = *scalep;
+      const double b = *scalep2;
+      g5(Out, InScale, Add, n_4vec, a, Cx(0, b), a, Cx(0, -b));
+    }
+
+    template<typename T>
+    void axmbyz_ig5(T *Out, T *scalep, T *InScale, T *scalep2, T *Add, int n_4vec)
+    {
+      const double a = *scalep;
+      const double b = *scalep2;
+      g5(Out, InScale, Add, n_4vec, a, Cx(0, -b), a, Cx(0, b));
+    }
+
+    template<typename T>
+    void xpayz_ig5(T *Out, T *scalep, T *InScale, T *Add, int n_4vec)
+    {
+      const double a = *scalep;
+      g5(Out, InScale, Add, n_4vec, 1, Cx(0, a), 1, Cx(0, -a));
+    }
+
+    template<typename T>
+    void xmayz_ig5(T *Out, T *scalep, T *InScale, T *Add, int n_4vec)
+    {
+      const double a = *scalep;
+      g5(Out, InScale, Add, n_4vec, 1, Cx(0, -a), 1, Cx(0, a));
+    }
+
+
+    // The hooks use REAL, the benchmark both precisions
+    template void axpyz_g5ProjPlus(REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void axpyz_g5ProjPlus(REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void axpyz_g5ProjMinus(REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void axpyz_g5ProjMinus(REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void axmyz_g5ProjPlus(REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void axmyz_g5ProjPlus(REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void axmyz_g5ProjMinus(REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void axmyz_g5ProjMinus(REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void xpayz_g5ProjPlus(REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void xpayz_g5ProjPlus(REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void xpayz_g5ProjMinus(REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void xpayz_g5ProjMinus(REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void xmayz_g5ProjPlus(REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void xmayz_g5ProjPlus(REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void xmayz_g5ProjMinus(REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void xmayz_g5ProjMinus(REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void add_g5ProjPlus(REAL32*, REAL32*, REAL32*, int);
+    template void add_g5ProjPlus(REAL64*, REAL64*, REAL64*, int);
+    template void add_g5ProjMinus(REAL32*, REAL32*, REAL32*, int);
+    template void add_g5ProjMinus(REAL64*, REAL64*, REAL64*, int);
+    template void sub_g5ProjPlus(REAL32*, REAL32*, REAL32*, int);
+    template void sub_g5ProjPlus(REAL64*, REAL64*, REAL64*, int);
+    template void sub_g5ProjMinus(REAL32*, REAL32*, REAL32*, int);
+    template void sub_g5ProjMinus(REAL64*, REAL64*, REAL64*, int);
+    template void scal_g5ProjPlus(REAL32*, REAL32*, REAL32*, int);
+    template void scal_g5ProjPlus(REAL64*, REAL64*, REAL64*, int);
+    template void scal_g5ProjMinus(REAL32*, REAL32*, REAL32*, int);
+    template void scal_g5ProjMinus(REAL64*, REAL64*, REAL64*, int);
+    template void axpbyz_g5ProjPlus(REAL32*, REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void axpbyz_g5ProjPlus(REAL64*, REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void axpbyz_g5ProjMinus(REAL32*, REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void axpbyz_g5ProjMinus(REAL64*, REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void axmbyz_g5ProjPlus(REAL32*, REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void axmbyz_g5ProjPlus(REAL64*, REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void axmbyz_g5ProjMinus(REAL32*, REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void axmbyz_g5ProjMinus(REAL64*, REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void scal_g5(REAL32*, REAL32*, REAL32*, int);
+    template void scal_g5(REAL64*, REAL64*, REAL64*, int);
+    template void axpbyz_g5(REAL32*, REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void axpbyz_g5(REAL64*, REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void xmayz_g5(REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void xmayz_g5(REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void g5_axmbyz(REAL32*, REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void g5_axmbyz(REAL64*, REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void axpbyz_ig5(REAL32*, REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void axpbyz_ig5(REAL64*, REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void axmbyz_ig5(REAL32*, REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void axmbyz_ig5(REAL64*, REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void xpayz_ig5(REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void xpayz_ig5(REAL64*, REAL64*, REAL64*, REAL64*, int);
+    template void xmayz_ig5(REAL32*, REAL32*, REAL32*, REAL32*, int);
+    template void xmayz_ig5(REAL64*, REAL64*, REAL64*, REAL64*, int);
+
+  } // namespace AVX
+} // namespace QDP
@@ -0,0 +1,71 @@
+/*! @file
+ * @brief Instruction set selection for the scalarsite AVX kernels
+ */
+
+#include "scalarsite_avx/avx_dispatch.h"
+
+#include <cstring>
+
+namespace QDP {
+  namespace AVX {
+
+    namespace {
+      // -1 until the first kernel call or setIsa()
+      int current_isa = -1;
+    }
+
+
+    Isa detectedIsa()
+    {
+#if defined(QDP_AVX_HAVE_TARGET)
+      // libgcc also checks that the OS saves the wide registers
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx512f"))
+	return AVX512;
+      if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+	return AVX2;
+#endif
+      return Generic;
+    }
+
+
+    Isa currentIsa()
+    {
+      if (current_isa < 0)
+	current_isa = detectedIsa();
+      return (Isa)current_isa;
+    }
+
+
+    void setIsa(Isa isa)
+    {
+      Isa best = detectedIsa();
+      current_isa = isa < best ? isa : best;
+    }
+
+
+    const char* isaName(Isa isa)
+    {
+      switch (isa) {
+      case AVX2:   return "avx2";
+      case AVX512: return "avx512";
+      default:     return "generic";
+      }
+    }
+
+
+    bool parseIsa(const char* name, Isa& isa)
+    {
+      if (std::strcmp(name, "generic") == 0)
+	isa = Generic;
+      else if (std::strcmp(name, "avx2") == 0)
+	isa = AVX2;
+      else if (std::strcmp(name, "avx512") == 0)
+	isa = AVX512;
+      else
+	return false;
+      return true;
+    }
+
+  } // namespace AVX
+} // namespace QDP
@@ -0,0 +1,331 @@
+/*! @file
+ * @brief AVX2/AVX-512 double precision SU(3) kernels
+ *
+ * Matrix products are computed row by row: row i of A*B is the sum over
+ * k of the complex number A(i,k) times row k of B. With the real and
+ * imaginary parts of A(i,k) broadcast, that is one FMA into a real and
+ * one into an imaginary accumulator (the latter against the row with re
+ * and im swapped), and an addsub at the end. Adjoint operands are
+ * transposed into a temporary first, which costs 18 moves against 108
+ * multiplies.
+ */
+
+#include "scalarsite_avx/avx_linalg_su3_double.h"
+#include "scalarsite_avx/avx_blas_double.h"
+
+#if defined(QDP_AVX_HAVE_TARGET)
+#include <immintrin.h>
+#endif
+
+namespace QDP {
+  namespace AVX {
+
+    namespace {
+
+      // t = adj(m)
+      inline void adj3(double* t, const double* m)
+      {
+	for (int i = 0; i < 3; ++i)
+	  for (int j = 0; j < 3; ++j) {
+	    t[6*i + 2*j]     =  m[6*j + 2*i];
+	    t[6*i + 2*j + 1] = -m[6*j + 2*i + 1];
+	  }
+      }
+
+      //-------------------------------------------------------------------
+      // c = a*b, c must not alias a or b
+      void mm_generic(double* c, const double* a, const double* b)
+      {
+	for (int i = 0; i < 3; ++i)
+	  for (int j = 0; j < 3; ++j) {
+	    double re = 0.0, im = 0.0;
+	    for (int k = 0; k < 3; ++k) {
+	      double ar = a[6*i + 2*k], ai = a[6*i + 2*k + 1];
+	      double br = b[6*k + 2*j], bi = b[6*k + 2*j + 1];
+	      re += ar * br - ai * bi;
+	      im += ar * bi + ai * br;
+	    }
+	    c[6*i + 2*j]     = re;
+	    c[6*i + 2*j + 1] = im;
+	  }
+      }
+
+      // w[k] = m*v[k] for n_vec color vectors
+      void mv_generic(double* w, const double* m, const double* v, int n_vec)
+      {
+	for (int n = 0; n < n_vec; ++n, v += 6, w += 6)
+	  for (int i = 0; i < 3; ++i) {
+	    double re = 0.0, im = 0.0;
+	    for (int k = 0; k < 3; ++k) {
+	      double mr = m[6*i + 2*k], mi = m[6*i + 2*k + 1];
+	      re += mr * v[2*k] - mi * v[2*k + 1];
+	      im += mr * v[2*k + 1] + mi * v[2*k];
+	    }
+	    w[2*i]     = re;
+	    w[2*i + 1] = im;
+	  }
+      }
+
+
+#if defined(QDP_AVX_HAVE_TARGET)
+      //-------------------------------------------------------------------
+      // AVX2: a row of 3 complex numbers is a 256 bit register for the
+      // first two columns and a 128 bit one for the third
+      QDP_AVX2_TARGET
+      void mm_avx2(double* c, const double* a, const double* b)
+      {
+	__m256d b0 = _mm256_loadu_pd(b);
+	__m256d b1 = _mm256_loadu_pd(b + 6);
+	__m256d b2 = _mm256_loadu_pd(b + 12);
+	__m128d h0 = _mm_loadu_pd(b + 4);
+	__m128d h1 = _mm_loadu_pd(b + 10);
+	__m128d h2 = _mm_loadu_pd(b + 16);
+	__m256d s0 = _mm256_permute_pd(b0, 0x5);
+	__m256d s1 = _mm256_permute_pd(b1, 0x5);
+	__m256d s2 = _mm256_permute_pd(b2, 0x5);
+	__m128d t0 = _mm_permute_pd(h0, 0x1);
+	__m128d t1 = _mm_permute_pd(h1, 0x1);
+	__m128d t2 = _mm_permute_pd(h2, 0x1);
+
+	for (int i = 0; i < 3; ++i, a += 6, c += 6) {
+	  __m256d re = _mm256_mul_pd(_mm256_broadcast_sd(a), b0);
+	  __m256d im = _mm256_mul_pd(_mm256_broadcast_sd(a + 1), s0);
+	  __m128d rh = _mm_mul_pd(_mm_set1_pd(a[0]), h0);
+	  __m128d ih = _mm_mul_pd(_mm_set1_pd(a[1]), t0);
+
+	  re = _mm256_fmadd_pd(_mm256_broadcast_sd(a + 2), b1, re);
+	  im = _mm256_fmadd_pd(_mm256_broadcast_sd(a + 3), s1, im);
+	  rh = _mm_fmadd_pd(_mm_set1_pd(a[2]), h1, rh);
+	  ih = _mm_fmadd_pd(_mm_set1_pd(a[3]), t1, ih);
+
+	  re = _mm256_fmadd_pd(_mm256_broadcast_sd(a + 4), b2, re);
+	  im = _mm256_fmadd_pd(_mm256_broadcast_sd(a + 5), s2, im);
+	  rh = _mm_fmadd_pd(_mm_set1_pd(a[4]), h2, rh);
+	  ih = _mm_fmadd_pd(_mm_set1_pd(a[5]), t2, ih);
+
+	  _mm256_storeu_pd(c, _mm256_addsub_pd(re, im));
+	  _mm_storeu_pd(c + 4, _mm_addsub_pd(rh, ih));
+	}
+      }
+
+      // Same scheme with the columns of m, which are gathered once and
+      // reused for all vectors of the site
+      QDP_AVX2_TARGET
+      void mv_avx2(double* w, const double* m, const double* v, int n_vec)
+      {
+	__m256d c0 = _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(m)),     _mm_loadu_pd(m + 6), 1);
+	__m256d c1 = _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(m + 2)), _mm_loadu_pd(m + 8), 1);
+	__m256d c2 = _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(m + 4)), _mm_loadu_pd(m + 10), 1);
+	__m128d h0 = _mm_loadu_pd(m + 12);
+	__m128d h1 = _mm_loadu_pd(m + 14);
+	__m128d h2 = _mm_loadu_pd(m + 16);
+	__m256d s0 = _mm256_permute_pd(c0, 0x5);
+	__m256d s1 = _mm256_permute_pd(c1, 0x5);
+	__m256d s2 = _mm256_permute_pd(c2, 0x5);
+	__m128d t0 = _mm_permute_pd(h0, 0x1);
+	__m128d t1 = _mm_permute_pd(h1, 0x1);
+	__m128d t2 = _mm_permute_pd(h2, 0x1);
+
+	for (int n = 0; n < n_vec; ++n, v += 6, w += 6) {
+	  __m256d re = _mm256_mul_pd(_mm256_broadcast_sd(v), c0);
+	  __m256d im = _mm256_mul_pd(_mm256_broadcast_sd(v + 1), s0);
+	  __m128d rh = _mm_mul_pd(_mm_set1_pd(v[0]), h0);
+	  __m128d ih = _mm_mul_pd(_mm_set1_pd(v[1]), t0);
+
+	  re = _mm256_fmadd_pd(_mm256_broadcast_sd(v + 2), c1, re);
+	  im = _mm256_fmadd_pd(_mm256_broadcast_sd(v + 3), s1, im);
+	  rh = _mm_fmadd_pd(_mm_set1_pd(v[2]), h1, rh);
+	  ih = _mm_fmadd_pd(_mm_set1_pd(v[3]), t1, ih);
+
+	  re = _mm256_fmadd_pd(_mm256_broadcast_sd(v + 4), c2, re);
+	  im = _mm256_fmadd_pd(_mm256_broadcast_sd(v + 5), s2, im);
+	  rh = _mm_fmadd_pd(_mm_set1_pd(v[4]), h2, rh);
+	  ih = _mm_fmadd_pd(_mm_set1_pd(v[5]), t2, ih);
+
+	  _mm256_storeu_pd(w, _mm256_addsub_pd(re, im));
+	  _mm_storeu_pd(w + 4, _mm_addsub_pd(rh, ih));
+	}
+      }
+
+
+      //-------------------------------------------------------------------
+      // AVX-512: one row in the low 6 lanes of a register
+      QDP_AVX512_TARGET
+      void mm_avx512(double* c, const double* a, const double* b)
+      {
+	const __mmask8 row = 0x3F;
+	const __m512d one = _mm512_set1_pd(1.0);
+	__m512d b0 = _mm512_maskz_loadu_pd(row, b);
+	__m512d b1 = _mm512_maskz_loadu_pd(row, b + 6);
+	__m512d b2 = _mm512_maskz_loadu_pd(row, b + 12);
+	// Full zero mask, the unmasked permute trips -Wuninitialized in GCC's headers
+	__m512d s0 = _mm512_maskz_permute_pd((__mmask8)0xFF, b0, 0x55);
+	__m512d s1 = _mm512_maskz_permute_pd((__mmask8)0xFF, b1, 0x55);
+	__m512d s2 = _mm512_maskz_permute_pd((__mmask8)0xFF, b2, 0x55);
+
+	for (int i = 0; i < 3; ++i, a += 6, c += 6) {
+	  __m512d re = _mm512_mul_pd(_mm512_set1_pd(a[0]), b0);
+	  __m512d im = _mm512_mul_pd(_mm512_set1_pd(a[1]), s0);
+	  re = _mm512_fmadd_pd(_mm512_set1_pd(a[2]), b1, re);
+	  im = _mm512_fmadd_pd(_mm512_set1_pd(a[3]), s1, im);
+	  re = _mm512_fmadd_pd(_mm512_set1_pd(a[4]), b2, re);
+	  im = _mm512_fmadd_pd(_mm512_set1_pd(a[5]), s2, im);
+	  // even lanes re - im, odd lanes re + im
+	  _mm512_mask_storeu_pd(c, row, _mm512_fmaddsub_pd(one, re, im));
+	}
+      }
+#endif
+
+
+      //-------------------------------------------------------------------
+      void mm(double* c, const double* a, const double* b)
+      {
+#if defined(QDP_AVX_HAVE_TARGET)
+	switch (currentIsa()) {
+	case AVX512: mm_avx512(c, a, b); return;
+	case AVX2:   mm_avx2(c, a, b);   return;
+	default: break;
+	}
+#endif
+	mm_generic(c, a, b);
+      }
+
+      // A color vector fills less than one 512 bit register, so the
+      // AVX-512 level keeps the AVX2 code here
+      void mv(double* w, const double* m, const double* v, int n_vec)
+      {
+#if defined(QDP_AVX_HAVE_TARGET)
+	if (currentIsa() >= AVX2) {
+	  mv_avx2(w, m, v, n_vec);
+	  return;
+	}
+#endif
+	mv_generic(w, m, v, n_vec);
+      }
+
+      /* m3 = op(m1)*op(m2), or m3 += a op(m1)*op(m2) when a is given */
+      void mult(double* m3, const double* a, const double* m1, bool adj1,
+		const double* m2, bool adj2, int n_mat)
+      {
+	double t1[18], t2[18], t3[18];
+
+	for (int n = 0; n < n_mat; ++n, m1 += 18, m2 += 18, m3 += 18) {
+	  const double* l = m1;
+	  const double* r = m2;
+	  if (adj1) {
+	    adj3(t1, m1);
+	    l = t1;
+	  }
+	  if (adj2) {
+	    adj3(t2, m2);
+	    r = t2;
+	  }
+
+	  // Through a temporary, m3 may alias m1 or m2
+	  mm(t3, l, r);
+	  if (a)
+	    for (int i = 0; i < 18; ++i)
+	      m3[i] += *a * t3[i];
+	  else
+	    for (int i = 0; i < 18; ++i)
+	      m3[i] = t3[i];
+	}
+      }
+
+    } // anonymous namespace
+
+
+    void m_eq_scal_m(REAL64* m2, REAL64* a, REAL64* m1, int n_mat)
+    {
+      scal(m2, *a, m1, 18*n_mat);
+    }
+
+    void m_muleq_scal(REAL64* m, REAL64* a, int n_mat)
+    {
+      scal(m, *a, m, 18*n_mat);
+    }
+
+    void m_peq_m(REAL64* m2, REAL64* m1, int n_mat)
+    {
+      axpby(m2, 1.0, m1, 1.0, m2, 18*n_mat);
+    }
+
+    void m_meq_m(REAL64* m2, REAL64* m1, int n_mat)
+    {
+      axpby(m2, -1.0, m1, 1.0, m2, 18*n_mat);
+    }
+
+    void m_peq_h(REAL64* m2, REAL64* m1, int n_mat)
+    {
+      double t[18];
+      for (int n = 0; n < n_mat; ++n, m1 += 18, m2 += 18) {
+	adj3(t, m1);
+	for (int i = 0; i < 18; ++i)
+	  m2[i] += t[i];
+      }
+    }
+
+    void m_meq_h(REAL64* m2, REAL64* m1, int n_mat)
+    {
+      double t[18];
+      for (int n = 0; n < n_mat; ++n, m1 += 18, m2 += 18) {
+	adj3(t, m1);
+	for (int i = 0; i < 18; ++i)
+	  m2[i] -= t[i];
+      }
+    }
+
+    void m_eq_mm(REAL64* m3, REAL64* m1, REAL64* m2, int n_mat)
+    {
+      mult(m3, 0, m1, false, m2, false, n_mat);
+    }
+
+    void m_peq_amm(REAL64* m3, REAL64* a, REAL64* m1, REAL64* m2, int n_mat)
+    {
+      mult(m3, a, m1, false, m2, false, n_mat);
+    }
+
+    void m_eq_mh(REAL64* m3, REAL64* m1, REAL64* m2, int n_mat)
+    {
+      mult(m3, 0, m1, false, m2, true, n_mat);
+    }
+
+    void m_peq_amh(REAL64* m3, REAL64* a, REAL64* m1, REAL64* m2, int n_mat)
+    {
+      mult(m3, a, m1, false, m2, true, n_mat);
+    }
+
+    void m_eq_hm(REAL64* m3, REAL64* m1, REAL64* m2, int n_mat)
+    {
+      mult(m3, 0, m1, true, m2, false, n_mat);
+    }
+
+    void m_peq_ahm(REAL64* m3, REAL64* a, REAL64* m1, REAL64* m2, int n_mat)
+    {
+      mult(m3, a, m1, true, m2, false, n_mat);
+    }
+
+    void m_eq_hh(REAL64* m3, REAL64* m1, REAL64* m2, int n_mat)
+    {
+      mult(m3, 0, m1, true, m2, true, n_mat);
+    }
+
+    void m_peq_ahh(REAL64* m3, REAL64* a, REAL64* m1, REAL64* m2, int n_mat)
+    {
+      mult(m3, a, m1, true, m2, true, n_mat);
+    }
+
+    void mult_su3_mat_vec(REAL64* v2, const REAL64* m, const REAL64* v1, int n_vec)
+    {
+      mv(v2, m, v1, n_vec);
+    }
+
+    void mult_adj_su3_mat_vec(REAL64* v2, const REAL64* m, const REAL64* v1, int n_vec)
+    {
+      double t[18];
+      adj3(t, m);
+      mv(v2, t, v1, n_vec);
+    }
+
+  } // namespace AVX
+} // namespace QDP
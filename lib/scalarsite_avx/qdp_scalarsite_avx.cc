@@ -0,0 +1,207 @@
+// -*- C++ -*-
+
+/*! @file
+ * @brief AVX implementation of the SSE double precision entry points
+ *
+ * The AVX build keeps the double precision hooks of the SSE build and
+ * links these in place of the kernels in lib/scalarsite_sse, so the hooks
+ * pick up the AVX2/AVX-512 code without being duplicated.
+ */
+
+#include "scalarsite_sse/sse_blas_vaxpy4_double.h"
+#include "scalarsite_sse/sse_blas_vaypx4_double.h"
+#include "scalarsite_sse/sse_blas_vaxmyz4_double.h"
+#include "scalarsite_sse/sse_blas_vaxpbyz4_double.h"
+#include "scalarsite_sse/sse_blas_vaxmbyz4_double.h"
+#include "scalarsite_sse/sse_blas_vscal4_double.h"
+#include "scalarsite_sse/sse_blas_local_sumsq_double.h"
+#include "scalarsite_sse/sse_blas_local_vcdot_real_double.h"
+#include "scalarsite_sse/sse_blas_local_vcdot_double.h"
+#include "scalarsite_sse/sse_linalg_mm_su3_double.h"
+
+#include "scalarsite_avx/avx_blas_double.h"
+#include "scalarsite_avx/avx_linalg_su3_double.h"
+
+namespace QDP {
+
+  // BLAS1 on Dirac fermions
+  void vaxpy4(REAL64 *Out, REAL64 *scalep, REAL64 *InScale, int n_4vec)
+  {
+    AVX::vaxpy4(Out, scalep, InScale, n_4vec);
+  }
+
+  void vaxpyz4(REAL64 *Out, REAL64 *scalep, REAL64 *InScale, REAL64 *Add, int n_4vec)
+  {
+    AVX::vaxpyz4(Out, scalep, InScale, Add, n_4vec);
+  }
+
+  void vaxmy4(REAL64 *Out, REAL64 *scalep, REAL64 *InScale, int n_4vec)
+  {
+    AVX::vaxmy4(Out, scalep, InScale, n_4vec);
+  }
+
+  void vaxmyz4(REAL64 *Out, REAL64 *scalep, REAL64 *InScale, REAL64 *Sub, int n_4vec)
+  {
+    AVX::vaxmyz4(Out, scalep, InScale, Sub, n_4vec);
+  }
+
+  void vaypx4(REAL64 *Out, REAL64 *scalep, REAL64 *InScale, int n_4vec)
+  {
+    AVX::vaypx4(Out, scalep, InScale, n_4vec);
+  }
+
+  void vaxpby4(REAL64 *y, REAL64 *a, REAL64 *x, REAL64 *b, int n_4vec)
+  {
+    AVX::vaxpby4(y, a, x, b, n_4vec);
+  }
+
+  void vaxpbyz4(REAL64 *z, REAL64 *a, REAL64 *x, REAL64 *b, REAL64 *y, int n_4vec)
+  {
+    AVX::vaxpbyz4(z, a, x, b, y, n_4vec);
+  }
+
+  void vaxmby4(REAL64 *y, REAL64 *a, REAL64 *x, REAL64 *b, int n_4vec)
+  {
+    AVX::vaxmby4(y, a, x, b, n_4vec);
+  }
+
+  void vaxmbyz4(REAL64 *z, REAL64 *a, REAL64 *x, REAL64 *b, REAL64 *y, int n_4vec)
+  {
+    AVX::vaxmbyz4(z, a, x, b, y, n_4vec);
+  }
+
+  void vscal4(REAL64 *z, REAL64 *a, REAL64 *x, int n_4vec)
+  {
+    AVX::vscal4(z, a, x, n_4vec);
+  }
+
+  void local_sumsq4(REAL64 *sum, REAL64 *x, int n_4vec)
+  {
+    AVX::local_sumsq4(sum, x, n_4vec);
+  }
+
+  void local_vcdot4(REAL64 *sum, REAL64 *y, REAL64 *x, int n_4vec)
+  {
+    AVX::local_vcdot4(sum, y, x, n_4vec);
+  }
+
+  void local_vcdot_real4(REAL64 *sum, REAL64 *y, REAL64 *x, int n_4vec)
+  {
+    AVX::local_vcdot_real4(sum, y, x, n_4vec);
+  }
+
+
+  // SU(3) matrices
+  void ssed_m_eq_scal_m(REAL64* m2, REAL64* a, REAL64* m1, int n_mat)
+  {
+    AVX::m_eq_scal_m(m2, a, m1, n_mat);
+  }
+
+  void ssed_m_muleq_scal(REAL64* m, REAL64* a, int n_mat)
+  {
+    AVX::m_muleq_scal(m, a, n_mat);
+  }
+
+  void ssed_m_peq_m(REAL64* m2, REAL64* m1, int n_mat)
+  {
+    AVX::m_peq_m(m2, m1, n_mat);
+  }
+
+  void ssed_m_meq_m(REAL64* m2, REAL64* m1, int n_mat)
+  {
+    AVX::m_meq_m(m2, m1, n_mat);
+  }
+
+  void ssed_m_peq_h(REAL64* m2, REAL64* m1, int n_mat)
+  {
+    AVX::m_peq_h(m2, m1, n_mat);
+  }
+
+  void ssed_m_meq_h(REAL64* m2, REAL64* m1, int n_mat)
+  {
+    AVX::m_meq_h(m2, m1, n_mat);
+  }
+
+
+  // The AVX kernels need no alignment, the _u variants are the same
+  void ssed_m_eq_mm(REAL64* m3, REAL64* m1, REAL64* m2, int n_mat)
+  {
+    AVX::m_eq_mm(m3, m1, m2, n_mat);
+  }
+
+  void ssed_m_eq_mm_u(REAL64* m3, REAL64* m1, REAL64* m2, int n_mat)
+  {
+    AVX::m_eq_mm(m3, m1, m2, n_mat);
+  }
+
+  void ssed_m_peq_amm(REAL64* m3, REAL64* a, REAL64* m1, REAL64* m2, int n_mat)
+  {
+    AVX::m_peq_amm(m3, a, m1, m2, n_mat);
+  }
+
+  void ssed_m_peq_amm_u(REAL64* m3, REAL64* a, REAL64* m1, REAL64* m2, int n_mat)
+  {
+    AVX::m_peq_amm(m3, a, m1, m2, n_mat);
+  }
+
+  void ssed_m_eq_mh(REAL64* m3, REAL64* m1, REAL64* m2, int n_mat)
+  {
+    AVX::m_eq_mh(m3, m1, m2, n_mat);
+  }
+
+  void ssed_m_eq_mh_u(REAL64* m3, REAL64* m1, REAL64* m2, int n_mat)
+  {
+    AVX::m_eq_mh(m3, m1, m2, n_mat);
+  }
+
+  void ssed_m_peq_amh(REAL64* m3, REAL64* a, REAL64* m1, REAL64* m2, int n_mat)
+  {
+    AVX::m_peq_amh(m3, a, m1, m2, n_mat);
+  }
+
+  void ssed_m_peq_amh_u(REAL64* m3, REAL64* a, REAL64* m1, REAL64* m2, int n_mat)
+  {
+    AVX::m_peq_amh(m3, a, m1, m2, n_mat);
+  }
+
+  void ssed_m_eq_hm(REAL64* m3, REAL64* m1, REAL64* m2, int n_mat)
+  {
+    AVX::m_eq_hm(m3, m1, m2, n_mat);
+  }
+
+  void ssed_m_eq_hm_u(REAL64* m3, REAL64* m1, REAL64* m2, int n_mat)
+  {
+    AVX::m_eq_hm(m3, m1, m2, n_mat);
+  }
+
+  void ssed_m_peq_ahm(REAL64* m3, REAL64* a, REAL64* m1, REAL64* m2, int n_mat)
+  {
+    AVX::m_peq_ahm(m3, a, m1, m2, n_mat);
+  }
+
+  void ssed_m_peq_ahm_u(REAL64* m3, REAL64* a, REAL64* m1, REAL64* m2, int n_mat)
+  {
+    AVX::m_peq_ahm(m3, a, m1, m2, n_mat);
+  }
+
+  void ssed_m_eq_hh(REAL64* m3, REAL64* m1, REAL64* m2, int n_mat)
+  {
+    AVX::m_eq_hh(m3, m1, m2, n_mat);
+  }
+
+  void ssed_m_eq_hh_u(REAL64* m3, REAL64* m1, REAL64* m2, int n_mat)
+  {
+    AVX::m_eq_hh(m3, m1, m2, n_mat);
+  }
+
+  void ssed_m_peq_ahh(REAL64* m3, REAL64* a, REAL64* m1, REAL64* m2, int n_mat)
+  {
+    AVX::m_peq_ahh(m3, a, m1, m2, n_mat);
+  }
+
+  void ssed_m_peq_ahh_u(REAL64* m3, REAL64* a, REAL64* m1, REAL64* m2, int n_mat)
+  {
+    AVX::m_peq_ahh(m3, a, m1, m2, n_mat);
+  }
+
+} // namespace QDP
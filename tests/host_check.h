@@ -0,0 +1,44 @@
+// -*- C++ -*-
+//
+// Failure counting for the host-only tests: the ones that run without
+// QDP_initialize, QMP or a GPU. A test calls check() for every condition
+// and returns summary() from main, which prints "Summary: N failures" and
+// gives the exit code.
+
+#ifndef HOST_CHECK_H
+#define HOST_CHECK_H
+
+#include <iostream>
+#include <string>
+
+namespace HostCheck {
+
+  inline int& numFailed()
+  {
+    static int n = 0;
+    return n;
+  }
+
+  //! Count and report a failure
+  inline void fail(const std::string& what)
+  {
+    std::cout << "FAIL: " << what << std::endl;
+    numFailed()++;
+  }
+
+  inline void check(bool cond, const std::string& what)
+  {
+    if (!cond)
+      fail(what);
+  }
+
+  //! Print the summary line, returns the exit code of the test
+  inline int summary()
+  {
+    std::cout << "Summary: " << numFailed() << " failures" << std::endl;
+    return numFailed() ? 1 : 0;
+  }
+
+}
+
+#endif
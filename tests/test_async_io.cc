@@ -0,0 +1,155 @@
+// Checks of the asynchronous file stream buffer: files written in pieces
+// of random size, with seeks and overwrites, must equal a model kept in
+// memory, and reads with random seeks must return the model, for one,
+// two and three chunks with and without direct I/O. The chunks are made
+// small so that every path is taken many times. Needs neither QMP nor a
+// lattice.
+
+#include "qdp_async_io.h"
+#include "host_check.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <istream>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace QDP;
+using namespace HostCheck;
+
+namespace {
+  std::string tmpFile()
+  {
+    const char* dir = getenv("TMPDIR");
+    return std::string(dir ? dir : "/tmp") + "/test_async_io." + std::to_string(getpid());
+  }
+
+  std::vector<char> readAll(const std::string& path)
+  {
+    std::ifstream f(path.c_str(), std::ios::binary);
+    return std::vector<char>( std::istreambuf_iterator<char>(f) , std::istreambuf_iterator<char>() );
+  }
+
+  //! Write the model in random pieces, overwrite a few ranges after seeking back
+  void testWrite(const AsyncIOOptions& opt, const std::string& what)
+  {
+    const std::string path = tmpFile();
+    std::mt19937 rng(opt.buffers + 10 * opt.direct);
+    std::vector<char> model(5 * opt.chunk + 1234);
+    for (char& c : model)
+      c = rng();
+
+    AsyncFileBuf buf;
+    check( buf.open(path, std::ios_base::out, opt) , what + ": open" );
+    std::ostream f(&buf);
+
+    bool tell = true;
+    size_t pos = 0;
+    while (pos < model.size()) {
+      size_t n = std::min( model.size() - pos , (size_t)(rng() % (2 * opt.chunk)) );
+      if (rng() % 4 == 0)
+	n = std::min( n , (size_t)(rng() % 8) );   // small writes, as for headers
+      f.write( model.data() + pos , n );
+      pos += n;
+      tell = tell && (size_t)f.tellp() == pos;
+    }
+    check( tell , what + ": tellp" );
+
+    // Overwrite inside, then append at the end
+    for (int k = 0; k < 3; ++k) {
+      size_t at = rng() % model.size();
+      size_t n = std::min( model.size() - at , (size_t)(rng() % opt.chunk) );
+      for (size_t i = 0; i < n; ++i)
+	model[at + i] = rng();
+      f.seekp( at );
+      f.write( model.data() + at , n );
+    }
+    f.seekp( 0 , std::ios_base::end );
+    check( (size_t)f.tellp() == model.size() , what + ": seekp to the end" );
+    model.push_back( 'x' );
+    f.put( 'x' );
+
+    f.flush();
+    check( f.good() , what + ": stream good" );
+    check( buf.close() , what + ": close" );
+    check( readAll(path) == model , what + ": file contents" );
+
+    // Read back in pieces, then at random positions
+    AsyncFileBuf rbuf;
+    check( rbuf.open(path, std::ios_base::in, opt) , what + ": open for reading" );
+    std::istream g(&rbuf);
+
+    std::vector<char> got(model.size());
+    pos = 0;
+    while (pos < model.size()) {
+      size_t n = std::min( model.size() - pos , (size_t)(rng() % (2 * opt.chunk)) + 1 );
+      g.read( got.data() + pos , n );
+      pos += g.gcount();
+      if (!g)
+	break;
+    }
+    check( pos == model.size() && got == model , what + ": sequential read" );
+
+    char extra;
+    g.read( &extra , 1 );
+    check( g.eof() && g.gcount() == 0 , what + ": end of file" );
+    g.clear();
+
+    bool ok = true;
+    for (int k = 0; k < 50; ++k) {
+      size_t at = rng() % model.size();
+      size_t n = std::min( model.size() - at , (size_t)(rng() % (opt.chunk + 100)) );
+      if (k % 2)
+	g.seekg( at );
+      else
+	g.seekg( (long long)at - (long long)g.tellg() , std::ios_base::cur );
+      ok = ok && (size_t)g.tellg() == at;
+      std::vector<char> piece(n);
+      g.read( piece.data() , n );
+      ok = ok && (size_t)g.gcount() == n && std::equal( piece.begin() , piece.end() , model.begin() + at );
+    }
+    check( ok , what + ": random reads" );
+
+    g.seekg( -10 , std::ios_base::end );
+    ok = (size_t)g.tellg() == model.size() - 10;
+    char tail[10];
+    g.read( tail , 10 );
+    check( ok && std::equal( tail , tail + 10 , model.end() - 10 ) , what + ": seekg from the end" );
+
+    check( rbuf.close() , what + ": close after reading" );
+    remove( path.c_str() );
+  }
+}
+
+int main(int argc, char **argv)
+{
+  for (int buffers = 1; buffers <= 3; ++buffers)
+    for (bool direct : { false , true }) {
+      AsyncIOOptions opt;
+      opt.chunk = 3 * 4096;
+      opt.buffers = buffers;
+      opt.direct = direct;
+      testWrite( opt , std::to_string(buffers) + " buffers" + (direct ? ", direct" : "") );
+    }
+
+  // Chunks are rounded up to the alignment
+  {
+    AsyncIOOptions opt;
+    opt.chunk = 5000;
+    testWrite( opt , "unaligned chunk size" );
+  }
+
+  {
+    AsyncFileBuf buf;
+    check( !buf.open( "/nonexistent/dir/file" , std::ios_base::out ) && !buf.is_open() , "open failure" );
+    check( !buf.open( "/nonexistent/file" , std::ios_base::in ) , "open failure for reading" );
+  }
+
+  return summary();
+}
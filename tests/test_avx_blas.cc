@@ -0,0 +1,299 @@
+// Checks of the scalarsite AVX kernels on every instruction set the CPU
+// supports, against plain loops and against the generic gamma_5
+// kernels. Needs neither QDP_initialize nor a lattice.
+
+#include "qdp_precision.h"
+#include "scalarsite_avx/avx_dispatch.h"
+#include "scalarsite_avx/avx_blas_double.h"
+#include "scalarsite_avx/avx_linalg_su3_double.h"
+#include "scalarsite_avx/avx_blas_g5.h"
+
+#include "scalarsite_generic/generic_blas_vaxpy3_g5.h"
+#include "scalarsite_generic/generic_blas_vaypx3_g5.h"
+#include "scalarsite_generic/generic_blas_vadd3_g5.h"
+#include "scalarsite_generic/generic_blas_vscal_g5.h"
+#include "scalarsite_generic/generic_blas_vaxpby3_g5.h"
+#include "scalarsite_generic/generic_blas_g5.h"
+#include "host_check.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace QDP;
+using namespace HostCheck;
+
+namespace {
+  std::mt19937 rng(4321);
+
+  template<typename T>
+  std::vector<T> random(int n)
+  {
+    std::uniform_real_distribution<double> u(-1.0, 1.0);
+    std::vector<T> v(n);
+    for (int i = 0; i < n; ++i)
+      v[i] = u(rng);
+    return v;
+  }
+
+  template<typename T, typename U>
+  double maxdiff(const std::vector<T>& a, const std::vector<U>& b)
+  {
+    double m = 0.0;
+    for (size_t i = 0; i < a.size(); ++i)
+      m = std::max(m, std::fabs((double)a[i] - (double)b[i]));
+    return m;
+  }
+
+  // An odd count and a count that is no multiple of the vector length
+  const int n_4vec = 7;
+  const int n_mat  = 5;
+
+  void testBlas(const std::string& isa)
+  {
+    const int n = 24 * n_4vec;
+    std::vector<double> x = random<double>(n), y = random<double>(n);
+    double a = 0.75, b = -1.25;
+
+    std::vector<double> ref(n), out;
+
+    out = y;
+    AVX::vaxpy4(out.data(), &a, x.data(), n_4vec);
+    for (int i = 0; i < n; ++i) ref[i] = a * x[i] + y[i];
+    check(maxdiff(out, ref) < 1e-14, isa + " vaxpy4");
+
+    AVX::vaxmyz4(out.data(), &a, x.data(), y.data(), n_4vec);
+    for (int i = 0; i < n; ++i) ref[i] = a * x[i] - y[i];
+    check(maxdiff(out, ref) < 1e-14, isa + " vaxmyz4");
+
+    out = y;
+    AVX::vaypx4(out.data(), &a, x.data(), n_4vec);
+    for (int i = 0; i < n; ++i) ref[i] = x[i] + a * y[i];
+    check(maxdiff(out, ref) < 1e-14, isa + " vaypx4");
+
+    out = y;
+    AVX::vaxmby4(out.data(), &a, x.data(), &b, n_4vec);
+    for (int i = 0; i < n; ++i) ref[i] = a * x[i] - b * y[i];
+    check(maxdiff(out, ref) < 1e-14, isa + " vaxmby4");
+
+    AVX::vaxpbyz4(out.data(), &a, x.data(), &b, y.data(), n_4vec);
+    for (int i = 0; i < n; ++i) ref[i] = a * x[i] + b * y[i];
+    check(maxdiff(out, ref) < 1e-14, isa + " vaxpbyz4");
+
+    AVX::vscal4(out.data(), &a, x.data(), n_4vec);
+    for (int i = 0; i < n; ++i) ref[i] = a * x[i];
+    check(maxdiff(out, ref) < 1e-14, isa + " vscal4");
+
+    double s, c[2], sr = 0.0, cr = 0.0, ci = 0.0;
+    for (int i = 0; i < n; i += 2) {
+      sr += x[i] * x[i] + x[i+1] * x[i+1];
+      cr += y[i] * x[i] + y[i+1] * x[i+1];
+      ci += y[i] * x[i+1] - y[i+1] * x[i];
+    }
+    AVX::local_sumsq4(&s, x.data(), n_4vec);
+    check(std::fabs(s - sr) < 1e-12, isa + " local_sumsq4");
+    AVX::local_vcdot4(c, y.data(), x.data(), n_4vec);
+    check(std::fabs(c[0] - cr) < 1e-12 && std::fabs(c[1] - ci) < 1e-12, isa + " local_vcdot4");
+    AVX::local_vcdot_real4(&s, y.data(), x.data(), n_4vec);
+    check(std::fabs(s - cr) < 1e-12, isa + " local_vcdot_real4");
+  }
+
+
+  // m3 = op(m1)*op(m2) for 3x3 complex matrices
+  void refMult(double* m3, const double* m1, bool adj1, const double* m2, bool adj2)
+  {
+    for (int i = 0; i < 3; ++i)
+      for (int j = 0; j < 3; ++j) {
+	double re = 0.0, im = 0.0;
+	for (int k = 0; k < 3; ++k) {
+	  int l = adj1 ? 6*k + 2*i : 6*i + 2*k;
+	  int r = adj2 ? 6*j + 2*k : 6*k + 2*j;
+	  double lr = m1[l], li = adj1 ? -m1[l+1] : m1[l+1];
+	  double rr = m2[r], ri = adj2 ? -m2[r+1] : m2[r+1];
+	  re += lr * rr - li * ri;
+	  im += lr * ri + li * rr;
+	}
+	m3[6*i + 2*j]     = re;
+	m3[6*i + 2*j + 1] = im;
+      }
+  }
+
+  void testSU3(const std::string& isa)
+  {
+    const int n = 18 * n_mat;
+    std::vector<double> m1 = random<double>(n), m2 = random<double>(n), m3 = random<double>(n);
+    double a = 0.5;
+
+    typedef void (*Eq)(REAL64*, REAL64*, REAL64*, int);
+    typedef void (*Peq)(REAL64*, REAL64*, REAL64*, REAL64*, int);
+    const Eq   eq[]  = { AVX::m_eq_mm, AVX::m_eq_mh, AVX::m_eq_hm, AVX::m_eq_hh };
+    const Peq  peq[] = { AVX::m_peq_amm, AVX::m_peq_amh, AVX::m_peq_ahm, AVX::m_peq_ahh };
+    const char* name[] = { "mm", "mh", "hm", "hh" };
+
+    for (int f = 0; f < 4; ++f) {
+      bool adj1 = f >= 2, adj2 = f % 2;
+      std::vector<double> ref(n), acc(n), out(n);
+      for (int k = 0; k < n_mat; ++k) {
+	refMult(&ref[18*k], &m1[18*k], adj1, &m2[18*k], adj2);
+	for (int i = 0; i < 18; ++i)
+	  acc[18*k + i] = m3[18*k + i] + a * ref[18*k + i];
+      }
+
+      eq[f](out.data(), m1.data(), m2.data(), n_mat);
+      check(maxdiff(out, ref) < 1e-14, isa + " m_eq_" + name[f]);
+
+      out = m3;
+      peq[f](out.data(), &a, m1.data(), m2.data(), n_mat);
+      check(maxdiff(out, acc) < 1e-14, isa + " m_peq_a" + name[f]);
+    }
+
+    // In place, as in M = M*M
+    std::vector<double> ref(n), out = m1;
+    for (int k = 0; k < n_mat; ++k)
+      refMult(&ref[18*k], &m1[18*k], false, &m2[18*k], false);
+    AVX::m_eq_mm(out.data(), out.data(), m2.data(), n_mat);
+    check(maxdiff(out, ref) < 1e-14, isa + " m_eq_mm in place");
+
+    // M += adj(M1)
+    out = m3;
+    AVX::m_peq_h(out.data(), m1.data(), n_mat);
+    for (int k = 0; k < n_mat; ++k)
+      for (int i = 0; i < 3; ++i)
+	for (int j = 0; j < 3; ++j) {
+	  ref[18*k + 6*i + 2*j]     = m3[18*k + 6*i + 2*j]     + m1[18*k + 6*j + 2*i];
+	  ref[18*k + 6*i + 2*j + 1] = m3[18*k + 6*i + 2*j + 1] - m1[18*k + 6*j + 2*i + 1];
+	}
+    check(maxdiff(out, ref) < 1e-14, isa + " m_peq_h");
+
+    // Matrix times the four color vectors of a Dirac fermion
+    std::vector<double> v = random<double>(24), w(24), wref(24), unit(18, 0.0);
+    for (int i = 0; i < 3; ++i)
+      unit[8*i] = 1.0;
+    for (int adj = 0; adj < 2; ++adj) {
+      // v as the columns of a 3x4 matrix, padded with zeros to 3x3 blocks
+      for (int s = 0; s < 4; ++s)
+	for (int i = 0; i < 3; ++i) {
+	  double re = 0.0, im = 0.0;
+	  for (int k = 0; k < 3; ++k) {
+	    int l = adj ? 6*k + 2*i : 6*i + 2*k;
+	    double mr = m1[l], mi = adj ? -m1[l+1] : m1[l+1];
+	    re += mr * v[6*s + 2*k]     - mi * v[6*s + 2*k + 1];
+	    im += mr * v[6*s + 2*k + 1] + mi * v[6*s + 2*k];
+	  }
+	  wref[6*s + 2*i]     = re;
+	  wref[6*s + 2*i + 1] = im;
+	}
+      if (adj)
+	AVX::mult_adj_su3_mat_vec(w.data(), m1.data(), v.data(), 4);
+      else
+	AVX::mult_su3_mat_vec(w.data(), m1.data(), v.data(), 4);
+      check(maxdiff(w, wref) < 1e-14, isa + (adj ? " adj(M)*V" : " M*V"));
+    }
+
+    AVX::mult_su3_mat_vec(w.data(), unit.data(), v.data(), 4);
+    check(maxdiff(w, v) == 0.0, isa + " identity*V");
+  }
+
+
+  // Run one gamma_5 kernel in REAL against the generic one, and in the
+  // other precision against the same result
+  template<typename F>
+  void checkG5(const std::string& what, F f)
+  {
+    const int n = 24 * n_4vec;
+    std::vector<double> xd = random<double>(n), yd = random<double>(n);
+    std::vector<REAL> x(xd.begin(), xd.end()), y(yd.begin(), yd.end());
+    std::vector<REAL> ref(n), out(n);
+    std::vector<REAL32> xf(xd.begin(), xd.end()), yf(yd.begin(), yd.end()), outf(n);
+    std::vector<REAL64> xl(x.begin(), x.end()), yl(y.begin(), y.end()), outl(n);
+
+    f(ref.data(), x.data(), y.data(), true);
+    f(outf.data(), xf.data(), yf.data(), false);
+    f(outl.data(), xl.data(), yl.data(), false);
+
+    check(maxdiff(outf, ref) < 1e-5, what + " single");
+    check(maxdiff(outl, ref) < (sizeof(REAL) == 8 ? 1e-14 : 1e-5), what + " double");
+  }
+
+#define G5_CHECK3(fn)							\
+  checkG5(isa + " " #fn, [](auto* o, auto* x, auto* y, bool generic) {	\
+      typedef typename std::remove_pointer<decltype(o)>::type T;	\
+      T a = 0.75;							\
+      if (generic) fn((REAL*)o, (REAL*)x, (REAL*)y, n_4vec);		\
+      else AVX::fn(o, x, y, n_4vec);					\
+      (void)a; })
+#define G5_CHECK4(fn)							\
+  checkG5(isa + " " #fn, [](auto* o, auto* x, auto* y, bool generic) {	\
+      typedef typename std::remove_pointer<decltype(o)>::type T;	\
+      T a = 0.75;							\
+      if (generic) fn((REAL*)o, (REAL*)&a, (REAL*)x, (REAL*)y, n_4vec); \
+      else AVX::fn(o, &a, x, y, n_4vec); })
+#define G5_CHECK5(fn)							\
+  checkG5(isa + " " #fn, [](auto* o, auto* x, auto* y, bool generic) {	\
+      typedef typename std::remove_pointer<decltype(o)>::type T;	\
+      T a = 0.75, b = -1.25;						\
+      if (generic) fn((REAL*)o, (REAL*)&a, (REAL*)x, (REAL*)&b, (REAL*)y, n_4vec); \
+      else AVX::fn(o, &a, x, &b, y, n_4vec); })
+#define G5_CHECKS(fn)							\
+  checkG5(isa + " " #fn, [](auto* o, auto* x, auto* y, bool generic) {	\
+      typedef typename std::remove_pointer<decltype(o)>::type T;	\
+      T a = 0.75;							\
+      if (generic) fn((REAL*)o, (REAL*)&a, (REAL*)x, n_4vec);		\
+      else AVX::fn(o, &a, x, n_4vec); })
+
+  void testG5(const std::string& isa)
+  {
+    G5_CHECK4(axpyz_g5ProjPlus);
+    G5_CHECK4(axpyz_g5ProjMinus);
+    G5_CHECK4(axmyz_g5ProjPlus);
+    G5_CHECK4(axmyz_g5ProjMinus);
+    G5_CHECK4(xpayz_g5ProjPlus);
+    G5_CHECK4(xpayz_g5ProjMinus);
+    G5_CHECK4(xmayz_g5ProjPlus);
+    G5_CHECK4(xmayz_g5ProjMinus);
+    G5_CHECK3(add_g5ProjPlus);
+    G5_CHECK3(add_g5ProjMinus);
+    G5_CHECK3(sub_g5ProjPlus);
+    G5_CHECK3(sub_g5ProjMinus);
+    G5_CHECKS(scal_g5ProjPlus);
+    G5_CHECKS(scal_g5ProjMinus);
+    G5_CHECK5(axpbyz_g5ProjPlus);
+    G5_CHECK5(axpbyz_g5ProjMinus);
+    G5_CHECK5(axmbyz_g5ProjPlus);
+    G5_CHECK5(axmbyz_g5ProjMinus);
+    G5_CHECKS(scal_g5);
+    G5_CHECK5(axpbyz_g5);
+    G5_CHECK4(xmayz_g5);
+    G5_CHECK5(g5_axmbyz);
+    G5_CHECK5(axpbyz_ig5);
+    G5_CHECK5(axmbyz_ig5);
+    G5_CHECK4(xpayz_ig5);
+    G5_CHECK4(xmayz_ig5);
+
+    // The lattice hooks call these in place, as in y = y + a*P+ x
+    const int n = 24 * n_4vec;
+    std::vector<REAL> x = random<REAL>(n), y = random<REAL>(n), ref(n);
+    REAL a = 0.75;
+    xpayz_g5ProjPlus(ref.data(), &a, y.data(), x.data(), n_4vec);
+    AVX::xpayz_g5ProjPlus(y.data(), &a, y.data(), x.data(), n_4vec);
+    check(maxdiff(y, ref) < 1e-6, isa + " xpayz_g5ProjPlus in place");
+  }
+}
+
+int main(int argc, char **argv)
+{
+  AVX::Isa best = AVX::detectedIsa();
+  for (int i = AVX::Generic; i <= best; ++i) {
+    AVX::setIsa((AVX::Isa)i);
+    std::string isa = AVX::isaName(AVX::currentIsa());
+    check(AVX::currentIsa() == i, isa + " selected");
+
+    testBlas(isa);
+    testSU3(isa);
+    testG5(isa);
+  }
+
+  return summary();
+}
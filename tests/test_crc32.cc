@@ -0,0 +1,121 @@
+// Checks of the checksum and byte-swap routines: the sliced crc32 against
+// the bit-at-a-time definition at every alignment and length, crc32_combine,
+// the split over host worker threads, and the fused byte_swap_crc32 against
+// swapping and summing separately. Needs neither QMP nor a lattice.
+
+#include "qdp_byteorder.h"
+#include "qdp_host_threads.h"
+#include "host_check.h"
+
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace QDPUtil;
+using namespace HostCheck;
+
+namespace {
+  //! The definition: reflected polynomial 0xedb88320, one bit at a time
+  n_uint32_t reference(n_uint32_t crc, const unsigned char* buf, size_t len)
+  {
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i) {
+      crc ^= buf[i];
+      for (int k = 0; k < 8; ++k)
+	crc = crc & 1 ? (crc >> 1) ^ 0xedb88320u : crc >> 1;
+    }
+    return ~crc;
+  }
+
+  //! The former byte swap: reverse every word
+  void referenceSwap(unsigned char* p, size_t size, size_t nmemb)
+  {
+    for (size_t j = 0; j < nmemb; ++j)
+      for (size_t k = 0; k < size / 2; ++k)
+	std::swap( p[j*size + k] , p[j*size + size - 1 - k] );
+  }
+
+  std::vector<unsigned char> randomBytes(size_t n, unsigned seed)
+  {
+    std::mt19937 rng(seed);
+    std::vector<unsigned char> v(n);
+    for (auto& b : v)
+      b = rng();
+    return v;
+  }
+
+  void testSwap(size_t size, size_t nmemb, const std::string& what)
+  {
+    std::vector<unsigned char> src = randomBytes(size * nmemb + 1, size + nmemb);
+    const unsigned char* s = src.data() + 1;   // not aligned
+    std::vector<unsigned char> swapped(s, s + size * nmemb);
+    referenceSwap(swapped.data(), size, nmemb);
+
+    n_uint32_t crc0 = 0x1234567;
+
+    // Writing: the checksum of the swapped bytes
+    std::vector<unsigned char> dst(size * nmemb + 3);
+    n_uint32_t w = byte_swap_crc32(crc0, dst.data() + 3, s, size, nmemb, true);
+    check( !memcmp(dst.data() + 3, swapped.data(), size * nmemb) , what + ": swapped copy" );
+    check( w == reference(crc0, swapped.data(), size * nmemb) , what + ": checksum of the output" );
+
+    // Reading, in place: the checksum of the bytes before the swap
+    std::vector<unsigned char> inplace(s, s + size * nmemb);
+    n_uint32_t r = byte_swap_crc32(crc0, inplace.data(), inplace.data(), size, nmemb, false);
+    check( inplace == swapped , what + ": swapped in place" );
+    check( r == reference(crc0, s, size * nmemb) , what + ": checksum of the input" );
+
+    std::vector<unsigned char> again(s, s + size * nmemb);
+    byte_swap(again.data(), size, nmemb);
+    check( again == swapped , what + ": byte_swap" );
+  }
+}
+
+int main(int argc, char **argv)
+{
+  const char* check_string = "123456789";
+  check( crc32(0, check_string, 9) == 0xcbf43926u , "check value" );
+  check( crc32(0, (const char*)0, 0) == 0 , "null buffer" );
+
+  // Every length and alignment around the 16 byte steps
+  std::vector<unsigned char> data = randomBytes(1 << 12, 1);
+  bool ok = true;
+  for (size_t off = 0; off < 16; ++off)
+    for (size_t len = 0; len < 100; ++len)
+      ok = ok && crc32(0xdeadbeef, data.data() + off, len) == reference(0xdeadbeef, data.data() + off, len);
+  check( ok , "short buffers" );
+  check( crc32(7, data.data(), data.size()) == reference(7, data.data(), data.size()) , "4k buffer" );
+
+  // Pieces summed separately and combined
+  ok = true;
+  for (size_t cut : { 0 , 1 , 15 , 16 , 17 , 1000 , 4095 , 4096 }) {
+    n_uint32_t a = crc32(0, data.data(), cut);
+    n_uint32_t b = crc32(0, data.data() + cut, data.size() - cut);
+    ok = ok && crc32_combine(a, b, data.size() - cut) == crc32(0, data.data(), data.size());
+  }
+  check( ok , "combine" );
+
+  // A running checksum carries over the combine
+  {
+    n_uint32_t run = crc32(0, data.data(), 100);
+    n_uint32_t b = crc32(0, data.data() + 100, 900);
+    check( crc32_combine(run, b, 900) == crc32(run, data.data() + 100, 900) , "combine onto a running checksum" );
+  }
+
+  for (size_t size : { 1 , 2 , 4 , 8 , 16 })
+    for (size_t nmemb : { 0 , 1 , 3 , 1000 , 5000 })
+      testSwap(size, nmemb, "size " + std::to_string(size) + " x " + std::to_string(nmemb));
+
+  // Above crc32_parallel_bytes the work is split over the workers
+  QDP::hostThreadsSetCount(3);
+  {
+    std::vector<unsigned char> big = randomBytes(3 * crc32_parallel_bytes + 13, 2);
+    check( crc32(99, big.data(), big.size()) == reference(99, big.data(), big.size()) , "threaded crc32" );
+    testSwap(8, (3 * crc32_parallel_bytes + 8) / 8, "threaded, size 8");
+    testSwap(16, (2 * crc32_parallel_bytes) / 16 + 1, "threaded, size 16");
+  }
+
+  return summary();
+}
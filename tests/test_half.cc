@@ -0,0 +1,112 @@
+// Host-side checks of the 16-bit storage word conversions.
+// Needs neither QDP_initialize nor a GPU.
+
+#include "qdp_half.h"
+#include "host_check.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+using namespace QDP;
+using namespace HostCheck;
+
+namespace {
+  void check(bool cond, const char* what, float f, unsigned short got)
+  {
+    if (!cond) {
+      std::ostringstream os;
+      os << what << " f=" << f << " got=0x" << std::hex << got;
+      fail(os.str());
+    }
+  }
+
+  // Next representable binary16 value towards +inf (finite, non-NaN input)
+  unsigned short half_up(unsigned short h)
+  {
+    if (h == 0x8000) return 0x0001;
+    return (h & 0x8000) ? h - 1 : h + 1;
+  }
+
+  void testHalfRoundTrip()
+  {
+    for (unsigned int h = 0; h < 0x10000; ++h) {
+      if ( ((h >> 10) & 0x1f) == 0x1f && (h & 0x3ff) )
+	continue;  // NaN payloads are only kept up to quieting
+      float f = halfBitsToFloat(h);
+      for (int m = 0; m < 4; ++m) {
+	unsigned short b = floatToHalfBits(f, (HalfRounding)m);
+	check(b == h, "half round trip", f, b);
+      }
+    }
+  }
+
+  void testHalfKnownValues()
+  {
+    check(floatToHalfBits(1.0f, HalfRounding::rn) == 0x3c00, "1.0", 1.0f, floatToHalfBits(1.0f, HalfRounding::rn));
+    check(floatToHalfBits(-2.0f, HalfRounding::rn) == 0xc000, "-2.0", -2.0f, floatToHalfBits(-2.0f, HalfRounding::rn));
+    check(floatToHalfBits(65504.0f, HalfRounding::rn) == 0x7bff, "max", 65504.0f, floatToHalfBits(65504.0f, HalfRounding::rn));
+    check(floatToHalfBits(1e6f, HalfRounding::rn) == 0x7c00, "overflow rn", 1e6f, floatToHalfBits(1e6f, HalfRounding::rn));
+    check(floatToHalfBits(1e6f, HalfRounding::rz) == 0x7bff, "overflow rz", 1e6f, floatToHalfBits(1e6f, HalfRounding::rz));
+    check(floatToHalfBits(-1e6f, HalfRounding::rp) == 0xfbff, "overflow rp", -1e6f, floatToHalfBits(-1e6f, HalfRounding::rp));
+    check(floatToHalfBits(std::ldexp(1.0f,-24), HalfRounding::rn) == 0x0001, "min subnormal", std::ldexp(1.0f,-24), floatToHalfBits(std::ldexp(1.0f,-24), HalfRounding::rn));
+    check(floatToHalfBits(std::ldexp(1.0f,-25), HalfRounding::rn) == 0x0000, "tie to even zero", std::ldexp(1.0f,-25), floatToHalfBits(std::ldexp(1.0f,-25), HalfRounding::rn));
+    check(floatToHalfBits(std::ldexp(1.0f,-30), HalfRounding::rp) == 0x0001, "tiny rp", std::ldexp(1.0f,-30), floatToHalfBits(std::ldexp(1.0f,-30), HalfRounding::rp));
+    check(floatToHalfBits(1.0f + std::ldexp(1.0f,-11), HalfRounding::rn) == 0x3c00, "tie to even", 1.0f, floatToHalfBits(1.0f + std::ldexp(1.0f,-11), HalfRounding::rn));
+    check(floatToHalfBits(1.0f + 3*std::ldexp(1.0f,-11), HalfRounding::rn) == 0x3c02, "tie to even up", 1.0f, floatToHalfBits(1.0f + 3*std::ldexp(1.0f,-11), HalfRounding::rn));
+    check(std::isnan(halfBitsToFloat(floatToHalfBits(NAN, HalfRounding::rn))), "nan", NAN, floatToHalfBits(NAN, HalfRounding::rn));
+  }
+
+  // Random values: rz/rm/rp bracket the input, rn picks the nearer neighbour
+  void testHalfRounding()
+  {
+    std::srand(11);
+    for (int i = 0; i < 1000000; ++i) {
+      float f = std::ldexp( (float)std::rand() / RAND_MAX - 0.5f , std::rand() % 44 - 28 );
+      unsigned short dn = floatToHalfBits(f, HalfRounding::rm);
+      unsigned short up = floatToHalfBits(f, HalfRounding::rp);
+      unsigned short zz = floatToHalfBits(f, HalfRounding::rz);
+      unsigned short nn = floatToHalfBits(f, HalfRounding::rn);
+      float fdn = halfBitsToFloat(dn);
+      float fup = halfBitsToFloat(up);
+
+      check(fdn <= f && f <= fup, "rm <= f <= rp", f, dn);
+      check(dn == up || half_up(dn) == up, "rm/rp neighbours", f, up);
+      check(zz == (f < 0 ? up : dn), "rz", f, zz);
+      check(nn == dn || nn == up, "rn is a neighbour", f, nn);
+      check(std::fabs(halfBitsToFloat(nn) - f) <= std::fabs((nn == dn ? fup : fdn) - f), "rn nearest", f, nn);
+    }
+  }
+
+  void testBFloat16()
+  {
+    for (unsigned int b = 0; b < 0x10000; ++b) {
+      float f = bfloat16BitsToFloat(b);
+      if (std::isnan(f))
+	continue;
+      for (int m = 0; m < 4; ++m) {
+	unsigned short r = floatToBFloat16Bits(f, (HalfRounding)m);
+	check(r == b, "bf16 round trip", f, r);
+      }
+    }
+    check(floatToBFloat16Bits(1.0f, HalfRounding::rn) == 0x3f80, "bf16 1.0", 1.0f, floatToBFloat16Bits(1.0f, HalfRounding::rn));
+    check(floatToBFloat16Bits(1.00390625f, HalfRounding::rn) == 0x3f80, "bf16 tie to even", 1.00390625f, floatToBFloat16Bits(1.00390625f, HalfRounding::rn));
+    check(floatToBFloat16Bits(1.01171875f, HalfRounding::rn) == 0x3f82, "bf16 tie to even up", 1.01171875f, floatToBFloat16Bits(1.01171875f, HalfRounding::rn));
+    check(floatToBFloat16Bits(1.001f, HalfRounding::rp) == 0x3f81, "bf16 rp", 1.001f, floatToBFloat16Bits(1.001f, HalfRounding::rp));
+    check(floatToBFloat16Bits(-1.001f, HalfRounding::rm) == 0xbf81, "bf16 rm", -1.001f, floatToBFloat16Bits(-1.001f, HalfRounding::rm));
+    check(floatToBFloat16Bits(-1.001f, HalfRounding::rz) == 0xbf80, "bf16 rz", -1.001f, floatToBFloat16Bits(-1.001f, HalfRounding::rz));
+    check(std::isnan(bfloat16BitsToFloat(floatToBFloat16Bits(NAN, HalfRounding::rp))), "bf16 nan", NAN, floatToBFloat16Bits(NAN, HalfRounding::rp));
+  }
+}
+
+
+int main(int argc, char **argv)
+{
+  testHalfRoundTrip();
+  testHalfKnownValues();
+  testHalfRounding();
+  testBFloat16();
+
+  return summary();
+}
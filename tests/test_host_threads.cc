@@ -0,0 +1,167 @@
+// Checks of the host worker pool: coverage of the static partition and
+// of work stealing, exceptions, nested loops and page release. Needs
+// neither QDP_initialize nor a GPU.
+
+#include "qdp_host_threads.h"
+#include "host_check.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace QDP;
+using namespace HostCheck;
+
+namespace {
+  //! Every index visited once, with and without stealing
+  void testCoverage(int nw)
+  {
+    hostThreadsSetCount(nw);
+    const size_t sizes[] = { 0, 1, 7, 1000, 100003 };
+    for (size_t n: sizes)
+      for (int steal = 0; steal < 2; ++steal)
+	for (size_t grain: { 1, 16, 4096 }) {
+	  std::vector<std::atomic<int> > seen(n);
+	  for (auto& s: seen) s = 0;
+	  std::atomic<int> bad_worker(0);
+	  hostParallelFor(n, grain, steal, [&](size_t lo, size_t hi, int w) {
+	      if (w < 0 || w >= nw) bad_worker++;
+	      for (size_t i = lo; i < hi; ++i) seen[i]++;
+	    });
+	  bool once = true;
+	  for (auto& s: seen) once = once && s == 1;
+	  std::string what = std::to_string(nw) + " workers, n=" + std::to_string(n)
+	    + " grain=" + std::to_string(grain) + (steal ? " steal" : "");
+	  check(once, what + ": every index once");
+	  check(bad_worker == 0, what + ": worker index in range");
+	}
+
+    // Without stealing each worker gets exactly its static chunk
+    const size_t n = 1001;
+    std::vector<std::pair<size_t,size_t> > got(nw, std::make_pair(1, 0));
+    std::atomic<int> calls(0);
+    hostParallelFor(n, 1, false, [&](size_t lo, size_t hi, int w) {
+	got[w] = std::make_pair(lo, hi);
+	calls++;
+      });
+    bool exact = calls == nw;
+    for (int w = 0; w < nw; ++w)
+      exact = exact && got[w].first == hostPartitionBegin(n, w, nw)
+	&& got[w].second == hostPartitionBegin(n, w + 1, nw);
+    check(exact, std::to_string(nw) + " workers: static chunks");
+  }
+
+  //! Idle workers take pieces of a slow chunk
+  void testStealing()
+  {
+    const int nw = 4;
+    hostThreadsSetCount(nw);
+    const size_t n = 64;
+    std::vector<int> by(n, -1);
+    hostParallelFor(n, 1, true, [&](size_t lo, size_t hi, int w) {
+	for (size_t i = lo; i < hi; ++i) {
+	  if (i < hostPartitionBegin(n, 1, nw))
+	    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	  by[i] = w;
+	}
+      });
+    int stolen = 0;
+    for (size_t i = 0; i < hostPartitionBegin(n, 1, nw); ++i)
+      stolen += by[i] != 0;
+    check(by[0] == 0, "owner starts at the front of its chunk");
+    check(stolen > 0, "slow chunk is shared");
+  }
+
+  void testExceptionsAndNesting()
+  {
+    hostThreadsSetCount(3);
+    bool caught = false;
+    try {
+      hostParallelFor(100, 1, true, [&](size_t lo, size_t, int) {
+	  if (lo == 70) throw std::runtime_error("boom");
+	});
+    } catch (std::runtime_error& e) {
+      caught = std::string(e.what()) == "boom";
+    }
+    check(caught, "exception reaches the caller");
+
+    // The pool is still usable, and a loop inside a loop runs serially
+    std::atomic<int> inner(0);
+    hostParallelFor(6, 1, false, [&](size_t lo, size_t hi, int) {
+	for (size_t i = lo; i < hi; ++i)
+	  hostParallelFor(10, 1, true, [&](size_t a, size_t b, int w) {
+	      if (w == 0) inner += (int)(b - a);
+	    });
+      });
+    check(inner == 60, "nested loops");
+  }
+
+  void testMemory()
+  {
+    const size_t page = sysconf(_SC_PAGESIZE);
+    char* p = 0;
+    if (posix_memalign((void**)&p, page, 5 * page))
+      abort();
+    memset(p, 0x5a, 5 * page);
+
+    // Pages 1..3 lie inside the range, 0 and 4 only partly
+    hostReleasePages(p + 100, 4 * page - 50);
+    bool zero = true, kept = true;
+    for (size_t i = page; i < 4 * page; ++i) zero = zero && p[i] == 0;
+    for (size_t i = 0; i < page; ++i) kept = kept && p[i] == 0x5a;
+    for (size_t i = 4 * page; i < 5 * page; ++i) kept = kept && p[i] == 0x5a;
+    check(zero, "released pages read as zero");
+    check(kept, "partial pages keep their contents");
+    free(p);
+
+    hostThreadsSetCount(4);
+    const size_t n = (3 << 20) + 17;
+    std::vector<char> a(n), b(n, 0);
+    for (size_t i = 0; i < n; ++i) a[i] = (char)(i * 7);
+    hostParallelCopy(b.data(), a.data(), n);
+    check(a == b, "parallel copy");
+  }
+
+  void testSettings()
+  {
+    HostPinning p;
+    check(hostThreadsParsePinning("auto", p) && p == HostPinning::automatic, "parse auto");
+    check(!hostThreadsParsePinning("maybe", p), "reject unknown pinning");
+
+    hostThreadsSetPinning(HostPinning::off);
+    check(!hostThreadsPinned() && hostThreadsNode(0) == -1, "no node when not pinned");
+    hostThreadsSetPinning(HostPinning::on);
+    check(hostThreadsNode(0) >= 0 && hostThreadsNode(0) < hostNumaNodes(), "node of a pinned worker");
+
+    // Loops still run pinned, and after switching back
+    std::atomic<int> sum(0);
+    hostParallelFor(1000, 10, true, [&](size_t lo, size_t hi, int) { sum += (int)(hi - lo); });
+    hostThreadsSetPinning(HostPinning::automatic);
+    hostParallelFor(1000, 10, true, [&](size_t lo, size_t hi, int) { sum += (int)(hi - lo); });
+    check(sum == 2000, "pinned loops");
+
+    hostThreadsSetCount(0);
+    check(hostThreadsGetCount() >= 1, "default worker count");
+  }
+}
+
+int main(int argc, char **argv)
+{
+  for (int nw: { 1, 2, 3, 8 })
+    testCoverage(nw);
+  testStealing();
+  testExceptionsAndNesting();
+  testMemory();
+  testSettings();
+
+  std::cout << hostNumaNodes() << " NUMA nodes, " << hostThreadsGetCount() << " workers by default" << std::endl;
+  return summary();
+}
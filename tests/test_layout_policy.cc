@@ -0,0 +1,184 @@
+// Checks of the site orderings within a node: every policy must give a
+// permutation with a working inverse, the checkerboards must agree with
+// the formulas of the former compile-time layouts and keep the parities
+// in two halves, and tiles and the Morton curve must keep neighbourhoods
+// together. Needs neither QMP nor a lattice.
+
+#include "qdp_layout_policy.h"
+#include "host_check.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace QDP;
+using namespace HostCheck;
+
+namespace {
+  const int nd = 4;
+
+  int volume(const int l[])
+  {
+    return l[0] * l[1] * l[2] * l[3];
+  }
+
+  void lexCoords(int lex, const int l[], int x[])
+  {
+    for (int i = 0; i < nd; ++i) {
+      x[i] = lex % l[i];
+      lex /= l[i];
+    }
+  }
+
+  int lexSite(const int x[], const int l[])
+  {
+    return x[0] + l[0] * (x[1] + l[1] * (x[2] + l[2] * x[3]));
+  }
+
+  std::string str(const int sub[])
+  {
+    std::string s;
+    for (int i = 0; i < nd; ++i)
+      s += " " + std::to_string(sub[i]);
+    return s;
+  }
+
+  //! Tables of a policy are a permutation and its inverse for every class
+  void testTables(const std::string& name, const int sub[])
+  {
+    std::shared_ptr<LayoutPolicy> p = layoutPolicyMake(name);
+    check( p != nullptr , name + ": known" );
+    if (!p)
+      return;
+
+    LayoutTables t;
+    std::string err = t.make( *p , nd , sub );
+    check( err.empty() , name + str(sub) + ": " + err );
+    if (!err.empty())
+      return;
+
+    bool ok = true;
+    for (int cls = 0; cls < p->numClasses(); ++cls)
+      for (int lex = 0; lex < t.vol; ++lex) {
+	int x[nd], y[nd];
+	lexCoords( lex , sub , x );
+	int l = t.linear( cls , x );
+	t.coords( cls , l , y );
+	ok = ok && l >= 0 && l < t.vol && lexSite( y , sub ) == lex;
+      }
+    check( ok , name + str(sub) + ": coordinates survive the round trip" );
+  }
+
+  /*! The checkerboards on a global lattice L split into nodes of extent
+      sub: class from the node origin, then the local table, compared with
+      the linearSiteIndex of the compile-time layouts */
+  void testCheckerboard(bool cb3d, const int L[], const int sub[])
+  {
+    std::string name = cb3d ? "cb3d" : "cb2";
+    std::shared_ptr<LayoutPolicy> p = layoutPolicyMake(name);
+    LayoutTables t;
+    check( t.make( *p , nd , sub ).empty() , name + str(sub) + ": tables" );
+
+    int half = t.vol / 2;
+    int cb_sub[nd] = { sub[0] / 2 , sub[1] , sub[2] , sub[3] };
+    int cb_dirs = cb3d ? nd - 1 : nd;
+
+    bool ok = true, halves = true;
+    for (int g = 0; g < volume(L); ++g) {
+      int c[nd], x[nd], origin[nd], cb_c[nd];
+      lexCoords( g , L , c );
+      for (int i = 0; i < nd; ++i) {
+	x[i] = c[i] % sub[i];
+	origin[i] = c[i] - x[i];
+      }
+
+      int cb = 0;
+      for (int m = 0; m < cb_dirs; ++m)
+	cb += c[m];
+      cb &= 1;
+
+      cb_c[0] = (c[0] / 2) % cb_sub[0];
+      for (int i = 1; i < nd; ++i)
+	cb_c[i] = c[i] % cb_sub[i];
+
+      // CB3D ordered the half lattices with t fastest
+      int order = cb3d
+	? c[3] % sub[3] + cb_sub[3] * (cb_c[0] + cb_sub[0] * (cb_c[1] + cb_sub[1] * cb_c[2]))
+	: lexSite( cb_c , cb_sub );
+
+      int l = t.linear( p->nodeClass( nd , origin ) , x );
+      ok = ok && l == order + cb * half;
+      halves = halves && (l < half) == (cb == 0);
+    }
+    check( ok , name + str(sub) + ": same index as the compile-time layout" );
+    check( halves , name + str(sub) + ": parities in two halves" );
+  }
+}
+
+int main(int argc, char **argv)
+{
+  const int sub_a[nd] = { 4 , 4 , 4 , 8 };
+  const int sub_b[nd] = { 2 , 6 , 4 , 4 };
+  const int sub_c[nd] = { 3 , 5 , 2 , 7 };
+
+  for (const char* name : { "lexico" , "cb2" , "cb3d" , "tiled" , "tiled:2" , "tiled:3" , "morton" }) {
+    testTables( name , sub_a );
+    testTables( name , sub_b );
+  }
+  for (const char* name : { "lexico" , "tiled" , "tiled:3" , "morton" })
+    testTables( name , sub_c );
+
+  // Checkerboards need an even extent in the first direction
+  {
+    LayoutTables t;
+    check( !t.make( *layoutPolicyMake("cb2") , nd , sub_c ).empty() , "cb2 on an odd subgrid is refused" );
+  }
+
+  // Several nodes, some with an odd origin
+  {
+    const int L[nd] = { 8 , 12 , 4 , 8 };
+    const int sub1[nd] = { 4 , 6 , 4 , 4 };
+    const int sub2[nd] = { 2 , 3 , 4 , 8 };
+    testCheckerboard( false , L , sub1 );
+    testCheckerboard( false , L , sub2 );
+    testCheckerboard( true , L , sub1 );
+    testCheckerboard( true , L , sub2 );
+  }
+
+  // Tiles are contiguous: the first tile of 4^4 holds the sites with x < 4
+  {
+    const int sub[nd] = { 8 , 8 , 4 , 8 };
+    LayoutTables t;
+    t.make( *layoutPolicyMake("tiled") , nd , sub );
+    bool ok = true;
+    for (int l = 0; l < 256; ++l) {
+      int x[nd];
+      t.coords( 0 , l , x );
+      ok = ok && x[0] < 4 && x[1] < 4 && x[2] < 4 && x[3] < 4;
+    }
+    check( ok , "tiled: first tile" );
+  }
+
+  // On a power of two subgrid the Morton index is the interleaved bits
+  {
+    const int sub[nd] = { 4 , 4 , 4 , 4 };
+    LayoutTables t;
+    t.make( *layoutPolicyMake("morton") , nd , sub );
+    bool ok = true;
+    for (int lex = 0; lex < t.vol; ++lex) {
+      int x[nd];
+      lexCoords( lex , sub , x );
+      int code = 0;
+      for (int k = 0; k < 2; ++k)
+	for (int i = 0; i < nd; ++i)
+	  code |= ((x[i] >> k) & 1) << (k * nd + i);
+      ok = ok && t.linear( 0 , x ) == code;
+    }
+    check( ok , "morton: interleaved bits" );
+  }
+
+  check( !layoutPolicyMake("cb32") && !layoutPolicyMake("tiled:0") && !layoutPolicyMake("") , "unknown names" );
+  check( layoutPolicyMake("tiled:2")->name() == "tiled:2" && layoutPolicyMake("tiled")->name() == "tiled:4" , "names" );
+
+  return summary();
+}
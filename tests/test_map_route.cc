@@ -0,0 +1,194 @@
+// Checks of the communication tables of general maps: several nodes are
+// simulated in one process, every node gathers its send buffer, the
+// segments are delivered like the messages would be, and the result of
+// the map is compared with the permutation. Needs neither QMP nor a GPU.
+
+#include "qdp_map_route.h"
+#include "qdp_host_threads.h"
+#include "host_check.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace QDP;
+using namespace HostCheck;
+
+namespace {
+  //! A global permutation of nodes*sites sites, global site g = node*sites + linear
+  struct Perm
+  {
+    int nodes, sites;
+    std::vector<int> src;   // src[g]: global source site of g
+    std::vector<int> dst;   // inverse of src
+
+    Perm(int nodes_, int sites_, const std::vector<int>& src_)
+      : nodes(nodes_), sites(sites_), src(src_), dst(src_.size())
+    {
+      for (size_t g = 0; g < src.size(); ++g)
+	dst[ src[g] ] = g;
+    }
+
+    MapSite site(int g) const { return MapSite{ g / sites , g % sites }; }
+
+    MapSiteFunc func(int node) const
+    {
+      return [this,node](int linear, int sign) {
+	int g = node * sites + linear;
+	return site( sign > 0 ? src[g] : dst[g] );
+      };
+    }
+  };
+
+  //! Build every node's route, exchange and compare
+  void testPerm(const Perm& p, const std::string& what, bool threads = false)
+  {
+    std::vector<MapRoute> route(p.nodes);
+    for (int n = 0; n < p.nodes; ++n) {
+      std::string err = mapRouteMake( route[n] , n , p.sites , p.func(n) , threads );
+      check( err.empty() , what + ": route of node " + std::to_string(n) + " " + err );
+      if (!err.empty())
+	return;
+    }
+
+    // The value of a site is its global index
+    std::vector< std::vector<int> > send(p.nodes), recv(p.nodes);
+    for (int n = 0; n < p.nodes; ++n) {
+      for (int s: route[n].soffsets)
+	send[n].push_back( n * p.sites + s );
+      recv[n].assign( route[n].roffsets.size() , -1 );
+    }
+
+    // Deliver: sender's segment for d is d's segment for the sender
+    bool sizes = true;
+    for (int n = 0; n < p.nodes; ++n)
+      for (size_t k = 0; k < route[n].destnodes.size(); ++k) {
+	int d = route[n].destnodes[k];
+	const MapRoute& rd = route[d];
+	auto it = std::lower_bound( rd.srcenodes.begin() , rd.srcenodes.end() , n );
+	if (it == rd.srcenodes.end() || *it != n) { sizes = false; continue; }
+	size_t j = it - rd.srcenodes.begin();
+	if (rd.srcenodes_num[j] != route[n].destnodes_num[k]) { sizes = false; continue; }
+	std::copy( send[n].begin() + route[n].destnodes_off[k] ,
+		   send[n].begin() + route[n].destnodes_off[k] + route[n].destnodes_num[k] ,
+		   recv[d].begin() + rd.srcenodes_off[j] );
+      }
+    check( sizes , what + ": segment sizes agree" );
+
+    bool ok = true;
+    for (int n = 0; n < p.nodes; ++n)
+      for (int linear = 0; linear < p.sites; ++linear) {
+	int g = route[n].goffsets[linear];
+	int v = g >= 0 ? n * p.sites + g : recv[n][ -g - 1 ];
+	ok = ok && v == p.src[ n * p.sites + linear ];
+      }
+    check( ok , what + ": every site gets its source" );
+
+    for (int n = 0; n < p.nodes; ++n) {
+      const MapRoute& r = route[n];
+      check( r.offnode() == !r.destnodes.empty() , what + ": offnode" );
+      check( std::is_sorted( r.roffsets.begin() , r.roffsets.end() ) , what + ": roffsets ascending" );
+      int in  = std::accumulate( r.srcenodes_num.begin() , r.srcenodes_num.end() , 0 );
+      int out = std::accumulate( r.destnodes_num.begin() , r.destnodes_num.end() , 0 );
+      check( in == (int)r.roffsets.size() && out == (int)r.soffsets.size() , what + ": buffer sizes" );
+    }
+  }
+
+  //! Lattice of L[0] x L[1] sites split into N[0] x N[1] nodes, lexicographic everywhere
+  struct Grid
+  {
+    int L[2], N[2];
+    int sub(int d) const { return L[d] / N[d]; }
+    int sites() const { return sub(0) * sub(1); }
+    int nodes() const { return N[0] * N[1]; }
+    int global(int x, int y) const {
+      int node = (x / sub(0)) + N[0] * (y / sub(1));
+      int linear = (x % sub(0)) + sub(0) * (y % sub(1));
+      return node * sites() + linear;
+    }
+    template<class F> std::vector<int> perm(F f) const {
+      std::vector<int> src( nodes() * sites() );
+      for (int y = 0; y < L[1]; ++y)
+	for (int x = 0; x < L[0]; ++x) {
+	  int sx, sy;
+	  f( x , y , sx , sy );
+	  src[ global(x,y) ] = global(sx,sy);
+	}
+      return src;
+    }
+  };
+}
+
+int main(int argc, char **argv)
+{
+  const Grid g1 = { { 16 , 1 } , { 4 , 1 } };
+  const Grid g2 = { { 8 , 8 } , { 2 , 2 } };
+  const Grid g3 = { { 12 , 12 } , { 3 , 2 } };
+
+  // Nearest neighbour shift: one peer each way, as before
+  testPerm( Perm( g1.nodes() , g1.sites() , g1.perm( [&](int x, int y, int& sx, int& sy) {
+	  sx = (x + 1) % g1.L[0]; sy = y; } ) ) , "shift 1d" );
+
+  // Reflection: the partner node is both source and destination
+  testPerm( Perm( g1.nodes() , g1.sites() , g1.perm( [&](int x, int y, int& sx, int& sy) {
+	  sx = g1.L[0] - 1 - x; sy = y; } ) ) , "reflection 1d" );
+
+  // Twisted boundary: sites near the edge come from a shifted row on another node
+  testPerm( Perm( g2.nodes() , g2.sites() , g2.perm( [&](int x, int y, int& sx, int& sy) {
+	  sx = (x + 1) % g2.L[0]; sy = x + 1 == g2.L[0] ? (y + 3) % g2.L[1] : y; } ) ) , "twisted 2d" );
+
+  // Transpose on a square lattice and on a non-square node grid
+  testPerm( Perm( g2.nodes() , g2.sites() , g2.perm( [&](int x, int y, int& sx, int& sy) {
+	  sx = y; sy = x; } ) ) , "transpose 2x2" );
+  testPerm( Perm( g3.nodes() , g3.sites() , g3.perm( [&](int x, int y, int& sx, int& sy) {
+	  sx = y; sy = x; } ) ) , "transpose 3x2" );
+
+  // A random permutation talks to every node
+  for (int seed = 1; seed <= 3; ++seed) {
+    std::vector<int> src( g3.nodes() * g3.sites() );
+    std::iota( src.begin() , src.end() , 0 );
+    std::mt19937 rng(seed);
+    std::shuffle( src.begin() , src.end() , rng );
+    testPerm( Perm( g3.nodes() , g3.sites() , src ) , "random " + std::to_string(seed) );
+  }
+
+  // The same tables when the map is evaluated on worker threads
+  {
+    hostThreadsSetCount(3);
+    const Grid g4 = { { 64 , 48 } , { 4 , 3 } };
+    std::vector<int> src( g4.nodes() * g4.sites() );
+    std::iota( src.begin() , src.end() , 0 );
+    std::mt19937 rng(7);
+    std::shuffle( src.begin() , src.end() , rng );
+    Perm p( g4.nodes() , g4.sites() , src );
+    testPerm( p , "random, threads" , true );
+
+    MapRoute a, b;
+    mapRouteMake( a , 5 , p.sites , p.func(5) );
+    mapRouteMake( b , 5 , p.sites , p.func(5) , true );
+    check( a.goffsets == b.goffsets && a.soffsets == b.soffsets && a.srcenodes == b.srcenodes ,
+	   "threads give the same route" );
+  }
+
+  // The identity needs no communication
+  {
+    std::vector<int> src( g2.nodes() * g2.sites() );
+    std::iota( src.begin() , src.end() , 0 );
+    Perm p( g2.nodes() , g2.sites() , src );
+    MapRoute r;
+    check( mapRouteMake( r , 1 , p.sites , p.func(1) ).empty() && !r.offnode() , "identity" );
+  }
+
+  // Directions that disagree are caught
+  {
+    MapRoute r;
+    MapSiteFunc bad = [](int linear, int sign) { return MapSite{ 0 , sign > 0 ? linear : (linear + 1) % 4 }; };
+    check( !mapRouteMake( r , 0 , 4 , bad ).empty() , "inconsistent inverse" );
+  }
+
+  return summary();
+}
@@ -0,0 +1,172 @@
+// Checks of the Philox4x32-10 generator behind -rng philox: the known
+// answers of Random123, the word order of Philox::Stream, the range of the
+// uniforms, and the statistics of the numbers the lattice generator uses:
+// mean, variance, a chi-square test of the distribution, and correlations
+// between neighbouring sites, words and calls. Needs neither QMP nor a
+// lattice.
+
+#include "qdp_philox.h"
+#include "host_check.h"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace QDP;
+using namespace HostCheck;
+
+namespace {
+  bool equal(const uint32_t a[4], const uint32_t b[4])
+  {
+    return a[0] == b[0] && a[1] == b[1] && a[2] == b[2] && a[3] == b[3];
+  }
+
+  //! The key of a seed, as RNG::philoxKey packs the 47 bits
+  void key(uint64_t seed, uint32_t k[2])
+  {
+    k[0] = (uint32_t)seed;
+    k[1] = (uint32_t)(seed >> 32);
+  }
+
+  //! Mean, variance and chi-square of one uniform per (site, word, call)
+  struct Moments {
+    static const int bins = 100;
+    double n = 0, sum = 0, sum2 = 0;
+    std::vector<double> hist = std::vector<double>(bins, 0.0);
+
+    void add(double u) {
+      n += 1;
+      sum += u;
+      sum2 += u * u;
+      hist[std::min((int)(u * bins), bins - 1)] += 1;
+    }
+    double mean() const { return sum / n; }
+    double var() const { return sum2 / n - mean() * mean(); }
+    double chi2() const {
+      double e = n / bins, c = 0;
+      for (double h : hist)
+	c += (h - e) * (h - e) / e;
+      return c;
+    }
+  };
+
+  //! Correlation of pairs (a[i], b[i])
+  double correlation(const std::vector<double>& a, const std::vector<double>& b)
+  {
+    double n = a.size(), ma = 0, mb = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+      ma += a[i];
+      mb += b[i];
+    }
+    ma /= n;
+    mb /= n;
+    double sab = 0, saa = 0, sbb = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+      sab += (a[i] - ma) * (b[i] - mb);
+      saa += (a[i] - ma) * (a[i] - ma);
+      sbb += (b[i] - mb) * (b[i] - mb);
+    }
+    return sab / std::sqrt(saa * sbb);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  // Known answers of Random123 (kat_vectors, philox4x32 with 10 rounds)
+  {
+    uint32_t ctr[4] = { 0, 0, 0, 0 }, k[2] = { 0, 0 };
+    const uint32_t want[4] = { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 };
+    Philox::philox4x32_10(ctr, k);
+    check(equal(ctr, want), "known answer, zero");
+  }
+  {
+    uint32_t ctr[4] = { ~0u, ~0u, ~0u, ~0u }, k[2] = { ~0u, ~0u };
+    const uint32_t want[4] = { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd };
+    Philox::philox4x32_10(ctr, k);
+    check(equal(ctr, want), "known answer, all ones");
+  }
+  {
+    uint32_t ctr[4] = { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 }, k[2] = { 0xa4093822, 0x299f31d0 };
+    const uint32_t want[4] = { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 };
+    Philox::philox4x32_10(ctr, k);
+    check(equal(ctr, want), "known answer, pi");
+  }
+
+  // The stream hands out the blocks (site, 0, call), (site, 1, call), ...
+  // word by word, with the 64 bit site in the first two counter words
+  {
+    uint32_t k[2];
+    key(11, k);
+    const uint64_t site = (5ull << 32) | 1234;
+    Philox::Stream s(k, site, 7);
+    bool ok = true;
+    for (uint32_t b = 0; b < 5; ++b) {
+      uint32_t ctr[4] = { 1234, 5, b, 7 };
+      Philox::philox4x32_10(ctr, k);
+      for (int w = 0; w < 4; ++w)
+	ok = ok && s.next() == ctr[w];
+    }
+    check(ok, "stream word order");
+
+    Philox::Stream wide(k, site, 7), low(k, (uint32_t)site, 7);
+    check(wide.next() != low.next(), "sites beyond 2^32 have their own stream");
+  }
+
+  // Uniforms lie in (0,1), are symmetric and exact at the ends; doubles
+  // have the full 53 bits
+  {
+    check(Philox::uniformFloat(0) == 1.0f / 16777216.0f, "float at 0");
+    check(Philox::uniformFloat(~0u) == 1.0f - 1.0f / 16777216.0f, "float at 2^32-1");
+    check(Philox::uniformDouble(0, 0) == std::ldexp(1.0, -53), "double at 0");
+    check(Philox::uniformDouble(~0u, ~0u) == 1.0 - std::ldexp(1.0, -53), "double at 2^64-1");
+    check(Philox::uniformDouble(0, 2u << 5) == 3 * std::ldexp(1.0, -53), "double low word");
+    check(Philox::uniformDouble(1u << 6, 0) == std::ldexp(1.0, -26) + std::ldexp(1.0, -53), "double high word");
+    bool sym = true;
+    for (uint32_t x = 0; x < 1u << 20; x += 97)
+      sym = sym && Philox::uniformFloat(x) + Philox::uniformFloat(~x) == 1.0f
+	&& Philox::uniformDouble(x, x * 2654435761u) + Philox::uniformDouble(~x, ~(x * 2654435761u)) == 1.0;
+    check(sym, "uniforms symmetric about 1/2");
+  }
+
+  // Statistics over sites, the 18 words of a color matrix and calls
+  const int sites = 1 << 16, words = 18, calls = 4;
+  Moments m;
+  std::vector<double> u0, u_site, u_word, u_call;
+  uint32_t k[2];
+  key(11, k);
+  for (int c = 0; c < calls; ++c) {
+    for (int s = 0; s < sites; ++s) {
+      Philox::Stream st(k, s, c), next_site(k, s + 1, c), next_call(k, s, c + 1);
+      double first = 0;
+      for (int w = 0; w < words; ++w) {
+	double u = Philox::uniformFloat(st.next());
+	m.add(u);
+	if (w == 0)
+	  first = u;
+	if (w == 1)
+	  u_word.push_back(u);
+      }
+      u0.push_back(first);
+      u_site.push_back(Philox::uniformFloat(next_site.next()));
+      u_call.push_back(Philox::uniformFloat(next_call.next()));
+    }
+  }
+
+  // For 4.7M numbers the standard errors are 1.3e-4 (mean) and 1.1e-4
+  // (variance); chi-square with 99 degrees of freedom has sigma 14.
+  const double tol_corr = 5.0 / std::sqrt((double)u0.size());
+  printf("mean %.6f  variance %.6f  chi2 %.1f / %d\n", m.mean(), m.var(), m.chi2(), Moments::bins - 1);
+  printf("correlation: next site %.5f  next word %.5f  next call %.5f  (tolerance %.5f)\n",
+	 correlation(u0, u_site), correlation(u0, u_word), correlation(u0, u_call), tol_corr);
+
+  check(std::fabs(m.mean() - 0.5) < 7e-4, "mean");
+  check(std::fabs(m.var() - 1.0 / 12.0) < 6e-4, "variance");
+  check(m.chi2() < 99 + 5 * 14, "chi-square");
+  check(std::fabs(correlation(u0, u_site)) < tol_corr, "correlation of neighbouring sites");
+  check(std::fabs(correlation(u0, u_word)) < tol_corr, "correlation of neighbouring words");
+  check(std::fabs(correlation(u0, u_call)) < tol_corr, "correlation of successive calls");
+
+  return summary();
+}
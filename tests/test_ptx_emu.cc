@@ -0,0 +1,349 @@
+// Checks of the host PTX emulator on handwritten kernels in the style
+// the JIT emits. Needs neither QDP_initialize nor a GPU.
+
+#include "qdp_ptx_emu.h"
+#include "host_check.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace QDP;
+using namespace HostCheck;
+
+namespace {
+  const char* header =
+    ".version 6.4\n"
+    ".target sm_61\n"
+    ".address_size 64\n";
+
+  CUfunction load(const std::string& body)
+  {
+    std::string ptx = std::string(header) + body;
+    CUmodule mod;
+    if (cuModuleLoadDataEx(&mod, ptx.c_str(), 0, NULL, NULL) != CUDA_SUCCESS) {
+      fail(std::string("load ") + ptxEmuLastError());
+      return NULL;
+    }
+    CUfunction f;
+    cuModuleGetFunction(&f, mod, "function");
+    return f;
+  }
+
+  template<class T>
+  CUdeviceptr device(const std::vector<T>& h)
+  {
+    CUdeviceptr d;
+    cuMemAlloc(&d, h.size() * sizeof(T));
+    cuMemcpyHtoD(d, h.data(), h.size() * sizeof(T));
+    return d;
+  }
+
+  template<class T>
+  std::vector<T> host(CUdeviceptr d, size_t n)
+  {
+    std::vector<T> h(n);
+    cuMemcpyDtoH(h.data(), d, n * sizeof(T));
+    return h;
+  }
+
+
+  // y[i] = a * x[i] + y[i] for i < n, with the bounds check the JIT writes
+  const char* axpy =
+    ".entry function (.param .s32 param0,.param .f32 param1,.param .u64 param2,.param .u64 param3)\n"
+    "{\n"
+    ".reg .f32 f<5>;\n"
+    ".reg .u32 u<4>;\n"
+    ".reg .s32 i<3>;\n"
+    ".reg .u64 l<6>;\n"
+    ".reg .pred p<1>;\n"
+    "ld.param.s32 i0,[param0];\n"
+    "ld.param.f32 f0,[param1];\n"
+    "ld.param.u64 l0,[param2];\n"
+    "ld.param.u64 l1,[param3];\n"
+    "mov.u32 u0,%ctaid.x;\n"
+    "mov.u32 u1,%ntid.x;\n"
+    "mov.u32 u2,%tid.x;\n"
+    "mul.lo.u32 u3,u0,u1;\n"
+    "add.u32 u3,u3,u2;\n"
+    "mov.b32 i1,u3;\n"
+    "setp.ge.s32 p0,i1,i0;\n"
+    "@p0 exit;\n"
+    "mul.wide.s32 l2,i1,4;\n"
+    "add.u64 l3,l0,l2;\n"
+    "add.u64 l4,l1,l2;\n"
+    "ld.global.f32 f1,[l3+0];\n"
+    "ld.global.f32 f2,[l4+0];\n"
+    "fma.rn.f32 f3,f0,f1,f2;\n"
+    "st.global.f32 [l4+0],f3;\n"
+    "exit;\n"
+    "}\n";
+
+  void testAxpy()
+  {
+    CUfunction f = load(axpy);
+    if (!f) return;
+
+    const int n = 1000;
+    std::vector<float> x(n), y(n + 24);
+    for (int i = 0; i < n; ++i) { x[i] = i; y[i] = 2 * i; }
+    CUdeviceptr dx = device(x);
+    CUdeviceptr dy = device(y);
+
+    int   num = n;
+    float a   = 0.5f;
+    void* args[] = { &num, &a, &dx, &dy };
+    check(cuLaunchKernel(f, (n + 127) / 128, 1, 1, 128, 1, 1, 0, NULL, args, NULL) == CUDA_SUCCESS, "axpy launch");
+
+    std::vector<float> r = host<float>(dy, n + 24);
+    bool ok = true;
+    for (int i = 0; i < n; ++i)
+      ok = ok && r[i] == 2.5f * i;
+    for (int i = n; i < n + 24; ++i)
+      ok = ok && r[i] == 0;
+    check(ok, "axpy result");
+
+    int regs;
+    cuFuncGetAttribute(&regs, CU_FUNC_ATTRIBUTE_NUM_REGS, f);
+    check(regs == 5 + 4 + 3 + 6 + 1, "axpy register count");
+
+    cuMemFree(dx);
+    cuMemFree(dy);
+  }
+
+
+  // Conversions, immediates, selp and a loop with a backward branch
+  const char* convert =
+    ".entry function (.param .u64 param0)\n"
+    "{\n"
+    ".reg .f32 f<4>;\n"
+    ".reg .f64 d<3>;\n"
+    ".reg .s32 i<4>;\n"
+    ".reg .u64 l<2>;\n"
+    ".reg .b16 x<1>;\n"
+    ".reg .pred p<2>;\n"
+    "ld.param.u64 l0,[param0];\n"
+    "mov.f32 f0,-2.5e+00;\n"
+    "cvt.rni.s32.f32 i0,f0;\n"             // -2 (ties to even)
+    "st.global.s32 [l0+0],i0;\n"
+    "cvt.rmi.f32.f32 f1,f0;\n"             // -3
+    "cvt.rzi.s32.f32 i1,f1;\n"
+    "st.global.s32 [l0+4],i1;\n"
+    "mov.f32 f2,0f7F800000;\n"             // inf saturates
+    "cvt.rzi.s32.f32 i2,f2;\n"
+    "st.global.s32 [l0+8],i2;\n"
+    "cvt.rn.f16.f32 x0,f0;\n"
+    "st.global.b16 [l0+12],x0;\n"
+    "mov.f64 d0,0d3FF0000000000000;\n"     // sum 1..10 in a loop
+    "mov.f64 d1,0d0000000000000000;\n"
+    "mov.s32 i3,1;\n"
+    "L0:\n"
+    "cvt.rn.f64.s32 d2,i3;\n"
+    "add.f64 d1,d1,d2;\n"
+    "add.s32 i3,i3,1;\n"
+    "setp.le.s32 p0,i3,10;\n"
+    "@p0 bra L0;\n"
+    "st.global.f64 [l0+16],d1;\n"
+    "setp.lt.f32 p1,f0,0f00000000;\n"
+    "selp.s32 i0,7,9,p1;\n"
+    "st.global.s32 [l0+24],i0;\n"
+    "sub.s32 i0,0,1;\n"
+    "shr.b32 i1,i0,28;\n"                  // logical
+    "st.global.s32 [l0+28],i1;\n"
+    "mov.f32 f3,0f7FC00000;\n"             // NaN compares false
+    "setp.eq.f32 p1,f3,f3;\n"
+    "selp.s32 i0,1,0,p1;\n"
+    "st.global.s32 [l0+32],i0;\n"
+    "exit;\n"
+    "}\n";
+
+  void testConvert()
+  {
+    CUfunction f = load(convert);
+    if (!f) return;
+
+    CUdeviceptr d;
+    cuMemAlloc(&d, 40);
+    void* args[] = { &d };
+    check(cuLaunchKernel(f, 1, 1, 1, 1, 1, 1, 0, NULL, args, NULL) == CUDA_SUCCESS, "convert launch");
+
+    std::vector<unsigned char> r = host<unsigned char>(d, 40);
+    int i; unsigned short h; double s; unsigned int u;
+    std::memcpy(&i, &r[0], 4);  check(i == -2, "cvt.rni");
+    std::memcpy(&i, &r[4], 4);  check(i == -3, "cvt.rmi");
+    std::memcpy(&i, &r[8], 4);  check(i == 2147483647, "cvt saturation");
+    std::memcpy(&h, &r[12], 2); check(h == 0xc100, "cvt.rn.f16.f32");
+    std::memcpy(&s, &r[16], 8); check(s == 55.0, "loop");
+    std::memcpy(&i, &r[24], 4); check(i == 7, "selp");
+    std::memcpy(&u, &r[28], 4); check(u == 0xf, "shr.b32");
+    std::memcpy(&i, &r[32], 4); check(i == 0, "NaN compare");
+    cuMemFree(d);
+  }
+
+
+  // Block reduction in shared memory with barriers
+  const char* reduce =
+    ".extern .shared .align 4 .b8 sdata[];\n"
+    ".entry function (.param .u64 param0,.param .u64 param1)\n"
+    "{\n"
+    ".reg .f64 d<3>;\n"
+    ".reg .u32 u<6>;\n"
+    ".reg .u64 l<8>;\n"
+    ".reg .pred p<2>;\n"
+    "ld.param.u64 l0,[param0];\n"
+    "ld.param.u64 l1,[param1];\n"
+    "mov.u32 u0,%tid.x;\n"
+    "mov.u32 u1,%ctaid.x;\n"
+    "mov.u32 u2,%ntid.x;\n"
+    "mad.lo.u32 u3,u1,u2,u0;\n"
+    "mul.wide.u32 l2,u3,8;\n"
+    "add.u64 l2,l0,l2;\n"
+    "ld.global.f64 d0,[l2+0];\n"
+    "mov.u64 l3,sdata;\n"
+    "mul.wide.u32 l4,u0,8;\n"
+    "add.u64 l4,l3,l4;\n"
+    "st.shared.f64 [l4+0],d0;\n"
+    "bar.sync 0;\n"
+    "shr.u32 u4,u2,1;\n"
+    "L1:\n"
+    "setp.eq.u32 p0,u4,0;\n"
+    "@p0 bra L2;\n"
+    "setp.lt.u32 p1,u0,u4;\n"
+    "@!p1 bra L3;\n"
+    "mul.wide.u32 l5,u4,8;\n"
+    "add.u64 l5,l4,l5;\n"
+    "ld.shared.f64 d1,[l5+0];\n"
+    "ld.shared.f64 d2,[l4+0];\n"
+    "add.f64 d2,d2,d1;\n"
+    "st.shared.f64 [l4+0],d2;\n"
+    "L3:\n"
+    "bar.sync 0;\n"
+    "shr.u32 u4,u4,1;\n"
+    "bra L1;\n"
+    "L2:\n"
+    "setp.ne.u32 p0,u0,0;\n"
+    "@p0 exit;\n"
+    "ld.shared.f64 d0,[l3+0];\n"
+    "mul.wide.u32 l6,u1,8;\n"
+    "add.u64 l6,l1,l6;\n"
+    "st.global.f64 [l6+0],d0;\n"
+    "exit;\n"
+    "}\n";
+
+  void testReduce()
+  {
+    CUfunction f = load(reduce);
+    if (!f) return;
+
+    const int threads = 64, blocks = 8;
+    std::vector<double> x(threads * blocks);
+    for (size_t i = 0; i < x.size(); ++i) x[i] = i;
+    CUdeviceptr dx = device(x);
+    CUdeviceptr ds;
+    cuMemAlloc(&ds, blocks * sizeof(double));
+
+    void* args[] = { &dx, &ds };
+    check(cuLaunchKernel(f, blocks, 1, 1, threads, 1, 1, threads * sizeof(double), NULL, args, NULL) == CUDA_SUCCESS, "reduce launch");
+
+    std::vector<double> s = host<double>(ds, blocks);
+    bool ok = true;
+    for (int b = 0; b < blocks; ++b) {
+      double ref = 0;
+      for (int t = 0; t < threads; ++t) ref += b * threads + t;
+      ok = ok && s[b] == ref;
+    }
+    check(ok, "reduce result");
+
+    // Too little shared memory is caught
+    check(cuLaunchKernel(f, blocks, 1, 1, threads, 1, 1, 8, NULL, args, NULL) == CUDA_ERROR_LAUNCH_FAILED, "shared out of bounds");
+    check(cuCtxSynchronize() == CUDA_ERROR_LAUNCH_FAILED, "sticky error");
+    check(cuCtxSynchronize() == CUDA_SUCCESS, "sticky error reported once");
+
+    cuMemFree(dx);
+    cuMemFree(ds);
+  }
+
+
+  void testBounds()
+  {
+    CUfunction f = load(axpy);
+    if (!f) return;
+
+    std::vector<float> x(100, 1.0f), y(100, 1.0f);
+    CUdeviceptr dx = device(x);
+    CUdeviceptr dy = device(y);
+
+    int   num = 101;   // one past the end
+    float a   = 1.0f;
+    void* args[] = { &num, &a, &dx, &dy };
+    check(cuLaunchKernel(f, 1, 1, 1, 128, 1, 1, 0, NULL, args, NULL) == CUDA_ERROR_LAUNCH_FAILED, "global out of bounds");
+    check(ptxEmuLastError().find("out of bounds") != std::string::npos, "error message");
+    cuCtxSynchronize();
+
+    check(cuLaunchKernel(f, 1, 1, 1, 2048, 1, 1, 0, NULL, args, NULL) == CUDA_ERROR_LAUNCH_OUT_OF_RESOURCES, "block too large");
+
+    cuMemFree(dx);
+    cuMemFree(dy);
+  }
+
+
+  void testCounters()
+  {
+    CUfunction f = load(axpy);
+    if (!f) return;
+
+    const int n = 256;
+    std::vector<float> x(n, 1.0f), y(n, 1.0f);
+    CUdeviceptr dx = device(x);
+    CUdeviceptr dy = device(y);
+    int   num = n;
+    float a   = 2.0f;
+    void* args[] = { &num, &a, &dx, &dy };
+
+    ptxEmuSetCounting(true);
+    cuLaunchKernel(f, 2, 1, 1, 128, 1, 1, 0, NULL, args, NULL);
+    cuLaunchKernel(f, 2, 1, 1, 128, 1, 1, 0, NULL, args, NULL);
+    ptxEmuSetCounting(false);
+
+    PTXEmuCounters c;
+    check(ptxEmuGetCounters(f, c), "counters found");
+    check(c.launches == 2, "launches");
+    check(c.threads == 2 * n, "threads");
+    check(c.flops == 2 * 2 * n, "flops");
+    check(c.bytes_loaded == 2 * 8 * n, "bytes loaded");
+    check(c.bytes_stored == 2 * 4 * n, "bytes stored");
+    check(c.instructions == 2 * 20 * n, "instructions");
+
+    std::vector<float> r = host<float>(dy, n);
+    check(r[0] == 5.0f && r[n-1] == 5.0f, "counted launches run");
+
+    cuMemFree(dx);
+    cuMemFree(dy);
+  }
+
+
+  void testParseError()
+  {
+    CUmodule mod;
+    std::string ptx = std::string(header) + ".entry function () { frobnicate.u32 u0; }";
+    check(cuModuleLoadDataEx(&mod, ptx.c_str(), 0, NULL, NULL) == CUDA_ERROR_INVALID_IMAGE, "unknown instruction");
+  }
+}
+
+
+int main(int argc, char **argv)
+{
+  // Once serially and once spread over more workers than blocks per worker
+  for (int threads: { 1, 4 }) {
+    ptxEmuSetThreads(threads);
+    testAxpy();
+    testConvert();
+    testReduce();
+    testBounds();
+    testCounters();
+  }
+  testParseError();
+
+  return summary();
+}
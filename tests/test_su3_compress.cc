@@ -0,0 +1,165 @@
+// Round trips of SU(3) matrices through su3Compress and su3Reconstruct
+// for 12 and 8 reals: random matrices, the unit matrix, diagonal ones and
+// ones close to diagonal, where the 8-real form divides by almost zero.
+// Needs neither QMP nor a lattice.
+
+#include "qdp.h"
+#include "host_check.h"
+
+#include <cmath>
+#include <complex>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace QDP;
+using namespace HostCheck;
+
+namespace {
+  typedef std::complex<double> dcmplx;
+
+  dcmplx get(const double* m, int row, int col)
+  {
+    return dcmplx(m[2*(3*row+col)], m[2*(3*row+col)+1]);
+  }
+
+  void put(double* m, int row, int col, const dcmplx& z)
+  {
+    m[2*(3*row+col)]   = z.real();
+    m[2*(3*row+col)+1] = z.imag();
+  }
+
+  //! Third row from the first two, (a x b)^*
+  void completeRow(double* m)
+  {
+    for (int k = 0; k < 3; ++k) {
+      int i = (k+1) % 3;
+      int j = (k+2) % 3;
+      put(m, 2, k, std::conj(get(m, 0, i) * get(m, 1, j) - get(m, 0, j) * get(m, 1, i)));
+    }
+  }
+
+  //! Random SU(3) matrix, Gram-Schmidt on two gaussian rows
+  void randomSU3(std::mt19937& gen, double* m)
+  {
+    std::normal_distribution<double> g;
+    dcmplx a[3], b[3];
+    for (int k = 0; k < 3; ++k) {
+      a[k] = dcmplx(g(gen), g(gen));
+      b[k] = dcmplx(g(gen), g(gen));
+    }
+    double na = 0;
+    for (int k = 0; k < 3; ++k) na += std::norm(a[k]);
+    for (int k = 0; k < 3; ++k) a[k] /= std::sqrt(na);
+    dcmplx ab = 0;
+    for (int k = 0; k < 3; ++k) ab += std::conj(a[k]) * b[k];
+    for (int k = 0; k < 3; ++k) b[k] -= ab * a[k];
+    double nb = 0;
+    for (int k = 0; k < 3; ++k) nb += std::norm(b[k]);
+    for (int k = 0; k < 3; ++k) b[k] /= std::sqrt(nb);
+    for (int k = 0; k < 3; ++k) {
+      put(m, 0, k, a[k]);
+      put(m, 1, k, b[k]);
+    }
+    completeRow(m);
+  }
+
+  //! diag(e^{i alpha}, e^{i beta}, e^{-i(alpha+beta)})
+  void diagonalSU3(double alpha, double beta, double* m)
+  {
+    for (int k = 0; k < 18; ++k)
+      m[k] = 0.0;
+    put(m, 0, 0, std::polar(1.0, alpha));
+    put(m, 1, 1, std::polar(1.0, beta));
+    put(m, 2, 2, std::polar(1.0, -alpha - beta));
+  }
+
+  //! diag(e^{i phi}) times a rotation by theta in the (1,2) plane: a1 = a2 = 0, b2 != 0
+  void blockSU3(double phi, double theta, double* m)
+  {
+    for (int k = 0; k < 18; ++k)
+      m[k] = 0.0;
+    dcmplx a0 = std::polar(1.0, phi);
+    put(m, 0, 0, a0);
+    put(m, 1, 1, std::conj(a0) * std::cos(theta));
+    put(m, 1, 2, std::conj(a0) * std::sin(theta));
+    completeRow(m);
+  }
+
+  //! Rotation by eps in the (0,1) plane of m, moves m slightly off block diagonal
+  void rotate01(double eps, double* m)
+  {
+    double c = std::cos(eps), s = std::sin(eps);
+    for (int k = 0; k < 3; ++k) {
+      dcmplx x = get(m, 0, k), y = get(m, 1, k);
+      put(m, 0, k, c * x - s * y);
+      put(m, 1, k, s * x + c * y);
+    }
+  }
+
+  double maxDiff(const double* m, const double* n)
+  {
+    double d = 0;
+    for (int k = 0; k < 18; ++k) {
+      if (!std::isfinite(n[k]))
+	return std::numeric_limits<double>::infinity();
+      d = std::max(d, std::fabs(m[k] - n[k]));
+    }
+    return d;
+  }
+
+  //! Whether m survives compression to 'reals' reals stored with precision eps
+  void roundTrip(const std::string& what, const double* m, int reals, double eps, double tol)
+  {
+    double packed[12], back[18];
+    su3Compress(m, reals, packed, eps);
+    su3Reconstruct(packed, reals, back);
+    double d = maxDiff(m, back);
+    std::ostringstream oss;
+    oss << what << " R=" << reals << ": max difference " << d;
+    check(d <= tol, oss.str());
+  }
+}
+
+
+int main()
+{
+  const double eps = std::numeric_limits<double>::epsilon();
+  std::mt19937 gen(4711);
+  double m[18];
+
+  for (int i = 0; i < 100; ++i) {
+    randomSU3(gen, m);
+    roundTrip("random", m, 12, eps, 1e-14);
+    roundTrip("random", m, 8, eps, 1e-10);
+  }
+
+  diagonalSU3(0.0, 0.0, m);
+  roundTrip("unit", m, 12, eps, 0.0);
+  roundTrip("unit", m, 8, eps, 1e-15);
+
+  std::uniform_real_distribution<double> phase(-M_PI, M_PI);
+  for (int i = 0; i < 100; ++i) {
+    diagonalSU3(phase(gen), phase(gen), m);
+    roundTrip("diagonal", m, 8, eps, 1e-15);
+    blockSU3(phase(gen), phase(gen), m);
+    roundTrip("block diagonal", m, 8, eps, 1e-15);
+  }
+
+  // Close to block diagonal: either form, but no loss beyond the bound
+  for (double e = 1e-2; e > 1e-12; e /= 10) {
+    blockSU3(phase(gen), phase(gen), m);
+    rotate01(e, m);
+    std::ostringstream oss;
+    oss << "rotated by " << e;
+    roundTrip(oss.str(), m, 8, eps, 1e-4);
+  }
+
+  // Packed in float precision: the flag is decided by the storage precision
+  diagonalSU3(0.3, -1.1, m);
+  roundTrip("diagonal, float", m, 8, std::numeric_limits<float>::epsilon(), 1e-15);
+
+  return summary();
+}
@@ -0,0 +1,130 @@
+// Checks of the block size search against a simulated kernel timing
+// model. Needs neither QDP_initialize nor a GPU.
+
+#include "qdp_tuner.h"
+#include "host_check.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+
+using namespace QDP;
+using namespace HostCheck;
+
+namespace {
+  //! Kernel time over block size with noise and occasional stalls
+  struct Model {
+    int    optimum;       // fastest block size
+    int    limit;         // launches above this run out of resources
+    double noise;         // relative gaussian noise
+    double stall_rate;    // probability of a 5x slower launch
+    std::mt19937 rng;
+
+    Model(int optimum, int limit, double noise, double stall_rate, unsigned seed):
+      optimum(optimum), limit(limit), noise(noise), stall_rate(stall_rate), rng(seed) {}
+
+    double ideal(int b) const {
+      double x = (double)(b - optimum) / optimum;
+      double t = 100.0 * (1.0 + 2.0 * x * x);
+      if (b < 32)
+	t *= 32.0 / b;     // partially filled warps
+      return t;
+    }
+
+    double sample(int b) {
+      std::normal_distribution<double> g(0.0, noise);
+      std::uniform_real_distribution<double> u(0.0, 1.0);
+      double t = ideal(b) * (1.0 + g(rng));
+      if (u(rng) < stall_rate)
+	t *= 5.0;
+      return t;
+    }
+  };
+
+  //! Drive the tuner like jit_launch does
+  int tune(BlockSizeTuner& t, Model& m)
+  {
+    int guard = 0;
+    while (!t.settled() && guard++ < 10000) {
+      int b = t.next();
+      if (b == 0)
+	break;
+      if (b > m.limit)
+	t.failed();
+      else
+	t.report(m.sample(b));
+    }
+    return t.best();
+  }
+
+  void testRobustMean()
+  {
+    std::vector<double> v = { 1.0, 1.0, 1.0, 1.0, 100.0 };
+    check(BlockSizeTuner::robustMean(v) == 1.0, "robust mean drops outlier");
+    std::vector<double> w = { 1.0, 2.0, 3.0 };
+    check(std::fabs(BlockSizeTuner::robustMean(w) - 2.0) < 1e-12, "robust mean keeps spread");
+  }
+
+  void testFindsWarpMultiple()
+  {
+    // 384 is not a power of two, the second pass has to find it
+    int ok = 0, trials = 50, max_launches = 0;
+    for (int i = 0; i < trials; ++i) {
+      Model m(384, 1024, 0.02, 0.05, 1234 + i);
+      BlockSizeTuner t(1024, 1 << 20);
+      int b = tune(t, m);
+      if (m.ideal(b) <= 1.02 * m.ideal(384))
+	ok++;
+      max_launches = std::max(max_launches, t.launches());
+    }
+    check(ok == trials, "noisy model: best block within 2% of optimum");
+    check(max_launches < 150, "bounded number of tuning launches");
+  }
+
+  void testOutOfResources()
+  {
+    Model m(512, 256, 0.02, 0.0, 7);
+    BlockSizeTuner t(1024, 1 << 20);
+    int b = tune(t, m);
+    check(t.settled(), "settles when large blocks fail");
+    check(b > 0 && b <= 256, "never picks a failing block size");
+    check(b == 256, "picks the largest block that runs");
+  }
+
+  void testAllFail()
+  {
+    Model m(128, 0, 0.0, 0.0, 1);
+    BlockSizeTuner t(1024, 1 << 20);
+    int b = tune(t, m);
+    check(t.settled() && b == 0, "reports failure when nothing runs");
+  }
+
+  void testSmallThreadCount()
+  {
+    Model m(384, 1024, 0.0, 0.0, 3);
+    BlockSizeTuner t(1024, 20);
+    int b = tune(t, m);
+    check(b > 0 && b <= 32, "block size bounded by thread count");
+  }
+
+  void testSingleSampleWarmup()
+  {
+    Model m(128, 1024, 0.0, 0.0, 5);
+    BlockSizeTuner t(1024, 1 << 20, 1);
+    t.report(1.0e9);   // cold launch, discarded
+    int b = tune(t, m);
+    check(b == 128, "warm-up launch is not scored");
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testRobustMean();
+  testFindsWarpMultiple();
+  testOutOfResources();
+  testAllFail();
+  testSmallThreadCount();
+  testSingleSampleWarmup();
+
+  return summary();
+}
@@ -0,0 +1,181 @@
+// Timings of the scalarsite BLAS1, gamma_5 and SU(3) kernels on the
+// generic, AVX2 and AVX-512 paths and on the SSE kernels they replace.
+// The SSE sources are linked into this program (see Makefile.am), the
+// library built with AVX does not have them. Needs neither QDP_initialize
+// nor a lattice.
+//
+// Usage: time_avx_blas [sites] [seconds per kernel]
+
+#include "qdp_precision.h"
+#include "scalarsite_avx/avx_dispatch.h"
+#include "scalarsite_avx/avx_blas_double.h"
+#include "scalarsite_avx/avx_linalg_su3_double.h"
+#include "scalarsite_avx/avx_blas_g5.h"
+
+#include "scalarsite_sse/sse_blas_vaxpy4_double.h"
+#include "scalarsite_sse/sse_blas_vaxpbyz4_double.h"
+#include "scalarsite_sse/sse_blas_vscal4_double.h"
+#include "scalarsite_sse/sse_blas_local_sumsq_double.h"
+#include "scalarsite_sse/sse_blas_local_vcdot_double.h"
+#include "scalarsite_sse/sse_linalg_mm_su3_double.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <vector>
+
+using namespace QDP;
+
+namespace {
+  int    sites   = 1 << 14;
+  double seconds = 0.2;
+
+  // 64 byte aligned buffer of n numbers, as the SSE kernels need 16
+  template<typename T>
+  struct Buffer {
+    T* p;
+    explicit Buffer(size_t n) {
+      if (posix_memalign((void**)&p, 64, n * sizeof(T)))
+	abort();
+      std::mt19937 rng(n);
+      std::uniform_real_distribution<double> u(-1.0, 1.0);
+      for (size_t i = 0; i < n; ++i)
+	p[i] = u(rng);
+    }
+    ~Buffer() { free(p); }
+  };
+
+  // Best rate in GB/s of repeated calls, given the bytes moved per call
+  double rate(const std::function<void()>& f, double bytes)
+  {
+    typedef std::chrono::steady_clock Clock;
+    f();
+    double best = 1e30, total = 0.0;
+    while (total < seconds) {
+      Clock::time_point t0 = Clock::now();
+      f();
+      double t = std::chrono::duration<double>(Clock::now() - t0).count();
+      best = std::min(best, t);
+      total += t;
+    }
+    return bytes / best * 1e-9;
+  }
+
+  struct Kernel {
+    const char* name;
+    double bytes;
+    std::function<void()> f;
+  };
+
+  void report(const char* group, const std::vector<Kernel>& kernels,
+	      const std::vector<Kernel>& sse)
+  {
+    AVX::Isa best = AVX::detectedIsa();
+
+    printf("\n%-22s %10s %10s %10s %10s   [GB/s]\n", group, "generic", "avx2", "avx512", "sse");
+    for (size_t k = 0; k < kernels.size(); ++k) {
+      printf("%-22s", kernels[k].name);
+      for (int i = AVX::Generic; i <= AVX::AVX512; ++i) {
+	if (i > best) {
+	  printf(" %10s", "-");
+	  continue;
+	}
+	AVX::setIsa((AVX::Isa)i);
+	printf(" %10.2f", rate(kernels[k].f, kernels[k].bytes));
+      }
+      if (k < sse.size() && sse[k].f)
+	printf(" %10.2f", rate(sse[k].f, sse[k].bytes));
+      else
+	printf(" %10s", "-");
+      printf("\n");
+    }
+    AVX::setIsa(best);
+  }
+
+  void timeBlas()
+  {
+    const int n = 24 * sites;
+    const double v = n * sizeof(double);
+    Buffer<double> x(n), y(n), z(n);
+    double a = 0.5, b = -0.25, s[2];
+
+    std::vector<Kernel> k = {
+      { "vaxpy4",      3*v, [&]{ AVX::vaxpy4(y.p, &a, x.p, sites); } },
+      { "vaxpbyz4",    3*v, [&]{ AVX::vaxpbyz4(z.p, &a, x.p, &b, y.p, sites); } },
+      { "vscal4",      2*v, [&]{ AVX::vscal4(z.p, &a, x.p, sites); } },
+      { "local_sumsq4",  v, [&]{ AVX::local_sumsq4(s, x.p, sites); } },
+      { "local_vcdot4",2*v, [&]{ AVX::local_vcdot4(s, y.p, x.p, sites); } },
+    };
+    std::vector<Kernel> sse = {
+      { "vaxpy4",      3*v, [&]{ vaxpy4(y.p, &a, x.p, sites); } },
+      { "vaxpbyz4",    3*v, [&]{ vaxpbyz4(z.p, &a, x.p, &b, y.p, sites); } },
+      { "vscal4",      2*v, [&]{ vscal4(z.p, &a, x.p, sites); } },
+      { "local_sumsq4",  v, [&]{ local_sumsq4(s, x.p, sites); } },
+      { "local_vcdot4",2*v, [&]{ local_vcdot4(s, y.p, x.p, sites); } },
+    };
+    report("BLAS1 double", k, sse);
+  }
+
+  template<typename T>
+  void timeG5(const char* group)
+  {
+    const int n = 24 * sites;
+    const double v = n * sizeof(T);
+    Buffer<T> x(n), y(n), z(n);
+    T a = 0.5, b = -0.25;
+
+    std::vector<Kernel> k = {
+      { "axpyz_g5ProjPlus",  3*v, [&]{ AVX::axpyz_g5ProjPlus(z.p, &a, x.p, y.p, sites); } },
+      { "xmayz_g5ProjMinus", 3*v, [&]{ AVX::xmayz_g5ProjMinus(z.p, &a, y.p, x.p, sites); } },
+      { "scal_g5",           2*v, [&]{ AVX::scal_g5(z.p, &a, x.p, sites); } },
+      { "axpbyz_g5",         3*v, [&]{ AVX::axpbyz_g5(z.p, &a, x.p, &b, y.p, sites); } },
+      { "axpbyz_ig5",        3*v, [&]{ AVX::axpbyz_ig5(z.p, &a, x.p, &b, y.p, sites); } },
+    };
+    report(group, k, std::vector<Kernel>());
+  }
+
+  void timeSU3()
+  {
+    const double m = 18 * sizeof(double);
+    Buffer<double> m1(18 * sites), m2(18 * sites), m3(18 * sites);
+    Buffer<double> v1(24 * sites), v2(24 * sites);
+    double a = 0.5;
+
+    std::vector<Kernel> k = {
+      { "m_eq_mm",   3*m*sites, [&]{ AVX::m_eq_mm(m3.p, m1.p, m2.p, sites); } },
+      { "m_eq_mh",   3*m*sites, [&]{ AVX::m_eq_mh(m3.p, m1.p, m2.p, sites); } },
+      { "m_peq_ahm", 4*m*sites, [&]{ AVX::m_peq_ahm(m3.p, &a, m1.p, m2.p, sites); } },
+      { "M*D",       (m + 48*sizeof(double))*sites, [&]{
+	  for (int s = 0; s < sites; ++s)
+	    AVX::mult_su3_mat_vec(v2.p + 24*s, m1.p + 18*s, v1.p + 24*s, 4); } },
+      { "adj(M)*D",  (m + 48*sizeof(double))*sites, [&]{
+	  for (int s = 0; s < sites; ++s)
+	    AVX::mult_adj_su3_mat_vec(v2.p + 24*s, m1.p + 18*s, v1.p + 24*s, 4); } },
+    };
+    std::vector<Kernel> sse = {
+      { "m_eq_mm",   3*m*sites, [&]{ ssed_m_eq_mm(m3.p, m1.p, m2.p, sites); } },
+      { "m_eq_mh",   3*m*sites, [&]{ ssed_m_eq_mh(m3.p, m1.p, m2.p, sites); } },
+      { "m_peq_ahm", 4*m*sites, [&]{ ssed_m_peq_ahm(m3.p, &a, m1.p, m2.p, sites); } },
+    };
+    report("SU(3) double", k, sse);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1)
+    sites = atoi(argv[1]);
+  if (argc > 2)
+    seconds = atof(argv[2]);
+
+  printf("%d sites, best of %g s per kernel, CPU supports %s\n",
+	 sites, seconds, AVX::isaName(AVX::detectedIsa()));
+  timeBlas();
+  timeG5<REAL32>("gamma_5 single");
+  timeG5<REAL64>("gamma_5 double");
+  timeSU3();
+
+  return 0;
+}
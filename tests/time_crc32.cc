@@ -0,0 +1,120 @@
+// Timings of the checksum and byte-swap paths of BinaryWriter and
+// BinaryReader: the former byte-at-a-time crc32 and swap in place, swap
+// back, against the sliced crc32 and the fused byte_swap_crc32, on one
+// host worker and on all of them. Needs neither QDP_initialize nor a
+// lattice.
+//
+// Usage: time_crc32 [MB] [seconds per kernel]
+
+#include "qdp_byteorder.h"
+#include "qdp_host_threads.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <vector>
+
+using namespace QDPUtil;
+
+namespace {
+  size_t bytes   = 64 << 20;
+  double seconds = 0.5;
+
+  // Best rate in GB/s of repeated calls
+  double rate(const std::function<void()>& f)
+  {
+    typedef std::chrono::steady_clock Clock;
+    f();
+    double best = 1e30, total = 0.0;
+    while (total < seconds) {
+      Clock::time_point t0 = Clock::now();
+      f();
+      double t = std::chrono::duration<double>(Clock::now() - t0).count();
+      best = std::min(best, t);
+      total += t;
+    }
+    return bytes / best * 1e-9;
+  }
+
+  //! The former crc32: one table lookup per byte
+  struct ByteTable {
+    n_uint32_t t[256];
+    ByteTable() {
+      for (n_uint32_t n = 0; n < 256; ++n) {
+	n_uint32_t c = n;
+	for (int k = 0; k < 8; ++k)
+	  c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+	t[n] = c;
+      }
+    }
+    n_uint32_t crc(n_uint32_t crc, const unsigned char* buf, size_t len) const {
+      crc = ~crc;
+      while (len--)
+	crc = t[(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+      return ~crc;
+    }
+  };
+
+  //! The former byte swap of 8 byte words: through a char array
+  void oldSwap8(void* ptr, size_t nmemb)
+  {
+    char* p = (char*)ptr;
+    for (size_t j = 0; j < nmemb; ++j, p += 8) {
+      char c[8];
+      for (int k = 0; k < 8; ++k) c[k] = p[k];
+      for (int k = 0; k < 8; ++k) p[k] = c[7 - k];
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1)
+    bytes = (size_t)atoi(argv[1]) << 20;
+  if (argc > 2)
+    seconds = atof(argv[2]);
+
+  const int maxw = QDP::hostThreadsGetCount();
+  printf("%zu MB of doubles, best of %g s per kernel, %d host workers\n", bytes >> 20, seconds, maxw);
+
+  std::vector<unsigned char> data(bytes), staging(bytes);
+  std::mt19937 rng(1);
+  for (auto& b : data)
+    b = rng();
+
+  ByteTable table;
+  const size_t nmemb = bytes / 8;
+  volatile n_uint32_t sink = 0;
+
+  printf("\n%-34s %10s %10s   [GB/s]\n", "", "1 worker", "all");
+  auto row = [&](const char* name, const std::function<void()>& f) {
+    QDP::hostThreadsSetCount(1);
+    double one = rate(f);
+    QDP::hostThreadsSetCount(maxw);
+    printf("%-34s %10.2f %10.2f\n", name, one, rate(f));
+  };
+
+  row("crc32 byte at a time", [&]{ sink = table.crc(0, data.data(), bytes); });
+  row("crc32 slicing-by-16", [&]{ sink = crc32(0, data.data(), bytes); });
+  row("byte_swap old", [&]{ oldSwap8(data.data(), nmemb); });
+  row("byte_swap", [&]{ byte_swap(data.data(), 8, nmemb); });
+  row("write: swap, crc32, swap back old", [&]{
+      oldSwap8(data.data(), nmemb);
+      sink = table.crc(0, data.data(), bytes);
+      oldSwap8(data.data(), nmemb);
+    });
+  row("write: byte_swap_crc32 to staging", [&]{
+      sink = byte_swap_crc32(0, staging.data(), data.data(), 8, nmemb, true);
+    });
+  row("read: crc32, swap old", [&]{
+      sink = table.crc(0, data.data(), bytes);
+      oldSwap8(data.data(), nmemb);
+    });
+  row("read: byte_swap_crc32 in place", [&]{
+      sink = byte_swap_crc32(0, data.data(), data.data(), 8, nmemb, false);
+    });
+
+  return 0;
+}